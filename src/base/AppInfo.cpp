@@ -56,6 +56,70 @@ bool AppInfo::ParseAppInfo(Json::Value &root)
         stream_timeout_time = sttObj.asUInt();
     }    
 
+    Json::Value oqbObj = root["out_queue_max_bytes"];
+    if(!oqbObj.isNull())
+    {
+        out_queue_max_bytes = oqbObj.asUInt();
+    }
+    Json::Value oqtObj = root["out_queue_max_time"];
+    if(!oqtObj.isNull())
+    {
+        out_queue_max_time = oqtObj.asUInt();
+    }
+    Json::Value spObj = root["slow_policy"];
+    if(!spObj.isNull())
+    {
+        auto policy = spObj.asString();
+        if(policy == "drop_non_ref")
+        {
+            slow_policy = kSlowConsumerDropNonRef;
+        }
+        else if(policy == "disconnect")
+        {
+            slow_policy = kSlowConsumerDisconnect;
+        }
+        else
+        {
+            slow_policy = kSlowConsumerSkipToKeyframe;
+        }
+    }
+    Json::Value sdtObj = root["slow_disconnect_time"];
+    if(!sdtObj.isNull())
+    {
+        slow_disconnect_time = sdtObj.asUInt();
+    }
+
+    Json::Value lmObj = root["latency_mode"];
+    if(!lmObj.isNull())
+    {
+        latency_mode = lmObj.asString() == "on";
+    }
+    Json::Value nlObj = root["notsent_lowat"];
+    if(!nlObj.isNull())
+    {
+        notsent_lowat = nlObj.asUInt();
+    }
+    Json::Value stObj = root["sndbuf_time"];
+    if(!stObj.isNull())
+    {
+        sndbuf_time = stObj.asUInt();
+    }
+    Json::Value mbgObj = root["memory_budget_mb"];
+    if(!mbgObj.isNull())
+    {
+        memory_budget_mb = mbgObj.asUInt();
+    }
+    Json::Value obbObj = root["out_batch_max_bytes"];
+    if(!obbObj.isNull())
+    {
+        out_batch_max_bytes = obbObj.asUInt();
+    }
+    Json::Value obtObj = root["out_batch_max_time"];
+    if(!obtObj.isNull())
+    {
+        out_batch_max_time = obtObj.asUInt();
+    }
+
     Json::Value pullsObj = root["pull"];
     if(!pullsObj.isNull()&&pullsObj.isArray())
     {
@@ -72,6 +136,16 @@ bool AppInfo::ParseAppInfo(Json::Value &root)
             << " content_latency:" << content_latency
             << " stream_idle_time:"<< stream_idle_time
             << " stream_timeout_time" << stream_timeout_time
+            << " out_queue_max_bytes:" << out_queue_max_bytes
+            << " out_queue_max_time:" << out_queue_max_time
+            << " slow_policy:" << slow_policy
+            << " slow_disconnect_time:" << slow_disconnect_time
+            << " latency_mode:" << latency_mode
+            << " notsent_lowat:" << notsent_lowat
+            << " sndbuf_time:" << sndbuf_time
+            << " memory_budget_mb:" << memory_budget_mb
+            << " out_batch_max_bytes:" << out_batch_max_bytes
+            << " out_batch_max_time:" << out_batch_max_time
             << " rtmp_support:" << rtmp_support
             << " flv_support:" << flv_support
             << " hls_support:" << hls_support;
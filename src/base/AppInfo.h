@@ -13,6 +13,15 @@ namespace tmms
         using TargetPtr = std::shared_ptr<Target>;
 
         class DomainInfo;
+
+        // 播放者跟不上时（输出队列超过字节数或时长上限）的处理策略
+        enum SlowConsumerPolicy
+        {
+            kSlowConsumerDropNonRef = 0,      // 丢弃非参考帧
+            kSlowConsumerSkipToKeyframe = 1,  // 跳到最新的关键帧
+            kSlowConsumerDisconnect = 2,      // 超限持续 slow_disconnect_time 后断开
+        };
+
         class AppInfo
         {
         public:
@@ -30,6 +39,16 @@ namespace tmms
             uint32_t content_latency{3*1000};
             uint32_t stream_idle_time{30*1000};
             uint32_t stream_timeout_time{30*1000};
+            uint32_t out_queue_max_bytes{8*1024*1024};  // 单个播放者积压的最大字节数，0 表示不限
+            uint32_t out_queue_max_time{0};             // 单个播放者积压的最大时长（毫秒），0 表示 2 倍 content_latency
+            SlowConsumerPolicy slow_policy{kSlowConsumerSkipToKeyframe};
+            uint32_t slow_disconnect_time{10*1000};     // disconnect 策略下超限多久后断开（毫秒）
+            bool latency_mode{false};                   // 播放连接的延迟模式：TCP_NOTSENT_LOWAT、按码率的发送缓冲区、内核积压计入输出队列
+            uint32_t notsent_lowat{16*1024};            // 延迟模式下内核里最多积压多少没发出的字节
+            uint32_t sndbuf_time{500};                  // 延迟模式下发送缓冲区装多少毫秒的数据
+            uint32_t memory_budget_mb{0};               // 这个 app 所有流的媒体内存预算（MB），0 表示不限
+            uint32_t out_batch_max_bytes{256*1024};     // 播放者一次取帧的字节上限，落后时按倍数放大，0 表示不限
+            uint32_t out_batch_max_time{200};           // 播放者一次取帧的媒体时长上限（毫秒），落后时按倍数放大，0 表示不限
 
             std::vector<TargetPtr> pulls;
         };
@@ -57,6 +57,62 @@ bool Config::LoadConfig(const std::string &file)
         thread_nums_ = threadsObj.asInt(); // 将"threads"字段赋值给线程数量变量。
     }
 
+    // 解析"poller"字段，表示事件循环使用的 I/O 后端（epoll / io_uring）
+    Json::Value pollerObj = root["poller"];
+    if (!pollerObj.isNull()) 
+    {
+        poller_ = pollerObj.asString(); // 内核不支持 io_uring 时事件循环会回退到 epoll。
+    }
+
+    // 解析"loop_policy"字段，表示新连接和拉流选择事件循环的策略
+    Json::Value policyObj = root["loop_policy"];
+    if (!policyObj.isNull()) 
+    {
+        loop_policy_ = policyObj.asString(); // round_robin、least_loaded 或 p2c。
+    }
+
+    // 解析"busy_poll_us"字段，表示低延迟场景下事件循环睡眠前忙轮询的时间
+    Json::Value busyPollObj = root["busy_poll_us"];
+    if (!busyPollObj.isNull()) 
+    {
+        busy_poll_us_ = busyPollObj.asInt(); // 0 表示关闭。
+    }
+
+    // 解析"placement"字段，表示播放连接留在接受它的循环（accept），还是迁移到会话所在的循环（session）
+    Json::Value placementObj = root["placement"];
+    if (!placementObj.isNull()) 
+    {
+        placement_ = placementObj.asString(); // accept 或 session。
+    }
+
+    // 解析"zerocopy_threshold"字段，表示播放连接中不小于多少字节的媒体数据用 MSG_ZEROCOPY 发送
+    Json::Value zerocopyObj = root["zerocopy_threshold"];
+    if (!zerocopyObj.isNull()) 
+    {
+        zerocopy_threshold_ = zerocopyObj.asInt(); // 0 表示关闭。
+    }
+
+    // 解析"loop_stats"字段，表示是否开启事件循环延迟统计（通过 HTTP /stats 查看）
+    Json::Value loopStatsObj = root["loop_stats"];
+    if (!loopStatsObj.isNull()) 
+    {
+        loop_stats_ = loopStatsObj.asBool(); // 默认关闭。
+    }
+
+    // 解析"packet_pool_huge_pages"字段，表示包内存池是否从大页 arena 分配小块
+    Json::Value hugePagesObj = root["packet_pool_huge_pages"];
+    if (!hugePagesObj.isNull()) 
+    {
+        packet_pool_huge_pages_ = hugePagesObj.asBool(); // 默认关闭。
+    }
+
+    // 解析"memory_budget_mb"字段，表示全进程媒体数据（GOP 缓存、编码头、HLS 分片、播放队列）的内存预算
+    Json::Value memoryBudgetObj = root["memory_budget_mb"];
+    if (!memoryBudgetObj.isNull()) 
+    {
+        memory_budget_mb_ = memoryBudgetObj.asUInt(); // 默认 0，不限。
+    }
+
     // 解析"Log"字段，加载日志配置信息
     Json::Value logObj = root["log"];
     if (!logObj.isNull()) 
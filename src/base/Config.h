@@ -84,6 +84,14 @@ namespace tmms                    // 定义命名空间 tmms (Namespace for the
             int32_t cpu_start_{0};      // CPU 起始编号 (Starting CPU number).
             int32_t thread_nums_{1};    // 线程数量，默认 1 (Number of threads, default 1).
             int32_t cpus_{1};           // CPU 核数，默认 1 (Number of CPUs, default 1).
+            std::string poller_{"epoll"}; // I/O 后端，epoll 或 io_uring (I/O backend: epoll or io_uring).
+            std::string loop_policy_{"round_robin"}; // 事件循环选择策略 round_robin / least_loaded / p2c (Loop selection policy).
+            int32_t busy_poll_us_{0};   // 事件循环忙轮询窗口，微秒，0 表示关闭 (Loop busy-poll window in microseconds, 0 disables it).
+            std::string placement_{"accept"}; // 播放者放置方式 accept / session (Player placement: stay on the accepting loop, or move to the session's loop).
+            bool loop_stats_{false};
+            int32_t zerocopy_threshold_{0}; // 播放连接 MSG_ZEROCOPY 发送的最小块大小，0 表示关闭 (Minimum payload size for MSG_ZEROCOPY sends to players, 0 disables it).    // 是否开启事件循环延迟统计 (Whether loop latency statistics are collected).
+            bool packet_pool_huge_pages_{false}; // 包内存池是否用大页 arena (Whether the packet pool carves blocks from huge-page arenas).
+            uint32_t memory_budget_mb_{0};  // 全进程媒体内存预算，MB，0 表示不限 (Process-wide media memory budget in MB, 0 means unlimited).
 
         private:
             bool ParseDirectory(const Json::Value &root);
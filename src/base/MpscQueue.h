@@ -0,0 +1,123 @@
+#pragma once
+// 防止头文件被重复包含
+// Prevents this header file from being included multiple times.
+
+#include "NonCopyable.h"   // 禁止拷贝 (Non-copyable base class)
+#include <atomic>          // 原子变量，实现无锁同步 (Atomics for lock-free synchronization)
+#include <vector>          // 存储环形队列的槽位 (Storage for ring slots)
+#include <cstddef>         // size_t
+#include <cstdint>         // intptr_t
+#include <utility>         // std::move
+
+namespace tmms
+{
+    namespace base
+    {
+        // 有界无锁多生产者单消费者队列 (Bounded lock-free multi-producer single-consumer queue)
+        // 基于 Vyukov 的有界队列：每个槽位带一个序号，生产者通过 CAS 抢占写位置，
+        // 消费者只有一个，读位置只由消费者推进，不需要 CAS。
+        // Based on Vyukov's bounded queue: every slot carries a sequence number, producers
+        // claim a write position with a CAS, and the single consumer alone advances the read position.
+        // 容量会向上取整为 2 的幂 (Capacity is rounded up to a power of two).
+        template <typename T>
+        class MpscQueue : public NonCopyable
+        {
+        public:
+            explicit MpscQueue(size_t capacity)
+            :mask_(RoundUp(capacity) - 1),cells_(mask_ + 1)
+            {
+                for(size_t i = 0; i <= mask_; i++)
+                {
+                    cells_[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+            ~MpscQueue() = default;
+
+            // 生产者入队，队列满时返回 false (Producer side; returns false when the ring is full)
+            bool TryPush(T &&value)
+            {
+                Cell *cell = nullptr;
+                size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+                while(true)
+                {
+                    cell = &cells_[pos & mask_];
+                    size_t seq = cell->sequence.load(std::memory_order_acquire);
+                    intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                    if(diff == 0)
+                    {
+                        if(enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        {
+                            break;
+                        }
+                    }
+                    else if(diff < 0)
+                    {
+                        return false; // 槽位还没被消费，队列已满 (slot not consumed yet, ring is full)
+                    }
+                    else
+                    {
+                        pos = enqueue_pos_.load(std::memory_order_relaxed);
+                    }
+                }
+                cell->data = std::move(value);
+                cell->sequence.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+
+            // 消费者出队，只能在单一线程调用 (Consumer side; must only be called from one thread)
+            bool TryPop(T &value)
+            {
+                size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+                Cell *cell = &cells_[pos & mask_];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                if((intptr_t)seq - (intptr_t)(pos + 1) < 0)
+                {
+                    return false; // 队列为空 (the ring is empty)
+                }
+                value = std::move(cell->data);
+                cell->data = T();
+                cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+                dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+                return true;
+            }
+
+            // 近似的元素数量，仅用于统计 (Approximate size, for statistics only)
+            size_t SizeApprox() const
+            {
+                size_t head = enqueue_pos_.load(std::memory_order_relaxed);
+                size_t tail = dequeue_pos_.load(std::memory_order_relaxed);
+                return head >= tail ? head - tail : 0;
+            }
+
+            size_t Capacity() const
+            {
+                return mask_ + 1;
+            }
+
+        private:
+            static size_t RoundUp(size_t n)
+            {
+                size_t cap = 2;
+                while(cap < n)
+                {
+                    cap <<= 1;
+                }
+                return cap;
+            }
+
+            struct Cell
+            {
+                std::atomic<size_t> sequence{0};
+                T data;
+            };
+
+            const size_t mask_;
+            std::vector<Cell> cells_;
+            // 生产者竞争的写位置，单独一个 cache line，避免和消费者的读位置伪共享
+            // Write position contended by producers, kept on its own cache line to avoid
+            // false sharing with the consumer's read position.
+            alignas(64) std::atomic<size_t> enqueue_pos_{0};
+            alignas(64) std::atomic<size_t> dequeue_pos_{0};
+        };
+    }
+}
@@ -15,6 +15,8 @@
 #include "live/WebrtcService.h"
 #include "mmedia/webrtc/WebrtcServer.h"
 #include "mmedia/webrtc/Srtp.h"
+#include "mmedia/base/PacketPool.h"
+#include "json/json.h"
 
 using namespace tmms::live;
 using namespace tmms::mm;
@@ -25,55 +27,33 @@ namespace
 }
 SessionPtr LiveService::CreateSession(const std::string &session_name)
 {
-    std::lock_guard<std::mutex> lk(lock_);
-    auto iter = sessions_.find(session_name);
-    if(iter != sessions_.end())
-    {
-        return iter->second;
-    }
-
-    auto list = base::StringUtils::SplitString(session_name,"/");
-    if(list.size() != 3)
-    {
-        LIVE_ERROR << "create session failed. Invalid session name:" << session_name;
-        return session_null;
-    }
-    ConfigPtr config = sConfigMgr->GetConfig();
-    auto app_info = config->GetAppInfo(list[0],list[1]);
-    if(!app_info)
-    {
-        LIVE_ERROR << "create session failed. cant found config. domain:" << list[0] << " app:" << list[1];
-        return session_null;
-    }
-    auto s = std::make_shared<Session>(session_name);
-    s->SetAppInfo(app_info);
-
-    sessions_.emplace(session_name,s);
-    LIVE_DEBUG << "create session success. session_name:" << session_name << " now:" << base::TTime::NowMS();
-    return s;
+    return sessions_.FindOrCreate(session_name,[&session_name]() -> SessionPtr {
+        auto list = base::StringUtils::SplitString(session_name,"/");
+        if(list.size() != 3)
+        {
+            LIVE_ERROR << "create session failed. Invalid session name:" << session_name;
+            return session_null;
+        }
+        ConfigPtr config = sConfigMgr->GetConfig();
+        auto app_info = config->GetAppInfo(list[0],list[1]);
+        if(!app_info)
+        {
+            LIVE_ERROR << "create session failed. cant found config. domain:" << list[0] << " app:" << list[1];
+            return session_null;
+        }
+        auto s = std::make_shared<Session>(session_name);
+        s->SetAppInfo(app_info);
+        LIVE_DEBUG << "create session success. session_name:" << session_name << " now:" << base::TTime::NowMS();
+        return s;
+    });
 }
 SessionPtr LiveService::FindSession(const std::string &session_name)
 {
-    std::lock_guard<std::mutex> lk(lock_);
-    auto iter = sessions_.find(session_name);
-    if(iter != sessions_.end())
-    {
-        return iter->second;
-    }
-    return session_null;
+    return sessions_.Find(session_name);
 }
 bool LiveService::CloseSession(const std::string &session_name)
 {
-    SessionPtr s;
-    {
-        std::lock_guard<std::mutex> lk(lock_);
-        auto iter = sessions_.find(session_name);
-        if(iter != sessions_.end())
-        {
-            s = iter->second;
-            sessions_.erase(iter);
-        }
-    }
+    auto s = sessions_.Remove(session_name);
     if(s)
     {
         LIVE_INFO << " close session:" << s->SessionName()  << " now:" << base::TTime::NowMS();
@@ -83,23 +63,27 @@ bool LiveService::CloseSession(const std::string &session_name)
 }
 void LiveService::OnTimer(const TaskPtr &t)
 {
-    std::lock_guard<std::mutex> lk(lock_);
-    for(auto iter = sessions_.begin();iter != sessions_.end();)
+    // 超时检查在注册表的锁外做，一次只锁一个分片 (timeouts are checked outside the registry locks, one shard at a time)
+    std::vector<SessionPtr> expired;
+    sessions_.Expire([](const SessionPtr &s){
+        return s->IsTimeout();
+    },expired);
+    for(auto &s : expired)
     {
-        if(iter->second->IsTimeout())
-        {
-            LIVE_INFO << "session:" << iter->second->SessionName() 
-                    << " is timeout. close it. Now:" << base::TTime::NowMS();
-            iter->second->Clear();
-            iter = sessions_.erase(iter);
-        }
-        else
-        {
-            iter ++;
-        }
+        LIVE_INFO << "session:" << s->SessionName() 
+                << " is timeout. close it. Now:" << base::TTime::NowMS();
+        s->Clear();
     }
     t->Restart();
 }
+void LiveService::OnMemoryTimer(const TaskPtr &t)
+{
+    std::vector<SessionPtr> sessions;
+    sessions_.Snapshot(sessions);
+    // 统计和裁剪要拿会话和流的锁，不在注册表的锁里做
+    memory_governor_.Check(sessions);
+    t->Restart();
+}
 
 void LiveService::OnNewConnection(const TcpConnectionPtr &conn)
 {
@@ -151,7 +135,7 @@ bool LiveService::OnPlay(const TcpConnectionPtr &conn,
         return false;
     }     
     conn->SetContext(kUserContext,user);     
-    s->AddPlayer(std::dynamic_pointer_cast<PlayerUser>(user));
+    AddPlayer(s,conn,std::dynamic_pointer_cast<PlayerUser>(user));
     return true;     
 }
 bool LiveService::OnPublish(const TcpConnectionPtr &conn,
@@ -222,6 +206,19 @@ void LiveService::OnRequest(const TcpConnectionPtr &conn,const HttpRequestPtr &r
         LIVE_DEBUG << h.first << ":" << h.second;
     }
     
+    if(req->IsRequest() && req->Path() == "/stats")
+    {
+        auto content = GetLoopStats();
+        auto res = std::make_shared<HttpRequest>(false);
+        res->SetStatusCode(200);
+        res->AddHeader("server","tmms");
+        res->AddHeader("content-length",std::to_string(content.size()));
+        res->AddHeader("content-type","application/json");
+        res->AddHeader("Connection","close");
+        res->SetBody(content);
+        http_cxt->PostRequest(res);
+        return ;
+    }
     if(req->IsRequest())
     {
         //http://ip:port/domain/app/stream.flv
@@ -275,7 +272,7 @@ void LiveService::OnRequest(const TcpConnectionPtr &conn,const HttpRequestPtr &r
             conn->SetContext(kUserContext,user);
             auto flv = std::make_shared<FlvContext>(conn,this);
             conn->SetContext(kFlvContext,flv);
-            s->AddPlayer(std::dynamic_pointer_cast<PlayerUser>(user));     
+            AddPlayer(s,conn,std::dynamic_pointer_cast<PlayerUser>(user));     
         }
         else if(ext == "m3u8")
         {
@@ -317,7 +314,13 @@ void LiveService::OnRequest(const TcpConnectionPtr &conn,const HttpRequestPtr &r
 void LiveService::Start()
 {
     ConfigPtr config = sConfigMgr->GetConfig();
+    Poller::SetDefaultType(config->poller_); // 事件循环创建前选好 I/O 后端
     pool_ = new EventLoopThreadPool(config->thread_nums_,config->cpu_start_,config->cpus_);
+    pool_->SetPolicy(config->loop_policy_); // 拉流等按负载选择事件循环
+    session_placement_ = config->placement_ == "session"; // 播放者迁移到会话所在的循环
+    zerocopy_threshold_ = config->zerocopy_threshold_ > 0 ? config->zerocopy_threshold_ : 0;
+    PacketPool::EnableHugePages(config->packet_pool_huge_pages_); // 在第一个包分配之前
+    memory_governor_.SetProcessBudget((int64_t)config->memory_budget_mb_ * 1024 * 1024);
     pool_->Start();
 
     sDnsService->Start();
@@ -327,6 +330,20 @@ void LiveService::Start()
     LIVE_TRACE << "eventloops size:" << eventloops.size();
     for(auto &el:eventloops)
     {
+        if(config->busy_poll_us_ > 0)
+        {
+            el->SetBusyPoll(config->busy_poll_us_);
+        }
+        if(config->loop_stats_)
+        {
+            el->EnableStats(true);
+        }
+        // 每秒收回别的循环替本循环释放的包引用，交还跨线程释放的包内存
+        // Once a second, settle packet references other loops released for this one and hand back cross-thread frees
+        el->RunEvery(1.0,[](){
+            Packet::ReclaimDeferred();
+            PacketPool::Flush();
+        });
         for(auto &s:services)
         {
             if(s->protocol == "RTMP"||s->protocol == "rtmp")
@@ -371,6 +388,8 @@ void LiveService::Start()
     
     TaskPtr t = std::make_shared<Task>(std::bind(&LiveService::OnTimer,this,std::placeholders::_1),5000);
     sTaskMgr->Add(t);
+    TaskPtr memory = std::make_shared<Task>(std::bind(&LiveService::OnMemoryTimer,this,std::placeholders::_1),1000);
+    sTaskMgr->Add(memory);
 }
 
 void LiveService::Stop()
@@ -381,4 +400,159 @@ EventLoop *LiveService::GetNextLoop()
 {
     return pool_->GetNextLoop();
 }
+EventLoop *LiveService::GetNextLoop(Session &session)
+{
+    if(session_placement_)
+    {
+        EventLoop *home = session.HomeLoop();
+        if(home)
+        {
+            return home;
+        }
+    }
+    return pool_->GetNextLoop();
+}
+void LiveService::AddPlayer(const SessionPtr &s, const TcpConnectionPtr &conn, const PlayerUserPtr &user)
+{
+    if(zerocopy_threshold_ > 0)
+    {
+        conn->EnableZeroCopy(zerocopy_threshold_); // 大块媒体数据不拷贝进内核
+    }
+    auto &app_info = user->GetAppInfo();
+    if(app_info && app_info->out_queue_max_bytes > 0)
+    {
+        // 慢播放者由 Stream 按策略处理，这里的硬上限只兜底，所以放宽一倍
+        conn->SetMaxPendingBytes(2 * (size_t)app_info->out_queue_max_bytes);
+    }
+    if(app_info && app_info->latency_mode)
+    {
+        conn->EnableLatencyMode(app_info->notsent_lowat);
+    }
+    if(!session_placement_)
+    {
+        s->AddPlayer(user);
+        return;
+    }
+    // 迁移完成后才加入会话，迁移之前推流端不会给这个连接投递任何任务
+    // The player joins the session only after the move, so the publisher never posts to it mid-move.
+    EventLoop *target = s->PickPlayerLoop(conn->Loop(),pool_);
+    conn->MoveToLoop(target,[s,user](const TcpConnectionPtr &c, bool moved){
+        if(!moved)
+        {
+            // 迁移途中连接关了，播放者没有加入会话，在这里关掉 (the connection closed mid-move; the player never joined, close it here)
+            LIVE_DEBUG << "player connection closed while moving to its session loop. session name:" << s->SessionName()
+                    << ",user:" << user->UserId();
+            s->CloseUser(user);
+            return;
+        }
+        s->AddPlayer(user);
+    });
+}
 
+namespace
+{
+    Json::Value HistogramToJson(const Log2Histogram &h)
+    {
+        Json::Value v;
+        uint64_t count = h.Count();
+        v["count"] = (Json::UInt64)count;
+        v["avg"] = (Json::UInt64)(count > 0 ? h.Sum() / count : 0);
+        v["p50"] = (Json::UInt64)h.Percentile(0.5);
+        v["p99"] = (Json::UInt64)h.Percentile(0.99);
+        v["max"] = (Json::UInt64)h.Max();
+        Json::Value buckets(Json::arrayValue);
+        for(int i = 0; i < Log2Histogram::kBuckets; i++)
+        {
+            uint64_t n = h.Bucket(i);
+            if(n > 0) // 只输出非空桶，le 是桶上界 (only non-empty buckets; le is the bucket upper bound)
+            {
+                Json::Value b;
+                b["le"] = (Json::UInt64)Log2Histogram::BucketLimit(i);
+                b["count"] = (Json::UInt64)n;
+                buckets.append(b);
+            }
+        }
+        v["buckets"] = buckets;
+        return v;
+    }
+}
+
+std::string LiveService::GetLoopStats() const
+{
+    Json::Value root;
+    uint64_t local = local_activations_.load(std::memory_order_relaxed);
+    uint64_t cross = cross_activations_.load(std::memory_order_relaxed);
+    root["placement"] = session_placement_ ? "session" : "accept";
+    root["local_activations"] = (Json::UInt64)local;
+    root["cross_activations"] = (Json::UInt64)cross;
+    root["cross_activation_ratio"] = local + cross > 0 ? (double)cross / (local + cross) : 0.0;
+    Json::Value slow;
+    slow["dropped_frames"] = (Json::UInt64)dropped_frames_.load(std::memory_order_relaxed);
+    slow["dropped_bytes"] = (Json::UInt64)dropped_bytes_.load(std::memory_order_relaxed);
+    slow["keyframe_skips"] = (Json::UInt64)keyframe_skips_.load(std::memory_order_relaxed);
+    slow["skipped_frames"] = (Json::UInt64)skipped_frames_.load(std::memory_order_relaxed);
+    slow["skipped_bytes"] = (Json::UInt64)skipped_bytes_.load(std::memory_order_relaxed);
+    slow["disconnects"] = (Json::UInt64)slow_disconnects_.load(std::memory_order_relaxed);
+    root["slow_consumer"] = slow;
+    Json::Value send;
+    uint64_t sent = sent_frames_.load(std::memory_order_relaxed);
+    send["frames"] = (Json::UInt64)sent;
+    send["latency_avg_ms"] = (Json::UInt64)(sent > 0 ? send_latency_sum_.load(std::memory_order_relaxed) / sent : 0);
+    send["latency_max_ms"] = (Json::UInt64)send_latency_max_.load(std::memory_order_relaxed);
+    root["player_send"] = send;
+    Json::Value packet_pool;
+    packet_pool["huge_pages"] = PacketPool::HugePages();
+    packet_pool["large_allocs"] = (Json::UInt64)PacketPool::LargeAllocs();
+    packet_pool["classes"] = Json::Value(Json::arrayValue);
+    std::vector<PacketPoolClassStats> pool_stats;
+    PacketPool::GetStats(pool_stats);
+    for(auto &ps : pool_stats)
+    {
+        Json::Value c;
+        c["block_size"] = (Json::UInt64)ps.block_size;
+        c["hits"] = (Json::UInt64)ps.hits;
+        c["misses"] = (Json::UInt64)ps.misses;
+        c["bytes_held"] = (Json::Int64)ps.bytes_held;
+        packet_pool["classes"].append(c);
+    }
+    root["packet_pool"] = packet_pool;
+    root["memory"] = memory_governor_.Stats();
+    root["loops"] = Json::Value(Json::arrayValue);
+    if(!pool_)
+    {
+        return root.toStyledString();
+    }
+    auto loops = pool_->GetLoops();
+    for(size_t i = 0; i < loops.size(); i++)
+    {
+        EventLoop *loop = loops[i];
+        Json::Value item;
+        item["loop"] = (Json::UInt64)i;
+        item["connections"] = loop->Connections();
+        item["bytes_in_per_sec"] = (Json::UInt64)loop->BytesInPerSec();
+        item["bytes_out_per_sec"] = (Json::UInt64)loop->BytesOutPerSec();
+        item["queue_depth"] = (Json::UInt64)loop->QueueDepth();
+        item["busy_permille"] = loop->BusyPermille();
+        item["load_score"] = (Json::UInt64)loop->LoadScore();
+        item["iterations"] = (Json::UInt64)loop->Iterations();
+        item["read_yields"] = (Json::UInt64)loop->ReadYields();
+        item["stats_enabled"] = loop->StatsEnabled();
+        if(loop->StatsEnabled())
+        {
+            const LoopStats &stats = loop->Stats();
+            item["iterations_per_sec"] = (Json::UInt64)stats.IterationsPerSec();
+            item["wakeups_per_sec"] = (Json::UInt64)stats.WakeupsPerSec();
+            item["callback_max_us"] = (Json::UInt64)stats.CallbackMaxUs();
+            item["task_age_max_us"] = (Json::UInt64)stats.TaskAgeMaxUs();
+            item["timer_lag_max_us"] = (Json::UInt64)stats.TimerLagMaxUs();
+            item["poll_wait_us"] = HistogramToJson(stats.PollWait());
+            item["iteration_callbacks_us"] = HistogramToJson(stats.IterationCallbacks());
+            item["callback_us"] = HistogramToJson(stats.Callback());
+            item["task_batch"] = HistogramToJson(stats.TaskBatch());
+            item["task_age_us"] = HistogramToJson(stats.TaskAge());
+            item["timer_lag_us"] = HistogramToJson(stats.TimerLag());
+        }
+        root["loops"].append(item);
+    }
+    return root.toStyledString();
+}
@@ -10,10 +10,13 @@
 #include "mmedia/rtmp/RtmpHandler.h"
 #include "mmedia/http/HttpHandler.h"
 #include "mmedia/webrtc/WebrtcServer.h"
+#include "live/MemoryGovernor.h"
+#include "live/SessionRegistry.h"
 #include <memory>
 #include <vector>
 #include <mutex>
 #include <unordered_map>
+#include <atomic>
 
 namespace tmms
 {
@@ -25,6 +28,8 @@ namespace tmms
         
         class Session;
         using SessionPtr = std::shared_ptr<Session>;
+        class PlayerUser;
+        using PlayerUserPtr = std::shared_ptr<PlayerUser>;
 
         class LiveService:public RtmpHandler,public HttpHandler
         {
@@ -36,6 +41,8 @@ namespace tmms
             SessionPtr FindSession(const std::string &session_name);
             bool CloseSession(const std::string &session_name); 
             void OnTimer(const TaskPtr &t);
+            // 每秒统计媒体内存，超预算时回收 (Accounts media memory every second and reclaims over budget)
+            void OnMemoryTimer(const TaskPtr &t);
 
             void OnNewConnection(const TcpConnectionPtr &conn) override;
             void OnConnectionDestroy(const TcpConnectionPtr &conn) override;
@@ -51,15 +58,72 @@ namespace tmms
             void Start();
             void Stop();
             EventLoop *GetNextLoop();
+            // 拉流选择循环：会话亲和放置时用会话的主循环，让拉流和播放者在同一个循环
+            // Loop for a relay pull: with session placement the session's home loop, so the pull
+            // shares a loop with its players.
+            EventLoop *GetNextLoop(Session &session);
+            // 推流分发时记录本循环执行和跨循环投递的通知数，每个循环一次 (counts notifications run locally vs posted across loops, one per loop)
+            void AddActivations(uint64_t local, uint64_t cross)
+            {
+                local_activations_.fetch_add(local, std::memory_order_relaxed);
+                cross_activations_.fetch_add(cross, std::memory_order_relaxed);
+            }
+            // 慢播放者处理计数：丢非参考帧、跳关键帧、超限断开 (slow consumer decisions: non-reference drops, keyframe skips, disconnects)
+            void AddDroppedFrames(uint64_t frames, uint64_t bytes)
+            {
+                dropped_frames_.fetch_add(frames, std::memory_order_relaxed);
+                dropped_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+            }
+            void AddKeyframeSkip(uint64_t frames, uint64_t bytes)
+            {
+                keyframe_skips_.fetch_add(1, std::memory_order_relaxed);
+                skipped_frames_.fetch_add(frames, std::memory_order_relaxed);
+                skipped_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+            }
+            void AddSlowDisconnect()
+            {
+                slow_disconnects_.fetch_add(1, std::memory_order_relaxed);
+            }
+            // 播放者取走的帧从推流收到到交给连接发送的延迟，毫秒，每批一次 (ingest-to-send latency of frames taken by players, ms, once per batch)
+            void AddSendLatency(uint64_t frames, uint64_t sum_ms, uint64_t max_ms)
+            {
+                sent_frames_.fetch_add(frames, std::memory_order_relaxed);
+                send_latency_sum_.fetch_add(sum_ms, std::memory_order_relaxed);
+                uint64_t cur = send_latency_max_.load(std::memory_order_relaxed);
+                while(max_ms > cur && !send_latency_max_.compare_exchange_weak(cur, max_ms, std::memory_order_relaxed))
+                {
+                }
+            }
+            // 所有事件循环的负载和延迟统计，JSON 格式，HTTP 的 /stats 返回这个内容
+            // Load and latency statistics of every event loop as JSON; served by HTTP at /stats.
+            std::string GetLoopStats() const;
             std::shared_ptr<WebrtcServer> GetWebrtcServer()const 
             {
                 return webrtc_server_;
             }
         private:
+            // 把播放者加入会话，会话亲和放置时先把连接迁移到会话的循环
+            // Adds a player to its session, first moving the connection to the session's loop
+            // when session placement is on.
+            void AddPlayer(const SessionPtr &s, const TcpConnectionPtr &conn, const PlayerUserPtr &user);
+
             EventLoopThreadPool * pool_{nullptr};
+            bool session_placement_{false};  // 播放者按会话放置到推流所在循环 (players placed on their session's loop)
+            size_t zerocopy_threshold_{0};   // 播放连接的零拷贝发送阈值 (zero-copy send threshold for players)
+            std::atomic<uint64_t> local_activations_{0};
+            std::atomic<uint64_t> cross_activations_{0};
+            std::atomic<uint64_t> dropped_frames_{0};
+            std::atomic<uint64_t> dropped_bytes_{0};
+            std::atomic<uint64_t> keyframe_skips_{0};
+            std::atomic<uint64_t> skipped_frames_{0};
+            std::atomic<uint64_t> skipped_bytes_{0};
+            std::atomic<uint64_t> slow_disconnects_{0};
+            std::atomic<uint64_t> sent_frames_{0};
+            std::atomic<uint64_t> send_latency_sum_{0};
+            std::atomic<uint64_t> send_latency_max_{0};
+            MemoryGovernor memory_governor_;
             std::vector<TcpServer*> servers_;
-            std::mutex lock_;
-            std::unordered_map<std::string,SessionPtr> sessions_;
+            SessionRegistry sessions_;
 
             std::shared_ptr<WebrtcServer>  webrtc_server_;
         };
@@ -0,0 +1,203 @@
+#include "MemoryGovernor.h"
+#include "Session.h"
+#include "Stream.h"
+#include "base/AppInfo.h"
+#include "live/base/LiveLog.h"
+#include "mmedia/base/PacketPool.h"
+#include <map>
+#include <algorithm>
+
+using namespace tmms::live;
+using namespace tmms::mm;
+
+namespace
+{
+    const int64_t kMB = 1024 * 1024;
+}
+
+struct MemoryGovernor::Usage
+{
+    SessionPtr session;
+    StreamPtr stream;
+    StreamMemory memory;
+};
+
+namespace
+{
+    template <typename T>
+    int64_t Sum(const std::vector<T*> &streams)
+    {
+        int64_t bytes = 0;
+        for(auto u : streams)
+        {
+            bytes += u->memory.Total();
+        }
+        return bytes;
+    }
+
+    int64_t PoolIdleBytes()
+    {
+        std::vector<PacketPoolClassStats> stats;
+        PacketPool::GetStats(stats);
+        int64_t bytes = 0;
+        for(auto &s : stats)
+        {
+            bytes += s.bytes_held;
+        }
+        return bytes;
+    }
+}
+
+void MemoryGovernor::SetProcessBudget(int64_t bytes)
+{
+    process_budget_ = bytes;
+}
+
+int64_t MemoryGovernor::Reclaim(std::vector<Usage*> &streams, int64_t bytes)
+{
+    // 占用最多的流先裁 (the biggest streams go first)
+    std::sort(streams.begin(),streams.end(),[](const Usage *a, const Usage *b){
+        return a->memory.Total() > b->memory.Total();
+    });
+    int64_t freed = 0;
+    for(auto u : streams)
+    {
+        if(freed >= bytes)
+        {
+            break;
+        }
+        int64_t hls = u->stream->ShrinkIdle();
+        hls_released_bytes_ += hls;
+        int64_t trimmed = 0;
+        if(freed + hls < bytes)
+        {
+            trimmed = u->stream->Trim(bytes - freed - hls,u->session->Players());
+            if(trimmed > 0)
+            {
+                trims_++;
+                trimmed_bytes_ += trimmed;
+            }
+        }
+        if(hls + trimmed > 0)
+        {
+            int64_t players = u->memory.players;
+            u->memory = u->stream->Memory();
+            u->memory.players = players;
+        }
+        freed += hls + trimmed;
+    }
+    return freed;
+}
+
+void MemoryGovernor::Check(const std::vector<SessionPtr> &sessions)
+{
+    std::vector<Usage> usages;
+    usages.reserve(sessions.size());
+    for(auto &s : sessions)
+    {
+        auto stream = s->GetStream();
+        if(!stream || !s->GetAppInfo())
+        {
+            continue;
+        }
+        Usage u;
+        u.session = s;
+        u.stream = stream;
+        u.memory = stream->Memory();
+        for(auto &p : s->Players())
+        {
+            u.memory.players += p->PendingBytes();
+        }
+        usages.emplace_back(std::move(u));
+    }
+
+    std::vector<Usage*> all;
+    std::map<std::string,std::vector<Usage*>> apps;
+    for(auto &u : usages)
+    {
+        auto &app = u.session->GetAppInfo();
+        apps[app->domain_name + "/" + app->app_name].push_back(&u);
+        all.push_back(&u);
+    }
+
+    bool over = false;
+    for(auto &a : apps)
+    {
+        int64_t budget = a.second.front()->session->GetAppInfo()->memory_budget_mb * kMB;
+        int64_t used = Sum(a.second);
+        if(budget <= 0 || used <= budget)
+        {
+            continue;
+        }
+        over = true;
+        int64_t freed = Reclaim(a.second,used - budget);
+        LIVE_INFO << "app:" << a.first << " over memory budget. used:" << used
+                << ",budget:" << budget
+                << ",freed:" << freed;
+    }
+
+    int64_t pool_idle = PoolIdleBytes();
+    int64_t used = Sum(all) + pool_idle;
+    if(process_budget_ > 0 && used > process_budget_)
+    {
+        over = true;
+        // 先还池里的空闲块，再裁流 (idle pool blocks go back first, then streams are trimmed)
+        int64_t released = PacketPool::ReleaseIdle();
+        pool_released_bytes_ += released;
+        pool_idle = std::max<int64_t>(pool_idle - released,0);
+        int64_t freed = 0;
+        if(used - released > process_budget_)
+        {
+            freed = Reclaim(all,used - released - process_budget_);
+        }
+        LIVE_INFO << "process over memory budget. used:" << used
+                << ",budget:" << process_budget_
+                << ",pool released:" << released
+                << ",freed:" << freed;
+    }
+    if(over)
+    {
+        checks_over_budget_++;
+    }
+
+    Json::Value stats;
+    stats["process_budget"] = (Json::Int64)process_budget_;
+    stats["used"] = (Json::Int64)(Sum(all) + pool_idle);
+    stats["pool_idle"] = (Json::Int64)pool_idle;
+    stats["over_budget_checks"] = (Json::UInt64)checks_over_budget_;
+    stats["trims"] = (Json::UInt64)trims_;
+    stats["trimmed_bytes"] = (Json::Int64)trimmed_bytes_;
+    stats["hls_released_bytes"] = (Json::Int64)hls_released_bytes_;
+    stats["pool_released_bytes"] = (Json::Int64)pool_released_bytes_;
+    stats["apps"] = Json::Value(Json::arrayValue);
+    for(auto &a : apps)
+    {
+        Json::Value item;
+        item["app"] = a.first;
+        item["budget"] = (Json::Int64)(a.second.front()->session->GetAppInfo()->memory_budget_mb * kMB);
+        item["used"] = (Json::Int64)Sum(a.second);
+        item["streams"] = (Json::UInt64)a.second.size();
+        stats["apps"].append(item);
+    }
+    stats["streams"] = Json::Value(Json::arrayValue);
+    for(auto &u : usages)
+    {
+        Json::Value item;
+        item["session"] = u.session->SessionName();
+        item["ring"] = (Json::Int64)u.memory.ring;
+        item["codec"] = (Json::Int64)u.memory.codec;
+        item["hls"] = (Json::Int64)u.memory.hls;
+        item["players"] = (Json::Int64)u.memory.players;
+        item["total"] = (Json::Int64)u.memory.Total();
+        stats["streams"].append(item);
+    }
+
+    std::lock_guard<std::mutex> lk(lock_);
+    stats_.swap(stats);
+}
+
+Json::Value MemoryGovernor::Stats() const
+{
+    std::lock_guard<std::mutex> lk(lock_);
+    return stats_;
+}
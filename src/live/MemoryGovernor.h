@@ -0,0 +1,58 @@
+#pragma once
+
+#include "json/json.h"
+#include <string>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+
+namespace tmms
+{
+    namespace live
+    {
+        class Session;
+        using SessionPtr = std::shared_ptr<Session>;
+
+        // MemoryGovernor：媒体内存的记账和预算。
+        // 主线程定时统计每路流持有的字节（环形缓冲区即 GOP 缓存、编码头历史、HLS 分片窗口、播放者连接里的积压），
+        // 按 app（域名/app）和全进程汇总，和 app 的 memory_budget_mb、进程的 memory_budget_mb 比较。
+        // 超预算时先释放空闲的 HLS 分片，再从占用最多的流开始裁掉没有播放者还需要的最老的 GOP，最新的 GOP
+        // 总是留着；进程超预算时先把包内存池仓库里的空闲块还给系统。预算为 0 时只记账。
+        // MemoryGovernor: accounting and budgets for media memory.
+        // A main-thread timer adds up the bytes every stream holds (the ring, i.e. the GOP cache, codec
+        // header history, the HLS fragment window and the backlog on player connections) per app
+        // (domain/app) and for the process, and compares them with the app's and the process's
+        // memory_budget_mb. Over budget it first drops idle HLS fragments, then trims the oldest GOPs no
+        // player still needs, biggest streams first; the latest GOP always stays. Over the process
+        // budget the packet pool's idle depot blocks go back to the system first. A budget of 0 only
+        // keeps the accounts.
+        class MemoryGovernor
+        {
+        public:
+            MemoryGovernor() = default;
+            ~MemoryGovernor() = default;
+
+            // 全进程预算，字节，0 表示不限 (Process-wide budget in bytes, 0 means unlimited)
+            void SetProcessBudget(int64_t bytes);
+            // 统计并在超预算时回收，在主线程调用 (Accounts and reclaims when over budget; called on the main thread)
+            void Check(const std::vector<SessionPtr> &sessions);
+            // 最近一次统计，HTTP 的 /stats 返回这个内容 (The latest accounts; served by HTTP at /stats)
+            Json::Value Stats() const;
+
+        private:
+            struct Usage;
+            int64_t Reclaim(std::vector<Usage*> &streams, int64_t bytes);
+
+            int64_t process_budget_{0};
+            uint64_t checks_over_budget_{0};
+            uint64_t trims_{0};
+            int64_t trimmed_bytes_{0};
+            int64_t hls_released_bytes_{0};
+            int64_t pool_released_bytes_{0};
+
+            mutable std::mutex lock_;   // 保护 stats_，/stats 在别的线程读 (guards stats_, read by /stats on another thread)
+            Json::Value stats_;
+        };
+    }
+}
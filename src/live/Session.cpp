@@ -9,6 +9,9 @@
 #include "live/relay/PullerRelay.h"
 #include "live/user/WebrtcPlayerUser.h"
 #include "live/WebrtcService.h"
+#include "live/LiveService.h"
+#include "network/net/EventLoopThreadPool.h"
+#include <algorithm>
 
 using namespace tmms::live;
 using namespace tmms::base;
@@ -16,6 +19,9 @@ using namespace tmms::base;
 namespace
 {
     static UserPtr user_null;
+    // 会话循环集合里最空闲的循环忙碌超过这个千分比时，再借一个循环
+    // When even the idlest loop of a session's set is busier than this (permille), borrow another.
+    const uint32_t kSessionLoopBusyPermille = 700;
 }
 Session::Session(const std::string &session_name)
 :session_name_(session_name)
@@ -149,7 +155,9 @@ void Session::CloseUser(const UserPtr &user)
                             << ",elapsed:" << user->ElapsedTime()
                             << ",ReadyTime:" << ReadyTime()
                             << ",stream time:" << SinceStart();            
-                players_.erase(std::dynamic_pointer_cast<PlayerUser>(user));
+                auto player = std::dynamic_pointer_cast<PlayerUser>(user);
+                players_.erase(player);
+                RemoveFromGroupNoLock(player);
                 player_live_time_ = tmms::base::TTime::NowMS();
             }
         }
@@ -160,17 +168,130 @@ void Session::CloseUser(const UserPtr &user)
 void Session::ActiveAllPlayers()
 {
     sWebrtcService->Push2Players();
-    std::lock_guard<std::mutex> lk(lock_);
-    for(auto const &u:players_)
+    std::vector<LoopPlayersPtr> groups;
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        groups.reserve(loop_players_.size());
+        for(auto const &g:loop_players_)
+        {
+            // 上一次的通知还没处理就不再投递，那一次处理时这一帧已经在流里了
+            // Nothing more is posted while the last notification is pending; when it runs this
+            // frame is already in the stream.
+            if(!g.second->pending.exchange(true))
+            {
+                groups.push_back(g.second);
+            }
+        }
+    }
+    uint64_t local = 0;
+    uint64_t cross = 0;
+    auto self = shared_from_this();
+    for(auto const &g:groups)
+    {
+        // 推流所在循环的组直接执行，其他循环每个只投递一次
+        // The publishing loop's group runs inline; every other loop gets a single post.
+        if(g->loop->IsInLoopThread())
+        {
+            local++;
+        }
+        else
+        {
+            cross++;
+        }
+        g->loop->RunInLoop([self,g](){
+            self->DrainPlayers(g);
+        });
+    }
+    sLiveService->AddActivations(local, cross);
+}
+
+void Session::DrainPlayers(const LoopPlayersPtr &group)
+{
+    // 先清标记：处理过程中又来的帧会再投递一次 (cleared first, so frames arriving meanwhile post again)
+    group->pending.store(false);
+    if(group->snapshot_version != group->version.load())
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        group->snapshot.assign(group->players.begin(),group->players.end());
+        group->snapshot_version = group->version.load();
+    }
+    std::vector<PlayerUserPtr> moved;
+    for(auto const &u:group->snapshot)
     {
+        if(u->destroyed_ || !u->connection_)
+        {
+            continue;
+        }
+        // 连接迁到了别的循环：这一次由 Active 转投过去，之后换到新循环的组里
+        // The connection moved to another loop: Active forwards this one, then it changes group.
+        if(!u->connection_->Loop()->IsInLoopThread())
+        {
+            moved.push_back(u);
+        }
         u->Active();
     }
-}   
+    if(!moved.empty())
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        for(auto const &u:moved)
+        {
+            if(players_.count(u) > 0)
+            {
+                RemoveFromGroupNoLock(u);
+                AddToGroupNoLock(u,u->connection_->Loop());
+            }
+        }
+    }
+}
+
+void Session::AddToGroupNoLock(const PlayerUserPtr &user, EventLoop *loop)
+{
+    auto &group = loop_players_[loop];
+    if(!group)
+    {
+        group = std::make_shared<LoopPlayers>(loop);
+    }
+    group->players.insert(user);
+    group->version++;
+    player_loops_[user.get()] = loop;
+}
+
+void Session::RemoveFromGroupNoLock(const PlayerUserPtr &user)
+{
+    auto iter = player_loops_.find(user.get());
+    if(iter == player_loops_.end())
+    {
+        return;
+    }
+    auto group = loop_players_.find(iter->second);
+    if(group != loop_players_.end())
+    {
+        group->second->players.erase(user);
+        group->second->version++;
+        // 空组直接去掉，它的快照随最后一次通知一起释放
+        // An empty group is dropped; its snapshot goes away with its last notification.
+        if(group->second->players.empty())
+        {
+            loop_players_.erase(group);
+        }
+    }
+    player_loops_.erase(iter);
+}
+
+std::vector<PlayerUserPtr> Session::Players()
+{
+    std::lock_guard<std::mutex> lk(lock_);
+    return std::vector<PlayerUserPtr>(players_.begin(),players_.end());
+}
 void Session::AddPlayer(const PlayerUserPtr &user)
 {
     {
         std::lock_guard<std::mutex> lk(lock_);
         players_.insert(user);
+        if(user->connection_)
+        {
+            AddToGroupNoLock(user,user->connection_->Loop());
+        }
     }
     LIVE_DEBUG << " add player,session name:" << session_name_ << ",user:" << user->UserId();
 
@@ -196,6 +317,53 @@ void Session::SetPublisher(UserPtr &user)
         publisher_->Close();
     }
     publisher_ = user;
+
+    // 推流连接所在的循环成为主循环，之后的播放者优先放到这里
+    // The publishing connection's loop becomes home; later players are placed there first.
+    if(user && user->connection_)
+    {
+        EventLoop *loop = user->connection_->Loop();
+        auto iter = std::find(loops_.begin(), loops_.end(), loop);
+        if(iter != loops_.end())
+        {
+            loops_.erase(iter);
+        }
+        loops_.insert(loops_.begin(), loop);
+    }
+}
+
+EventLoop *Session::PickPlayerLoop(EventLoop *current, EventLoopThreadPool *pool)
+{
+    std::lock_guard<std::mutex> lk(lock_);
+    if(loops_.empty())
+    {
+        loops_.push_back(current);
+        return current;
+    }
+    EventLoop *best = loops_.front();
+    for(auto loop : loops_)
+    {
+        if(loop->LoadScore() < best->LoadScore())
+        {
+            best = loop;
+        }
+    }
+    if(pool && best->BusyPermille() >= kSessionLoopBusyPermille && loops_.size() < pool->Size())
+    {
+        EventLoop *extra = pool->GetNextLoop();
+        if(std::find(loops_.begin(), loops_.end(), extra) == loops_.end())
+        {
+            loops_.push_back(extra);
+            return extra;
+        }
+    }
+    return best;
+}
+
+EventLoop *Session::HomeLoop()
+{
+    std::lock_guard<std::mutex> lk(lock_);
+    return loops_.empty() ? nullptr : loops_.front();
 }
 
 StreamPtr Session::GetStream()
@@ -209,6 +377,7 @@ const string &Session::SessionName()const
 void Session::SetAppInfo(AppInfoPtr &ptr)
 {
     app_info_ = ptr;
+    stream_->SetBufferSize(app_info_->max_buffer);
 }
 AppInfoPtr &Session::GetAppInfo()
 {
@@ -230,6 +399,8 @@ void Session::Clear()
         CloseUserNoLock(std::dynamic_pointer_cast<User>(p));
     }
     players_.clear();
+    loop_players_.clear();
+    player_loops_.clear();
 }
 
 void Session::CloseUserNoLock(const UserPtr &user)
@@ -5,11 +5,17 @@
 #include "base/AppInfo.h"
 #include <string>
 #include <unordered_set>
+#include <unordered_map>
 #include <mutex>
 #include <atomic>
+#include <vector>
 
 namespace tmms
 {
+    namespace network
+    {
+        class EventLoopThreadPool;
+    }
     namespace live
     {
         using PlayerUserPtr = std::shared_ptr<PlayerUser>;
@@ -35,8 +41,13 @@ namespace tmms
                             const std::string &param,
                             UserType type);
             void CloseUser(const UserPtr &user);
+            // 通知所有播放者有新数据：每个有播放者的循环只投递一次，由那个循环一次处理完它上面的播放者
+            // Notifies every player of new data: one post per loop that has players, and that loop
+            // activates all of its local players in one pass.
             void ActiveAllPlayers();
             void AddPlayer(const PlayerUserPtr &user);
+            // 当前播放者的快照 (Snapshot of the current players)
+            std::vector<PlayerUserPtr> Players();
             void SetPublisher(UserPtr &user);
             
             StreamPtr GetStream() ;
@@ -46,10 +57,45 @@ namespace tmms
             bool IsPublishing() const ;
             void Clear();
 
+            // 会话亲和放置：为新播放者挑选事件循环。会话有一组循环，第一个是主循环（推流或拉流连接所在的循环），
+            // 从中选负载最低的；都太忙时从线程池再借一个循环加入集合。还没有循环时播放者当前的循环成为主循环。
+            // Session-affine placement: picks the loop for a new player. A session owns a set of loops,
+            // the first being its home (where the publishing or pulling connection lives); the least
+            // loaded member wins, and when all are too busy another loop from the pool joins the set.
+            // With no loop yet, the player's current loop becomes the home loop.
+            EventLoop *PickPlayerLoop(EventLoop *current, EventLoopThreadPool *pool);
+            EventLoop *HomeLoop();
+
         private:
+            // 同一个循环上的播放者。players 由 lock_ 保护，变了就加 version；snapshot 只在该循环线程
+            // 里用，version 变了才重新拷贝。pending 表示已经投递过通知、循环还没处理。
+            // The players living on one loop. players is guarded by lock_ and bumps version on every
+            // change; snapshot is only touched on that loop's thread and recopied when version moves.
+            // pending means a notification has been posted and the loop has not drained it yet.
+            struct LoopPlayers
+            {
+                explicit LoopPlayers(EventLoop *l)
+                : loop(l)
+                {
+                }
+                EventLoop *loop;
+                std::unordered_set<PlayerUserPtr> players;
+                std::atomic<uint64_t> version{0};
+                std::atomic<bool> pending{false};
+                std::vector<PlayerUserPtr> snapshot;
+                uint64_t snapshot_version{0};
+            };
+            using LoopPlayersPtr = std::shared_ptr<LoopPlayers>;
+
+            // 在组所在的循环里激活它的播放者 (Activates a group's players on the group's loop)
+            void DrainPlayers(const LoopPlayersPtr &group);
+            void AddToGroupNoLock(const PlayerUserPtr &user, EventLoop *loop);
+            void RemoveFromGroupNoLock(const PlayerUserPtr &user);
             void CloseUserNoLock(const UserPtr &user);
             std::string session_name_;
             std::unordered_set<PlayerUserPtr> players_;
+            std::unordered_map<EventLoop*,LoopPlayersPtr> loop_players_;  // 按循环分组的播放者 (players grouped by loop)
+            std::unordered_map<PlayerUser*,EventLoop*> player_loops_;      // 播放者所在的组 (the group each player is in)
             AppInfoPtr app_info_;
             StreamPtr stream_;
             UserPtr publisher_;
@@ -57,6 +103,7 @@ namespace tmms
             std::atomic<int64_t> player_live_time_;
 
             PullerRelay * pull_{nullptr};
+            std::vector<EventLoop*> loops_; // 会话的事件循环集合，第一个是主循环
         };
     }
 }
\ No newline at end of file
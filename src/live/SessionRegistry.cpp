@@ -0,0 +1,114 @@
+#include "SessionRegistry.h"
+
+using namespace tmms::live;
+
+const size_t SessionRegistry::kShards;
+
+SessionRegistry::Shard &SessionRegistry::ShardOf(const std::string &name)
+{
+    return shards_[std::hash<std::string>()(name) % kShards];
+}
+
+SessionPtr SessionRegistry::Find(const std::string &name)
+{
+    auto &shard = ShardOf(name);
+    std::lock_guard<std::mutex> lk(shard.lock);
+    auto iter = shard.sessions.find(name);
+    if(iter != shard.sessions.end())
+    {
+        return iter->second;
+    }
+    return SessionPtr();
+}
+
+SessionPtr SessionRegistry::FindOrCreate(const std::string &name, const Creator &create)
+{
+    auto s = Find(name);
+    if(s)
+    {
+        return s;
+    }
+    // 创建会话（读配置、建流）比较重，不占着分片的锁
+    // Building a session (config lookup, the stream) is heavy, so the shard lock is not held for it.
+    s = create();
+    if(!s)
+    {
+        return s;
+    }
+    auto &shard = ShardOf(name);
+    std::lock_guard<std::mutex> lk(shard.lock);
+    return shard.sessions.emplace(name,s).first->second;
+}
+
+SessionPtr SessionRegistry::Remove(const std::string &name)
+{
+    SessionPtr s;
+    auto &shard = ShardOf(name);
+    std::lock_guard<std::mutex> lk(shard.lock);
+    auto iter = shard.sessions.find(name);
+    if(iter != shard.sessions.end())
+    {
+        s = std::move(iter->second);
+        shard.sessions.erase(iter);
+    }
+    return s;
+}
+
+void SessionRegistry::Expire(const Predicate &expired, std::vector<SessionPtr> &removed)
+{
+    std::vector<std::pair<std::string,SessionPtr>> entries;
+    for(auto &shard : shards_)
+    {
+        entries.clear();
+        {
+            std::lock_guard<std::mutex> lk(shard.lock);
+            entries.reserve(shard.sessions.size());
+            for(auto &s : shard.sessions)
+            {
+                entries.emplace_back(s.first,s.second);
+            }
+        }
+        for(auto &e : entries)
+        {
+            // 锁外先筛一遍，只有看起来超时的才在锁里再检查一次：检查之后、删除之前可能有播放者
+            // 通过 FindOrCreate 拿到它加了进来，锁里的检查和删除之间 Find 拿不到它
+            // Screen outside the lock and check again under it only for the ones that look expired: a
+            // player may have joined through FindOrCreate since the first check, and no Find can hand
+            // the session out between the check under the lock and the erase.
+            if(!expired(e.second))
+            {
+                continue;
+            }
+            std::lock_guard<std::mutex> lk(shard.lock);
+            auto iter = shard.sessions.find(e.first);
+            if(iter != shard.sessions.end() && iter->second == e.second && expired(e.second))
+            {
+                shard.sessions.erase(iter);
+                removed.push_back(e.second);
+            }
+        }
+    }
+}
+
+void SessionRegistry::Snapshot(std::vector<SessionPtr> &sessions)
+{
+    for(auto &shard : shards_)
+    {
+        std::lock_guard<std::mutex> lk(shard.lock);
+        for(auto &s : shard.sessions)
+        {
+            sessions.push_back(s.second);
+        }
+    }
+}
+
+size_t SessionRegistry::Size()
+{
+    size_t n = 0;
+    for(auto &shard : shards_)
+    {
+        std::lock_guard<std::mutex> lk(shard.lock);
+        n += shard.sessions.size();
+    }
+    return n;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+#include <functional>
+#include <cstddef>
+
+namespace tmms
+{
+    namespace live
+    {
+        class Session;
+        using SessionPtr = std::shared_ptr<Session>;
+
+        // SessionRegistry：按会话名查找会话的表，按名字的哈希分成 kShards 个分片，每个分片一把锁。
+        // 锁里只做哈希表的查找、插入和删除：新会话在锁外创建好再放进去，超时检查在锁外对分片的快照做，
+        // 所以推流、播放、关闭和超时清理互相之间只在同一个分片上短暂地碰到，FLV/HLS 请求的查找不会
+        // 被一批推流或者一次全表清理挡住。
+        // SessionRegistry: sessions by name, split into kShards shards by name hash, one lock each.
+        // Only the hash map lookup, insert and erase happen under a lock: a new session is built
+        // outside and then put in, and timeouts are checked outside on a snapshot of each shard. So
+        // publish, play, close and the timeout sweep only meet briefly on the same shard, and FLV/HLS
+        // lookups are not held up by a burst of publishes or a sweep of the whole table.
+        class SessionRegistry
+        {
+        public:
+            static const size_t kShards = 64;
+            using Creator = std::function<SessionPtr()>;
+            using Predicate = std::function<bool(const SessionPtr &)>;
+
+            SessionRegistry() = default;
+            ~SessionRegistry() = default;
+
+            SessionPtr Find(const std::string &name);
+            // 有就返回已有的，没有就在锁外调用 create 创建后放进去；两个线程同时创建时以先放进去的为准，
+            // create 返回空时不放。
+            // Returns the existing session, or builds one with create outside the lock and puts it
+            // in; when two threads race the first one in wins. Nothing is put in if create returns null.
+            SessionPtr FindOrCreate(const std::string &name, const Creator &create);
+            // 删除并返回，没有时返回空 (Removes and returns the session; null when there is none)
+            SessionPtr Remove(const std::string &name);
+            // 逐个分片取快照、在锁外检查，为真的在锁里删除前再检查一次，删掉的追加到 removed；检查期间
+            // 被替换掉的不删。第二次检查在分片的锁里，这时 expired 不能再调用注册表
+            // Snapshots one shard at a time and checks outside the lock; a session expired holds for is
+            // checked again under the lock right before it is removed and appended to removed. A
+            // session replaced meanwhile is left alone. The second check runs under the shard lock, where
+            // expired must not call back into the registry.
+            void Expire(const Predicate &expired, std::vector<SessionPtr> &removed);
+            // 所有会话的快照 (A snapshot of every session)
+            void Snapshot(std::vector<SessionPtr> &sessions);
+            size_t Size();
+
+        private:
+            struct Shard
+            {
+                std::mutex lock;
+                std::unordered_map<std::string,SessionPtr> sessions;
+                char pad[64];   // 相邻分片的锁不在同一个缓存行 (keeps neighbouring shard locks off one cache line)
+            };
+            Shard &ShardOf(const std::string &name);
+
+            Shard shards_[kShards];
+        };
+    }
+}
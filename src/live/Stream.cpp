@@ -3,6 +3,10 @@
 #include "live/base/CodecUtils.h"
 #include "live/base/LiveLog.h"
 #include "Session.h"
+#include "live/LiveService.h"
+#include "network/net/TcpConnection.h"
+#include <algorithm>
+#include <cstdlib>
 
 using namespace tmms::live;
 using namespace tmms::base;
@@ -68,8 +72,23 @@ void Stream::SetReady(bool ready)
     ready_time_ = TTime::NowMS();
 }
 
+void Stream::SetBufferSize(uint32_t size)
+{
+    std::lock_guard<std::mutex> lk(lock_);
+    if(size == 0 || frame_index_ >= 0)
+    {
+        return;
+    }
+    packet_buffer_size_ = size;
+    packet_buffer_.Resize(size);
+    gop_mgr_.SetCapacity(size);
+}
 void Stream::AddPacket(PacketPtr && packet)
 {
+    if(CodecUtils::IsCodecHeader(packet))
+    {
+        packet->SetCodecFlags(kCodecFlagHeader);
+    }
     auto t = time_corrector_.CorrectTimestamp(packet);
     packet->SetTimeStamp(t);
 
@@ -82,8 +101,12 @@ void Stream::AddPacket(PacketPtr && packet)
             SetReady(true);
             packet->SetPacketType(kPacketTypeVideo|kFrameTypeKeyFrame);
         }
+        else if(packet->IsVideo()&&CodecUtils::IsNonReferenceFrame(packet))
+        {
+            packet->SetPacketType(kPacketTypeVideo|kFrameTypeDisposable);
+        }
 
-        if(CodecUtils::IsCodecHeader(packet))
+        if(packet->CodecFlags() & kCodecFlagHeader)
         {
             codec_headers_.ParseCodecHeader(packet);
             if(packet->IsVideo())
@@ -105,11 +128,35 @@ void Stream::AddPacket(PacketPtr && packet)
 
         gop_mgr_.AddFrame(packet);
         ProcessHls(packet);
-        packet_buffer_[index%packet_buffer_size_] = std::move(packet);
+        int64_t offset = total_bytes_;
+        total_bytes_ += packet->PacketSize();
+        auto now = TTime::NowMS();
+        packet->SetIngestTime(now);
+        if(bitrate_time_ == 0)
+        {
+            bitrate_time_ = now;
+            bitrate_bytes_ = total_bytes_;
+        }
+        else if(now - bitrate_time_ >= 1000)
+        {
+            bitrate_ = (total_bytes_ - bitrate_bytes_) * 1000 / (now - bitrate_time_);
+            bitrate_time_ = now;
+            bitrate_bytes_ = total_bytes_;
+        }
+        auto &slot = packet_buffer_.Owned(index);
+        if(slot)
+        {
+            ring_bytes_ -= slot->MemoryBytes();
+        }
+        ring_bytes_ += packet->MemoryBytes();
+        // 写好槽之后播放者才能看到这一帧 (players see the frame only once its slot is written)
+        packet_buffer_.Publish(index,std::move(packet),offset);
         auto min_idx = frame_index_ - packet_buffer_size_;
         if(min_idx>0)
         {
             gop_mgr_.ClearExpriedGop(min_idx);
+            // 编码头历史只留环形缓冲区里的帧还能取到的版本
+            codec_headers_.Trim(std::max<int64_t>(min_idx + 1,trim_index_));
         }
     }
 
@@ -126,7 +173,7 @@ void Stream::AddPacket(PacketPtr && packet)
     }
 }
 
-void Stream::GetFrames(const PlayerUserPtr &user)
+void Stream::GetFrames(PlayerUser *user)
 {
     if(!HasMedia())
     {
@@ -139,38 +186,221 @@ void Stream::GetFrames(const PlayerUserPtr &user)
     {
         return ;
     }
-    std::lock_guard<std::mutex> lk(lock_);
-    if(user->out_index_>=0)
+    if(user->out_index_.load(std::memory_order_relaxed)>=0)
     {
-        int min_idx = frame_index_ - packet_buffer_size_;
-        int content_lantency = user->GetAppInfo()->content_latency;
-        if((user->out_index_<min_idx)
-            ||((gop_mgr_.LastestTimeStamp() - user->out_frame_timestamp_)>2*content_lantency))
+        // 稳定状态不拿锁，只有要跳 GOP 时 CheckOutputLimit 才去拿 (no lock in the steady state; CheckOutputLimit takes it only to skip)
+        if(CheckOutputLimit(user))
         {
-            LIVE_INFO << "need skip out index:" << user->out_index_
-                    << ",min idx:" << min_idx
-                    << ",out timestamp:" << user->out_frame_timestamp_
-                    << ",latest timestamp:" << gop_mgr_.LastestTimeStamp();
-            SkipFrame(user);
-        }    
+            GetNextFrame(user);
+            return ;
+        }
     }
     else
     {
-        if(!LocateGop(user))
+        std::lock_guard<std::mutex> lk(lock_);
+        if(LocateGop(user))
         {
-            return ;
+            GetNextFrame(user);
+        }
+        return ;
+    }
+    // 关闭会回调到会话，不能持有 lock_
+    user->Close();
+}
+int64_t Stream::BytesFrom(int64_t index) const
+{
+    // 先读总字节数：读到的偏移所在的帧已经发布，总数不会比它小
+    return BytesFrom(index,total_bytes_.load(std::memory_order_acquire));
+}
+int64_t Stream::BytesFrom(int64_t index, int64_t total) const
+{
+    for(int i = 0; i < 4; i++)
+    {
+        int64_t last = packet_buffer_.Last();
+        if(index > last)
+        {
+            return 0;
+        }
+        int64_t oldest = std::max<int64_t>(last - packet_buffer_size_ + 1,0);
+        int64_t offset = 0;
+        // 推流正好覆盖了这一格就重新取最老的帧 (retry from the new oldest frame when the publisher just overwrote the slot)
+        if(packet_buffer_.Offset(std::max(index,oldest),offset))
+        {
+            return std::max<int64_t>(total - offset,0);
+        }
+    }
+    return 0;
+}
+void Stream::TuneSocket(PlayerUser *user)
+{
+    // 码率变化超过四分之一才重新设置发送缓冲区
+    int64_t bitrate = bitrate_;
+    if(bitrate <= 0 || std::abs(bitrate - user->tuned_bitrate_) * 4 < user->tuned_bitrate_)
+    {
+        return;
+    }
+    if(user->connection_)
+    {
+        user->connection_->SetSendBufferForBitrate(bitrate,user->GetAppInfo()->sndbuf_time);
+    }
+    user->tuned_bitrate_ = bitrate;
+}
+StreamMemory Stream::Memory()
+{
+    StreamMemory memory;
+    std::lock_guard<std::mutex> lk(lock_);
+    memory.ring = ring_bytes_;
+    memory.codec = codec_headers_.Bytes();
+    memory.hls = muxer_.Bytes();
+    return memory;
+}
+int64_t Stream::Trim(int64_t bytes, const std::vector<PlayerUserPtr> &players)
+{
+    std::lock_guard<std::mutex> lk(lock_);
+    // 最新的 GOP 留给新来的播放者，播放者还没发的帧也不能动
+    int64_t limit = gop_mgr_.LastGopIndex();
+    for(auto &p : players)
+    {
+        int32_t out_index = p->out_index_.load(std::memory_order_relaxed);
+        if(out_index >= 0)
+        {
+            limit = std::min<int64_t>(limit,out_index + 1);
+        }
+    }
+    int64_t last = frame_index_;
+    int64_t idx = std::max<int64_t>(std::max<int64_t>(last - packet_buffer_size_ + 1,0),trim_index_);
+    int64_t freed = 0;
+    for(; idx < limit; idx++)
+    {
+        auto &pkt = packet_buffer_.Owned(idx);
+        if(!pkt)
+        {
+            continue;
         }
+        // 够了就在下一个 GOP 的开头停下
+        if(freed >= bytes && pkt->IsKeyFrame())
+        {
+            break;
+        }
+        freed += pkt->MemoryBytes();
+        packet_buffer_.Clear(idx);
     }
-    GetNextFrame(user);
+    // 没有读者还在看的包马上释放 (packets no reader is looking at are freed right away)
+    packet_buffer_.Reclaim();
+    if(freed == 0)
+    {
+        return 0;
+    }
+    trim_index_ = idx;
+    ring_bytes_ -= freed;
+    // 起始帧被裁掉的 GOP 不能再用来定位
+    gop_mgr_.ClearExpriedGop(idx - 1);
+    int64_t codec = codec_headers_.Bytes();
+    codec_headers_.Trim(idx);
+    freed += codec - codec_headers_.Bytes();
+    LIVE_DEBUG << "trim stream:" << session_name_ << " to frame:" << idx
+                << ",freed:" << freed
+                << ",frame index:" << last;
+    return freed;
 }
-bool Stream::LocateGop(const PlayerUserPtr &user)
+bool Stream::CheckOutputLimit(PlayerUser *user)
+{
+    auto &app = user->GetAppInfo();
+    // 被覆盖或被内存预算裁掉的帧都取不到了
+    int64_t min_idx = std::max<int64_t>(frame_index_ - packet_buffer_size_,trim_index_ - 1);
+    int64_t max_time = app->out_queue_max_time > 0 ? app->out_queue_max_time : 2 * app->content_latency;
+    int64_t queued_time = gop_mgr_.LastestTimeStamp() - user->out_frame_timestamp_;
+    // 积压 = 流里还没取走的帧 + 连接里还没写出的字节，延迟模式下再加上内核里还没被确认的字节
+    int32_t out_index = user->out_index_.load(std::memory_order_relaxed);
+    int64_t queued_bytes = BytesFrom(out_index + 1);
+    if(user->connection_)
+    {
+        int64_t pending = user->connection_->PendingBytes();
+        user->pending_bytes_.store(pending,std::memory_order_relaxed);
+        queued_bytes += pending;
+        if(app->latency_mode)
+        {
+            TuneSocket(user);
+            int64_t backlog = user->connection_->SocketBacklogBytes();
+            queued_bytes += backlog;
+            int64_t bitrate = bitrate_;
+            if(bitrate > 0)
+            {
+                queued_time += backlog * 1000 / bitrate; // 内核积压折算成时长
+            }
+        }
+    }
+    bool lost = out_index < min_idx; // 要发的帧已经被覆盖，只能跳
+    bool over = lost || queued_time > max_time
+                || (app->out_queue_max_bytes > 0 && queued_bytes > app->out_queue_max_bytes);
+    if(!over)
+    {
+        user->over_limit_since_ = 0;
+        user->drop_non_ref_ = false;
+        return true;
+    }
+
+    auto now = TTime::NowMS();
+    if(user->over_limit_since_ == 0)
+    {
+        user->over_limit_since_ = now;
+        LIVE_INFO << "player over output limit. out index:" << out_index
+                << ",min idx:" << min_idx
+                << ",queued bytes:" << queued_bytes
+                << ",queued time:" << queued_time
+                << ",policy:" << app->slow_policy
+                << ",host:" << user->user_id_;
+    }
+    if(lost || app->slow_policy == kSlowConsumerSkipToKeyframe)
+    {
+        int64_t from = out_index;
+        {
+            // GOP 和编码头只在锁里读 (GOPs and codec headers are only read under the lock)
+            std::lock_guard<std::mutex> lk(lock_);
+            SkipFrame(user);
+        }
+        int64_t to = user->out_index_.load(std::memory_order_relaxed);
+        if(to > from)
+        {
+            uint64_t frames = to - from;
+            // 两次都按同一个总字节数算，推流在中间前进了也不会减成负数
+            // (one total for both, so a publisher moving on in between cannot make it negative)
+            int64_t total = total_bytes_.load(std::memory_order_acquire);
+            uint64_t bytes = std::max<int64_t>(BytesFrom(from + 1,total) - BytesFrom(to + 1,total),0);
+            user->keyframe_skips_++;
+            user->skipped_frames_ += frames;
+            user->skipped_bytes_ += bytes;
+            user->over_limit_since_ = 0;
+            sLiveService->AddKeyframeSkip(frames,bytes);
+        }
+        return true;
+    }
+    if(app->slow_policy == kSlowConsumerDropNonRef)
+    {
+        user->drop_non_ref_ = true;
+        return true;
+    }
+    if(now - user->over_limit_since_ >= app->slow_disconnect_time)
+    {
+        LIVE_WARN << "player over output limit for " << now - user->over_limit_since_
+                << "ms, disconnect it. queued bytes:" << queued_bytes
+                << ",queued time:" << queued_time
+                << ",dropped frames:" << user->dropped_frames_
+                << ",skipped frames:" << user->skipped_frames_
+                << ",host:" << user->user_id_;
+        sLiveService->AddSlowDisconnect();
+        return false;
+    }
+    return true;
+}
+bool Stream::LocateGop(PlayerUser *user)
 {
     int content_lantency = user->GetAppInfo()->content_latency;
     int lantency = 0;
     auto idx = gop_mgr_.GetGopByLatency(content_lantency,lantency);
     if(idx != -1)
     {
-        user->out_index_ = idx - 1;
+        user->out_index_.store(idx - 1,std::memory_order_relaxed);
     }
     else 
     {
@@ -246,12 +476,13 @@ bool Stream::LocateGop(const PlayerUserPtr &user)
     return true;
 
 }
-void Stream::SkipFrame(const PlayerUserPtr &user)
+void Stream::SkipFrame(PlayerUser *user)
 {
     int content_lantency = user->GetAppInfo()->content_latency;
     int lantency = 0;
     auto idx = gop_mgr_.GetGopByLatency(content_lantency,lantency);
-    if(idx == -1 || idx <= user->out_index_)
+    int32_t out_index = user->out_index_.load(std::memory_order_relaxed);
+    if(idx == -1 || idx <= out_index)
     {
         return;
     }
@@ -284,35 +515,89 @@ void Stream::SkipFrame(const PlayerUserPtr &user)
         }
     }      
 
-    LIVE_DEBUG << "skip frame " << user->out_index_ << "->" << idx
+    LIVE_DEBUG << "skip frame " << out_index << "->" << idx
                 << ",lantency:" << lantency 
                 << ",frame_index:" << frame_index_
                 << ",host:" << user->user_id_;
-    user->out_index_ = idx - 1;  
+    user->out_index_.store(idx - 1,std::memory_order_relaxed);
 }
 
-void Stream::GetNextFrame(const PlayerUserPtr &user)
+FrameBatch Stream::BatchLimit(PlayerUser *user, int64_t from_timestamp) const
 {
-    auto idx = user->out_index_ + 1;
-    auto max_idx = frame_index_.load();
-    for(int i = 0;i < 10;i++)
+    auto &app = user->GetAppInfo();
+    int64_t backlog_bytes = BytesFrom(user->out_index_.load(std::memory_order_relaxed) + 1);
+    int64_t backlog_time = std::max<int64_t>(gop_mgr_.LastestTimeStamp() - from_timestamp,0);
+    uint32_t busy = 0;
+    if(user->connection_ && user->connection_->Loop())
     {
-        if(idx>max_idx)
+        busy = user->connection_->Loop()->BusyPermille();
+    }
+    return FrameBatch::Limit(app->out_batch_max_bytes,app->out_batch_max_time,
+                             backlog_bytes,backlog_time,busy);
+}
+void Stream::GetNextFrame(PlayerUser *user)
+{
+    int64_t idx = user->out_index_.load(std::memory_order_relaxed) + 1;
+    auto max_idx = packet_buffer_.Last();
+    uint64_t dropped_frames = 0;
+    uint64_t dropped_bytes = 0;
+    PacketRing::ReadGuard guard;
+    FrameBatch batch;
+    int64_t first_timestamp = -1;
+    int64_t taken_bytes = 0;
+    int frames = 0;
+    int64_t now = 0;
+    uint64_t taken_frames = 0;
+    uint64_t lag_sum = 0;
+    uint64_t lag_max = 0;
+    while(idx <= max_idx)
+    {
+        auto pkt = packet_buffer_.Get(idx);
+        if(!pkt)
         {
             break;
         }
-        auto &pkt = packet_buffer_[idx%packet_buffer_size_];
-        if(pkt)
+        // 上限按这一批第一帧算出落后多少，之后每帧先看装没装满
+        if(first_timestamp < 0)
         {
-            user->out_frames_.emplace_back(pkt);
-            user->out_index_ = pkt->Index();
-            user->out_frame_timestamp_ = pkt->TimeStamp();
-            idx = pkt->Index() + 1;
+            first_timestamp = pkt->TimeStamp();
+            batch = BatchLimit(user,first_timestamp);
         }
-        else 
+        else if(batch.Full(taken_bytes,(int64_t)pkt->TimeStamp() - first_timestamp,frames))
         {
             break;
         }
+        frames++;
+        user->out_index_.store(pkt->Index(),std::memory_order_relaxed);
+        user->out_frame_timestamp_ = pkt->TimeStamp();
+        idx = pkt->Index() + 1;
+        if(user->drop_non_ref_&&pkt->IsDisposable())
+        {
+            dropped_frames++;
+            dropped_bytes += pkt->PacketSize();
+            continue;
+        }
+        taken_bytes += pkt->PacketSize();
+        // 从推流收到到交给播放者发送的时间 (ingest-to-send latency)
+        if(now == 0)
+        {
+            now = TTime::NowMS();
+        }
+        uint64_t lag = now > pkt->IngestTime() ? now - pkt->IngestTime() : 0;
+        taken_frames++;
+        lag_sum += lag;
+        lag_max = std::max(lag_max,lag);
+        user->out_frames_.emplace_back(std::move(pkt));
+    }
+    if(dropped_frames > 0)
+    {
+        user->dropped_frames_ += dropped_frames;
+        user->dropped_bytes_ += dropped_bytes;
+        sLiveService->AddDroppedFrames(dropped_frames,dropped_bytes);
+    }
+    if(taken_frames > 0)
+    {
+        sLiveService->AddSendLatency(taken_frames,lag_sum,lag_max);
     }
 }
 
@@ -3,6 +3,8 @@
 #include "live/base/TimeCorrector.h"
 #include "live/base/GopMgr.h"
 #include "live/base/CodecHeader.h"
+#include "live/base/PacketRing.h"
+#include "live/base/FrameBatch.h"
 #include "mmedia/base/Packet.h"
 #include "live/user/PlayerUser.h"
 #include "live/user/User.h"
@@ -22,6 +24,20 @@ namespace tmms
         using UserPtr = std::shared_ptr<User>;
         using PlayerUserPtr = std::shared_ptr<PlayerUser>;
         class Session;
+
+        // 一路流持有的媒体内存，字节 (Media memory held by one stream, in bytes)
+        struct StreamMemory
+        {
+            int64_t ring{0};      // 环形缓冲区里的帧，也就是 GOP 缓存 (frames in the ring, i.e. the GOP cache)
+            int64_t codec{0};     // 编码头和 meta 的历史 (codec header and metadata history)
+            int64_t hls{0};       // HLS 分片窗口，包括空闲分片 (HLS fragment window, idle fragments included)
+            int64_t players{0};   // 播放者连接里还没写出的字节 (bytes queued on player connections)
+            int64_t Total() const
+            {
+                return ring + codec + hls + players;
+            }
+        };
+
         class Stream
         {
         public:
@@ -37,8 +53,31 @@ namespace tmms
             bool Ready() const;
 
             void AddPacket(PacketPtr && packet);
+            // 环形缓冲区的帧数，只在收到第一帧之前生效 (Ring size in frames; only takes effect before the first frame)
+            void SetBufferSize(uint32_t size);
+            // 环形缓冲区、编码头历史和 HLS 分片占的内存，不含播放者 (Memory of the ring, codec history and HLS fragments; players not included)
+            StreamMemory Memory();
+            // 从最老的帧开始按整个 GOP 裁掉至少 bytes 字节，不动 players 还要发的帧和最新的 GOP，返回释放的字节数
+            // Trims whole GOPs from the oldest frame until at least bytes are freed, keeping frames any of
+            // players still has to send and the latest GOP; returns the bytes freed.
+            int64_t Trim(int64_t bytes, const std::vector<PlayerUserPtr> &players);
+            // 释放空闲的 HLS 分片 (Releases idle HLS fragments)
+            int64_t ShrinkIdle()
+            {
+                return muxer_.ShrinkIdle();
+            }
 
-            void GetFrames(const PlayerUserPtr &user);
+            // 取下一批帧放进播放者的输出队列。调用方要持有 user 的引用：超限断开时连接会被同步关闭。
+            // 已经定位过的播放者不拿 lock_，直接从环形缓冲区无锁地读
+            // Fetches the next frames into the player's queue. The caller must keep user alive: a player
+            // over its limit gets its connection closed synchronously. A player that has located its
+            // GOP reads the ring lock-free without taking lock_.
+            void GetFrames(PlayerUser *user);
+            // 最近一秒多的流码率（字节/秒）
+            int64_t Bitrate() const
+            {
+                return bitrate_;
+            }
             bool HasVideo()const;
             bool HasAudio() const;
             std::string PlayList()
@@ -51,9 +90,20 @@ namespace tmms
             }
         private:
             void ProcessHls(PacketPtr &packet);
-            bool LocateGop(const PlayerUserPtr &user);
-            void SkipFrame(const PlayerUserPtr &user);
-            void GetNextFrame(const PlayerUserPtr &user); 
+            bool LocateGop(PlayerUser *user);
+            void SkipFrame(PlayerUser *user);
+            // 按 app 的慢播放者策略检查输出积压，返回 false 表示应断开播放者
+            bool CheckOutputLimit(PlayerUser *user);
+            // 延迟模式下按流码率设置播放连接的发送缓冲区
+            void TuneSocket(PlayerUser *user);
+            // 从第 index 帧到最新帧的字节数，index 已被覆盖时从最老的一帧算起
+            int64_t BytesFrom(int64_t index) const;
+            // 同上，按调用方读好的总字节数算，几次调用用同一个 total 相减才一致
+            // (Same, against a total the caller already read; differences need one total for every call)
+            int64_t BytesFrom(int64_t index, int64_t total) const;
+            // 这一批的字节和时长上限，from_timestamp 是这一批第一帧的时间戳
+            FrameBatch BatchLimit(PlayerUser *user, int64_t from_timestamp) const;
+            void GetNextFrame(PlayerUser *user); 
 
             void SetReady(bool ready);
             int64_t data_coming_time_{0};
@@ -64,7 +114,13 @@ namespace tmms
             std::string session_name_;
             std::atomic<int64_t> frame_index_{-1}; 
             uint32_t packet_buffer_size_{1000};
-            std::vector<PacketPtr> packet_buffer_;
+            PacketRing packet_buffer_;  // 最近的帧和每帧之前流的累计字节数，写入在 lock_ 里
+            std::atomic<int64_t> total_bytes_{0};
+            int64_t ring_bytes_{0};     // 环形缓冲区里的包占的内存
+            std::atomic<int64_t> trim_index_{0};     // 这之前的帧已被裁掉
+            int64_t bitrate_time_{0};
+            int64_t bitrate_bytes_{0};
+            std::atomic<int64_t> bitrate_{0};
             bool has_audio_{false};
             bool has_video_{false};
             bool has_meta_{false};
@@ -43,8 +43,7 @@ void WebrtcService::OnStun(const network::UdpSocketPtr &socket,const network::In
         if(packet)
         {
             auto server = sLiveService->GetWebrtcServer();
-            auto naddr = webrtc_user->GetSockAddr();
-            packet->SetExt(naddr);
+            packet->SetDestAddr(*webrtc_user->GetSockAddr());
             server->SendPacket(packet);
         }            
     }
@@ -52,16 +51,16 @@ void WebrtcService::OnStun(const network::UdpSocketPtr &socket,const network::In
 
     if(webrtc_user)
     {
-        auto iter1 = users_.find(addr.ToIpPort());
+        auto iter1 = users_.find(addr);
         if(iter1 == users_.end())
         {
-            users_.emplace(addr.ToIpPort(),webrtc_user);
+            users_.emplace(addr,webrtc_user);
         }
     } 
 }
 void WebrtcService::OnDtls(const network::UdpSocketPtr &socket,const network::InetAddress &addr,network::MsgBuffer &buf)
 {
-    auto iter = users_.find(addr.ToIpPort());
+    auto iter = users_.find(addr);
     if(iter != users_.end())
     {
         auto webrtc_user = iter->second;
@@ -75,7 +74,7 @@ void WebrtcService::OnRtp(const network::UdpSocketPtr &socket,const network::Ine
 }
 void WebrtcService::OnRtcp(const network::UdpSocketPtr &socket,const network::InetAddress &addr,network::MsgBuffer &buf)
 {
-    auto iter = users_.find(addr.ToIpPort());
+    auto iter = users_.find(addr);
     if(iter != users_.end())
     {
         auto webrtc_user = iter->second;
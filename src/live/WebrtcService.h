@@ -37,7 +37,7 @@ namespace tmms
             std::mutex lock_;
             std::unordered_map<std::string,WebrtcPlayerUserPtr> name_users_;
             std::mutex users_lock_;
-            std::unordered_map<std::string,WebrtcPlayerUserPtr> users_;
+            std::unordered_map<network::InetAddress,WebrtcPlayerUserPtr> users_;  // 按对端二进制地址分发 (demux by binary peer address)
         };
         #define sWebrtcService tmms::base::Singleton<tmms::live::WebrtcService>::Instance()
     }
@@ -16,63 +16,51 @@ CodecHeader::~CodecHeader()
 
 }
 
-PacketPtr  CodecHeader::Meta(int idx)
+const size_t CodecHeader::kHistoryCapacity;
+
+PacketPtr CodecHeader::Find(const IndexRing<PacketPtr> &packets,int idx,const PacketPtr &lastest) const
 {
     if(idx <= 0)
     {
-        return meta_;
+        return lastest;
     }
-    auto iter = meta_packets_.rbegin();
-    for(;iter!=meta_packets_.rend();iter++)
-    {
-        PacketPtr pkt = *iter;
-        if(pkt->Index() <= idx)
-        {
-            return pkt;
-        }
+    // 最后一个不晚于 idx 的版本 (the last version at or before idx)
+    size_t pos = packets.PartitionPoint([idx](const PacketPtr &pkt){
+        return pkt->Index() <= idx;
+    });
+    if(pos == 0)
+    {
+        return lastest;
     }
-    return meta_;
+    return packets.At(pos - 1);
+}
+PacketPtr  CodecHeader::Meta(int idx)
+{
+    return Find(meta_packets_,idx,meta_);
 }
 PacketPtr  CodecHeader::VideoHeader(int idx)
 {
-    if(idx <= 0)
-    {
-        return video_header_;
-    }
-    auto iter = video_header_packets_.rbegin();
-    for(;iter!=video_header_packets_.rend();iter++)
-    {
-        PacketPtr pkt = *iter;
-        if(pkt->Index() <= idx)
-        {
-            return pkt;
-        }
-    }
-    return video_header_;
+    return Find(video_header_packets_,idx,video_header_);
 }
 PacketPtr  CodecHeader::AudioHeader(int idx)
 {
-    if(idx <= 0)
+    return Find(audio_header_packets_,idx,audio_header_);
+}
+void CodecHeader::Save(IndexRing<PacketPtr> &packets,const PacketPtr &packet)
+{
+    PacketPtr dropped;
+    if(packets.PushBack(packet,&dropped))
     {
-        return audio_header_;
-    }
-    auto iter = audio_header_packets_.rbegin();
-    for(;iter!=audio_header_packets_.rend();iter++)
-    {
-        PacketPtr pkt = *iter;
-        if(pkt->Index() <= idx)
-        {
-            return pkt;
-        }
+        bytes_ -= dropped->MemoryBytes();
     }
-    return audio_header_;
+    bytes_ += packet->MemoryBytes();
 }
 void CodecHeader::SaveMeta(const PacketPtr &packet)
 {
     meta_ = packet;
     ++ meta_version_;
 
-    meta_packets_.emplace_back(packet);
+    Save(meta_packets_,packet);
 
     LIVE_TRACE << "save meta ,meta version:" << meta_version_
                 << ",size:" << packet->PacketSize()
@@ -157,7 +145,7 @@ void CodecHeader::SaveAudioHeader(const PacketPtr &packet)
     audio_header_ = packet;
     ++ audio_version_;
 
-    audio_header_packets_.emplace_back(packet);
+    Save(audio_header_packets_,packet);
 
     LIVE_TRACE << "save audio header ,version:" << audio_version_
                 << ",size:" << packet->PacketSize()
@@ -168,7 +156,7 @@ void CodecHeader::SaveVideoHeader(const PacketPtr &packet)
     video_header_ = packet;
     ++ video_version_;
 
-    video_header_packets_.emplace_back(packet);
+    Save(video_header_packets_,packet);
 
     LIVE_TRACE << "save video header ,version:" << video_version_
                 << ",size:" << packet->PacketSize()
@@ -190,4 +178,27 @@ bool CodecHeader::ParseCodecHeader(const PacketPtr &packet)
         SaveVideoHeader(packet);
     }
     return true;
-}
\ No newline at end of file
+}
+void CodecHeader::TrimHistory(IndexRing<PacketPtr> &packets,int64_t min_idx)
+{
+    // 最后一个不晚于 min_idx 的版本还要留着，更早的没有人会再取到
+    // (The last version at or before min_idx is still needed; nothing can reach the older ones)
+    size_t pos = packets.PartitionPoint([min_idx](const PacketPtr &pkt){
+        return pkt->Index() <= min_idx;
+    });
+    for(size_t i = 1; i < pos; i++)
+    {
+        bytes_ -= packets.Front()->MemoryBytes();
+        packets.PopFront();
+    }
+}
+void CodecHeader::Trim(int64_t min_idx)
+{
+    TrimHistory(meta_packets_,min_idx);
+    TrimHistory(audio_header_packets_,min_idx);
+    TrimHistory(video_header_packets_,min_idx);
+}
+int64_t CodecHeader::Bytes() const
+{
+    return bytes_;
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include "mmedia/base/Packet.h"
+#include "live/base/IndexRing.h"
 #include <vector>
 #include <memory>
 #include <cstdint>
@@ -10,12 +11,22 @@ namespace tmms
     {
         using namespace tmms::mm;
 
+        // CodecHeader：一路流的编码头和 meta，连同环形缓冲区里的帧还用得到的历史版本。
+        // 历史按包序号存在固定容量的环里，播放者按帧号二分查找；推流方在一个窗口里改了太多次时
+        // 挤掉最旧的版本。
+        // CodecHeader: a stream's codec headers and metadata, with the older versions frames in the
+        // ring still need. The history lives in fixed-capacity rings ordered by packet index that
+        // players binary-search by frame index; a publisher changing them too often within one window
+        // pushes out the oldest versions.
         class CodecHeader
         {
         public:
+            static const size_t kHistoryCapacity = 64;
+
             CodecHeader();
             ~CodecHeader();
 
+            // 第 idx 帧该用的版本，idx <= 0 时是最新的 (The version frame idx should use; the latest when idx <= 0)
             PacketPtr  Meta(int idx);
             PacketPtr  VideoHeader(int idx);
             PacketPtr  AudioHeader(int idx);
@@ -24,18 +35,28 @@ namespace tmms
             void SaveAudioHeader(const PacketPtr &packet);
             void SaveVideoHeader(const PacketPtr &packet);
             bool ParseCodecHeader(const PacketPtr &packet);
+            // 去掉被 min_idx 之前更新的版本取代的历史，min_idx 是环形缓冲区里最老的帧
+            // (Drops history entries superseded by a newer one at or before min_idx, the oldest frame in the ring)
+            void Trim(int64_t min_idx);
+            // 历史里的包占的字节 (Bytes held by the history packets)
+            int64_t Bytes() const;
 
         private:
+            PacketPtr Find(const IndexRing<PacketPtr> &packets,int idx,const PacketPtr &lastest) const;
+            void Save(IndexRing<PacketPtr> &packets,const PacketPtr &packet);
+            void TrimHistory(IndexRing<PacketPtr> &packets,int64_t min_idx);
+
             PacketPtr video_header_;
             PacketPtr audio_header_;
             PacketPtr meta_;
             int meta_version_{0};
             int audio_version_{0};
             int video_version_{0};
-            std::vector<PacketPtr> video_header_packets_;
-            std::vector<PacketPtr> audio_header_packets_;
-            std::vector<PacketPtr> meta_packets_;
+            IndexRing<PacketPtr> video_header_packets_{kHistoryCapacity};
+            IndexRing<PacketPtr> audio_header_packets_{kHistoryCapacity};
+            IndexRing<PacketPtr> meta_packets_{kHistoryCapacity};
             int64_t start_timestamp_{0};
+            int64_t bytes_{0};
         };
     }
 }
\ No newline at end of file
@@ -23,4 +23,45 @@ bool CodecUtils::IsKeyFrame(const PacketPtr &packet)
         return ((*b>>4)&0x0f) == 1;
     }
     return false;
+}
+bool CodecUtils::IsNonReferenceFrame(const PacketPtr &packet)
+{
+    if(packet->PacketSize()<2)
+    {
+        return false;
+    }
+    const uint8_t *b = (const uint8_t*)packet->Data();
+    int frame_type = (b[0]>>4)&0x0f;
+    if(frame_type == 3) // disposable inter frame
+    {
+        return true;
+    }
+    // 只认识 AVC NALU（codec id 7，AVCPacketType 1），NALU 前面是 4 字节长度
+    if(frame_type != 2 || (b[0]&0x0f) != 7 || b[1] != 1)
+    {
+        return false;
+    }
+    int32_t size = packet->PacketSize();
+    int32_t pos = 5;
+    bool has_slice = false;
+    while(pos + 4 < size)
+    {
+        uint32_t len = ((uint32_t)b[pos]<<24)|((uint32_t)b[pos+1]<<16)|((uint32_t)b[pos+2]<<8)|b[pos+3];
+        pos += 4;
+        if(len == 0 || len > (uint32_t)(size - pos))
+        {
+            return false;
+        }
+        int nal_type = b[pos]&0x1f;
+        if(nal_type >= 1 && nal_type <= 5)
+        {
+            if((b[pos]&0x60) != 0)
+            {
+                return false;
+            }
+            has_slice = true;
+        }
+        pos += len;
+    }
+    return has_slice;
 }
\ No newline at end of file
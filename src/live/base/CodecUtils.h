@@ -12,6 +12,8 @@ namespace tmms
         public:
             static bool IsCodecHeader(const PacketPtr &packet);
             static bool IsKeyFrame(const PacketPtr &packet);
+            // FLV 帧类型为 disposable，或 H.264 帧里所有 slice 的 nal_ref_idc 都是 0
+            static bool IsNonReferenceFrame(const PacketPtr &packet);
         };
     }
 }
\ No newline at end of file
@@ -0,0 +1,41 @@
+#include "FrameBatch.h"
+#include <algorithm>
+
+using namespace tmms::live;
+
+const int FrameBatch::kMaxCatchUp;
+const int FrameBatch::kMaxFrames;
+const uint32_t FrameBatch::kBusyPermille;
+const uint32_t FrameBatch::kSaturatedPermille;
+
+FrameBatch FrameBatch::Limit(int64_t max_bytes, int64_t max_time,
+                             int64_t backlog_bytes, int64_t backlog_time,
+                             uint32_t busy_permille)
+{
+    // 落后几批就放大几倍，按字节和时长里落后更多的那个算
+    // Scale by how many batches behind the player is, whichever of bytes and time is further behind
+    int64_t scale = 1;
+    if(max_bytes > 0)
+    {
+        scale = std::max<int64_t>(scale,backlog_bytes / max_bytes);
+    }
+    if(max_time > 0)
+    {
+        scale = std::max<int64_t>(scale,backlog_time / max_time);
+    }
+    int64_t cap = kMaxCatchUp;
+    if(busy_permille >= kSaturatedPermille)
+    {
+        cap = 1;
+    }
+    else if(busy_permille >= kBusyPermille)
+    {
+        cap = std::max<int64_t>(kMaxCatchUp / 2,1);
+    }
+    scale = std::min(scale,cap);
+
+    FrameBatch batch;
+    batch.bytes = max_bytes * scale;
+    batch.time = max_time * scale;
+    return batch;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+namespace tmms
+{
+    namespace live
+    {
+        // FrameBatch：播放者一次从流里取多少帧，用字节数和媒体时长表示。
+        // 基础上限来自 app 的 out_batch_max_bytes 和 out_batch_max_time。播放者落后超过一批时按落后的
+        // 倍数放大，最多 kMaxCatchUp 倍，让追赶的播放者尽快追上；所在循环忙的时候少放大，免得一个追赶的
+        // 播放者占住循环，拖慢同一循环上的其他连接。不落后的播放者本来就只有几帧可取，延迟不受影响。
+        // 不管上限多小，一批至少一帧；帧数另有 kMaxFrames 的硬上限，纯音频这种小帧不会一次堆太多节点。
+        // FrameBatch: how much a player takes from the stream at a time, in bytes and media time.
+        // The base limits come from the app's out_batch_max_bytes and out_batch_max_time. A player
+        // more than one batch behind gets them scaled by how far behind it is, up to kMaxCatchUp times,
+        // so it catches up quickly; on a busy loop the scaling is cut back so one catching-up player
+        // does not hold the loop and delay the other connections on it. A player that is not behind
+        // only has a few frames to take anyway, so its latency is unaffected.
+        // A batch always takes at least one frame, and kMaxFrames caps the frame count so tiny frames
+        // such as pure audio do not pile up too many send nodes at once.
+        struct FrameBatch
+        {
+            static const int kMaxCatchUp = 4;
+            static const int kMaxFrames = 256;
+            static const uint32_t kBusyPermille = 800;      // 超过这个忙碌比例只放大一半 (above this busy ratio only half the scaling)
+            static const uint32_t kSaturatedPermille = 950; // 超过这个不放大 (above this no scaling)
+
+            // 按落后的字节数、时长和循环的忙碌千分比算出这一批的上限
+            // Computes this batch's limits from the backlog in bytes and time and the loop's busy permille
+            static FrameBatch Limit(int64_t max_bytes, int64_t max_time,
+                                    int64_t backlog_bytes, int64_t backlog_time,
+                                    uint32_t busy_permille);
+
+            // 已经取了 bytes 字节、跨度 span 毫秒，是否装满 (Whether bytes taken over span ms fill the batch)
+            bool Full(int64_t taken_bytes, int64_t span, int frames) const
+            {
+                return frames >= kMaxFrames
+                        || (bytes > 0 && taken_bytes >= bytes)
+                        || (time > 0 && span >= time);
+            }
+
+            int64_t bytes{0};   // 0 表示不按字节限制 (0 means no byte limit)
+            int64_t time{0};    // 毫秒，0 表示不按时长限制 (ms, 0 means no time limit)
+        };
+    }
+}
@@ -3,13 +3,21 @@
 
 using namespace tmms::live;
 
+GopMgr::GopMgr(size_t capacity)
+:gops_(capacity)
+{
+}
+void GopMgr::SetCapacity(size_t capacity)
+{
+    gops_.SetCapacity(capacity);
+}
 void GopMgr::AddFrame(const PacketPtr &packet)
 {
     lastest_timestamp_ = packet->TimeStamp();
 
     if(packet->IsKeyFrame())
     {
-        gops_.emplace_back(packet->Index(),packet->TimeStamp());
+        gops_.PushBack(GopItemInfo(packet->Index(),packet->TimeStamp()));
         max_gop_length_ = std::max(max_gop_length_,gop_length_);
         total_gop_length_ += gop_length_;
         gop_numbers_ ++;
@@ -23,44 +31,42 @@ int32_t GopMgr::MaxGopLength() const
 }
 size_t GopMgr::GopSize() const
 {
-    return gops_.size();
+    return gops_.Size();
 }
 int GopMgr::GetGopByLatency(int content_latency, int &latency) const
 {
-    int got = -1;
     latency = 0;
-    auto iter = gops_.rbegin();
-    for(;iter!=gops_.rend();++iter)
+    // 时间戳经过 TimeCorrector 校正，按 GOP 顺序递增
+    // (timestamps are corrected by TimeCorrector and grow in GOP order)
+    int64_t lastest = lastest_timestamp_;
+    int64_t oldest = lastest - content_latency;
+    size_t pos = gops_.PartitionPoint([oldest](const GopItemInfo &g){
+        return g.timestamp < oldest;
+    });
+    if(pos == gops_.Size())
     {
-        int item_latency = lastest_timestamp_ - iter->timestamp;
-        if(item_latency<=content_latency)
-        {
-            got = iter->index;
-            latency = item_latency;
-        }
-        else 
-        {
-            break;
-        }
+        return -1;
     }
-    return got;
+    auto &gop = gops_.At(pos);
+    latency = lastest - gop.timestamp;
+    return gop.index;
 }
-void GopMgr::ClearExpriedGop(int min_idx)
+int32_t GopMgr::GopByIndex(int64_t index) const
 {
-    if(gops_.empty())
+    size_t pos = gops_.PartitionPoint([index](const GopItemInfo &g){
+        return g.index <= index;
+    });
+    if(pos == 0)
     {
-        return ;
+        return -1;
     }
-    for(auto iter = gops_.begin();iter!= gops_.end();)
+    return gops_.At(pos - 1).index;
+}
+void GopMgr::ClearExpriedGop(int min_idx)
+{
+    while(!gops_.Empty() && gops_.Front().index <= min_idx)
     {
-        if(iter->index <= min_idx)
-        {
-            iter = gops_.erase(iter);
-        }
-        else 
-        {
-            iter++;
-        }
+        gops_.PopFront();
     }
 }
 
@@ -69,9 +75,10 @@ void GopMgr::PrintAllGop()
     std::stringstream ss;
 
     ss << "all gop:";
-    for(auto iter = gops_.begin();iter!= gops_.end();iter++)
+    for(size_t i = 0; i < gops_.Size(); i++)
     {
-        ss << "[" << iter->index <<","<< iter->timestamp<< "]";
+        auto &gop = gops_.At(i);
+        ss << "[" << gop.index <<","<< gop.timestamp<< "]";
     }
     LIVE_TRACE << ss.str() << "\n";
-}
\ No newline at end of file
+}
@@ -1,9 +1,11 @@
 #pragma once
 
 #include "mmedia/base/Packet.h"
+#include "live/base/IndexRing.h"
 #include <vector>
 #include <memory>
 #include <cstdint>
+#include <atomic>
 
 namespace tmms
 {
@@ -13,8 +15,9 @@ namespace tmms
 
         struct GopItemInfo
         {
-            int32_t index;
-            int64_t timestamp;
+            int32_t index{-1};
+            int64_t timestamp{0};
+            GopItemInfo() = default;
             GopItemInfo(int32_t i,int64_t t)
             :index(i),timestamp(t)
             {}
@@ -23,26 +26,38 @@ namespace tmms
         class GopMgr
         {
         public:
-            GopMgr() = default;
+            // capacity 是最多记住的 GOP 数，取环形缓冲区的帧数就够了：每帧都是关键帧也装得下
+            // capacity is the most GOPs remembered; the ring's frame count is enough even if every frame is a keyframe
+            explicit GopMgr(size_t capacity = 1000);
             ~GopMgr(){};
+            void SetCapacity(size_t capacity);
 
             void AddFrame(const PacketPtr &packet);
             int32_t MaxGopLength() const;
             size_t GopSize() const;
+            // 延迟不超过 content_latency 的最老的 GOP 的起始帧，二分查找 (The oldest GOP within content_latency; binary search)
             int GetGopByLatency(int content_latency, int &latency) const;
+            // 第 index 帧所在 GOP 的起始帧，不在记录里时返回 -1，二分查找
+            // (First frame of the GOP holding frame index, -1 if not remembered; binary search)
+            int32_t GopByIndex(int64_t index) const;
             void ClearExpriedGop(int min_idx);
+            // 最新的 GOP 的起始帧，没有时返回 -1 (Index of the latest GOP's first frame, -1 if none)
+            int32_t LastGopIndex() const
+            {
+                return gops_.Empty() ? -1 : gops_.Back().index;
+            }
             void PrintAllGop();
             int64_t LastestTimeStamp() const
             {
                 return lastest_timestamp_;
             }
         private:
-            std::vector<GopItemInfo> gops_;
+            IndexRing<GopItemInfo> gops_;
             int32_t gop_length_{0};
             int32_t max_gop_length_{0};
             int32_t gop_numbers_{0};
             int32_t total_gop_length_{0};
-            int64_t lastest_timestamp_{0};
+            std::atomic<int64_t> lastest_timestamp_{0};   // 播放者不拿锁读 (read by players without the lock)
         };
 
     }
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <utility>
+
+namespace tmms
+{
+    namespace live
+    {
+        // IndexRing：固定容量的环形数组，元素按包序号从旧到新追加，从最旧的一头删除。
+        // 满了再追加会挤掉最旧的一个。元素按序号（和时间戳）有序，所以用 PartitionPoint 二分查找。
+        // 只在流的 lock_ 里用，不带锁。
+        // IndexRing: a fixed-capacity ring of elements appended oldest to newest by packet index and
+        // removed from the oldest end. Appending when full pushes out the oldest one. Elements are
+        // ordered by index (and timestamp), so PartitionPoint finds things by binary search.
+        // Used under the stream's lock_; no locking of its own.
+        template <typename T>
+        class IndexRing
+        {
+        public:
+            explicit IndexRing(size_t capacity)
+            : items_(capacity > 0 ? capacity : 1)
+            {
+            }
+
+            size_t Size() const
+            {
+                return size_;
+            }
+            bool Empty() const
+            {
+                return size_ == 0;
+            }
+            size_t Capacity() const
+            {
+                return items_.size();
+            }
+            // 第 i 个，0 是最旧的 (The i-th element, 0 being the oldest)
+            const T &At(size_t i) const
+            {
+                return items_[(head_ + i) % items_.size()];
+            }
+            const T &Front() const
+            {
+                return At(0);
+            }
+            const T &Back() const
+            {
+                return At(size_ - 1);
+            }
+
+            // 追加一个，满了挤掉最旧的，被挤掉的放进 dropped，返回是否挤掉了
+            // Appends one; when full the oldest is pushed out into dropped. Returns whether one was.
+            bool PushBack(T item, T *dropped = nullptr)
+            {
+                bool full = size_ == items_.size();
+                if(full)
+                {
+                    if(dropped)
+                    {
+                        *dropped = std::move(items_[head_]);
+                    }
+                    items_[head_] = std::move(item);
+                    head_ = (head_ + 1) % items_.size();
+                    return true;
+                }
+                items_[(head_ + size_) % items_.size()] = std::move(item);
+                size_++;
+                return false;
+            }
+            void PopFront()
+            {
+                items_[head_] = T();
+                head_ = (head_ + 1) % items_.size();
+                size_--;
+            }
+            void Clear()
+            {
+                while(size_ > 0)
+                {
+                    PopFront();
+                }
+                head_ = 0;
+            }
+            // 改容量，留下最新的那些 (Changes the capacity, keeping the newest elements)
+            void SetCapacity(size_t capacity)
+            {
+                capacity = capacity > 0 ? capacity : 1;
+                std::vector<T> items(capacity);
+                size_t keep = size_ < capacity ? size_ : capacity;
+                for(size_t i = 0; i < keep; i++)
+                {
+                    items[i] = std::move(items_[(head_ + size_ - keep + i) % items_.size()]);
+                }
+                items_.swap(items);
+                head_ = 0;
+                size_ = keep;
+            }
+
+            // 第一个让 pred 为 false 的位置，pred 在前面一段为 true、后面为 false；都为 true 时返回 Size()
+            // The first position where pred is false, pred being true for a prefix and false after it;
+            // Size() when it holds everywhere.
+            template <typename Pred>
+            size_t PartitionPoint(Pred pred) const
+            {
+                size_t lo = 0, hi = size_;
+                while(lo < hi)
+                {
+                    size_t mid = lo + (hi - lo) / 2;
+                    if(pred(At(mid)))
+                    {
+                        lo = mid + 1;
+                    }
+                    else
+                    {
+                        hi = mid;
+                    }
+                }
+                return lo;
+            }
+
+        private:
+            std::vector<T> items_;
+            size_t head_{0};
+            size_t size_{0};
+        };
+    }
+}
@@ -0,0 +1,213 @@
+#include "PacketRing.h"
+#include <limits>
+
+using namespace tmms::live;
+
+namespace
+{
+    const int64_t kSlotWriting = -2;    // 槽正在被写 (the slot is being written)
+    const size_t kReclaimBatch = 64;    // 攒够这么多退役包才去扫读者 (retired packets gathered before scanning readers)
+    const int kFreePerRetire = 2;       // 每退役一个顺带释放几个，把释放摊开 (packets freed along with each retirement, spreading the frees out)
+
+    // 每个读过环形缓冲区的线程一条记录，0 表示不在临界区里。线程退出后记录留给别的线程复用
+    // One record per thread that has read a ring; 0 means outside a critical section. A record is
+    // reused by other threads after its thread exits.
+    struct EpochRecord
+    {
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<bool> in_use{true};
+        EpochRecord *next{nullptr};
+        char padding[104];  // 两条记录的 epoch 不落在同一个缓存行 (keeps two records' epochs off one cache line)
+    };
+
+    std::atomic<uint64_t> global_epoch{1};
+    std::atomic<EpochRecord*> records{nullptr};
+
+    EpochRecord *AcquireRecord()
+    {
+        for(auto r = records.load(std::memory_order_acquire); r; r = r->next)
+        {
+            bool expected = false;
+            if(!r->in_use.load(std::memory_order_relaxed)
+                && r->in_use.compare_exchange_strong(expected,true))
+            {
+                return r;
+            }
+        }
+        auto r = new EpochRecord();     // 不释放，一直留在链表里 (never freed; stays on the list)
+        r->next = records.load(std::memory_order_relaxed);
+        while(!records.compare_exchange_weak(r->next,r,std::memory_order_release,std::memory_order_relaxed))
+        {
+        }
+        return r;
+    }
+
+    struct ThreadEpoch
+    {
+        ~ThreadEpoch()
+        {
+            if(record)
+            {
+                record->epoch.store(0,std::memory_order_release);
+                record->in_use.store(false,std::memory_order_release);
+            }
+        }
+        EpochRecord *record{nullptr};
+        int depth{0};
+    };
+    thread_local ThreadEpoch thread_epoch;
+
+    // 正在临界区里的读者里最早的纪元，没有读者时是最大值
+    // (The earliest epoch among readers inside a critical section; the maximum when there are none)
+    uint64_t MinActiveEpoch()
+    {
+        // 和读者进入时的 fence 配对：没看到它的记录，它就一定能看到退役前写好的槽
+        // Pairs with the readers' fence on entry: a reader whose record is not seen here is bound to
+        // see the slot as rewritten before the retirement.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t min = std::numeric_limits<uint64_t>::max();
+        for(auto r = records.load(std::memory_order_acquire); r; r = r->next)
+        {
+            uint64_t e = r->epoch.load(std::memory_order_acquire);
+            if(e != 0 && e < min)
+            {
+                min = e;
+            }
+        }
+        return min;
+    }
+}
+
+PacketRing::ReadGuard::ReadGuard()
+{
+    ThreadEpoch &t = thread_epoch;
+    if(t.depth++ == 0)
+    {
+        if(!t.record)
+        {
+            t.record = AcquireRecord();
+        }
+        t.record->epoch.store(global_epoch.load(std::memory_order_acquire),std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+PacketRing::ReadGuard::~ReadGuard()
+{
+    ThreadEpoch &t = thread_epoch;
+    if(--t.depth == 0)
+    {
+        t.record->epoch.store(0,std::memory_order_release);
+    }
+}
+
+PacketRing::PacketRing(uint32_t size)
+:size_(size),slots_(size),packets_(size)
+{
+}
+void PacketRing::Resize(uint32_t size)
+{
+    size_ = size;
+    std::vector<Slot>(size).swap(slots_);
+    packets_.assign(size,PacketPtr());
+}
+void PacketRing::Write(Slot &slot, int64_t index, Packet *packet, int64_t offset)
+{
+    slot.seq.store(kSlotWriting,std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.packet.store(packet,std::memory_order_relaxed);
+    slot.offset.store(offset,std::memory_order_relaxed);
+    slot.seq.store(index,std::memory_order_release);
+}
+void PacketRing::Retire(PacketPtr &&packet)
+{
+    // 纪元在槽改写之后推进：在新纪元里进来的读者一定看到改写后的槽
+    // The epoch advances after the slot is rewritten: readers entering in the new epoch see the new slot
+    uint64_t epoch = global_epoch.fetch_add(1,std::memory_order_acq_rel);
+    retired_.emplace_back(RetiredPacket{epoch,std::move(packet)});
+    // 一次只释放几个，不让某一帧的写入一下子释放一整批
+    // Only a few at a time, so no single publish frees a whole batch
+    if(retired_.size() >= kReclaimBatch && retired_.front().epoch >= safe_epoch_)
+    {
+        safe_epoch_ = MinActiveEpoch();
+    }
+    for(int i = 0; i < kFreePerRetire && !retired_.empty() && retired_.front().epoch < safe_epoch_; i++)
+    {
+        retired_.pop_front();
+    }
+}
+void PacketRing::Reclaim()
+{
+    if(retired_.empty())
+    {
+        return;
+    }
+    safe_epoch_ = MinActiveEpoch();
+    // 退役纪元按顺序递增 (retirement epochs only grow)
+    while(!retired_.empty() && retired_.front().epoch < safe_epoch_)
+    {
+        retired_.pop_front();
+    }
+}
+void PacketRing::Publish(int64_t index, PacketPtr &&packet, int64_t offset)
+{
+    auto i = index % size_;
+    PacketPtr old = std::move(packets_[i]);
+    packets_[i] = std::move(packet);
+    Write(slots_[i],index,packets_[i].get(),offset);
+    last_.store(index,std::memory_order_release);
+    if(old)
+    {
+        Retire(std::move(old));
+    }
+}
+void PacketRing::Clear(int64_t index)
+{
+    auto i = index % size_;
+    Slot &slot = slots_[i];
+    if(!packets_[i] || slot.seq.load(std::memory_order_relaxed) != index)
+    {
+        return;
+    }
+    Write(slot,index,nullptr,slot.offset.load(std::memory_order_relaxed));
+    Retire(std::move(packets_[i]));
+}
+PacketPtr PacketRing::Get(int64_t index) const
+{
+    if(index < 0)
+    {
+        return PacketPtr();
+    }
+    const Slot &slot = slots_[index % size_];
+    if(slot.seq.load(std::memory_order_acquire) != index)
+    {
+        return PacketPtr();
+    }
+    Packet *packet = slot.packet.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(slot.seq.load(std::memory_order_relaxed) != index)
+    {
+        return PacketPtr();
+    }
+    // 读到的包要么还在槽里，要么已退役但还没释放 (the packet is still in the slot, or retired but not yet freed)
+    return PacketPtr::Ref(packet);
+}
+bool PacketRing::Offset(int64_t index, int64_t &offset) const
+{
+    if(index < 0)
+    {
+        return false;
+    }
+    const Slot &slot = slots_[index % size_];
+    if(slot.seq.load(std::memory_order_acquire) != index)
+    {
+        return false;
+    }
+    int64_t value = slot.offset.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if(slot.seq.load(std::memory_order_relaxed) != index)
+    {
+        return false;
+    }
+    offset = value;
+    return true;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "mmedia/base/Packet.h"
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <cstdint>
+
+namespace tmms
+{
+    namespace live
+    {
+        using namespace tmms::mm;
+
+        // PacketRing：一写多读的无锁环形缓冲区，存一路流最近的帧和每帧之前的累计字节数。
+        // 写者（推流所在的线程，裁剪时是主线程，由调用方串行化）按序号写槽：先把槽的序号标成正在写，
+        // 写入包指针和字节偏移，再用 release 写回序号。读者在任何线程上读，读前读后各看一次序号，
+        // 两次都等于要读的帧号才算读到。被覆盖或被裁掉的包不马上释放，先按当前纪元退役，
+        // 等所有在更早纪元里进来的读者都离开之后才释放，所以读者在 ReadGuard 里拿到的裸指针
+        // 一直有效，可以放心地加引用。
+        // PacketRing: a lock-free single-writer multi-reader ring holding a stream's latest frames and
+        // the stream byte count before each frame.
+        // The writer (the publisher's thread, or the main thread when trimming; the caller serializes
+        // them) marks the slot as being written, stores the packet pointer and byte offset, and then
+        // stores the sequence number back with release. Readers on any thread check the sequence
+        // before and after reading; the read counts only when both equal the wanted frame.
+        // Overwritten or trimmed packets are not freed at once. They are retired with the current
+        // epoch and freed once every reader that entered in an earlier epoch has left, so a raw
+        // pointer a reader gets inside a ReadGuard stays valid long enough to take a reference.
+        class PacketRing
+        {
+        public:
+            // 读者的纪元临界区，可以嵌套 (A reader's epoch critical section; may nest)
+            class ReadGuard
+            {
+            public:
+                ReadGuard();
+                ~ReadGuard();
+                ReadGuard(const ReadGuard &) = delete;
+                ReadGuard &operator=(const ReadGuard &) = delete;
+            };
+
+            explicit PacketRing(uint32_t size);
+            ~PacketRing() = default;
+
+            // 只能在写入第一帧之前调用 (Only before the first frame is written)
+            void Resize(uint32_t size);
+            uint32_t Size() const
+            {
+                return size_;
+            }
+
+            // 写者接口，调用方保证同一时刻只有一个写者 (Writer side; the caller keeps it to one writer at a time)
+            // 写入第 index 帧和它之前的累计字节数，槽里原来的包退役
+            // Writes frame index and the byte count before it; the slot's old packet is retired
+            void Publish(int64_t index, PacketPtr &&packet, int64_t offset);
+            // 清掉第 index 帧，字节偏移留着 (Clears frame index; its byte offset stays)
+            void Clear(int64_t index);
+            // 写者看槽里的包，不做检查 (The writer's view of a slot; unchecked)
+            const PacketPtr &Owned(int64_t index) const
+            {
+                return packets_[index % size_];
+            }
+            // 释放已经没有读者能看到的退役包 (Frees retired packets no reader can still see)
+            void Reclaim();
+            // 还没释放的退役包数 (Retired packets not yet freed)
+            size_t Retired() const
+            {
+                return retired_.size();
+            }
+
+            // 读者接口，任何线程 (Reader side, any thread)
+            // 已经发布的最新帧号，没有时是 -1 (The latest published frame, -1 if none)
+            int64_t Last() const
+            {
+                return last_.load(std::memory_order_acquire);
+            }
+            // 取第 index 帧，还没写、已被覆盖或裁掉时返回空。必须在 ReadGuard 里调用
+            // Gets frame index; empty when not yet written, overwritten or trimmed. Must be called inside a ReadGuard.
+            PacketPtr Get(int64_t index) const;
+            // 第 index 帧之前的累计字节数，这一帧已被覆盖时返回 false
+            // The byte count before frame index; false when the frame has been overwritten
+            bool Offset(int64_t index, int64_t &offset) const;
+
+        private:
+            struct Slot
+            {
+                std::atomic<int64_t> seq{-1};
+                std::atomic<Packet*> packet{nullptr};
+                std::atomic<int64_t> offset{0};
+            };
+            struct RetiredPacket
+            {
+                uint64_t epoch;
+                PacketPtr packet;
+            };
+            void Write(Slot &slot, int64_t index, Packet *packet, int64_t offset);
+            void Retire(PacketPtr &&packet);
+
+            uint32_t size_{0};
+            std::vector<Slot> slots_;
+            std::vector<PacketPtr> packets_;   // 槽里的包的引用，只有写者碰 (references to the slots' packets; writer only)
+            std::deque<RetiredPacket> retired_;
+            uint64_t safe_epoch_{0};           // 上次扫读者得到的：早于它退役的包都可以释放 (from the last reader scan: packets retired before it can go)
+            std::atomic<int64_t> last_{-1};
+        };
+    }
+}
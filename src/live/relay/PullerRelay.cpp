@@ -53,7 +53,7 @@ bool PullerRelay::GetTargets()
 }
 Puller *PullerRelay::GetPuller(TargetPtr p)
 {
-    current_loop_ = sLiveService->GetNextLoop();
+    current_loop_ = sLiveService->GetNextLoop(session_); // 会话亲和放置时和播放者在同一个循环
     if(p->protocol == "RTMP"||p->protocol == "rtmp")
     {
         return new RtmpPuller(current_loop_,&session_,this);
@@ -113,7 +113,7 @@ void PullerRelay::Pull()
     {
         Puller *p = puller_;
         TargetPtr t = current_target_;
-        current_loop_->RunAfter(current_target_->interval,[p,t](){
+        current_loop_->RunAfter(current_target_->interval/1000.0,[p,t](){ // interval 单位是毫秒
             if(p)
             {
                 p->Pull(t);
@@ -0,0 +1,259 @@
+#include "live/Session.h"
+#include "live/Stream.h"
+#include "live/user/PlayerUser.h"
+#include "live/base/FrameBatch.h"
+#include "base/AppInfo.h"
+#include "base/DomainInfo.h"
+#include "network/net/Connection.h"
+#include "mmedia/base/Packet.h"
+#include <iostream>
+#include <cstring>
+
+using namespace tmms::live;
+using namespace tmms::mm;
+using namespace tmms::base;
+using namespace tmms::network;
+
+// 播放者取帧批量测试：
+// 1. 上限的计算：不落后用基础上限，落后按倍数放大，循环忙时少放大，饱和时不放大。
+// 2. 纯音频（只有开头一帧封面关键帧）：一次到了一秒多的小帧，按时长一批取完大部分，不再是 10 帧。
+// 3. 高码率：300KB 的 IDR 加 60KB 的 P 帧，按字节截断；比上限还大的一帧也照样取。
+// 4. 落后 900 帧的播放者：每批放大到上限的 4 倍，追上需要的批数比固定 10 帧少得多。
+// Player frame batch test:
+// 1. Limits: the base limits when not behind, scaled when behind, scaled less on a busy loop and
+//    not at all on a saturated one.
+// 2. Pure audio (with one cover keyframe at the start): over a second of small frames arrives at
+//    once and one batch takes most of it by time instead of 10 frames.
+// 3. High bitrate: a 300 KB IDR plus 60 KB P frames are cut by bytes; a frame bigger than the whole
+//    limit is still taken.
+// 4. A player 900 frames behind: batches scale to 4 times the limit, so catching up takes far fewer
+//    batches than fixed 10-frame batches.
+
+namespace
+{
+    DomainInfo domain;
+
+    class TestConnection : public Connection
+    {
+    public:
+        TestConnection()
+        : Connection(nullptr, -1, InetAddress(), InetAddress())
+        {
+        }
+        void ForceClose() override
+        {
+        }
+    };
+
+    // 每次取完把帧和编码头都当作已发出 (Treats the frames and codec headers of every fetch as sent)
+    class TestPlayer : public PlayerUser
+    {
+    public:
+        TestPlayer(const ConnectionPtr &conn, const StreamPtr &stream, const SessionPtr &s)
+        : PlayerUser(conn, stream, s)
+        {
+        }
+        bool PostFrames() override
+        {
+            return true;
+        }
+        // 取一批，返回帧数，bytes 和 span 是这一批的字节数和时间跨度 (Fetches one batch; returns the frame count, with its bytes and time span)
+        int Fetch(int64_t &bytes, int64_t &span)
+        {
+            ClearMeta();
+            ClearAudioHeader();
+            ClearVideoHeader();
+            out_frames_.clear();
+            stream_->GetFrames(this);
+            bytes = 0;
+            span = 0;
+            for(auto &f : out_frames_)
+            {
+                bytes += f->PacketSize();
+            }
+            if(!out_frames_.empty())
+            {
+                span = out_frames_.back()->TimeStamp() - out_frames_.front()->TimeStamp();
+            }
+            return out_frames_.size();
+        }
+        int64_t OutIndex() const
+        {
+            return out_index_.load();
+        }
+    };
+
+    PacketPtr Frame(int type, uint8_t b0, uint8_t b1, int32_t size, int64_t ts)
+    {
+        PacketPtr p = Packet::NewPacket(size);
+        memset(p->Data(), 0, size);
+        p->Data()[0] = b0;
+        p->Data()[1] = b1;
+        p->SetPacketSize(size);
+        p->SetPacketType(type);
+        p->SetTimeStamp(ts);
+        return p;
+    }
+    PacketPtr VideoHeader()
+    {
+        return Frame(kPacketTypeVideo, 0x17, 0x00, 64, 0);
+    }
+    PacketPtr AudioHeader()
+    {
+        return Frame(kPacketTypeAudio, 0xaf, 0x00, 4, 0);
+    }
+    PacketPtr Video(bool key, int32_t size, int64_t ts)
+    {
+        return Frame(kPacketTypeVideo, key ? 0x17 : 0x27, 0x01, size, ts);
+    }
+    PacketPtr Audio(int64_t ts)
+    {
+        return Frame(kPacketTypeAudio, 0xaf, 0x01, 200, ts);
+    }
+
+    struct Fixture
+    {
+        Fixture(const std::string &name)
+        {
+            app = std::make_shared<AppInfo>(domain);
+            app->domain_name = "hx.com";
+            app->app_name = "live";
+            app->content_latency = 100 * 1000;     // 新播放者从最老的 GOP 开始 (new players start at the oldest GOP)
+            app->out_queue_max_time = 1000 * 1000; // 不触发慢播放者处理 (keeps slow-player handling out of the way)
+            app->out_queue_max_bytes = 0;
+            session = std::make_shared<Session>(name);
+            session->SetAppInfo(app);
+            stream = session->GetStream();
+            player = std::make_shared<TestPlayer>(std::make_shared<TestConnection>(), stream, session);
+            player->SetAppInfo(app);
+        }
+        ~Fixture()
+        {
+            player.reset();
+        }
+        AppInfoPtr app;
+        SessionPtr session;
+        StreamPtr stream;
+        std::shared_ptr<TestPlayer> player;
+    };
+
+    bool TestLimit()
+    {
+        const int64_t kBytes = 256 * 1024, kTime = 200;
+        auto steady = FrameBatch::Limit(kBytes, kTime, 30 * 1024, 80, 0);
+        auto lagging = FrameBatch::Limit(kBytes, kTime, 4 * 1024 * 1024, 36000, 0);
+        auto busy = FrameBatch::Limit(kBytes, kTime, 4 * 1024 * 1024, 36000, 850);
+        auto saturated = FrameBatch::Limit(kBytes, kTime, 4 * 1024 * 1024, 36000, 990);
+        auto by_time = FrameBatch::Limit(kBytes, kTime, 10 * 1024, 650, 0);   // 纯音频：字节少时长多 (pure audio: few bytes, much time)
+        bool ok = steady.bytes == kBytes && steady.time == kTime
+                && lagging.bytes == 4 * kBytes && lagging.time == 4 * kTime
+                && busy.bytes == 2 * kBytes && saturated.bytes == kBytes
+                && by_time.time == 3 * kTime;
+        // 至少一帧，帧数有硬上限 (at least one frame, with a hard cap on frames)
+        ok = ok && !steady.Full(0, 0, 0) && steady.Full(kBytes, 0, 1) && steady.Full(0, kTime, 1)
+                && steady.Full(0, 0, FrameBatch::kMaxFrames);
+        std::cout << "limit: steady:" << steady.bytes << "/" << steady.time
+                  << " lagging:" << lagging.bytes << "/" << lagging.time
+                  << " busy:" << busy.bytes << " saturated:" << saturated.bytes
+                  << (ok ? " ok" : " failed") << std::endl;
+        return ok;
+    }
+
+    bool TestPureAudio()
+    {
+        Fixture f("hx.com/live/audio");
+        f.stream->AddPacket(VideoHeader());
+        f.stream->AddPacket(AudioHeader());
+        f.stream->AddPacket(Video(true, 20000, 0));     // 封面 (the cover frame)
+        int64_t bytes = 0, span = 0;
+        f.player->Fetch(bytes, span);                    // 定位并取走封面 (locates and takes the cover)
+        // 一次到了 50 帧 AAC，每帧 23ms，共 1150ms (50 AAC frames of 23 ms arrive at once, 1150 ms)
+        for(int i = 1; i <= 50; i++)
+        {
+            f.stream->AddPacket(Audio(i * 23));
+        }
+        int first = f.player->Fetch(bytes, span);
+        int64_t first_span = span;
+        int second = f.player->Fetch(bytes, span);
+        int third = f.player->Fetch(bytes, span);
+        // 落后 1150ms，放大 4 倍到 800ms：跨度不到 800ms 的 35 帧；剩下的 15 帧不到两批，回到 200ms 一批
+        // 1150 ms behind scales the limit 4 times to 800 ms: 35 frames spanning under 800 ms; the other
+        // 15 are under two batches behind, so back to 200 ms a batch
+        bool ok = first == 35 && first_span < 800 && second == 9 && third == 6;
+        // 跟上之后每到一帧取一帧 (once caught up, each frame is taken as it arrives)
+        f.stream->AddPacket(Audio(51 * 23));
+        ok = ok && f.player->Fetch(bytes, span) == 1;
+        std::cout << "pure audio: batches " << first << "+" << second << "+" << third << " frames, first span:" << first_span
+                  << "ms" << (ok ? " ok" : " failed") << std::endl;
+        return ok;
+    }
+
+    bool TestHighBitrate()
+    {
+        Fixture f("hx.com/live/high");
+        f.stream->AddPacket(VideoHeader());
+        f.stream->AddPacket(Video(true, 300 * 1024, 0));
+        int64_t bytes = 0, span = 0;
+        f.player->Fetch(bytes, span);
+        // 一个 GOP 开头的 300KB IDR 加 9 个 60KB P 帧，共 840KB (a 300 KB IDR and 9 P frames of 60 KB, 840 KB)
+        f.stream->AddPacket(Video(true, 300 * 1024, 40));
+        for(int i = 2; i <= 10; i++)
+        {
+            f.stream->AddPacket(Video(false, 60 * 1024, i * 40));
+        }
+        // 落后 840KB 放大 3 倍到 768KB：取到 780KB 为止的 9 帧 (840 KB behind scales 3 times to 768 KB: 9 frames up to 780 KB)
+        int first = f.player->Fetch(bytes, span);
+        int64_t first_bytes = bytes;
+        int second = f.player->Fetch(bytes, span);
+        bool ok = first == 9 && first_bytes == 780 * 1024 && second == 1;
+        // 比整批上限还大的一帧照样取 (a frame bigger than the whole limit is still taken)
+        f.stream->AddPacket(Video(true, 2 * 1024 * 1024, 480));
+        ok = ok && f.player->Fetch(bytes, span) == 1 && bytes == 2 * 1024 * 1024;
+        std::cout << "high bitrate: batches " << first << "+" << second << " frames, first:" << first_bytes
+                  << " bytes" << (ok ? " ok" : " failed") << std::endl;
+        return ok;
+    }
+
+    bool TestLaggingPlayer()
+    {
+        Fixture f("hx.com/live/lagging");
+        f.stream->AddPacket(VideoHeader());
+        f.stream->AddPacket(Video(true, 5000, 0));
+        int64_t bytes = 0, span = 0;
+        f.player->Fetch(bytes, span);
+        // 落后 900 帧（25fps，每帧 5KB，36 秒）(900 frames behind: 25 fps, 5 KB each, 36 s)
+        for(int i = 1; i <= 900; i++)
+        {
+            f.stream->AddPacket(Video(i % 25 == 0, 5000, i * 40));
+        }
+        int first = f.player->Fetch(bytes, span);
+        int batches = 1, frames = first;
+        while(frames < 900 && batches < 1000)
+        {
+            int n = f.player->Fetch(bytes, span);
+            if(n == 0)
+            {
+                break;
+            }
+            frames += n;
+            batches++;
+        }
+        // 时长先到：放大到 800ms，一批 20 帧；追到最后不到一批落后时回到 200ms
+        // Time binds first: scaled to 800 ms, 20 frames a batch; back to 200 ms in the last stretch
+        bool ok = first == 20 && frames == 900 && f.player->OutIndex() == 901
+                && batches < 900 / 10;
+        std::cout << "lagging player: first batch " << first << " frames, caught up in " << batches
+                  << " batches (fixed 10-frame batches: 90)" << (ok ? " ok" : " failed") << std::endl;
+        return ok;
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    bool ok = TestLimit();
+    ok = TestPureAudio() && ok;
+    ok = TestHighBitrate() && ok;
+    ok = TestLaggingPlayer() && ok;
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,188 @@
+#include "live/base/IndexRing.h"
+#include "live/base/GopMgr.h"
+#include "live/base/CodecHeader.h"
+#include "mmedia/base/Packet.h"
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+
+using namespace tmms::live;
+using namespace tmms::mm;
+
+// GOP 和编码头环形记录测试：
+// 1. IndexRing 绕过好几圈之后顺序、挤掉最旧的和改容量都对。
+// 2. GopMgr 在小容量下绕圈，按延迟和按帧号的二分查找和逐个扫描的结果一致，过期清理只删前面的。
+// 3. 推流中途换编码头：每一帧取到的都是它之前最近的那个版本；裁剪只留窗口里还用得到的版本；
+//    改得太频繁时历史不超过容量，字节数跟着对。
+// GOP and codec header ring test:
+// 1. IndexRing keeps order, pushes out the oldest and resizes correctly after wrapping many times.
+// 2. GopMgr wraps with a small capacity; binary search by latency and by frame index agrees with a
+//    linear scan, and expiry only removes from the front.
+// 3. Codec headers changing mid-stream: every frame gets the latest version before it; trimming
+//    keeps only versions the window can still reach; changing them too often keeps the history at
+//    capacity with the byte count following.
+
+namespace
+{
+    PacketPtr Frame(int64_t index, int64_t ts, bool key, bool header = false, uint8_t tag = 0)
+    {
+        int32_t size = header ? 32 : 100;
+        PacketPtr p = Packet::NewPacket(size);
+        memset(p->Data(), 0, size);
+        p->Data()[0] = key ? 0x17 : 0x27;
+        p->Data()[1] = header ? 0x00 : 0x01;
+        p->Data()[2] = tag;
+        p->SetPacketSize(size);
+        p->SetPacketType(key ? (kPacketTypeVideo | kFrameTypeKeyFrame) : kPacketTypeVideo);
+        p->SetIndex(index);
+        p->SetTimeStamp(ts);
+        return p;
+    }
+
+    bool TestIndexRing()
+    {
+        IndexRing<int> ring(8);
+        int dropped = -1;
+        bool ok = true;
+        for(int i = 0; i < 100; i++)
+        {
+            bool full = ring.PushBack(i, &dropped);
+            ok = ok && full == (i >= 8) && (!full || dropped == i - 8);
+        }
+        ok = ok && ring.Size() == 8 && ring.Front() == 92 && ring.Back() == 99;
+        ring.PopFront();
+        ring.PopFront();
+        ring.PushBack(100);
+        ok = ok && ring.Size() == 7 && ring.Front() == 94 && ring.Back() == 100;
+        ok = ok && ring.PartitionPoint([](int v){ return v <= 96; }) == 3
+                && ring.PartitionPoint([](int v){ return v < 0; }) == 0
+                && ring.PartitionPoint([](int v){ return v < 1000; }) == 7;
+        // 缩小时留最新的，放大后接着用 (shrinking keeps the newest; growing goes on from there)
+        ring.SetCapacity(4);
+        ok = ok && ring.Size() == 4 && ring.Front() == 97 && ring.Back() == 100;
+        ring.SetCapacity(16);
+        for(int i = 101; i < 110; i++)
+        {
+            ring.PushBack(i);
+        }
+        ok = ok && ring.Size() == 13 && ring.Front() == 97 && ring.Back() == 109;
+        for(size_t i = 0; i < ring.Size(); i++)
+        {
+            ok = ok && ring.At(i) == 97 + (int)i;
+        }
+        std::cout << "index ring: " << (ok ? "ok" : "failed") << std::endl;
+        return ok;
+    }
+
+    bool TestGopWrap()
+    {
+        const int kCapacity = 16;
+        GopMgr gops(kCapacity);
+        std::vector<std::pair<int64_t, int64_t>> all;  // 所有关键帧的 (序号, 时间戳) (every keyframe's index and timestamp)
+        srand(7);
+        int64_t ts = 0;
+        bool ok = true;
+        for(int64_t i = 0; i < 3000; i++)
+        {
+            bool key = i == 0 || rand() % 10 == 0;
+            ts += 20 + rand() % 40;
+            gops.AddFrame(Frame(i, ts, key));
+            if(key)
+            {
+                all.emplace_back(i, ts);
+            }
+            if(i % 7 != 0)
+            {
+                continue;
+            }
+            // 环里是最近的 kCapacity 个 GOP (the ring holds the latest kCapacity GOPs)
+            size_t n = std::min<size_t>(all.size(), kCapacity);
+            std::vector<std::pair<int64_t, int64_t>> kept(all.end() - n, all.end());
+            ok = ok && gops.GopSize() == n && gops.LastGopIndex() == kept.back().first;
+            // 按延迟：逐个扫描的结果 (by latency, against a linear scan)
+            int content_latency = rand() % 3000;
+            int expect = -1, expect_latency = 0;
+            for(auto it = kept.rbegin(); it != kept.rend() && ts - it->second <= content_latency; ++it)
+            {
+                expect = it->first;
+                expect_latency = ts - it->second;
+            }
+            int latency = 0;
+            ok = ok && gops.GetGopByLatency(content_latency, latency) == expect && latency == expect_latency;
+            // 按帧号 (by frame index)
+            int64_t probe = i - rand() % 200;
+            int32_t expect_gop = -1;
+            for(auto &g : kept)
+            {
+                if(g.first <= probe)
+                {
+                    expect_gop = g.first;
+                }
+            }
+            ok = ok && gops.GopByIndex(probe) == expect_gop;
+        }
+        // 过期清理只删前面的 (expiry only removes from the front)
+        size_t before = gops.GopSize();
+        int64_t cut = all[all.size() - 5].first;
+        gops.ClearExpriedGop(cut);
+        ok = ok && before == kCapacity && gops.GopSize() == 4 && gops.GopByIndex(cut) == -1
+                && gops.GopByIndex(all.back().first) == all.back().first;
+        std::cout << "gop wrap: " << all.size() << " gops through capacity " << kCapacity
+                  << (ok ? " ok" : " failed") << std::endl;
+        return ok;
+    }
+
+    uint8_t Tag(const PacketPtr &p)
+    {
+        return p ? (uint8_t)p->Data()[2] : 0;
+    }
+
+    bool TestHeaderChanges()
+    {
+        CodecHeader headers;
+        // 第 0、300、600 帧换视频头 (video headers change at frames 0, 300 and 600)
+        std::vector<PacketPtr> versions;
+        for(int v = 0; v < 3; v++)
+        {
+            versions.push_back(Frame(v * 300, v * 12000, true, true, v + 1));
+            headers.ParseCodecHeader(versions.back());
+        }
+        int64_t one = versions[0]->MemoryBytes();
+        bool ok = headers.Bytes() == 3 * one;
+        for(int idx : {1, 299, 300, 301, 599, 600, 900})
+        {
+            uint8_t expect = idx < 300 ? 1 : (idx < 600 ? 2 : 3);
+            ok = ok && Tag(headers.VideoHeader(idx)) == expect;
+        }
+        ok = ok && Tag(headers.VideoHeader(0)) == 3;
+        // 窗口从第 350 帧开始：第一个版本没人要了，第二个还要 (the window starts at 350: v1 is unreachable, v2 still needed)
+        headers.Trim(350);
+        ok = ok && headers.Bytes() == 2 * one && Tag(headers.VideoHeader(350)) == 2
+                && Tag(headers.VideoHeader(700)) == 3;
+        headers.Trim(650);
+        ok = ok && headers.Bytes() == one && Tag(headers.VideoHeader(650)) == 3;
+
+        // 每一帧都换头：历史不超过容量，最老的被挤掉 (a new header every frame: the history stays at capacity)
+        CodecHeader busy;
+        const int kChanges = CodecHeader::kHistoryCapacity * 3;
+        for(int i = 1; i <= kChanges; i++)
+        {
+            busy.ParseCodecHeader(Frame(i, i * 40, true, true, i % 250));
+        }
+        ok = ok && busy.Bytes() == (int64_t)CodecHeader::kHistoryCapacity * one
+                && Tag(busy.VideoHeader(kChanges)) == kChanges % 250
+                && Tag(busy.VideoHeader(kChanges - 10)) == (kChanges - 10) % 250;
+        std::cout << "header changes: " << (ok ? "ok" : "failed") << std::endl;
+        return ok;
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    bool ok = TestIndexRing();
+    ok = TestGopWrap() && ok;
+    ok = TestHeaderChanges() && ok;
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,336 @@
+#include "live/base/PacketRing.h"
+#include "network/net/EventLoop.h"
+#include "network/net/EventLoopThreadPool.h"
+#include "mmedia/base/Packet.h"
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+using namespace tmms::live;
+using namespace tmms::mm;
+using namespace tmms::network;
+
+// 一写多读环形缓冲区测试：
+// 1. 压力测试：主线程推流，不时裁掉一段帧；所有循环上的很多读者同时按序读，读到的包的序号、内容和
+//    字节偏移都要对，拿着的包在读者放手之前不能被释放，结束后所有包都释放。
+// 2. 推流延迟和读者数的关系：同样的读者分布在所有循环上，对比原来的“锁 + PacketPtr 数组”和无锁环形
+//    缓冲区，每写一帧的平均耗时和 p99。每项取几轮里最好的一次。
+// Single-writer multi-reader ring test:
+// 1. Stress: the main thread publishes and trims a run of frames now and then, while many readers
+//    on all loops read in order. The index, data and byte offset of every packet read must match,
+//    a packet held by a reader must not be freed before it lets go, and every packet is freed at
+//    the end.
+// 2. Ingest latency versus reader count: the same readers spread over all loops, comparing the old
+//    "mutex + PacketPtr array" with the lock-free ring; mean and p99 time to publish one frame.
+//    Each figure is the best of a few rounds.
+
+namespace
+{
+    const int kLoops = 4;
+    const uint32_t kRing = 256;
+    const int32_t kSizes[] = {1500, 3000, 400, 6000, 400, 12000, 400, 60000};
+    const int kSizeCount = sizeof(kSizes) / sizeof(kSizes[0]);
+    const int kBatch = 10;              // 一次最多取 10 帧 (10 frames per fetch)
+    std::atomic<int64_t> live_packets{0};
+
+    int64_t SizeOf(int64_t index)
+    {
+        return kSizes[index % kSizeCount];
+    }
+    // 第 index 帧之前的累计字节数 (The byte count before frame index)
+    int64_t OffsetOf(int64_t index)
+    {
+        int64_t cycle = 0;
+        for(auto s : kSizes)
+        {
+            cycle += s;
+        }
+        int64_t offset = index / kSizeCount * cycle;
+        for(int64_t i = 0; i < index % kSizeCount; i++)
+        {
+            offset += kSizes[i];
+        }
+        return offset;
+    }
+
+    // 引用外部数据的包，数据释放时计数减一，数据开头写着帧号
+    // A packet over external data that counts itself down when freed; the data starts with the frame index
+    PacketPtr NewFrame(int64_t index)
+    {
+        int32_t size = SizeOf(index);
+        live_packets++;
+        std::shared_ptr<char> data(new char[size], [](char *p){
+            live_packets--;
+            delete [] p;
+        });
+        memcpy(data.get(), &index, sizeof(index));
+        auto packet = Packet::NewPacket(data, size);
+        packet->SetIndex(index);
+        return packet;
+    }
+
+    struct Reader
+    {
+        int64_t next{0};
+        std::vector<PacketPtr> held;    // 像 out_frames_ 一样在临界区外拿着 (held outside the critical section, like out_frames_)
+        uint64_t frames{0};
+        uint64_t errors{0};
+    };
+
+    // 读一批，返回读到的帧数 (Reads one batch; returns the frames read)
+    int ReadBatch(const PacketRing &ring, Reader &r, bool check)
+    {
+        // 上一批的包在这里才放手 (the previous batch is let go only now)
+        r.held.clear();
+        int n = 0;
+        PacketRing::ReadGuard guard;
+        int64_t last = ring.Last();
+        r.next = std::max<int64_t>(r.next, last - (int64_t)ring.Size() + 1);  // 掉队就跳 (skip ahead when overrun)
+        for(int i = 0; i < kBatch && r.next <= last; i++, r.next++)
+        {
+            auto packet = ring.Get(r.next);
+            if(!packet)
+            {
+                continue;   // 被裁掉或刚被覆盖 (trimmed or just overwritten)
+            }
+            n++;
+            if(check)
+            {
+                int64_t data = 0;
+                memcpy(&data, packet->Data(), sizeof(data));
+                int64_t offset = 0;
+                bool offset_ok = !ring.Offset(r.next, offset) || offset == OffsetOf(r.next);
+                if(packet->Index() != r.next || data != r.next
+                    || packet->PacketSize() != SizeOf(r.next) || !offset_ok)
+                {
+                    r.errors++;
+                }
+            }
+            r.held.emplace_back(std::move(packet));
+        }
+        r.frames += n;
+        return n;
+    }
+
+    // 原来的做法：锁里拷贝 PacketPtr (The old way: copy PacketPtrs under a lock)
+    struct LockedRing
+    {
+        std::mutex lock;
+        std::vector<PacketPtr> packets{kRing};
+        std::vector<int64_t> offsets = std::vector<int64_t>(kRing, 0);
+        std::atomic<int64_t> last{-1};
+
+        void Publish(int64_t index, PacketPtr &&packet, int64_t offset)
+        {
+            std::lock_guard<std::mutex> lk(lock);
+            offsets[index % kRing] = offset;
+            packets[index % kRing] = std::move(packet);
+            last = index;
+        }
+        int ReadBatch(Reader &r)
+        {
+            r.held.clear();
+            int n = 0;
+            std::lock_guard<std::mutex> lk(lock);
+            int64_t l = last;
+            r.next = std::max<int64_t>(r.next, l - (int64_t)kRing + 1);
+            for(int i = 0; i < kBatch && r.next <= l; i++, r.next++)
+            {
+                auto &packet = packets[r.next % kRing];
+                if(packet && packet->Index() == r.next)
+                {
+                    r.held.emplace_back(packet);
+                    n++;
+                }
+            }
+            r.frames += n;
+            return n;
+        }
+    };
+
+    // 每个循环上一组读者，轮流读到 done 为止，没读到就让出 CPU
+    // (A group of readers per loop, taking turns until done; yields when nothing was read)
+    template <typename F>
+    void StartReaders(std::vector<EventLoop*> &loops, std::vector<std::vector<Reader>> &groups,
+                      std::atomic<bool> &done, std::atomic<int> &running, F read)
+    {
+        for(size_t l = 0; l < loops.size(); l++)
+        {
+            running++;
+            auto group = &groups[l];
+            loops[l]->RunInLoop([group, &done, &running, read](){
+                while(!done.load())
+                {
+                    int n = 0;
+                    for(auto &r : *group)
+                    {
+                        n += read(r);
+                    }
+                    if(n == 0)
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+                for(auto &r : *group)
+                {
+                    r.held.clear();
+                }
+                Packet::ReclaimDeferred();
+                running--;
+            });
+        }
+    }
+
+    void WaitReaders(std::atomic<int> &running)
+    {
+        while(running.load() > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    bool TestStress(std::vector<EventLoop*> &loops)
+    {
+        const int64_t kFrames = 200000;
+        const int kReadersPerLoop = 16;
+        uint64_t errors = 0, frames = 0;
+        {
+            PacketRing ring(kRing);
+            std::vector<std::vector<Reader>> groups(loops.size(), std::vector<Reader>(kReadersPerLoop));
+            std::atomic<bool> done{false};
+            std::atomic<int> running{0};
+            StartReaders(loops, groups, done, running, [&ring](Reader &r){
+                return ReadBatch(ring, r, true);
+            });
+            for(int64_t i = 0; i < kFrames; i++)
+            {
+                ring.Publish(i, NewFrame(i), OffsetOf(i));
+                // 每 1000 帧裁掉稍早的 20 帧 (every 1000 frames, trim 20 slightly older ones)
+                if(i % 1000 == 999)
+                {
+                    for(int64_t t = i - 120; t < i - 100; t++)
+                    {
+                        ring.Clear(t);
+                    }
+                    ring.Reclaim();
+                }
+                if(i % 64 == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            done = true;
+            WaitReaders(running);
+            ring.Reclaim();
+            errors += ring.Retired();   // 读者都走了，退役的包应该都释放了 (with every reader gone nothing stays retired)
+            for(auto &group : groups)
+            {
+                for(auto &r : group)
+                {
+                    errors += r.errors;
+                    frames += r.frames;
+                }
+            }
+        }
+        Packet::ReclaimDeferred();
+        bool ok = errors == 0 && frames > 0 && live_packets.load() == 0;
+        std::cout << "stress: " << loops.size() * kReadersPerLoop << " readers on " << loops.size()
+                  << " loops, frames read:" << frames << " errors:" << errors
+                  << " live packets:" << live_packets.load() << (ok ? " ok" : " failed") << std::endl;
+        return ok;
+    }
+
+    struct Latency
+    {
+        double mean{0};
+        double p99{0};
+    };
+
+    template <typename Ring, typename Read>
+    Latency RunIngest(std::vector<EventLoop*> &loops, int readers, Ring &ring, Read read)
+    {
+        const int64_t kFrames = 20000;
+        std::vector<std::vector<Reader>> groups(loops.size());
+        for(int i = 0; i < readers; i++)
+        {
+            groups[i % loops.size()].emplace_back();
+        }
+        std::atomic<bool> done{false};
+        std::atomic<int> running{0};
+        StartReaders(loops, groups, done, running, [&ring, read](Reader &r){
+            return read(ring, r);
+        });
+        std::vector<double> ns;
+        ns.reserve(kFrames);
+        for(int64_t i = 0; i < kFrames; i++)
+        {
+            auto packet = NewFrame(i);
+            auto start = std::chrono::steady_clock::now();
+            ring.Publish(i, std::move(packet), OffsetOf(i));
+            ns.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+            if(i % 64 == 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+        done = true;
+        WaitReaders(running);
+        Latency l;
+        for(auto n : ns)
+        {
+            l.mean += n;
+        }
+        l.mean /= ns.size();
+        std::sort(ns.begin(), ns.end());
+        l.p99 = ns[ns.size() * 99 / 100];
+        return l;
+    }
+
+    void BenchIngest(std::vector<EventLoop*> &loops)
+    {
+        const int kRounds = 3;
+        for(int readers : {0, 16, 64, 256})
+        {
+            Latency locked, lockfree;
+            locked.mean = locked.p99 = lockfree.mean = lockfree.p99 = 1e18;
+            for(int r = 0; r < kRounds; r++)
+            {
+                LockedRing a;
+                auto l = RunIngest(loops, readers, a, [](LockedRing &ring, Reader &r){
+                    return ring.ReadBatch(r);
+                });
+                locked.mean = std::min(locked.mean, l.mean);
+                locked.p99 = std::min(locked.p99, l.p99);
+                PacketRing b(kRing);
+                l = RunIngest(loops, readers, b, [](PacketRing &ring, Reader &r){
+                    return ReadBatch(ring, r, false);
+                });
+                lockfree.mean = std::min(lockfree.mean, l.mean);
+                lockfree.p99 = std::min(lockfree.p99, l.p99);
+            }
+            std::cout << "ingest, readers:" << readers
+                      << " mutex: mean " << locked.mean << " ns p99 " << locked.p99
+                      << " ns, lock-free: mean " << lockfree.mean << " ns p99 " << lockfree.p99
+                      << " ns" << std::endl;
+        }
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    EventLoopThreadPool pool(kLoops, 0, kLoops);
+    pool.Start();
+    auto loops = pool.GetLoops();
+    bool ok = TestStress(loops);
+    BenchIngest(loops);
+    Packet::ReclaimDeferred();
+    ok = ok && live_packets.load() == 0;
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
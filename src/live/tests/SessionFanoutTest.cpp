@@ -0,0 +1,338 @@
+#include "live/Session.h"
+#include "live/Stream.h"
+#include "live/LiveService.h"
+#include "live/user/PlayerUser.h"
+#include "base/AppInfo.h"
+#include "base/DomainInfo.h"
+#include "network/net/Connection.h"
+#include "network/net/EventLoop.h"
+#include "network/net/EventLoopThreadPool.h"
+#include "json/json.h"
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+
+using namespace tmms::live;
+using namespace tmms::base;
+using namespace tmms::network;
+
+// 会话按循环分组激活播放者的测试：
+// 1. 正确性：播放者分在所有循环上，每次推流通知之后每个播放者都在自己的循环线程里被激活，并且看到了
+//    最新的一帧；连接迁到别的循环后在新循环里被激活；关掉的播放者不再被激活。
+// 2. 基准：8 个循环上 1 万个播放者，按直播开头那样每帧都通知，对比原来每个播放者投递一次和现在每个
+//    循环投递一次：推流线程每帧的耗时、每帧的跨线程投递数、循环被唤醒的次数，以及全部播放者看到最后
+//    一帧用的时间。
+// Test of activating a session's players grouped by loop:
+// 1. Correctness: with players spread over all loops, after every publish notification each player is
+//    activated on its own loop thread and sees the latest frame; a connection moved to another loop is
+//    activated there; a closed player is not activated any more.
+// 2. Benchmark: 10k players on 8 loops, notified on every frame as at the start of a stream, comparing
+//    the old post per player with a post per loop: publisher time per frame, cross-thread posts per
+//    frame, loop wakeups, and the time until every player has seen the last frame.
+
+namespace
+{
+    const int kLoops = 8;
+    const int kPlayers = 10000;
+    const int kFrames = 300;
+    DomainInfo domain;
+    std::atomic<int64_t> published{0};  // 最新一帧的序号 (the index of the latest frame)
+
+    class TestConnection : public Connection
+    {
+    public:
+        explicit TestConnection(EventLoop *loop)
+        : Connection(loop, -1, InetAddress(), InetAddress())
+        {
+        }
+        void ForceClose() override
+        {
+        }
+        // 模拟迁移，只在没有通知的时候调用 (Simulates a move; only called while nothing is posted)
+        void SetLoop(EventLoop *loop)
+        {
+            loop_ = loop;
+        }
+    };
+
+    // 像真的播放者一样：被激活时取走能取的帧，然后去激活，等下一次通知
+    // Like a real player: takes what there is when activated, then deactivates until the next notification
+    class TestPlayer : public PlayerUser
+    {
+    public:
+        TestPlayer(const ConnectionPtr &conn, const StreamPtr &stream, const SessionPtr &s)
+        : PlayerUser(conn, stream, s)
+        {
+        }
+        bool PostFrames() override
+        {
+            if(!connection_->Loop()->IsInLoopThread())
+            {
+                wrong_thread++;
+            }
+            activations++;
+            seen = published.load();
+            Deactive();
+            return true;
+        }
+        std::atomic<int64_t> seen{-1};
+        std::atomic<uint64_t> activations{0};
+        std::atomic<uint64_t> wrong_thread{0};
+    };
+    using TestPlayerPtr = std::shared_ptr<TestPlayer>;
+
+    struct Fixture
+    {
+        Fixture(const std::string &name, std::vector<EventLoop*> &loops, int players)
+        {
+            app = std::make_shared<AppInfo>(domain);
+            app->domain_name = "hx.com";
+            app->app_name = "live";
+            session = std::make_shared<Session>(name);
+            session->SetAppInfo(app);
+            // 有推流者，加播放者时不会去拉流 (with a publisher, adding players does not start a pull)
+            publisher = std::make_shared<User>(std::make_shared<TestConnection>(nullptr), session->GetStream(), session);
+            session->SetPublisher(publisher);
+            for(int i = 0; i < players; i++)
+            {
+                auto conn = std::make_shared<TestConnection>(loops[i % loops.size()]);
+                auto p = std::make_shared<TestPlayer>(conn, session->GetStream(), session);
+                TestPlayer *raw = p.get();
+                conn->SetActiveCallback([raw](const ConnectionPtr &){
+                    raw->PostFrames();
+                });
+                this->players.push_back(p);
+            }
+        }
+        ~Fixture()
+        {
+            session->Clear();
+        }
+        void Join()
+        {
+            for(auto &p : players)
+            {
+                session->AddPlayer(p);
+            }
+        }
+        // 等所有播放者看到第 frame 帧 (Waits until every player has seen frame)
+        bool WaitSeen(int64_t frame, const std::vector<TestPlayerPtr> &who, int timeout_ms = 10000)
+        {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+            while(std::chrono::steady_clock::now() < deadline)
+            {
+                bool all = true;
+                for(auto &p : who)
+                {
+                    if(p->seen.load() < frame)
+                    {
+                        all = false;
+                        break;
+                    }
+                }
+                if(all)
+                {
+                    return true;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+            return false;
+        }
+        AppInfoPtr app;
+        SessionPtr session;
+        UserPtr publisher;
+        std::vector<TestPlayerPtr> players;
+    };
+
+    uint64_t CrossPosts()
+    {
+        Json::Value root;
+        Json::CharReaderBuilder reader;
+        std::string err;
+        std::istringstream in(sLiveService->GetLoopStats());
+        Json::parseFromStream(reader, in, &root, &err);
+        return root["cross_activations"].asUInt64();
+    }
+
+    uint64_t Wakeups(std::vector<EventLoop*> &loops)
+    {
+        uint64_t n = 0;
+        for(auto l : loops)
+        {
+            n += l->Iterations();
+        }
+        return n;
+    }
+
+    bool TestCorrectness(std::vector<EventLoop*> &loops)
+    {
+        Fixture f("hx.com/live/correct", loops, 800);
+        f.Join();
+        bool ok = f.WaitSeen(0, f.players);
+        for(int i = 1; i <= 50; i++)
+        {
+            published = i;
+            f.session->ActiveAllPlayers();
+            ok = ok && f.WaitSeen(i, f.players);
+        }
+        // 等投递都处理完再迁移 (moves happen once every post has been handled)
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        std::vector<TestPlayerPtr> moved, closed, rest;
+        for(size_t i = 0; i < f.players.size(); i++)
+        {
+            auto &p = f.players[i];
+            if(i % 10 == 0)
+            {
+                std::static_pointer_cast<TestConnection>(p->GetConnection())->SetLoop(loops[(i + 3) % loops.size()]);
+                moved.push_back(p);
+            }
+            else if(i % 10 == 1)
+            {
+                f.session->CloseUser(p);
+                closed.push_back(p);
+            }
+            else
+            {
+                rest.push_back(p);
+            }
+        }
+        uint64_t closed_before = 0;
+        for(auto &p : closed)
+        {
+            closed_before += p->activations.load();
+        }
+        for(int i = 51; i <= 100; i++)
+        {
+            published = i;
+            f.session->ActiveAllPlayers();
+            ok = ok && f.WaitSeen(i, moved) && f.WaitSeen(i, rest);
+        }
+        uint64_t closed_after = 0, wrong = 0;
+        for(auto &p : closed)
+        {
+            closed_after += p->activations.load();
+        }
+        for(auto &p : f.players)
+        {
+            wrong += p->wrong_thread.load();
+        }
+        ok = ok && closed_after == closed_before && wrong == 0;
+        std::cout << "correctness: " << f.players.size() << " players, " << moved.size() << " moved, "
+                  << closed.size() << " closed, wrong thread:" << wrong
+                  << (ok ? " ok" : " failed") << std::endl;
+        return ok;
+    }
+
+    struct Result
+    {
+        double publish_mean{0};     // 推流线程每帧的耗时，微秒 (publisher time per frame, us)
+        double publish_p99{0};
+        double posts{0};            // 每帧的跨线程投递数 (cross-thread posts per frame)
+        double wakeups{0};          // 每帧的循环唤醒次数 (loop wakeups per frame)
+        double activations{0};      // 每帧的播放者激活次数 (player activations per frame)
+        double drain_ms{0};         // 最后一帧之后全部看到用的时间 (time for all players to see the last frame)
+        bool ok{false};
+    };
+
+    // 原来的做法：锁住会话，对每个播放者调用 Active，不在本线程的各投递一次
+    // The old way: lock the session and call Active on every player, one post each
+    void ActivePerPlayer(std::mutex &lock, std::vector<TestPlayerPtr> &players)
+    {
+        std::lock_guard<std::mutex> lk(lock);
+        for(auto &p : players)
+        {
+            p->Active();
+        }
+    }
+
+    Result Run(std::vector<EventLoop*> &loops, bool per_loop)
+    {
+        Fixture f(per_loop ? "hx.com/live/per_loop" : "hx.com/live/per_player", loops, kPlayers);
+        f.Join();
+        published = 0;
+        Result r;
+        r.ok = f.WaitSeen(0, f.players);
+        std::mutex lock;
+        std::vector<double> costs;
+        uint64_t activations = 0;
+        for(auto &p : f.players)
+        {
+            activations += p->activations.load();
+        }
+        uint64_t posts = CrossPosts();
+        uint64_t wakeups = Wakeups(loops);
+        std::chrono::steady_clock::time_point last;
+        for(int i = 1; i <= kFrames; i++)
+        {
+            published = i;
+            auto start = std::chrono::steady_clock::now();
+            if(per_loop)
+            {
+                f.session->ActiveAllPlayers();
+            }
+            else
+            {
+                ActivePerPlayer(lock, f.players);
+            }
+            last = std::chrono::steady_clock::now();
+            costs.push_back(std::chrono::duration<double, std::micro>(last - start).count());
+            // 25fps 的流每 40ms 一帧，这里快一些，循环来不及处理时就能看出积压
+            // A 25 fps stream sends a frame every 40 ms; this goes faster so a backlog shows up.
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        r.ok = r.ok && f.WaitSeen(kFrames, f.players, 60000);
+        r.drain_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - last).count();
+        uint64_t after = 0;
+        for(auto &p : f.players)
+        {
+            after += p->activations.load();
+        }
+        // 原来的做法每次激活就是一次投递，都在其他线程 (in the old way every activation is a post from another thread)
+        r.posts = per_loop ? (double)(CrossPosts() - posts) / kFrames : (double)(after - activations) / kFrames;
+        r.activations = (double)(after - activations) / kFrames;
+        r.wakeups = (double)(Wakeups(loops) - wakeups) / kFrames;
+        std::sort(costs.begin(), costs.end());
+        double sum = 0;
+        for(auto c : costs)
+        {
+            sum += c;
+        }
+        r.publish_mean = sum / costs.size();
+        r.publish_p99 = costs[costs.size() * 99 / 100];
+        return r;
+    }
+
+    void Print(const char *name, const Result &r)
+    {
+        std::cout << name << ": publish mean " << r.publish_mean << " us p99 " << r.publish_p99
+                  << " us, posts/frame " << r.posts << ", wakeups/frame " << r.wakeups
+                  << ", activations/frame " << r.activations << ", last frame seen after "
+                  << r.drain_ms << " ms" << (r.ok ? "" : " (not all players caught up)") << std::endl;
+    }
+
+    bool Bench(std::vector<EventLoop*> &loops)
+    {
+        std::cout << "fan-out, " << kPlayers << " players on " << kLoops << " loops, " << kFrames << " frames" << std::endl;
+        auto per_player = Run(loops, false);
+        Print("post per player", per_player);
+        auto per_loop = Run(loops, true);
+        Print("post per loop", per_loop);
+        return per_player.ok && per_loop.ok && per_loop.posts <= kLoops;
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    EventLoopThreadPool pool(kLoops, 0, kLoops);
+    pool.Start();
+    auto loops = pool.GetLoops();
+    bool ok = TestCorrectness(loops);
+    ok = Bench(loops) && ok;
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,308 @@
+#include "live/SessionRegistry.h"
+#include "live/Session.h"
+#include "base/AppInfo.h"
+#include "base/DomainInfo.h"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <unordered_map>
+#include <algorithm>
+
+using namespace tmms::live;
+using namespace tmms::base;
+
+// 会话注册表测试：
+// 1. 正确性：几个线程同时创建同一个会话拿到的是同一个；删除后再创建是新的；超时清理只删检查为真的，
+//    检查期间被替换掉的新会话留着，删除前不再超时的会话留着。
+// 2. 竞争基准：表里常驻一批正在播放的会话，几个“HTTP”线程不停地查这些会话；同时几个推流线程不停地
+//    创建、关闭会话，清理线程不停地做超时检查。对比原来的“一把锁 + 锁里创建 + 锁里检查全表”和分片注册表，
+//    看查找的 p50/p99/p99.9/最大耗时和推流线程每秒创建关闭的次数。
+// Session registry test:
+// 1. Correctness: threads creating the same session at once all get the same one; after removal a
+//    create gives a new one; the timeout sweep removes only the sessions it finds expired, keeps a
+//    new session that replaced one while it was being checked, and keeps one that stopped being
+//    expired before it was removed.
+// 2. Contention benchmark: a set of sessions being played stays in the table and a few "HTTP" threads
+//    keep looking them up, while publisher threads keep creating and closing sessions and a sweeper
+//    keeps checking timeouts. Compares the old "one lock, create under it, check the whole table under
+//    it" with the sharded registry: lookup p50/p99/p99.9/max and publisher creates+closes per second.
+
+namespace
+{
+    const int kLiveSessions = 2000;
+    const int kReaders = 4;
+    const int kPublishers = 2;
+    const int kBenchMs = 1500;
+    DomainInfo domain;
+    AppInfoPtr app;
+
+    SessionPtr NewSession(const std::string &name)
+    {
+        auto s = std::make_shared<Session>(name);
+        s->SetAppInfo(app);
+        return s;
+    }
+
+    std::string LiveName(int i)
+    {
+        return "hx.com/live/play" + std::to_string(i);
+    }
+
+    // 原来的做法 (The old way)
+    class LockedRegistry
+    {
+    public:
+        SessionPtr Find(const std::string &name)
+        {
+            std::lock_guard<std::mutex> lk(lock_);
+            auto iter = sessions_.find(name);
+            return iter != sessions_.end() ? iter->second : SessionPtr();
+        }
+        SessionPtr FindOrCreate(const std::string &name, const SessionRegistry::Creator &create)
+        {
+            std::lock_guard<std::mutex> lk(lock_);
+            auto iter = sessions_.find(name);
+            if(iter != sessions_.end())
+            {
+                return iter->second;
+            }
+            auto s = create();
+            sessions_.emplace(name, s);
+            return s;
+        }
+        SessionPtr Remove(const std::string &name)
+        {
+            SessionPtr s;
+            std::lock_guard<std::mutex> lk(lock_);
+            auto iter = sessions_.find(name);
+            if(iter != sessions_.end())
+            {
+                s = iter->second;
+                sessions_.erase(iter);
+            }
+            return s;
+        }
+        void Expire(const SessionRegistry::Predicate &expired, std::vector<SessionPtr> &removed)
+        {
+            std::lock_guard<std::mutex> lk(lock_);
+            for(auto iter = sessions_.begin(); iter != sessions_.end();)
+            {
+                if(expired(iter->second))
+                {
+                    removed.push_back(iter->second);
+                    iter = sessions_.erase(iter);
+                }
+                else
+                {
+                    ++iter;
+                }
+            }
+        }
+    private:
+        std::mutex lock_;
+        std::unordered_map<std::string, SessionPtr> sessions_;
+    };
+
+    bool TestCorrectness()
+    {
+        SessionRegistry registry;
+        const std::string name = "hx.com/live/same";
+        std::vector<SessionPtr> got(8);
+        std::atomic<int> created{0};
+        std::vector<std::thread> threads;
+        for(int i = 0; i < 8; i++)
+        {
+            threads.emplace_back([&, i](){
+                got[i] = registry.FindOrCreate(name, [&](){
+                    created++;
+                    return NewSession(name);
+                });
+            });
+        }
+        for(auto &t : threads)
+        {
+            t.join();
+        }
+        bool ok = created.load() >= 1 && registry.Size() == 1;
+        for(auto &s : got)
+        {
+            ok = ok && s && s == got[0] && registry.Find(name) == s;
+        }
+        // 创建失败时不放进去 (nothing is put in when creation fails)
+        ok = ok && !registry.FindOrCreate("hx.com/live/bad", [](){ return SessionPtr(); })
+                && !registry.Find("hx.com/live/bad");
+        ok = ok && registry.Remove(name) == got[0] && !registry.Find(name) && !registry.Remove(name);
+        auto again = registry.FindOrCreate(name, [&](){ return NewSession(name); });
+        ok = ok && again && again != got[0];
+
+        // 超时清理：双数的过期；检查 0 号时它被替换成新会话，新的要留着
+        // Sweep: even ones expire; session 0 is replaced while being checked and the new one stays
+        SessionRegistry sweep;
+        for(int i = 0; i < 200; i++)
+        {
+            sweep.FindOrCreate(LiveName(i), [i](){ return NewSession(LiveName(i)); });
+        }
+        auto old0 = sweep.Find(LiveName(0));
+        SessionPtr new0;
+        std::vector<SessionPtr> removed;
+        sweep.Expire([&](const SessionPtr &s){
+            if(s == old0)
+            {
+                sweep.Remove(LiveName(0));
+                new0 = sweep.FindOrCreate(LiveName(0), [](){ return NewSession(LiveName(0)); });
+            }
+            int i = std::stoi(s->SessionName().substr(std::string("hx.com/live/play").size()));
+            return i % 2 == 0;
+        }, removed);
+        ok = ok && removed.size() == 99 && sweep.Size() == 101 && sweep.Find(LiveName(0)) == new0
+                && !sweep.Find(LiveName(2)) && sweep.Find(LiveName(3));
+        std::vector<SessionPtr> all;
+        sweep.Snapshot(all);
+        ok = ok && all.size() == 101;
+
+        // 第一次检查超时、删除前有播放者加入（第二次检查不超时）的会话留着
+        // A session that looks expired but gets a player before the removal (the second check says
+        // no) stays
+        auto joined = sweep.Find(LiveName(1));
+        int joined_checks = 0;
+        std::vector<SessionPtr> kept;
+        sweep.Expire([&](const SessionPtr &s){
+            return s == joined && joined_checks++ == 0;
+        }, kept);
+        ok = ok && kept.empty() && joined_checks == 2 && sweep.Find(LiveName(1)) == joined;
+        std::cout << "correctness: racing creates " << created.load() << ", swept " << removed.size()
+                  << (ok ? " ok" : " failed") << std::endl;
+        return ok;
+    }
+
+    struct Result
+    {
+        double p50{0};      // 查找耗时，微秒 (lookup time, us)
+        double p99{0};
+        double p999{0};
+        double max{0};
+        double lookups{0};  // 每秒查找次数 (lookups per second)
+        double churn{0};    // 每秒创建加关闭的会话数 (sessions created and closed per second)
+        uint64_t sweeps{0};
+        bool ok{true};
+    };
+
+    template <typename Registry>
+    Result Run()
+    {
+        Registry registry;
+        for(int i = 0; i < kLiveSessions; i++)
+        {
+            registry.FindOrCreate(LiveName(i), [i](){ return NewSession(LiveName(i)); });
+        }
+        std::atomic<bool> running{true};
+        std::atomic<uint64_t> churn{0};
+        std::atomic<uint64_t> sweeps{0};
+        std::atomic<uint64_t> misses{0};
+        std::vector<std::vector<double>> costs(kReaders);
+        std::vector<std::thread> threads;
+        for(int r = 0; r < kReaders; r++)
+        {
+            threads.emplace_back([&, r](){
+                uint32_t seed = r + 1;
+                auto &cost = costs[r];
+                cost.reserve(1 << 20);
+                while(running.load(std::memory_order_relaxed))
+                {
+                    seed = seed * 1103515245 + 12345;
+                    auto name = LiveName((seed >> 8) % kLiveSessions);
+                    auto start = std::chrono::steady_clock::now();
+                    auto s = registry.Find(name);
+                    cost.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+                    if(!s)
+                    {
+                        misses++;
+                    }
+                }
+            });
+        }
+        for(int p = 0; p < kPublishers; p++)
+        {
+            threads.emplace_back([&, p](){
+                uint64_t n = 0;
+                while(running.load(std::memory_order_relaxed))
+                {
+                    auto name = "hx.com/live/push" + std::to_string(p) + "_" + std::to_string(n++);
+                    registry.FindOrCreate(name, [&name](){ return NewSession(name); });
+                    auto s = registry.Remove(name);
+                    if(s)
+                    {
+                        s->Clear();
+                    }
+                    churn++;
+                }
+            });
+        }
+        threads.emplace_back([&](){
+            while(running.load(std::memory_order_relaxed))
+            {
+                std::vector<SessionPtr> removed;
+                registry.Expire([](const SessionPtr &s){
+                    return s->IsTimeout();
+                }, removed);
+                sweeps++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(kBenchMs));
+        running = false;
+        for(auto &t : threads)
+        {
+            t.join();
+        }
+        std::vector<double> all;
+        for(auto &c : costs)
+        {
+            all.insert(all.end(), c.begin(), c.end());
+        }
+        std::sort(all.begin(), all.end());
+        Result res;
+        res.p50 = all[all.size() / 2];
+        res.p99 = all[all.size() * 99 / 100];
+        res.p999 = all[all.size() * 999 / 1000];
+        res.max = all.back();
+        res.lookups = all.size() * 1000.0 / kBenchMs;
+        res.churn = churn.load() * 1000.0 / kBenchMs;
+        res.sweeps = sweeps.load();
+        res.ok = misses.load() == 0;
+        return res;
+    }
+
+    void Print(const char *name, const Result &r)
+    {
+        std::cout << name << ": lookup p50 " << r.p50 << " us p99 " << r.p99 << " us p99.9 " << r.p999 << " us max " << r.max
+                  << " us, " << (uint64_t)r.lookups << " lookups/s, " << (uint64_t)r.churn
+                  << " creates+closes/s, " << r.sweeps << " sweeps" << (r.ok ? "" : " (lookups missed)") << std::endl;
+    }
+
+    bool Bench()
+    {
+        std::cout << "contention, " << kLiveSessions << " live sessions, " << kReaders << " lookup threads, "
+                  << kPublishers << " publisher threads, 1 sweeper" << std::endl;
+        auto locked = Run<LockedRegistry>();
+        Print("single lock", locked);
+        auto sharded = Run<SessionRegistry>();
+        Print("sharded", sharded);
+        return locked.ok && sharded.ok;
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    app = std::make_shared<AppInfo>(domain);
+    app->domain_name = "hx.com";
+    app->app_name = "live";
+    bool ok = TestCorrectness();
+    ok = Bench() && ok;
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -12,10 +12,18 @@ FlvPlayerUser::FlvPlayerUser(const ConnectionPtr &ptr,const StreamPtr &stream,co
 :PlayerUser(ptr,stream,s)
 {
 
+}
+FlvContext *FlvPlayerUser::Context()
+{
+    if(!context_)
+    {
+        context_ = connection_->GetContext<FlvContext>(kFlvContext);
+    }
+    return context_.get();
 }
 void FlvPlayerUser::PushFlvHttpHeader()
 {
-    auto cxt = connection_->GetContext<FlvContext>(kFlvContext);
+    auto cxt = Context();
     if(cxt)
     {
         bool has_video = stream_->HasVideo();
@@ -36,7 +44,7 @@ bool FlvPlayerUser::PostFrames()
         PushFlvHttpHeader();
         return false;
     }
-    stream_->GetFrames(std::dynamic_pointer_cast<PlayerUser>(shared_from_this()));
+    stream_->GetFrames(this);
     if(meta_)
     {
         auto ret = PushFrame(meta_,true);
@@ -85,7 +93,7 @@ UserType FlvPlayerUser::GetUserType() const
 
 bool FlvPlayerUser::PushFrame(PacketPtr &packet,bool is_header)
 {
-    auto cx = connection_->GetContext<FlvContext>(kFlvContext);
+    auto cx = Context();
     if(!cx||!cx->Ready())
     {
         return false;
@@ -103,7 +111,7 @@ bool FlvPlayerUser::PushFrame(PacketPtr &packet,bool is_header)
 
 bool FlvPlayerUser::PushFrames(std::vector<PacketPtr> &list)
 {
-    auto cx = connection_->GetContext<FlvContext>(kFlvContext);
+    auto cx = Context();
     if(!cx||!cx->Ready())
     {
         return false;
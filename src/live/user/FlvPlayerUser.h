@@ -4,6 +4,10 @@
 
 namespace tmms
 {
+    namespace mm
+    {
+        class FlvContext;
+    }
     namespace live
     {
         class FlvPlayerUser:public PlayerUser
@@ -19,7 +23,12 @@ namespace tmms
             bool PushFrame(PacketPtr &packet,bool is_header);
             bool PushFrames(std::vector<PacketPtr> &list);
             void PushFlvHttpHeader();
+            // 连接的 FLV 上下文，第一次用时从连接取出缓存下来，之后发帧不再查找
+            // The connection's FLV context, looked up once on first use and cached for every later send
+            FlvContext *Context();
+
             bool http_header_sent_{false};
+            std::shared_ptr<FlvContext> context_;
         };
     }
 }
\ No newline at end of file
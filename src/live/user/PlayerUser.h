@@ -4,6 +4,7 @@
 #include "mmedia/base/Packet.h"
 #include "live/base/TimeCorrector.h"
 #include <vector>
+#include <atomic>
 
 namespace tmms
 {
@@ -26,6 +27,11 @@ namespace tmms
 
             virtual bool PostFrames() = 0;
             TimeCorrector& GetTimeCorrector();
+            // 连接里还没写出的字节，内存统计在主线程读 (Bytes still queued on the connection; read by memory accounting on the main thread)
+            int64_t PendingBytes() const
+            {
+                return pending_bytes_.load(std::memory_order_relaxed);
+            }
         protected:
             PacketPtr video_header_;   
             PacketPtr audio_header_;  
@@ -44,7 +50,21 @@ namespace tmms
             int32_t out_version_{-1};
             int32_t out_frame_timestamp_{0};
             std::vector<PacketPtr> out_frames_;
-            int32_t out_index_{-1};
+            // 只有播放者所在的循环写；主线程裁剪内存时按它找还没发的帧，所以是原子的
+            // Only the player's loop writes it; the main thread reads it when trimming memory to find
+            // frames not yet sent, hence atomic.
+            std::atomic<int32_t> out_index_{-1};
+
+            // 慢播放者处理状态和计数，由 Stream 在播放者所在循环中更新
+            int64_t over_limit_since_{0};  // 开始超过输出上限的时间，0 表示没有超限
+            bool drop_non_ref_{false};     // 正在丢弃非参考帧
+            uint64_t dropped_frames_{0};
+            uint64_t dropped_bytes_{0};
+            uint64_t keyframe_skips_{0};
+            uint64_t skipped_frames_{0};
+            uint64_t skipped_bytes_{0};
+            int64_t tuned_bitrate_{0};     // 延迟模式下发送缓冲区按这个码率设置过
+            std::atomic<int64_t> pending_bytes_{0};  // 最近一次检查输出上限时连接里积压的字节
         };
     }
 }
\ No newline at end of file
@@ -19,7 +19,7 @@ bool RtmpPlayerUser::PostFrames()
         return false;
     }
     
-    stream_->GetFrames(std::dynamic_pointer_cast<PlayerUser>(shared_from_this()));
+    stream_->GetFrames(this);
     if(meta_)
     {
         auto ret = PushFrame(meta_,true);
@@ -66,9 +66,18 @@ UserType RtmpPlayerUser::GetUserType() const
     return UserType::kUserTypePlayerRtmp;
 }
 
+RtmpContext *RtmpPlayerUser::Context()
+{
+    if(!context_)
+    {
+        context_ = connection_->GetContext<RtmpContext>(kRtmpContext);
+    }
+    return context_.get();
+}
+
 bool RtmpPlayerUser::PushFrame(PacketPtr &packet,bool is_header)
 {
-    auto cx = connection_->GetContext<RtmpContext>(kRtmpContext);
+    auto cx = Context();
     if(!cx||!cx->Ready())
     {
         return false;
@@ -86,7 +95,7 @@ bool RtmpPlayerUser::PushFrame(PacketPtr &packet,bool is_header)
 
 bool RtmpPlayerUser::PushFrames(std::vector<PacketPtr> &list)
 {
-    auto cx = connection_->GetContext<RtmpContext>(kRtmpContext);
+    auto cx = Context();
     if(!cx||!cx->Ready())
     {
         return false;
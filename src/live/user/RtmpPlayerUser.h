@@ -4,6 +4,10 @@
 
 namespace tmms
 {
+    namespace mm
+    {
+        class RtmpContext;
+    }
     namespace live
     {
         class RtmpPlayerUser:public PlayerUser
@@ -18,6 +22,11 @@ namespace tmms
 
             bool PushFrame(PacketPtr &packet,bool is_header);
             bool PushFrames(std::vector<PacketPtr> &list);
+            // 连接的 RTMP 上下文，第一次用时从连接取出缓存下来，之后发帧不再查找
+            // The connection's RTMP context, looked up once on first use and cached for every later send
+            RtmpContext *Context();
+
+            std::shared_ptr<RtmpContext> context_;
         };
     }
 }
\ No newline at end of file
@@ -48,7 +48,7 @@ bool WebrtcPlayerUser::PostFrames()
         return false;
     }
     
-    stream_->GetFrames(std::dynamic_pointer_cast<PlayerUser>(shared_from_this()));
+    stream_->GetFrames(this);
     meta_.reset();
     std::list<PacketPtr> rtp_pkts;
     if(audio_header_)
@@ -114,7 +114,7 @@ bool WebrtcPlayerUser::PostFrames()
                     audio_out_bytes_ += np->PacketSize();
                     ++ audio_out_pkts_count_;
                 }
-                np->SetExt(addr_);
+                SetPacketAddr(np);
                 result.emplace_back(np);
             }
         }
@@ -189,7 +189,7 @@ void WebrtcPlayerUser::OnDtlsSend(const char *data,size_t size, Dtls *dtls)
     memcpy(packet->Data(),data,size);
     packet->SetPacketSize(size);
 
-    packet->SetExt(addr_);
+    SetPacketAddr(packet);
     auto server = sLiveService->GetWebrtcServer();
     server->SendPacket(packet);
 }
@@ -253,7 +253,7 @@ void WebrtcPlayerUser::SendSR(bool is_video)
         auto np = srtp_.RtcpProtect(packet);
         if(np)
         {
-            np->SetExt(addr_);
+            SetPacketAddr(np);
             auto server = sLiveService->GetWebrtcServer();
             server->SendPacket(np);
         }
@@ -349,7 +349,7 @@ void WebrtcPlayerUser::ProcessRtpfb(const char *buf,size_t size)
             auto np = srtp_.RtpProtect(p);
             if(np)
             {
-                np->SetExt(addr_);
+                SetPacketAddr(np);
                 result.emplace_back(np);
             }
         }
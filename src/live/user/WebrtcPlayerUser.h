@@ -29,17 +29,15 @@ namespace tmms
             std::string BuildAnswerSdp();
             void SetConnection(const ConnectionPtr &conn) override;
             void OnDtlsRecv(const char *buf,size_t size);
-            std::shared_ptr<struct sockaddr_in6> GetSockAddr() const
+            // 还没收到 STUN 时返回 nullptr (nullptr until the STUN binding request arrives)
+            const struct sockaddr_in6 *GetSockAddr() const
             {
-                return addr_;
+                return addr_set_ ? &addr_ : nullptr;
             }
             void SetSockAddr(const network::InetAddress &addr)
             {
-                if(!addr_)
-                {
-                    addr_ = std::make_shared<struct sockaddr_in6>();
-                }
-                addr.GetSockAddr((struct sockaddr*)addr_.get());
+                addr.GetSockAddr((struct sockaddr*)&addr_);
+                addr_set_ = true;
             }
             void OnRtcp(const char *buf,size_t size);
         private:
@@ -54,13 +52,22 @@ namespace tmms
             PacketPtr GetVideo(int idx);
             PacketPtr GetAudio(int idx); 
             void ProcessRtpfb(const char *buf,size_t size);
+            // 把对端地址写进包头 (Writes the peer address into the packet header)
+            void SetPacketAddr(const PacketPtr &packet) const
+            {
+                if(addr_set_)
+                {
+                    packet->SetDestAddr(addr_);
+                }
+            }
 
             std::string local_ufrag_;
             std::string local_passwd_;
             Sdp sdp_;
             Dtls dtls_;
             PacketPtr packet_;
-            std::shared_ptr<struct sockaddr_in6> addr_;
+            struct sockaddr_in6 addr_{};
+            bool addr_set_{false};
             socklen_t addr_len_{sizeof(struct sockaddr_in6)};
             bool dtls_done_{false};
             Srtp srtp_;
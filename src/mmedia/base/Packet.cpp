@@ -1,4 +1,8 @@
 #include "Packet.h" 
+#include "PacketPool.h"
+#include <mutex>
+#include <vector>
+#include <algorithm>
 // 引入头文件 "Packet.h"。这个文件中定义了 Packet 类及相关的类型、方法和变量。
 // Including the header file "Packet.h" where the `Packet` class, methods, and variables are defined.
 
@@ -6,6 +10,101 @@ using namespace tmms::mm;
 // 使用命名空间 `tmms::mm`，简化代码中对 Packet 类等内容的引用。
 // Use the namespace `tmms::mm` to simplify access to classes or functions within this namespace.
 
+namespace tmms
+{
+    namespace mm
+    {
+        // 线程的本地引用登记：别的线程释放本线程的本地引用时先记在这里，由本线程扣减。
+        // 对象永不释放，线程退出后包还指向它；退出后本地计数改在锁里扣减。
+        // Per-thread record of local references: when another thread releases one of them it is
+        // queued here and settled by this thread. Never freed, because packets keep pointing at it;
+        // once the thread has exited, local counts are settled under the lock instead.
+        struct PacketRefOwner
+        {
+            std::mutex lock;
+            std::vector<Packet*> released;
+            std::atomic<bool> pending{false};
+            bool alive{true};
+
+            // 在别的线程调用 (Called on another thread)
+            void Defer(Packet *packet)
+            {
+                {
+                    std::lock_guard<std::mutex> lk(lock);
+                    if(alive)
+                    {
+                        released.push_back(packet);
+                        pending.store(true,std::memory_order_release);
+                        return;
+                    }
+                    if(--packet->local_refs_ != 0)
+                    {
+                        return;
+                    }
+                }
+                packet->ReleaseShared();
+            }
+            // 在所属线程调用，retire 表示线程正在退出 (Called on the owning thread; retire when it is exiting)
+            void Drain(bool retire)
+            {
+                std::vector<Packet*> dead;
+                {
+                    std::lock_guard<std::mutex> lk(lock);
+                    alive = !retire;
+                    for(auto packet : released)
+                    {
+                        if(--packet->local_refs_ == 0)
+                        {
+                            dead.push_back(packet);
+                        }
+                    }
+                    released.clear();
+                    pending.store(false,std::memory_order_relaxed);
+                }
+                for(auto packet : dead)
+                {
+                    packet->ReleaseShared();
+                }
+            }
+        };
+    }
+}
+
+namespace
+{
+    struct RefOwnerReaper
+    {
+        PacketRefOwner *owner{nullptr};
+        ~RefOwnerReaper();
+    };
+
+    thread_local PacketRefOwner *tls_owner = nullptr;
+    thread_local bool tls_owner_retired = false;
+    thread_local RefOwnerReaper tls_owner_reaper;
+
+    RefOwnerReaper::~RefOwnerReaper()
+    {
+        if(owner)
+        {
+            // 之后本线程上的引用都走共享计数 (from here on references on this thread use the shared count)
+            tls_owner = nullptr;
+            tls_owner_retired = true;
+            owner->Drain(true);
+        }
+    }
+
+    PacketRefOwner *CurrentOwner()
+    {
+        if(tls_owner || tls_owner_retired)
+        {
+            return tls_owner;
+        }
+        tls_owner = new PacketRefOwner();
+        tls_owner_reaper.owner = tls_owner;
+        return tls_owner;
+    }
+}
+
 PacketPtr Packet::NewPacket(int32_t size)
 // 定义静态工厂方法 NewPacket，接收一个 `size` 参数，表示数据包的容量（字节数）。
 // Define a static factory method `NewPacket` which takes `size` as the packet's capacity (in bytes).
@@ -14,14 +113,14 @@ PacketPtr Packet::NewPacket(int32_t size)
     // 计算需要分配的内存大小：`Packet` 结构体大小 + 数据区大小。
     // Calculate the total memory block size: size of the `Packet` struct + data area size.
 
-    Packet * packet = (Packet*)new char[block_size];
-    // 在堆上分配一块连续的内存，并将其强制转换为 `Packet*` 指针。
-    // Allocate a continuous memory block on the heap and cast it to a `Packet*` pointer.
+    Packet * packet = (Packet*)PacketPool::Allocate(block_size);
+    // 从按大小分级的包内存池取一块连续的内存，并将其强制转换为 `Packet*` 指针。
+    // Take a continuous memory block from the size-class packet pool and cast it to a `Packet*` pointer.
     // Example: If `size` = 1024, `block_size` = 1024 + sizeof(Packet).
 
-    memset((void*)packet, 0x00, block_size);
-    // 使用 memset 将分配的内存块全部初始化为 0。
-    // Use `memset` to initialize the entire memory block to 0.
+    memset((void*)packet, 0x00, sizeof(Packet));
+    // 只把包头清零，数据区马上会被调用方写入。
+    // Only the header is zeroed; callers overwrite the data area right away.
 
     packet->index_ = -1;
     // 初始化 `index_` 成员变量，设为 -1，表示数据包的初始索引状态。
@@ -35,23 +134,113 @@ PacketPtr Packet::NewPacket(int32_t size)
     // 设置数据包的容量为传入的 `size` 参数。
     // Set the packet's capacity to the provided `size` parameter.
 
-    packet->ext_.reset();
-    // 调用 `ext_`（扩展数据的智能指针）方法 `reset`，清空扩展数据指针。
-    // Call `reset()` on `ext_` smart pointer to clear any existing extended data.
-
-    return PacketPtr(packet, [](Packet *p) {
-        delete [](char*)p; 
-    });
+    return PacketPtr(packet, packet->InitRefs());
     /*
-    返回一个 PacketPtr 智能指针（类似于 `std::shared_ptr`）。
-    智能指针使用自定义删除器（lambda 函数），在 `PacketPtr` 释放时，删除分配的内存。
-    The function returns a `PacketPtr` smart pointer (similar to `std::shared_ptr`).
-    A custom deleter (lambda function) is provided to safely release the allocated memory.
-
-    - 自定义删除器逻辑：使用 `delete[]` 释放用 `new char[]` 分配的内存。
-      The custom deleter uses `delete[]` to free the memory allocated with `new char[]`.
+    返回一个 PacketPtr 侵入式句柄，引用计数在包头里。
+    最后一个引用释放时调用 Destroy，析构成员并把内存块还给包内存池。
+    The function returns a `PacketPtr` intrusive handle; the reference count lives in the header.
+    When the last reference goes away, Destroy runs the member destructors and returns the block
+    to the packet pool.
     */
 }
+PacketPtr Packet::NewPacket(const std::shared_ptr<char> &slice, int32_t size, int32_t held)
+{
+    Packet * packet = (Packet*)PacketPool::Allocate(sizeof(Packet));
+    memset((void*)packet, 0x00, sizeof(Packet));
+    packet->index_ = -1;
+    packet->type_ = kPacketTypeUnknowed;
+    packet->capacity_ = size;
+    packet->size_ = size;
+    packet->slice_ = slice;
+    packet->slice_bytes_ = std::max(size,held);
+    return PacketPtr(packet, packet->InitRefs());
+}
+bool Packet::InitRefs()
+{
+    PacketRefOwner *owner = CurrentOwner();
+    if(owner && owner->pending.load(std::memory_order_acquire))
+    {
+        owner->Drain(false);
+    }
+    owner_ = owner;
+    local_refs_ = owner ? 1 : 0;
+    shared_refs_.store(1,std::memory_order_relaxed);
+    return owner != nullptr;
+}
+bool Packet::AddRef()
+{
+    // 只看已有的登记，没创建过包的线程不会有本地引用 (no lazy creation: a thread that never created a packet holds no local references)
+    PacketRefOwner *me = tls_owner;
+    if(me && me == owner_)
+    {
+        if(local_refs_++ == 0)
+        {
+            shared_refs_.fetch_add(1,std::memory_order_relaxed);
+        }
+        return true;
+    }
+    shared_refs_.fetch_add(1,std::memory_order_relaxed);
+    return false;
+}
+void Packet::Release(bool local)
+{
+    if(!local)
+    {
+        ReleaseShared();
+        return;
+    }
+    if(owner_ == tls_owner)
+    {
+        if(--local_refs_ == 0)
+        {
+            ReleaseShared();
+        }
+        return;
+    }
+    owner_->Defer(this);
+}
+void Packet::ReleaseShared()
+{
+    // 只剩这一份时没有别人能再加引用，不需要原子减 (with only this share left nobody else can add one, so no atomic decrement is needed)
+    if(shared_refs_.load(std::memory_order_acquire) == 1
+        || shared_refs_.fetch_sub(1,std::memory_order_acq_rel) == 1)
+    {
+        Destroy();
+    }
+}
+void Packet::Destroy()
+{
+    this->~Packet();  // 释放 ext_ 等成员 (releases ext_ and the other members)
+    PacketPool::Free(this);
+}
+void Packet::ReclaimDeferred()
+{
+    PacketRefOwner *owner = tls_owner;
+    if(owner && owner->pending.load(std::memory_order_acquire))
+    {
+        owner->Drain(false);
+    }
+}
+const tmms::network::BufferHolderOps PacketPtr::kHolderOps = {
+    &PacketPtr::HolderAddRef,
+    &PacketPtr::HolderRelease,
+};
+uintptr_t PacketPtr::HolderAddRef(void *packet)
+{
+    return ((Packet*)packet)->AddRef() ? 1 : 0;
+}
+void PacketPtr::HolderRelease(void *packet, uintptr_t local)
+{
+    ((Packet*)packet)->Release(local != 0);
+}
+tmms::network::BufferHolder PacketPtr::Hold() const
+{
+    if(!packet_)
+    {
+        return tmms::network::BufferHolder();
+    }
+    return tmms::network::BufferHolder::Adopt(packet_,packet_->AddRef() ? 1 : 0,&kHolderOps);
+}
 
 
 
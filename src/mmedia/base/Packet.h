@@ -6,6 +6,11 @@
 #include <memory>    // 引入智能指针 (std::shared_ptr)
 #include <cstring>   // 用于内存操作
 #include <cstdint>   // 提供固定宽度的整数类型，例如 int32_t, uint64_t
+#include <cstddef>   // std::nullptr_t
+#include <atomic>    // 包头里的引用计数 (reference count in the packet header)
+#include <netinet/in.h> // sockaddr_in6，包头里的目标地址 (destination address in the packet header)
+#include "network/net/BufferHolder.h" // 发送队列里持有包 (holds packets in output queues)
+#include "PacketPool.h"   // 包内存池，内存统计按块大小算 (packet pool; memory accounting uses its block sizes)
 
 namespace tmms    // 定义一个名为 `tmms` 的顶级命名空间 (顶层模块名)
 {
@@ -20,18 +25,36 @@ namespace tmms    // 定义一个名为 `tmms` 的顶级命名空间 (顶层模
             kPacketTypeMeta3 = 8,     // 特定元数据包类型
             kFrameTypeKeyFrame = 16,  // 视频关键帧 (比如I帧)
             kFrameTypeIDR = 32,       // 视频IDR帧 (Intra-coded Picture)
+            kFrameTypeDisposable = 64,// 可丢弃的视频帧，没有其他帧参考它 (non-reference frame)
             kPacketTypeUnknowed = 255 // 未知类型的包
         };
 
-        class Packet;   // 提前声明 `Packet` 类
-        using PacketPtr = std::shared_ptr<Packet>;  
-        // 定义智能指针别名，便于管理 `Packet` 对象的生命周期  
-        // `std::shared_ptr` 自动管理对象内存，防止内存泄漏。
+        class Packet;          // 提前声明 `Packet` 类
+        class PacketPtr;       // 包句柄，定义在 Packet 后面 (packet handle, defined after Packet)
+        struct PacketRefOwner; // 线程的本地引用登记 (per-thread record of local references)
 
-#pragma pack(push) 
-#pragma pack(1)  
-        // 修改结构体字节对齐方式为 1 字节对齐 (确保内存紧凑，提高传输效率)
-        class Packet
+        // 编解码标志，推流入口算一次，后面直接读 (Codec flags, worked out once at ingest and read afterwards)
+        enum
+        {
+            kCodecFlagHeader = 1,     // 编码头（sequence header）(codec sequence header)
+        };
+
+        // 包头里的类型化元数据，热路径上不用再单独分配 (Typed metadata inline in the packet header, so the hot path allocates none)
+        struct PacketMeta
+        {
+            uint32_t rtmp_csid;          // RTMP chunk stream id
+            uint32_t rtmp_msg_sid;       // RTMP message stream id
+            uint8_t rtmp_msg_type;       // RTMP 消息类型，0 表示没有 RTMP 头 (RTMP message type; 0 means no RTMP header)
+            uint8_t has_addr;            // addr 是否有效 (whether addr is set)
+            uint16_t codec_flags;        // kCodecFlag* 
+            int64_t ingest_ms;           // 推流收到的时间，毫秒 (ingest time in milliseconds)
+            struct sockaddr_in6 addr;    // 发送目标地址，WebRTC 用 (destination address, used by WebRTC)
+        };
+
+        // 包头按缓存行对齐，成员自然对齐；包内存池返回的块也按缓存行对齐，数据区紧跟包头
+        // The header is cache-line aligned with naturally aligned members; packet pool blocks are
+        // cache-line aligned too, and the data area follows the header
+        class alignas(64) Packet
         {
         public:
             // 构造函数，初始化包的容量 (Capacity)
@@ -43,6 +66,11 @@ namespace tmms    // 定义一个名为 `tmms` 的顶级命名空间 (顶层模
 
             // 工厂方法：创建一个新的 Packet 实例
             static PacketPtr NewPacket(int32_t size);
+            // 工厂方法：创建一个引用外部数据的 Packet，不拷贝，slice 持有数据直到包释放；
+            // held 是 slice 保活的整块缓冲区大小，计入包占的内存
+            // Factory for a packet that references external data without copying; slice keeps it alive.
+            // held is the size of the whole buffer the slice keeps alive, counted as the packet's memory.
+            static PacketPtr NewPacket(const std::shared_ptr<char> &slice, int32_t size, int32_t held);
 
             // 判断是否是视频包
             bool IsVideo() const
@@ -57,6 +85,13 @@ namespace tmms    // 定义一个名为 `tmms` 的顶级命名空间 (顶层模
                         && (type_ & kFrameTypeKeyFrame) == kFrameTypeKeyFrame;
             }
 
+            // 判断是否是可丢弃帧（非参考帧），丢掉它不影响后续帧解码
+            bool IsDisposable() const
+            {
+                return ((type_ & kPacketTypeVideo) == kPacketTypeVideo)
+                        && (type_ & kFrameTypeDisposable) == kFrameTypeDisposable;
+            }
+
             // 判断是否是音频包
             bool IsAudio() const
             {
@@ -136,34 +171,245 @@ namespace tmms    // 定义一个名为 `tmms` 的顶级命名空间 (顶层模
             }
 
             // 获取数据区域的指针  
-            // 数据区域紧跟在 Packet 对象之后  
+            // 数据区域紧跟在 Packet 对象之后，引用外部数据的包指向切片
             inline char *Data()
             {
-                return (char *)this + sizeof(Packet);
+                return slice_ ? slice_.get() : (char *)this + sizeof(Packet);
             }
 
-            // 获取扩展字段，并转换为指定类型的智能指针
-            template <typename T>
-            inline std::shared_ptr<T> Ext() const
+            // 是否引用外部数据 (Whether the data is a slice of an external buffer)
+            bool IsSlice() const
             {
-                return std::static_pointer_cast<T>(ext_);
+                return slice_ != nullptr;
             }
 
-            // 设置扩展字段 (void类型的共享指针)
-            inline void SetExt(const std::shared_ptr<void> &ext)
+            // 包占的内存：包头和数据区所在的包内存池块（按大小级向上取整），切片包再加它保活的整块缓冲区，用于内存统计
+            // (Memory held by the packet: the pool block of its header and data area, rounded up to the size
+            // class, plus the whole buffer a slice keeps alive; for accounting)
+            int64_t MemoryBytes() const
+            {
+                if(slice_)
+                {
+                    return PacketPool::BlockSize(sizeof(Packet)) + slice_bytes_;
+                }
+                return PacketPool::BlockSize(sizeof(Packet) + capacity_);
+            }
+
+            // RTMP 消息头，包大小就是消息长度，时间戳就是包的时间戳
+            // RTMP message header; the message length is the packet size and the timestamp is the packet's
+            void SetRtmpHeader(uint32_t csid, uint8_t msg_type, uint32_t msg_sid)
+            {
+                meta_.rtmp_csid = csid;
+                meta_.rtmp_msg_type = msg_type;
+                meta_.rtmp_msg_sid = msg_sid;
+            }
+            bool HasRtmpHeader() const
+            {
+                return meta_.rtmp_msg_type != 0;
+            }
+            uint32_t RtmpCsid() const
+            {
+                return meta_.rtmp_csid;
+            }
+            uint8_t RtmpMsgType() const
+            {
+                return meta_.rtmp_msg_type;
+            }
+            uint32_t RtmpMsgSid() const
             {
-                ext_ = ext;
+                return meta_.rtmp_msg_sid;
             }
 
+            // 发送目标地址，没有设置时返回 nullptr (Destination address; nullptr when not set)
+            void SetDestAddr(const struct sockaddr_in6 &addr)
+            {
+                meta_.addr = addr;
+                meta_.has_addr = 1;
+            }
+            const struct sockaddr_in6 *DestAddr() const
+            {
+                return meta_.has_addr ? &meta_.addr : nullptr;
+            }
+
+            // 推流收到的时间 (Ingest time)
+            void SetIngestTime(int64_t ms)
+            {
+                meta_.ingest_ms = ms;
+            }
+            int64_t IngestTime() const
+            {
+                return meta_.ingest_ms;
+            }
+
+            // 编解码标志 (Codec flags)
+            void SetCodecFlags(uint16_t flags)
+            {
+                meta_.codec_flags = flags;
+            }
+            uint16_t CodecFlags() const
+            {
+                return meta_.codec_flags;
+            }
+
+            // 处理别的线程替本线程释放的本地引用，事件循环定期调用
+            // Settles local references other threads released on this thread's behalf; loops call it periodically
+            static void ReclaimDeferred();
+
         private:
+            friend class PacketPtr;
+            friend struct PacketRefOwner;
+
+            bool InitRefs();              // 新包由创建线程持有一个引用 (a new packet starts with one reference held by its creator)
+            bool AddRef();                // 返回 true 表示拿到的是本地引用 (true when the new reference is local)
+            void Release(bool local);
+            void ReleaseShared();
+            void Destroy();
+
+            // 引用计数和常用字段放在包头第一个缓存行 (the counts and the hot fields share the header's first cache line)
+            std::atomic<int32_t> shared_refs_{0}; // 其他线程的引用，加上本地引用合起来的一份 (references from other threads, plus one for all local ones)
+            int32_t local_refs_{0};               // 创建线程上的引用，只有它读写 (references on the creating thread; only it touches this)
+            PacketRefOwner *owner_{nullptr};      // 创建线程 (creating thread)
             int32_t type_{kPacketTypeUnknowed};  // 包类型 (默认为未知)
             uint32_t size_{0};                   // 当前包的大小
             int32_t index_{-1};                  // 包的索引值
-            uint64_t timestamp_{0};              // 时间戳 (用于同步音视频数据)
             uint32_t capacity_{0};               // 包的总容量 (最大数据大小)
-            std::shared_ptr<void> ext_;          // 扩展字段，用于存储额外数据
+            uint64_t timestamp_{0};              // 时间戳 (用于同步音视频数据)
+            std::shared_ptr<char> slice_;        // 引用的外部数据 (referenced external data)
+            uint32_t slice_bytes_{0};            // slice_ 保活的缓冲区大小 (size of the buffer slice_ keeps alive)
+            PacketMeta meta_{};                  // 元数据，NewPacket 时和包头一起清零 (metadata, zeroed with the header by NewPacket)
         };
-#pragma pack()  // 恢复默认字节对齐方式
+
+        // PacketPtr：侵入式引用计数的包句柄，计数在包头里，和包数据是同一次分配。
+        // 创建包的线程（一般是推流所在的事件循环）上的引用只改普通的本地计数，所有本地引用合起来
+        // 占共享计数的一份；其他线程上的引用原子地加减共享计数。本地引用在别的线程释放时，
+        // 交回创建线程扣减。
+        // PacketPtr: an intrusive refcounted packet handle. The count lives in the packet header, in
+        // the same allocation as the data. References taken on the creating thread (usually the
+        // publisher's event loop) bump a plain local count, and all of them together hold one share
+        // of the atomic count; references on other threads add to the atomic count. A local
+        // reference released on another thread is handed back to the creating thread to settle.
+        class PacketPtr
+        {
+        public:
+            PacketPtr() = default;
+            PacketPtr(std::nullptr_t) {}
+            PacketPtr(const PacketPtr &other)
+                : packet_(other.packet_)
+            {
+                if(packet_)
+                {
+                    local_ = packet_->AddRef();
+                }
+            }
+            PacketPtr(PacketPtr &&other) noexcept
+                : packet_(other.packet_), local_(other.local_)
+            {
+                other.packet_ = nullptr;
+            }
+            ~PacketPtr()
+            {
+                if(packet_)
+                {
+                    packet_->Release(local_);
+                }
+            }
+            PacketPtr &operator=(const PacketPtr &other)
+            {
+                PacketPtr(other).swap(*this);
+                return *this;
+            }
+            PacketPtr &operator=(PacketPtr &&other) noexcept
+            {
+                PacketPtr(std::move(other)).swap(*this);
+                return *this;
+            }
+            PacketPtr &operator=(std::nullptr_t)
+            {
+                reset();
+                return *this;
+            }
+
+            void reset()
+            {
+                PacketPtr().swap(*this);
+            }
+            void swap(PacketPtr &other) noexcept
+            {
+                std::swap(packet_,other.packet_);
+                std::swap(local_,other.local_);
+            }
+            Packet *get() const
+            {
+                return packet_;
+            }
+            Packet *operator->() const
+            {
+                return packet_;
+            }
+            Packet &operator*() const
+            {
+                return *packet_;
+            }
+            explicit operator bool() const
+            {
+                return packet_ != nullptr;
+            }
+            // 是否是创建线程上的本地引用 (Whether this is a local reference on the creating thread)
+            bool IsLocal() const
+            {
+                return local_;
+            }
+            // 给发送队列用的所有者：直接持有包的一个引用，拷贝时走包自己的计数，不分配控制块
+            // An owner for output queues: holds one reference to the packet directly, and copies go
+            // through the packet's own count, with no control block allocated.
+            network::BufferHolder Hold() const;
+            // 给裸指针加一个引用。调用方要保证这期间别的引用还活着，比如环形缓冲区在纪元保护下读出的包
+            // Takes a new reference from a raw pointer. The caller must guarantee another reference
+            // stays alive meanwhile, e.g. a packet read out of a ring under epoch protection.
+            static PacketPtr Ref(Packet *packet)
+            {
+                return packet ? PacketPtr(packet,packet->AddRef()) : PacketPtr();
+            }
+
+        private:
+            friend class Packet;
+            static uintptr_t HolderAddRef(void *packet);
+            static void HolderRelease(void *packet, uintptr_t local);
+            static const network::BufferHolderOps kHolderOps;
+            // 接管一个已经计过数的引用 (Adopts a reference that is already counted)
+            PacketPtr(Packet *packet, bool local)
+                : packet_(packet), local_(local)
+            {
+            }
+
+            Packet *packet_{nullptr};
+            bool local_{false};
+        };
+
+        inline bool operator==(const PacketPtr &a, const PacketPtr &b)
+        {
+            return a.get() == b.get();
+        }
+        inline bool operator!=(const PacketPtr &a, const PacketPtr &b)
+        {
+            return a.get() != b.get();
+        }
+        inline bool operator==(const PacketPtr &a, std::nullptr_t)
+        {
+            return !a;
+        }
+        inline bool operator!=(const PacketPtr &a, std::nullptr_t)
+        {
+            return (bool)a;
+        }
+        inline bool operator==(std::nullptr_t, const PacketPtr &a)
+        {
+            return !a;
+        }
+        inline bool operator!=(std::nullptr_t, const PacketPtr &a)
+        {
+            return (bool)a;
+        }
     }
 }
 // ### **代码功能及其在直播流媒体系统中的实际应用**
@@ -204,11 +450,11 @@ namespace tmms    // 定义一个名为 `tmms` 的顶级命名空间 (顶层模
 // ---
 
 // ### **4. 为什么这种设计有效？**  
-// - **内存布局紧凑**：  
-//   使用 `#pragma pack(1)` 确保结构体在内存中**紧凑排列**，减少空间浪费，优化实时流媒体传输的带宽。  
-// - **可扩展性**：  
-//   使用 `ext_` 智能指针允许动态附加额外数据（例如自定义头信息或统计信息），而无需修改核心类。  
-//   - **示例**：为数据包添加丢包率或网络延迟的统计信息。  
+// - **内存布局对齐**：  
+//   包头按缓存行对齐，成员自然对齐，引用计数和常用字段在第一个缓存行，数据区紧跟包头。  
+// - **类型化元数据**：  
+//   RTMP 消息头、目标地址、推流时间、编解码标志直接放在包头的 `meta_` 里，热路径上不用额外分配。  
+//   - **示例**：WebRTC 发送时直接从包头取目标地址。  
 // - **类型安全**：  
 //   通过 `IsVideo()`、`IsAudio()` 和 `IsKeyFrame()` 等辅助函数，提供了简单可读的方法来判断数据包的类型。  
 //   - **示例**：确保视频数据包与音频数据包的处理逻辑不同。
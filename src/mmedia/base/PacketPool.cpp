@@ -0,0 +1,561 @@
+#include "PacketPool.h"
+#include <sys/mman.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+
+using namespace tmms::mm;
+
+namespace
+{
+    const uint32_t kLargeClass = kPacketPoolClasses;    // 不进池的大块 (oversized blocks outside the pool)
+    const size_t kLocalCacheBytes = 1024 * 1024;        // 每个线程每一级最多缓存的字节 (per-thread cache limit per class)
+    const size_t kDepotBytes = 8 * 1024 * 1024;         // 全局仓库每一级最多缓存的字节 (global depot limit per class)
+    const size_t kRemoteBatch = 32;                     // 跨线程释放满这么多块交还一次 (cross-thread frees handed back per batch)
+    const size_t kRemoteBatchBytes = 256 * 1024;        // 或者满这么多字节 (or once this many bytes are pending)
+
+    struct ThreadCache;
+
+    // 块头，紧挨在返回给调用方的地址前面 (Block header, right before the address handed out)
+    struct BlockHeader
+    {
+        ThreadCache *owner;   // 分配它的线程缓存，nullptr 表示线程已退出 (allocating thread's cache; nullptr once that thread has exited)
+        uint32_t cls;         // 大小级 (size class)
+        uint32_t arena;       // 从 arena 切出来的块不能单独释放 (blocks carved from an arena cannot be released on their own)
+        char pad[kPacketPoolAlign - 16];
+    };
+    static_assert(sizeof(BlockHeader) == kPacketPoolAlign, "the header keeps the payload cache-line aligned");
+
+    // 块按缓存行对齐，arena 里的块天然对齐 (Blocks are cache-line aligned; arena blocks are aligned by construction)
+    void *AlignedNew(size_t size)
+    {
+        void *p = nullptr;
+        if(::posix_memalign(&p,kPacketPoolAlign,size) != 0)
+        {
+            throw std::bad_alloc();
+        }
+        return p;
+    }
+
+    struct ClassCounters
+    {
+        std::atomic<uint64_t> hits{0};
+        std::atomic<uint64_t> misses{0};
+        std::atomic<int64_t> held{0};
+    };
+
+    // 只有所属线程写的计数，不需要带锁的加法 (Counters written by one thread only need no locked add)
+    inline void Bump(std::atomic<uint64_t> &counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1,std::memory_order_relaxed);
+    }
+
+    struct RemoteBatch
+    {
+        ThreadCache *owner;
+        std::vector<BlockHeader*> blocks;
+        size_t bytes;
+    };
+
+    // 线程缓存：free 和 remote 只有本线程访问；inbox 是别的线程交还的块，用锁保护。
+    // 缓存对象永不释放，线程退出后别的线程还可能往它交还块，统计也还要读。
+    // Thread cache: free and remote are touched by their own thread only; inbox holds blocks handed
+    // back by other threads and is guarded by lock. Caches are never freed: other threads may still
+    // hand blocks back after the thread exits, and the stats keep reading them.
+    struct ThreadCache
+    {
+        std::vector<BlockHeader*> free[kPacketPoolClasses];
+        ClassCounters counters[kPacketPoolClasses];
+        std::vector<RemoteBatch> remote;
+
+        std::mutex lock;
+        std::vector<BlockHeader*> inbox;
+        std::atomic<bool> inbox_pending{false};
+        bool alive{true};
+    };
+
+    // 全局状态，故意不析构，退出时其他线程还可能在释放包 (Global state, deliberately leaked: other threads may still free packets during exit)
+    struct Global
+    {
+        std::mutex lock;
+        std::vector<ThreadCache*> caches;
+        std::vector<BlockHeader*> depot[kPacketPoolClasses];
+        ClassCounters counters[kPacketPoolClasses];   // 仓库占用和没有线程缓存时的分配 (depot bytes and allocations without a thread cache)
+        std::atomic<uint64_t> large{0};
+        std::atomic<bool> huge{false};
+        char *arena{nullptr};
+        size_t arena_left{0};
+    };
+
+    Global &Pool()
+    {
+        static Global *pool = new Global();
+        return *pool;
+    }
+
+    inline size_t ClassSize(uint32_t cls)
+    {
+        return kPacketPoolMinBlock << cls;
+    }
+
+    inline uint32_t ClassOf(size_t bytes)
+    {
+        if(bytes <= kPacketPoolMinBlock)
+        {
+            return 0;
+        }
+        return 64 - __builtin_clzl(bytes - 1) - 8;   // kPacketPoolMinBlock == 1 << 8
+    }
+
+    inline size_t LocalCap(uint32_t cls)
+    {
+        size_t n = kLocalCacheBytes / ClassSize(cls);
+        return n < 2 ? 2 : n;
+    }
+
+    // 块放进仓库，仓库满了就释放 (Moves blocks into the depot, releasing what does not fit)
+    void ToDepot(std::vector<BlockHeader*> &blocks)
+    {
+        Global &pool = Pool();
+        std::vector<BlockHeader*> release;
+        {
+            std::lock_guard<std::mutex> lk(pool.lock);
+            for(auto b : blocks)
+            {
+                auto &depot = pool.depot[b->cls];
+                if(!b->arena && (depot.size() + 1) * ClassSize(b->cls) > kDepotBytes)
+                {
+                    release.push_back(b);
+                    continue;
+                }
+                depot.push_back(b);
+                pool.counters[b->cls].held.fetch_add(ClassSize(b->cls),std::memory_order_relaxed);
+            }
+        }
+        for(auto b : release)
+        {
+            ::free(b);
+        }
+        blocks.clear();
+    }
+
+    // 交还给分配线程，它已经退出就进仓库 (Hands blocks back to their owner, or to the depot once it has exited)
+    void HandBack(ThreadCache *owner, std::vector<BlockHeader*> &blocks)
+    {
+        if(owner)
+        {
+            std::lock_guard<std::mutex> lk(owner->lock);
+            if(owner->alive)
+            {
+                for(auto b : blocks)
+                {
+                    owner->counters[b->cls].held.fetch_add(ClassSize(b->cls),std::memory_order_relaxed);
+                }
+                owner->inbox.insert(owner->inbox.end(),blocks.begin(),blocks.end());
+                owner->inbox_pending.store(true,std::memory_order_release);
+                blocks.clear();
+                return;
+            }
+        }
+        ToDepot(blocks);
+    }
+
+    void FlushBatch(ThreadCache *cache, RemoteBatch &batch)
+    {
+        for(auto b : batch.blocks)
+        {
+            cache->counters[b->cls].held.fetch_sub(ClassSize(b->cls),std::memory_order_relaxed);
+        }
+        HandBack(batch.owner,batch.blocks);
+        batch.bytes = 0;
+    }
+
+    // 线程退出：交还攒着的块，空闲块全部进仓库 (Thread exit: hand back pending frees and move every idle block to the depot)
+    void RetireCache(ThreadCache *cache)
+    {
+        for(auto &batch : cache->remote)
+        {
+            FlushBatch(cache,batch);
+        }
+        std::vector<BlockHeader*> blocks;
+        {
+            std::lock_guard<std::mutex> lk(cache->lock);
+            cache->alive = false;
+            blocks.swap(cache->inbox);
+            cache->inbox_pending = false;
+        }
+        for(uint32_t cls = 0; cls < kPacketPoolClasses; cls++)
+        {
+            blocks.insert(blocks.end(),cache->free[cls].begin(),cache->free[cls].end());
+            std::vector<BlockHeader*>().swap(cache->free[cls]);
+        }
+        for(auto b : blocks)
+        {
+            cache->counters[b->cls].held.fetch_sub(ClassSize(b->cls),std::memory_order_relaxed);
+            b->owner = nullptr;
+        }
+        ToDepot(blocks);
+    }
+
+    // 线程退出时回收线程缓存 (Retires the thread cache when the thread exits)
+    struct CacheReaper
+    {
+        ThreadCache *cache{nullptr};
+        ~CacheReaper();
+    };
+
+    thread_local ThreadCache *tls_cache = nullptr;
+    thread_local bool tls_retired = false;
+    thread_local CacheReaper tls_reaper;
+
+    CacheReaper::~CacheReaper()
+    {
+        if(cache)
+        {
+            tls_cache = nullptr;
+            tls_retired = true;   // 之后的分配和释放不再走线程缓存 (later calls on this thread bypass the cache)
+            RetireCache(cache);
+        }
+    }
+
+    ThreadCache *Local()
+    {
+        if(tls_cache || tls_retired)
+        {
+            return tls_cache;
+        }
+        ThreadCache *cache = new ThreadCache();
+        {
+            Global &pool = Pool();
+            std::lock_guard<std::mutex> lk(pool.lock);
+            pool.caches.push_back(cache);
+        }
+        tls_reaper.cache = cache;
+        tls_cache = cache;
+        return cache;
+    }
+
+    void Drain(ThreadCache *cache)
+    {
+        std::vector<BlockHeader*> blocks;
+        {
+            std::lock_guard<std::mutex> lk(cache->lock);
+            blocks.swap(cache->inbox);
+            cache->inbox_pending.store(false,std::memory_order_relaxed);
+        }
+        for(auto b : blocks)
+        {
+            cache->free[b->cls].push_back(b);
+        }
+    }
+
+    // 从仓库取最多半个缓存上限的块 (Takes up to half a cache's worth of blocks from the depot)
+    void Refill(ThreadCache *cache, uint32_t cls)
+    {
+        Global &pool = Pool();
+        std::lock_guard<std::mutex> lk(pool.lock);
+        auto &depot = pool.depot[cls];
+        size_t n = std::min(depot.size(),(LocalCap(cls) + 1) / 2);
+        if(n == 0)
+        {
+            return;
+        }
+        auto &list = cache->free[cls];
+        list.insert(list.end(),depot.end() - n,depot.end());
+        depot.resize(depot.size() - n);
+        int64_t bytes = n * ClassSize(cls);
+        pool.counters[cls].held.fetch_sub(bytes,std::memory_order_relaxed);
+        cache->counters[cls].held.fetch_add(bytes,std::memory_order_relaxed);
+    }
+
+    BlockHeader *TakeFromDepot(uint32_t cls)
+    {
+        Global &pool = Pool();
+        std::lock_guard<std::mutex> lk(pool.lock);
+        auto &depot = pool.depot[cls];
+        if(depot.empty())
+        {
+            pool.counters[cls].misses.fetch_add(1,std::memory_order_relaxed);
+            return nullptr;
+        }
+        BlockHeader *b = depot.back();
+        depot.pop_back();
+        pool.counters[cls].held.fetch_sub(ClassSize(cls),std::memory_order_relaxed);
+        pool.counters[cls].hits.fetch_add(1,std::memory_order_relaxed);
+        return b;
+    }
+
+    // 新建一个 2MB arena，优先用预留的大页，没有就用透明大页 (Maps a new 2MB arena: reserved huge pages first, transparent huge pages otherwise)
+    char *NewArena()
+    {
+        void *p = ::mmap(nullptr,kPacketPoolArenaSize,PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB,-1,0);
+        if(p != MAP_FAILED)
+        {
+            return (char*)p;
+        }
+        // 透明大页要求 2MB 对齐，多映射一倍再裁掉 (THP needs 2MB alignment: map twice the size and trim)
+        size_t len = kPacketPoolArenaSize * 2;
+        p = ::mmap(nullptr,len,PROT_READ | PROT_WRITE,MAP_PRIVATE | MAP_ANONYMOUS,-1,0);
+        if(p == MAP_FAILED)
+        {
+            return nullptr;
+        }
+        char *start = (char*)p;
+        char *aligned = (char*)(((uintptr_t)start + kPacketPoolArenaSize - 1) & ~(uintptr_t)(kPacketPoolArenaSize - 1));
+        if(aligned > start)
+        {
+            ::munmap(start,aligned - start);
+        }
+        char *end = aligned + kPacketPoolArenaSize;
+        if(start + len > end)
+        {
+            ::munmap(end,start + len - end);
+        }
+#ifdef MADV_HUGEPAGE
+        ::madvise(aligned,kPacketPoolArenaSize,MADV_HUGEPAGE);
+#endif
+        return aligned;
+    }
+
+    BlockHeader *NewBlock(uint32_t cls)
+    {
+        size_t size = ClassSize(cls);
+        Global &pool = Pool();
+        if(pool.huge.load(std::memory_order_relaxed) && size <= kPacketPoolArenaMaxBlock)
+        {
+            std::lock_guard<std::mutex> lk(pool.lock);
+            if(pool.arena_left < size)
+            {
+                char *arena = NewArena();
+                if(arena)
+                {
+                    pool.arena = arena;
+                    pool.arena_left = kPacketPoolArenaSize;
+                }
+            }
+            if(pool.arena_left >= size)
+            {
+                BlockHeader *b = (BlockHeader*)pool.arena;
+                pool.arena += size;
+                pool.arena_left -= size;
+                b->arena = 1;
+                return b;
+            }
+        }
+        BlockHeader *b = (BlockHeader*)AlignedNew(size);
+        b->arena = 0;
+        return b;
+    }
+
+    void PushLocal(ThreadCache *cache, BlockHeader *b)
+    {
+        uint32_t cls = b->cls;
+        auto &list = cache->free[cls];
+        list.push_back(b);
+        cache->counters[cls].held.fetch_add(ClassSize(cls),std::memory_order_relaxed);
+        if(list.size() <= LocalCap(cls))
+        {
+            return;
+        }
+        // 超过上限，把较早的一半放进仓库 (Over the limit: the older half goes to the depot)
+        size_t n = list.size() / 2;
+        std::vector<BlockHeader*> spill(list.begin(),list.begin() + n);
+        list.erase(list.begin(),list.begin() + n);
+        cache->counters[cls].held.fetch_sub(n * ClassSize(cls),std::memory_order_relaxed);
+        ToDepot(spill);
+    }
+}
+
+size_t PacketPool::BlockSize(size_t size)
+{
+    size_t bytes = size + sizeof(BlockHeader);
+    uint32_t cls = ClassOf(bytes);
+    return cls >= kPacketPoolClasses ? bytes : ClassSize(cls);
+}
+
+void *PacketPool::Allocate(size_t size)
+{
+    size_t bytes = size + sizeof(BlockHeader);
+    uint32_t cls = ClassOf(bytes);
+    if(cls >= kPacketPoolClasses)
+    {
+        BlockHeader *b = (BlockHeader*)AlignedNew(bytes);
+        b->owner = nullptr;
+        b->cls = kLargeClass;
+        b->arena = 0;
+        Pool().large.fetch_add(1,std::memory_order_relaxed);
+        return b + 1;
+    }
+
+    ThreadCache *cache = Local();
+    BlockHeader *b = nullptr;
+    if(cache)
+    {
+        auto &list = cache->free[cls];
+        if(list.empty() && cache->inbox_pending.load(std::memory_order_acquire))
+        {
+            Drain(cache);
+        }
+        if(list.empty())
+        {
+            Refill(cache,cls);
+        }
+        if(!list.empty())
+        {
+            b = list.back();
+            list.pop_back();
+            cache->counters[cls].held.fetch_sub(ClassSize(cls),std::memory_order_relaxed);
+            Bump(cache->counters[cls].hits);
+        }
+        else
+        {
+            Bump(cache->counters[cls].misses);
+        }
+    }
+    else
+    {
+        b = TakeFromDepot(cls);
+    }
+    if(!b)
+    {
+        b = NewBlock(cls);
+    }
+    b->owner = cache;
+    b->cls = cls;
+    return b + 1;
+}
+
+void PacketPool::Free(void *ptr)
+{
+    if(!ptr)
+    {
+        return;
+    }
+    BlockHeader *b = (BlockHeader*)ptr - 1;
+    if(b->cls == kLargeClass)
+    {
+        ::free(b);
+        return;
+    }
+    ThreadCache *cache = Local();
+    if(cache && b->owner == cache)
+    {
+        PushLocal(cache,b);
+        return;
+    }
+    if(!cache)
+    {
+        std::vector<BlockHeader*> blocks(1,b);
+        HandBack(b->owner,blocks);
+        return;
+    }
+
+    // 别的线程分配的块，按所属线程攒批 (Allocated on another thread: batch it per owner)
+    RemoteBatch *batch = nullptr;
+    for(auto &r : cache->remote)
+    {
+        if(r.owner == b->owner)
+        {
+            batch = &r;
+            break;
+        }
+    }
+    if(!batch)
+    {
+        cache->remote.push_back(RemoteBatch{b->owner,{},0});
+        batch = &cache->remote.back();
+    }
+    size_t size = ClassSize(b->cls);
+    batch->blocks.push_back(b);
+    batch->bytes += size;
+    cache->counters[b->cls].held.fetch_add(size,std::memory_order_relaxed);
+    if(batch->blocks.size() >= kRemoteBatch || batch->bytes >= kRemoteBatchBytes)
+    {
+        FlushBatch(cache,*batch);
+    }
+}
+
+void PacketPool::EnableHugePages(bool on)
+{
+    Pool().huge.store(on,std::memory_order_relaxed);
+}
+
+bool PacketPool::HugePages()
+{
+    return Pool().huge.load(std::memory_order_relaxed);
+}
+
+void PacketPool::Flush()
+{
+    ThreadCache *cache = tls_cache;
+    if(!cache)
+    {
+        return;
+    }
+    for(auto &batch : cache->remote)
+    {
+        if(!batch.blocks.empty())
+        {
+            FlushBatch(cache,batch);
+        }
+    }
+}
+
+size_t PacketPool::ReleaseIdle()
+{
+    Global &pool = Pool();
+    std::vector<BlockHeader*> release;
+    size_t bytes = 0;
+    {
+        std::lock_guard<std::mutex> lk(pool.lock);
+        for(uint32_t cls = 0; cls < kPacketPoolClasses; cls++)
+        {
+            auto &depot = pool.depot[cls];
+            auto keep = std::partition(depot.begin(),depot.end(),[](BlockHeader *b){ return b->arena != 0; });
+            size_t n = depot.end() - keep;
+            if(n == 0)
+            {
+                continue;
+            }
+            release.insert(release.end(),keep,depot.end());
+            depot.erase(keep,depot.end());
+            pool.counters[cls].held.fetch_sub(n * ClassSize(cls),std::memory_order_relaxed);
+            bytes += n * ClassSize(cls);
+        }
+    }
+    for(auto b : release)
+    {
+        ::free(b);
+    }
+    return bytes;
+}
+
+void PacketPool::GetStats(std::vector<PacketPoolClassStats> &stats)
+{
+    stats.assign(kPacketPoolClasses,PacketPoolClassStats());
+    Global &pool = Pool();
+    std::lock_guard<std::mutex> lk(pool.lock);
+    for(uint32_t cls = 0; cls < kPacketPoolClasses; cls++)
+    {
+        auto &s = stats[cls];
+        s.block_size = ClassSize(cls);
+        s.hits = pool.counters[cls].hits.load(std::memory_order_relaxed);
+        s.misses = pool.counters[cls].misses.load(std::memory_order_relaxed);
+        s.bytes_held = pool.counters[cls].held.load(std::memory_order_relaxed);
+        for(auto cache : pool.caches)
+        {
+            s.hits += cache->counters[cls].hits.load(std::memory_order_relaxed);
+            s.misses += cache->counters[cls].misses.load(std::memory_order_relaxed);
+            s.bytes_held += cache->counters[cls].held.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+uint64_t PacketPool::LargeAllocs()
+{
+    return Pool().large.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tmms
+{
+    namespace mm
+    {
+        const int kPacketPoolClasses = 15;                         // 大小级数：256B .. 4MB (number of size classes)
+        const size_t kPacketPoolMinBlock = 256;                    // 最小的块 (smallest block)
+        const size_t kPacketPoolArenaSize = 2 * 1024 * 1024;       // 大页 arena 的大小 (size of one huge-page arena)
+        const size_t kPacketPoolArenaMaxBlock = 64 * 1024;         // 不超过这个大小的块从 arena 切 (blocks up to this size are carved from arenas)
+        const size_t kPacketPoolAlign = 64;                        // 返回的地址按缓存行对齐 (returned addresses are cache-line aligned)
+
+        // 一个大小级的统计 (Counters of one size class)
+        struct PacketPoolClassStats
+        {
+            size_t block_size{0};
+            uint64_t hits{0};         // 从空闲链表拿到块 (allocations served from a free list)
+            uint64_t misses{0};       // 新分配的块 (allocations that needed a new block)
+            int64_t bytes_held{0};    // 池里空闲块占的字节 (bytes sitting idle in the pool)
+        };
+
+        // PacketPool：Packet 的按大小分级的内存池。
+        // 每个线程有自己的空闲链表，同线程分配和释放不加锁。别的线程释放的块先攒在释放线程里，
+        // 满一批再加锁交还给分配它的线程，分配线程链表空了时再取回。线程本地缓存超过上限的块进全局仓库，
+        // 供其他线程使用。开启大页后，64KB 以内的块从 2MB 的大页 arena 里切，arena 不归还给系统。
+        // 超过 4MB 的块直接分配，不进池。
+        // PacketPool: a size-class pool for Packet blocks.
+        // Every thread has its own free lists, so allocating and freeing on one thread takes no lock.
+        // Blocks freed on another thread are collected there and handed back to the allocating thread
+        // in batches under its lock; the owner picks them up when its list runs dry. Blocks beyond a
+        // thread's cache limit go to a global depot for other threads. With huge pages on, blocks up to
+        // 64KB are carved from 2MB huge-page arenas, which are never returned to the system. Blocks
+        // above 4MB are allocated directly and bypass the pool.
+        class PacketPool
+        {
+        public:
+            // 分配至少 size 字节，按缓存行对齐，内容不清零 (At least size bytes, cache-line aligned, not zeroed)
+            static void *Allocate(size_t size);
+            static void Free(void *ptr);
+            // Allocate(size) 实际占的字节：所在大小级的块大小（含块头），不进池的大块是 size 加块头
+            // (Bytes Allocate(size) really takes: its size class's block, header included; size plus the header for oversized blocks)
+            static size_t BlockSize(size_t size);
+
+            // 在分配第一个包之前调用 (Call before the first packet is allocated)
+            static void EnableHugePages(bool on);
+            static bool HugePages();
+            // 把本线程攒着的跨线程释放交还 (Hands this thread's pending cross-thread frees back)
+            static void Flush();
+            // 释放全局仓库里的空闲块，arena 里的块留着，返回释放的字节数
+            // (Frees the idle blocks in the global depot, arena blocks stay; returns the bytes released)
+            static size_t ReleaseIdle();
+
+            static void GetStats(std::vector<PacketPoolClassStats> &stats);
+            // 不进池的大块分配次数 (Number of oversized allocations that bypassed the pool)
+            static uint64_t LargeAllocs();
+        };
+    }
+}
@@ -104,7 +104,6 @@ char FlvContext::GetRtmpPacketType(PacketPtr &pkt)
 }
 bool FlvContext::BuildFlvFrame(PacketPtr &pkt, uint32_t timestamp)
 {
-    out_packets_.emplace_back(pkt);
     char *header = current_;
     char *p = (char*)&previous_size_;
     *current_++ = p[3];
@@ -135,7 +134,7 @@ bool FlvContext::BuildFlvFrame(PacketPtr &pkt, uint32_t timestamp)
     auto h = std::make_shared<BufferNode>(header,current_- header);
     bufs_.emplace_back(std::move(h));
 
-    auto c = std::make_shared<BufferNode>(pkt->Data(),pkt->PacketSize());
+    auto c = std::make_shared<BufferNode>(pkt->Data(),pkt->PacketSize(),pkt.Hold()); // 持有 packet，零拷贝发送需要
     bufs_.emplace_back(std::move(c));
     return true;
 }
@@ -147,13 +146,13 @@ void FlvContext::Send()
     }
     sending_ = true;
     connection_->Send(bufs_);
+    // 头部已经拷贝进连接的输出队列，包体由分片持有，缓冲区马上可以复用
+    bufs_.clear();
+    current_ = out_buffer_;
 }
 void FlvContext::WriteComplete(const TcpConnectionPtr &conn)
 {
     sending_ = false;
-    current_ = out_buffer_;
-    bufs_.clear();
-    out_packets_.clear();
 
     if(handler_)
     {
@@ -29,7 +29,6 @@ namespace tmms
         private:
             char GetRtmpPacketType(PacketPtr &pkt);
             std::list<BufferNodePtr> bufs_;
-            std::list<PacketPtr> out_packets_;
             TcpConnectionPtr connection_;
             uint32_t previous_size_{0};
             std::string http_header_;
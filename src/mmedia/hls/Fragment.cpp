@@ -106,4 +106,8 @@ void Fragment::Reset()
 PacketPtr &Fragment::FragmentData()
 {
     return data_;
-}
\ No newline at end of file
+}
+int64_t Fragment::Bytes() const
+{
+    return data_ ? data_->MemoryBytes() : 0;
+}
@@ -29,6 +29,8 @@ namespace tmms
             void SetSequenceNo(int32_t no);
             void Reset();
             PacketPtr &FragmentData();
+            // 分片缓冲区占的内存 (Memory held by the fragment buffer)
+            int64_t Bytes() const;
             void Save();
         private:
             int64_t duration_{0};
@@ -78,6 +78,34 @@ void FragmentWindow::Shrink()
         free_fragments_.emplace_back(std::move(p));
     }
 }
+int64_t FragmentWindow::Bytes()
+{
+    std::lock_guard<std::mutex> lk(lock_);
+    int64_t bytes = 0;
+    for(auto &f:fragments_)
+    {
+        bytes += f->Bytes();
+    }
+    for(auto &f:free_fragments_)
+    {
+        bytes += f->Bytes();
+    }
+    return bytes;
+}
+int64_t FragmentWindow::ShrinkIdle()
+{
+    std::vector<FragmentPtr> idle;
+    {
+        std::lock_guard<std::mutex> lk(lock_);
+        idle.swap(free_fragments_);
+    }
+    int64_t bytes = 0;
+    for(auto &f:idle)
+    {
+        bytes += f->Bytes();
+    }
+    return bytes;
+}
 void FragmentWindow::UpdatePlayList()
 {
     std::lock_guard<std::mutex> lk(lock_);
@@ -23,6 +23,10 @@ namespace tmms
             FragmentPtr GetIdleFragment();
             const FragmentPtr &GetFragmentByName(const string &name);
             string GetPlayList();
+            // 窗口里和空闲的分片占的内存 (Memory held by the fragments in the window and the idle ones)
+            int64_t Bytes();
+            // 释放空闲分片，返回释放的字节数 (Releases the idle fragments; returns the bytes released)
+            int64_t ShrinkIdle();
             
         private:
             void Shrink();
@@ -78,4 +78,13 @@ void HLSMuxer::ParseCodec(FragmentPtr &fragment,PacketPtr &packet)
         VideoCodecID id = (VideoCodecID)(*data&0x0f);
         encoder_.SetStreamType(fragment.get(),id,kAudioCodecIDReserved);
     }
-}
\ No newline at end of file
+}
+int64_t HLSMuxer::Bytes()
+{
+    int64_t bytes = fragment_window_.Bytes();
+    if(current_fragment_)
+    {
+        bytes += current_fragment_->Bytes();
+    }
+    return bytes;
+}
@@ -22,6 +22,12 @@ namespace tmms
             void OnPacket(PacketPtr &packet);
             FragmentPtr GetFragment(const string &name);
             void ParseCodec(FragmentPtr &fragment,PacketPtr &packet);
+            // 分片窗口和正在写的分片占的内存 (Memory held by the fragment window and the fragment being written)
+            int64_t Bytes();
+            int64_t ShrinkIdle()
+            {
+                return fragment_window_.ShrinkIdle();
+            }
 
         private:
             static bool IsCodecHeader(const PacketPtr &packet);    
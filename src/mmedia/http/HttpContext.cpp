@@ -136,7 +136,7 @@ bool HttpContext::PostStreamChunk(PacketPtr &packet)
         else
         {
             post_state_ = kHttpContextPostHttpStreamChunk;
-            connection_->Send(out_pakcet_->Data(),out_pakcet_->PacketSize());
+            connection_->Send(out_pakcet_->Data(),out_pakcet_->PacketSize(),out_pakcet_.Hold());
         }
         return true;
     }
@@ -159,7 +159,7 @@ void HttpContext::WriteComplete(const TcpConnectionPtr &conn)
         case kHttpContextPostHttpHeader:
         {
             post_state_ = kHttpContextPostHttpBody;
-            connection_->Send(out_pakcet_->Data(),out_pakcet_->PacketSize());
+            connection_->Send(out_pakcet_->Data(),out_pakcet_->PacketSize(),out_pakcet_.Hold());
             break;
         }
         case kHttpContextPostHttpBody:
@@ -177,7 +177,7 @@ void HttpContext::WriteComplete(const TcpConnectionPtr &conn)
         case kHttpContextPostChunkLen:
         {
             post_state_ = kHttpContextPostChunkBody;
-            connection_->Send(out_pakcet_->Data(),out_pakcet_->PacketSize());
+            connection_->Send(out_pakcet_->Data(),out_pakcet_->PacketSize(),out_pakcet_.Hold());
             break;
         }
         case kHttpContextPostChunkBody:
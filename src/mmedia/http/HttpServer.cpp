@@ -65,12 +65,12 @@ void HttpServer::OnWriteComplete(const ConnectionPtr &conn)
     HttpContextPtr shake = conn->GetContext<HttpContext>(kHttpContext);
     if(shake)
     {
-        shake->WriteComplete(std::dynamic_pointer_cast<TcpConnection>(conn));
+        shake->WriteComplete(std::static_pointer_cast<TcpConnection>(conn));
     }
     FlvContextPtr flv = conn->GetContext<FlvContext>(kFlvContext);
     if(flv)
     {
-        flv->WriteComplete(std::dynamic_pointer_cast<TcpConnection>(conn));
+        flv->WriteComplete(std::static_pointer_cast<TcpConnection>(conn));
     }    
 }
 void HttpServer::OnActive(const ConnectionPtr &conn)
@@ -27,6 +27,7 @@ void RtmpClient::OnConnection(const TcpConnectionPtr& conn,bool connected)
 {
     if(connected)
     {
+        conn->EnableSlabBuffer();
         auto context = std::make_shared<RtmpContext>(conn,handler_,true);
         if(is_player_)
         {
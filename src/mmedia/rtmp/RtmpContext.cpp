@@ -148,32 +148,38 @@ int32_t RtmpContext::ParseMessage(MsgBuffer &buf)
         {
             msg_len = in_chunk_size_;
         }
+        // 包等到块体到齐时再创建，整条消息在一个块里的可以直接引用接收缓冲区
+        // The packet is created once the chunk body is here, so a single-chunk message can reference the receive buffer
+        // 消息头在包头里，收到一半的消息从包里取回 (the message header lives in the packet header; a partial message reloads it from there)
         PacketPtr &packet = in_packets_[csid];
-        if(!packet)
+        RtmpMsgHeader header;
+        header.cs_id = csid;
+        if(packet)
+        {
+            header.msg_len = packet->PacketSize() + packet->Space();
+            header.msg_sid = packet->RtmpMsgSid();
+            header.msg_type = packet->RtmpMsgType();
+            header.timestamp = packet->TimeStamp();
+        }
+        else
         {
-            packet = Packet::NewPacket(msg_len);
-            RtmpMsgHeaderPtr header = std::make_shared<RtmpMsgHeader>();
-            header->cs_id = csid;
-            header->msg_len = msg_len;
-            header->msg_sid = msg_sid;
-            header->msg_type = msg_type;
-            header->timestamp = 0;  
-            packet->SetExt(header);          
+            header.msg_len = msg_len;
+            header.msg_sid = msg_sid;
+            header.msg_type = msg_type;
+            header.timestamp = 0;  
         }
 
-        RtmpMsgHeaderPtr header = packet->Ext<RtmpMsgHeader>();
-
         if(fmt == kRtmpFmt0)
         {
             ts = BytesReader::ReadUint24T(pos+parsed);
             parsed += 3;
             in_deltas_[csid] = 0;
-            header->timestamp = ts;
-            header->msg_len = BytesReader::ReadUint24T(pos+parsed);
+            header.timestamp = ts;
+            header.msg_len = BytesReader::ReadUint24T(pos+parsed);
             parsed += 3;
-            header->msg_type = BytesReader::ReadUint8T(pos+parsed);
+            header.msg_type = BytesReader::ReadUint8T(pos+parsed);
             parsed += 1;
-            memcpy(&header->msg_sid,pos+parsed,4);
+            memcpy(&header.msg_sid,pos+parsed,4);
             parsed += 4;
         }
         else if(fmt == kRtmpFmt1)
@@ -181,32 +187,32 @@ int32_t RtmpContext::ParseMessage(MsgBuffer &buf)
             ts = BytesReader::ReadUint24T(pos+parsed);
             parsed += 3;
             in_deltas_[csid] = ts;
-            header->timestamp = ts + prev->timestamp;
-            header->msg_len = BytesReader::ReadUint24T(pos+parsed);
+            header.timestamp = ts + prev->timestamp;
+            header.msg_len = BytesReader::ReadUint24T(pos+parsed);
             parsed += 3;
-            header->msg_type = BytesReader::ReadUint8T(pos+parsed);
+            header.msg_type = BytesReader::ReadUint8T(pos+parsed);
             parsed += 1;
-            header->msg_sid = prev->msg_sid;
+            header.msg_sid = prev->msg_sid;
         }
         else if(fmt == kRtmpFmt2)
         {
             ts = BytesReader::ReadUint24T(pos+parsed);
             parsed += 3;
             in_deltas_[csid] = ts;
-            header->timestamp = ts + prev->timestamp;
-            header->msg_len = prev->msg_len;
-            header->msg_type = prev->msg_type;
-            header->msg_sid = prev->msg_sid;
+            header.timestamp = ts + prev->timestamp;
+            header.msg_len = prev->msg_len;
+            header.msg_type = prev->msg_type;
+            header.msg_sid = prev->msg_sid;
         }    
         else if(fmt == kRtmpFmt3)
         {
-            if(header->timestamp == 0)
+            if(header.timestamp == 0)
             {
-                header->timestamp = in_deltas_[csid] + prev->timestamp;
+                header.timestamp = in_deltas_[csid] + prev->timestamp;
             }
-            header->msg_len = prev->msg_len;
-            header->msg_type = prev->msg_type;
-            header->msg_sid = prev->msg_sid;
+            header.msg_len = prev->msg_len;
+            header.msg_type = prev->msg_type;
+            header.msg_sid = prev->msg_sid;
         } 
 
         bool ext = (ts == 0xFFFFFF);
@@ -225,35 +231,63 @@ int32_t RtmpContext::ParseMessage(MsgBuffer &buf)
             parsed += 4;
             if(fmt != kRtmpFmt0)
             {
-                header->timestamp = ts+ prev->timestamp;
+                header.timestamp = ts+ prev->timestamp;
                 in_deltas_[csid] = ts;
             }
         }
 
-        int bytes = std::min(packet->Space(),in_chunk_size_);
-        if(total_bytes - parsed < bytes)
+        int bytes = 0;
+        if(!packet)
         {
-            return 1;
+            bytes = std::min((int32_t)msg_len,in_chunk_size_);
+            if(total_bytes - parsed < (uint32_t)bytes)
+            {
+                return 1;
+            }
+            // 只有占了 slab 一大半的消息才切片：小消息（音频、元数据）切片会让整块 slab 跟着它在环里
+            // 留很久，拷贝更省内存；超过一半的切片每块 slab 最多一个，包按整块 slab 计内存
+            // Only a message that covers most of its slab is sliced: a slice of a small one (audio,
+            // metadata) would pin the whole slab for as long as it sits in the ring, so copying costs
+            // less memory. At most one slice above half a slab fits in a slab, and the packet is
+            // charged for the whole slab.
+            std::shared_ptr<char> slice;
+            size_t slab = buf.SlabSize();
+            if(bytes > 0 && bytes == (int32_t)msg_len && (size_t)bytes * 2 > slab)
+            {
+                slice = buf.Slice(pos+parsed);
+            }
+            packet = slice ? Packet::NewPacket(slice,msg_len,(int32_t)slab) : Packet::NewPacket(msg_len);
+        }
+        else
+        {
+            bytes = std::min(packet->Space(),in_chunk_size_);
+            if(total_bytes - parsed < (uint32_t)bytes)
+            {
+                return 1;
+            }
+        }
+        packet->SetRtmpHeader(header.cs_id,header.msg_type,header.msg_sid);
+        packet->SetTimeStamp(header.timestamp);
+        if(!packet->IsSlice())
+        {
+            const char * body = packet->Data() + packet->PacketSize();
+            memcpy((void*)body,pos+parsed,bytes);
+            packet->UpdatePacketSize(bytes);
         }
-
-        const char * body = packet->Data() + packet->PacketSize();
-        memcpy((void*)body,pos+parsed,bytes);
-        packet->UpdatePacketSize(bytes);
         parsed += bytes;
         
         buf.Retrieve(parsed);
         total_bytes -= parsed;
 
-        prev->cs_id = header->cs_id;
-        prev->msg_len = header->msg_len;
-        prev->msg_sid = header->msg_sid;
-        prev->msg_type = header->msg_type;
-        prev->timestamp = header->timestamp;
+        prev->cs_id = header.cs_id;
+        prev->msg_len = header.msg_len;
+        prev->msg_sid = header.msg_sid;
+        prev->msg_type = header.msg_type;
+        prev->timestamp = header.timestamp;
 
         if(packet->Space() == 0)
         {
-            packet->SetPacketType(header->msg_type);
-            packet->SetTimeStamp(header->timestamp);
+            packet->SetPacketType(header.msg_type);
             MessageComplete(std::move(packet));
             packet.reset();
         }
@@ -333,12 +367,15 @@ void RtmpContext::MessageComplete(PacketPtr && data)
 }
 bool RtmpContext::BuildChunk(const PacketPtr &packet,uint32_t timestamp,bool fmt0)
 {
-    RtmpMsgHeaderPtr h = packet->Ext<RtmpMsgHeader>();
-    if(h)
+    if(packet->HasRtmpHeader())
     {
-        out_sending_packets_.emplace_back(packet);
-        RtmpMsgHeaderPtr &prev = out_message_headers_[h->cs_id];
-        bool use_delta = !fmt0 && !prev && timestamp >= prev->timestamp && h->msg_sid == prev->msg_sid;
+        RtmpMsgHeader h;
+        h.cs_id = packet->RtmpCsid();
+        h.msg_len = packet->PacketSize();
+        h.msg_type = packet->RtmpMsgType();
+        h.msg_sid = packet->RtmpMsgSid();
+        RtmpMsgHeaderPtr &prev = out_message_headers_[h.cs_id];
+        bool use_delta = !fmt0 && !prev && timestamp >= prev->timestamp && h.msg_sid == prev->msg_sid;
         if(!prev)
         {
             prev = std::make_shared<RtmpMsgHeader>();
@@ -348,11 +385,11 @@ bool RtmpContext::BuildChunk(const PacketPtr &packet,uint32_t timestamp,bool fmt
         {
             fmt = kRtmpFmt1 ;
             timestamp -= prev->timestamp;
-            if(h->msg_type == prev->msg_type
-                && h->msg_len == prev->msg_len)
+            if(h.msg_type == prev->msg_type
+                && h.msg_len == prev->msg_len)
             {
                 fmt = kRtmpFmt2;
-                if(timestamp == out_deltas_[h->cs_id]) 
+                if(timestamp == out_deltas_[h.cs_id]) 
                 {
                     fmt = kRtmpFmt3;
                 }   
@@ -361,19 +398,19 @@ bool RtmpContext::BuildChunk(const PacketPtr &packet,uint32_t timestamp,bool fmt
 
         char *p = out_current_;
 
-        if(h->cs_id<64)
+        if(h.cs_id<64)
         {
-            *p++ = (char)((fmt<<6)|h->cs_id);
+            *p++ = (char)((fmt<<6)|h.cs_id);
         }
-        else if(h->cs_id<(64+256))
+        else if(h.cs_id<(64+256))
         {
            *p++ = (char)((fmt<<6)|0); 
-           *p++ = (char)(h->cs_id - 64);
+           *p++ = (char)(h.cs_id - 64);
         }
         else 
         {
            *p++ = (char)((fmt<<6)|1); 
-           uint16_t cs = h->cs_id-64;
+           uint16_t cs = h.cs_id-64;
            memcpy(p,&cs,sizeof(uint16_t));
            p += sizeof(uint16_t);
         }
@@ -387,24 +424,24 @@ bool RtmpContext::BuildChunk(const PacketPtr &packet,uint32_t timestamp,bool fmt
         if(fmt == kRtmpFmt0)
         {
             p += BytesWriter::WriteUint24T(p,ts);
-            p += BytesWriter::WriteUint24T(p,h->msg_len);
-            p += BytesWriter::WriteUint8T(p,h->msg_type);
+            p += BytesWriter::WriteUint24T(p,h.msg_len);
+            p += BytesWriter::WriteUint8T(p,h.msg_type);
 
-            memcpy(p,&h->msg_sid,4);
+            memcpy(p,&h.msg_sid,4);
             p += 4;
-            out_deltas_[h->cs_id] = 0;
+            out_deltas_[h.cs_id] = 0;
         } 
         else if(fmt == kRtmpFmt1)
         {
             p += BytesWriter::WriteUint24T(p,ts);
-            p += BytesWriter::WriteUint24T(p,h->msg_len);
-            p += BytesWriter::WriteUint8T(p,h->msg_type);
-            out_deltas_[h->cs_id] = timestamp;
+            p += BytesWriter::WriteUint24T(p,h.msg_len);
+            p += BytesWriter::WriteUint8T(p,h.msg_type);
+            out_deltas_[h.cs_id] = timestamp;
         }
         else if(fmt == kRtmpFmt2)
         {
             p += BytesWriter::WriteUint24T(p,ts);
-            out_deltas_[h->cs_id] = timestamp;
+            out_deltas_[h.cs_id] = timestamp;
         }    
 
         if(ts == 0xFFFFFF)
@@ -417,10 +454,10 @@ bool RtmpContext::BuildChunk(const PacketPtr &packet,uint32_t timestamp,bool fmt
         sending_bufs_.emplace_back(std::move(nheader));
         out_current_ = p;
 
-        prev->cs_id = h->cs_id;
-        prev->msg_len = h->msg_len;
-        prev->msg_sid = h->msg_sid;
-        prev->msg_type = h->msg_type;
+        prev->cs_id = h.cs_id;
+        prev->msg_len = h.msg_len;
+        prev->msg_sid = h.msg_sid;
+        prev->msg_type = h.msg_type;
         if(fmt == kRtmpFmt0)
         {
             prev->timestamp = timestamp;
@@ -431,18 +468,19 @@ bool RtmpContext::BuildChunk(const PacketPtr &packet,uint32_t timestamp,bool fmt
         }
         
         const char *body = packet->Data();
+        BufferHolder holder = packet.Hold(); // 所有分片共用一个所有者 (one owner shared by every chunk)
         int32_t bytes_parsed = 0;
         while(true)
         {
             const char * chunk = body+bytes_parsed;
-            int32_t size = h->msg_len - bytes_parsed;
+            int32_t size = h.msg_len - bytes_parsed;
             size = std::min(size,out_chunk_size_);
 
-            BufferNodePtr node = std::make_shared<BufferNode>((void*)chunk,size);
+            BufferNodePtr node = std::make_shared<BufferNode>((void*)chunk,size,holder); // 持有 packet，零拷贝发送需要
             sending_bufs_.emplace_back(std::move(node));
             bytes_parsed += size;
 
-            if(bytes_parsed<h->msg_len)
+            if(bytes_parsed<h.msg_len)
             {
                 if(out_current_ - out_buffer_ >= 4096)
                 {
@@ -451,19 +489,19 @@ bool RtmpContext::BuildChunk(const PacketPtr &packet,uint32_t timestamp,bool fmt
                 }
                 char *p = out_current_;
 
-                if(h->cs_id<64)
+                if(h.cs_id<64)
                 {
-                    *p++ = (char)(0xC0|h->cs_id);
+                    *p++ = (char)(0xC0|h.cs_id);
                 }
-                else if(h->cs_id<(64+256))
+                else if(h.cs_id<(64+256))
                 {
                     *p++ = (char)(0xC0|0); 
-                    *p++ = (char)(h->cs_id - 64);
+                    *p++ = (char)(h.cs_id - 64);
                 }
                 else 
                 {
                     *p++ = (char)(0xC0|1); 
-                    uint16_t cs = h->cs_id-64;
+                    uint16_t cs = h.cs_id-64;
                     memcpy(p,&cs,sizeof(uint16_t));
                     p += sizeof(uint16_t);
                 }
@@ -501,9 +539,13 @@ void RtmpContext::Send()
         }
         PacketPtr packet = std::move(out_waiting_queue_.front());
         out_waiting_queue_.pop_front();
+        out_waiting_bytes_ -= std::min<size_t>(packet->PacketSize(),out_waiting_bytes_);
         BuildChunk(std::move(packet));
     }
     connection_->Send(sending_bufs_);
+    // 协议头已经拷贝进连接的输出队列，包体由分片持有，头部缓冲区马上可以复用
+    sending_bufs_.clear();
+    out_current_ = out_buffer_;
 }
 bool RtmpContext::Ready() const
 {
@@ -511,11 +553,15 @@ bool RtmpContext::Ready() const
 }
 bool RtmpContext::BuildChunk (PacketPtr &&packet,uint32_t timestamp,bool fmt0)
 {
-    RtmpMsgHeaderPtr h = packet->Ext<RtmpMsgHeader>();
-    if(h)
+    if(packet->HasRtmpHeader())
     {
-        RtmpMsgHeaderPtr &prev = out_message_headers_[h->cs_id];
-        bool use_delta = !fmt0 && prev && timestamp >= prev->timestamp && h->msg_sid == prev->msg_sid;
+        RtmpMsgHeader h;
+        h.cs_id = packet->RtmpCsid();
+        h.msg_len = packet->PacketSize();
+        h.msg_type = packet->RtmpMsgType();
+        h.msg_sid = packet->RtmpMsgSid();
+        RtmpMsgHeaderPtr &prev = out_message_headers_[h.cs_id];
+        bool use_delta = !fmt0 && prev && timestamp >= prev->timestamp && h.msg_sid == prev->msg_sid;
         if(!prev)
         {
             prev = std::make_shared<RtmpMsgHeader>();
@@ -525,11 +571,11 @@ bool RtmpContext::BuildChunk (PacketPtr &&packet,uint32_t timestamp,bool fmt0)
         {
             fmt = kRtmpFmt1 ;
             timestamp -= prev->timestamp;
-            if(h->msg_type == prev->msg_type
-                && h->msg_len == prev->msg_len)
+            if(h.msg_type == prev->msg_type
+                && h.msg_len == prev->msg_len)
             {
                 fmt = kRtmpFmt2;
-                if(timestamp == out_deltas_[h->cs_id]) 
+                if(timestamp == out_deltas_[h.cs_id]) 
                 {
                     fmt = kRtmpFmt3;
                 }   
@@ -538,19 +584,19 @@ bool RtmpContext::BuildChunk (PacketPtr &&packet,uint32_t timestamp,bool fmt0)
 
         char *p = out_current_;
 
-        if(h->cs_id<64)
+        if(h.cs_id<64)
         {
-            *p++ = (char)((fmt<<6)|h->cs_id);
+            *p++ = (char)((fmt<<6)|h.cs_id);
         }
-        else if(h->cs_id<(64+256))
+        else if(h.cs_id<(64+256))
         {
            *p++ = (char)((fmt<<6)|0); 
-           *p++ = (char)(h->cs_id - 64);
+           *p++ = (char)(h.cs_id - 64);
         }
         else 
         {
            *p++ = (char)((fmt<<6)|1); 
-           uint16_t cs = h->cs_id-64;
+           uint16_t cs = h.cs_id-64;
            memcpy(p,&cs,sizeof(uint16_t));
            p += sizeof(uint16_t);
         }
@@ -564,24 +610,24 @@ bool RtmpContext::BuildChunk (PacketPtr &&packet,uint32_t timestamp,bool fmt0)
         if(fmt == kRtmpFmt0)
         {
             p += BytesWriter::WriteUint24T(p,ts);
-            p += BytesWriter::WriteUint24T(p,h->msg_len);
-            p += BytesWriter::WriteUint8T(p,h->msg_type);
+            p += BytesWriter::WriteUint24T(p,h.msg_len);
+            p += BytesWriter::WriteUint8T(p,h.msg_type);
 
-            memcpy(p,&h->msg_sid,4);
+            memcpy(p,&h.msg_sid,4);
             p += 4;
-            out_deltas_[h->cs_id] = 0;
+            out_deltas_[h.cs_id] = 0;
         } 
         else if(fmt == kRtmpFmt1)
         {
             p += BytesWriter::WriteUint24T(p,ts);
-            p += BytesWriter::WriteUint24T(p,h->msg_len);
-            p += BytesWriter::WriteUint8T(p,h->msg_type);
-            out_deltas_[h->cs_id] = timestamp;
+            p += BytesWriter::WriteUint24T(p,h.msg_len);
+            p += BytesWriter::WriteUint8T(p,h.msg_type);
+            out_deltas_[h.cs_id] = timestamp;
         }
         else if(fmt == kRtmpFmt2)
         {
             p += BytesWriter::WriteUint24T(p,ts);
-            out_deltas_[h->cs_id] = timestamp;
+            out_deltas_[h.cs_id] = timestamp;
         }    
 
         if(ts == 0xFFFFFF)
@@ -594,10 +640,10 @@ bool RtmpContext::BuildChunk (PacketPtr &&packet,uint32_t timestamp,bool fmt0)
         sending_bufs_.emplace_back(std::move(nheader));
         out_current_ = p;
 
-        prev->cs_id = h->cs_id;
-        prev->msg_len = h->msg_len;
-        prev->msg_sid = h->msg_sid;
-        prev->msg_type = h->msg_type;
+        prev->cs_id = h.cs_id;
+        prev->msg_len = h.msg_len;
+        prev->msg_sid = h.msg_sid;
+        prev->msg_type = h.msg_type;
         if(fmt == kRtmpFmt0)
         {
             prev->timestamp = timestamp;
@@ -608,18 +654,19 @@ bool RtmpContext::BuildChunk (PacketPtr &&packet,uint32_t timestamp,bool fmt0)
         }
         
         const char *body = packet->Data();
+        BufferHolder holder = packet.Hold(); // 所有分片共用一个所有者 (one owner shared by every chunk)
         int32_t bytes_parsed = 0;
         while(true)
         {
             const char * chunk = body+bytes_parsed;
-            int32_t size = h->msg_len - bytes_parsed;
+            int32_t size = h.msg_len - bytes_parsed;
             size = std::min(size,out_chunk_size_);
 
-            BufferNodePtr node = std::make_shared<BufferNode>((void*)chunk,size);
+            BufferNodePtr node = std::make_shared<BufferNode>((void*)chunk,size,holder); // 持有 packet，零拷贝发送需要
             sending_bufs_.emplace_back(std::move(node));
             bytes_parsed += size;
 
-            if(bytes_parsed<h->msg_len)
+            if(bytes_parsed<h.msg_len)
             {
                 if(out_current_ - out_buffer_ >= 4096)
                 {
@@ -628,19 +675,19 @@ bool RtmpContext::BuildChunk (PacketPtr &&packet,uint32_t timestamp,bool fmt0)
                 }
                 char *p = out_current_;
 
-                if(h->cs_id<64)
+                if(h.cs_id<64)
                 {
-                    *p++ = (char)(0xC0|h->cs_id);
+                    *p++ = (char)(0xC0|h.cs_id);
                 }
-                else if(h->cs_id<(64+256))
+                else if(h.cs_id<(64+256))
                 {
                     *p++ = (char)(0xC0|0); 
-                    *p++ = (char)(h->cs_id - 64);
+                    *p++ = (char)(h.cs_id - 64);
                 }
                 else 
                 {
                     *p++ = (char)(0xC0|1); 
-                    uint16_t cs = h->cs_id-64;
+                    uint16_t cs = h.cs_id-64;
                     memcpy(p,&cs,sizeof(uint16_t));
                     p += sizeof(uint16_t);
                 }
@@ -659,7 +706,6 @@ bool RtmpContext::BuildChunk (PacketPtr &&packet,uint32_t timestamp,bool fmt0)
                 break;
             }
         }
-        out_sending_packets_.emplace_back(std::move(packet));
         return true;
     }
     return false;
@@ -668,8 +714,6 @@ void RtmpContext::CheckAndSend()
 {
     sending_ = false;
     out_current_ = out_buffer_;
-    sending_bufs_.clear();
-    out_sending_packets_.clear();
 
     if(!out_waiting_queue_.empty())
     {
@@ -685,6 +729,16 @@ void RtmpContext::CheckAndSend()
 }
 void RtmpContext::PushOutQueue(PacketPtr && packet)
 {
+    out_waiting_bytes_ += packet->PacketSize();
+    if(out_waiting_bytes_ > kRtmpMaxWaitingBytes)
+    {
+        RTMP_ERROR << "host:" << connection_->PeerAddr().ToIpPort() << " out queue " << out_waiting_bytes_
+                   << " bytes over limit, close it.";
+        out_waiting_queue_.clear();
+        out_waiting_bytes_ = 0;
+        connection_->ForceClose();
+        return;
+    }
     out_waiting_queue_.emplace_back(std::move(packet));
     Send();
 }
@@ -692,62 +746,32 @@ void RtmpContext::PushOutQueue(PacketPtr && packet)
 void RtmpContext::SendSetChunkSize()
 {
     PacketPtr packet = Packet::NewPacket(64);
-    RtmpMsgHeaderPtr header = std::make_shared<RtmpMsgHeader>();
-    if(header)
-    {
-        header->cs_id = kRtmpCSIDCommand;
-        header->msg_len = 0;
-        header->msg_type = kRtmpMsgTypeChunkSize;
-        header->timestamp = 0;
-        header->msg_sid = kRtmpMsID0;
-        packet->SetExt(header);
-    }
+    packet->SetRtmpHeader(kRtmpCSIDCommand,kRtmpMsgTypeChunkSize,kRtmpMsID0);
 
     char *body = packet->Data();
-    header->msg_len = BytesWriter::WriteUint32T(body,out_chunk_size_);
-    packet->SetPacketSize(header->msg_len);
+    packet->SetPacketSize(BytesWriter::WriteUint32T(body,out_chunk_size_));
     RTMP_DEBUG << "send chuck size:" << out_chunk_size_ << " to host:" << connection_->PeerAddr().ToIpPort();
     PushOutQueue(std::move(packet));
 }
 void RtmpContext::SendAckWindowSize()
 {
     PacketPtr packet = Packet::NewPacket(64);
-    RtmpMsgHeaderPtr header = std::make_shared<RtmpMsgHeader>();
-    if(header)
-    {
-        header->cs_id = kRtmpCSIDCommand;
-        header->msg_len = 0;
-        header->msg_type = kRtmpMsgTypeWindowACKSize;
-        header->timestamp = 0;
-        header->msg_sid = kRtmpMsID0;
-        packet->SetExt(header);
-    }
+    packet->SetRtmpHeader(kRtmpCSIDCommand,kRtmpMsgTypeWindowACKSize,kRtmpMsID0);
 
     char *body = packet->Data();
-    header->msg_len = BytesWriter::WriteUint32T(body,ack_size_);
-    packet->SetPacketSize(header->msg_len);
+    packet->SetPacketSize(BytesWriter::WriteUint32T(body,ack_size_));
     RTMP_DEBUG << "send act size:" << ack_size_ << " to host:" << connection_->PeerAddr().ToIpPort();
     PushOutQueue(std::move(packet));
 }
 void RtmpContext::SendSetPeerBandwidth()
 {
     PacketPtr packet = Packet::NewPacket(64);
-    RtmpMsgHeaderPtr header = std::make_shared<RtmpMsgHeader>();
-    if(header)
-    {
-        header->cs_id = kRtmpCSIDCommand;
-        header->msg_len = 0;
-        header->msg_type = kRtmpMsgTypeSetPeerBW;
-        header->timestamp = 0;
-        header->msg_sid = kRtmpMsID0;
-        packet->SetExt(header);
-    }
+    packet->SetRtmpHeader(kRtmpCSIDCommand,kRtmpMsgTypeSetPeerBW,kRtmpMsID0);
 
     char *body = packet->Data();
 
     body += BytesWriter::WriteUint32T(body,ack_size_);
     *body++ = 0x02;
-    header->msg_len = 5;
     packet->SetPacketSize(5);
     RTMP_DEBUG << "send band width:" << ack_size_ << " to host:" << connection_->PeerAddr().ToIpPort();
     PushOutQueue(std::move(packet));
@@ -757,20 +781,10 @@ void RtmpContext::SendBytesRecv()
     if(in_bytes_>= ack_size_)
     {
         PacketPtr packet = Packet::NewPacket(64);
-        RtmpMsgHeaderPtr header = std::make_shared<RtmpMsgHeader>();
-        if(header)
-        {
-            header->cs_id = kRtmpCSIDCommand;
-            header->msg_len = 0;
-            header->msg_type = kRtmpMsgTypeBytesRead;
-            header->timestamp = 0;
-            header->msg_sid = kRtmpMsID0;
-            packet->SetExt(header);
-        }
+        packet->SetRtmpHeader(kRtmpCSIDCommand,kRtmpMsgTypeBytesRead,kRtmpMsID0);
 
         char *body = packet->Data();
-        header->msg_len = BytesWriter::WriteUint32T(body,in_bytes_);
-        packet->SetPacketSize(header->msg_len);
+        packet->SetPacketSize(BytesWriter::WriteUint32T(body,in_bytes_));
         //RTMP_DEBUG << "send act size:" << ack_size_ << " to host:" << connection_->PeerAddr().ToIpPort();
         PushOutQueue(std::move(packet));
         in_bytes_ = 0;
@@ -779,16 +793,7 @@ void RtmpContext::SendBytesRecv()
 void RtmpContext::SendUserCtrlMessage(short nType, uint32_t value1, uint32_t value2)
 {
     PacketPtr packet = Packet::NewPacket(64);
-    RtmpMsgHeaderPtr header = std::make_shared<RtmpMsgHeader>();
-    if(header)
-    {
-        header->cs_id = kRtmpCSIDCommand;
-        header->msg_len = 0;
-        header->msg_type = kRtmpMsgTypeUserControl;
-        header->timestamp = 0;
-        header->msg_sid = kRtmpMsID0;
-        packet->SetExt(header);
-    }
+    packet->SetRtmpHeader(kRtmpCSIDCommand,kRtmpMsgTypeUserControl,kRtmpMsID0);
 
     char *body = packet->Data();
     char *p = body;
@@ -799,8 +804,7 @@ void RtmpContext::SendUserCtrlMessage(short nType, uint32_t value1, uint32_t val
     {
         p += BytesWriter::WriteUint32T(body,value2);
     }
-    header->msg_len = p - body;
-    packet->SetPacketSize(header->msg_len);
+    packet->SetPacketSize(p - body);
     RTMP_DEBUG << "send user control type:" << nType 
                 << " value:" << value1 
                 << " value2:" << value2 
@@ -933,12 +937,7 @@ void RtmpContext::SendConnect()
 {
     SendSetChunkSize();
     PacketPtr packet = Packet::NewPacket(1024);
-    RtmpMsgHeaderPtr header = std::make_shared<RtmpMsgHeader>();
-    header->cs_id = kRtmpCSIDAMFIni;
-    header->msg_sid = 0;
-    header->msg_len = 0;
-    header->msg_type = kRtmpMsgTypeAMFMessage; 
-    packet->SetExt(header);
+    packet->SetRtmpHeader(kRtmpCSIDAMFIni,kRtmpMsgTypeAMFMessage,0);
 
     char *body = packet->Data();
     char *p = body;
@@ -957,9 +956,8 @@ void RtmpContext::SendConnect()
     *p++ = 0x00;
     *p++ = 0x09;
 
-    header->msg_len = p - body;
-    packet->SetPacketSize(header->msg_len);
-    RTMP_DEBUG << "send connect msg_len:" << header->msg_len << " to host:" << connection_->PeerAddr().ToIpPort();
+    packet->SetPacketSize(p - body);
+    RTMP_DEBUG << "send connect msg_len:" << packet->PacketSize() << " to host:" << connection_->PeerAddr().ToIpPort();
     PushOutQueue(std::move(packet));
 }
 void RtmpContext::HandleConnect(AMFObject &obj)
@@ -981,12 +979,7 @@ void RtmpContext::HandleConnect(AMFObject &obj)
     SendSetPeerBandwidth();
     SendSetChunkSize();
     PacketPtr packet = Packet::NewPacket(1024);
-    RtmpMsgHeaderPtr header = std::make_shared<RtmpMsgHeader>();
-    header->cs_id = kRtmpCSIDAMFIni;
-    header->msg_sid = 0;
-    header->msg_len = 0;
-    header->msg_type = kRtmpMsgTypeAMFMessage; 
-    packet->SetExt(header);
+    packet->SetRtmpHeader(kRtmpCSIDAMFIni,kRtmpMsgTypeAMFMessage,0);
 
     char *body = packet->Data();
     char *p = body;
@@ -1008,21 +1001,15 @@ void RtmpContext::HandleConnect(AMFObject &obj)
     *p++ = 0x00;
     *p++ = 0x09;
 
-    header->msg_len = p - body;
-    packet->SetPacketSize(header->msg_len);
-    RTMP_DEBUG << "connect result msg_len:" << header->msg_len << " to host:" << connection_->PeerAddr().ToIpPort();
+    packet->SetPacketSize(p - body);
+    RTMP_DEBUG << "connect result msg_len:" << packet->PacketSize() << " to host:" << connection_->PeerAddr().ToIpPort();
     PushOutQueue(std::move(packet));
 }
 
 void RtmpContext::SendCreateStream()
 {
     PacketPtr packet = Packet::NewPacket(1024);
-    RtmpMsgHeaderPtr header = std::make_shared<RtmpMsgHeader>();
-    header->cs_id = kRtmpCSIDAMFIni;
-    header->msg_sid = 0;
-    header->msg_len = 0;
-    header->msg_type = kRtmpMsgTypeAMFMessage; 
-    packet->SetExt(header);
+    packet->SetRtmpHeader(kRtmpCSIDAMFIni,kRtmpMsgTypeAMFMessage,0);
 
     char *body = packet->Data();
     char *p = body;
@@ -1031,9 +1018,8 @@ void RtmpContext::SendCreateStream()
     p += AMFAny::EncodeNumber(p, 4.0);
     *p++ = kAMFNull;
 
-    header->msg_len = p - body;
-    packet->SetPacketSize(header->msg_len);
-    RTMP_DEBUG << "send create stream msg_len:" << header->msg_len << " to host:" << connection_->PeerAddr().ToIpPort();
+    packet->SetPacketSize(p - body);
+    RTMP_DEBUG << "send create stream msg_len:" << packet->PacketSize() << " to host:" << connection_->PeerAddr().ToIpPort();
     PushOutQueue(std::move(packet));
 }
 void RtmpContext::HandleCreateStream(AMFObject &obj)
@@ -1041,12 +1027,7 @@ void RtmpContext::HandleCreateStream(AMFObject &obj)
     auto tran_id = obj.Property(1)->Number();
 
     PacketPtr packet = Packet::NewPacket(1024);
-    RtmpMsgHeaderPtr header = std::make_shared<RtmpMsgHeader>();
-    header->cs_id = kRtmpCSIDAMFIni;
-    header->msg_sid = 0;
-    header->msg_len = 0;
-    header->msg_type = kRtmpMsgTypeAMFMessage; 
-    packet->SetExt(header);
+    packet->SetRtmpHeader(kRtmpCSIDAMFIni,kRtmpMsgTypeAMFMessage,0);
 
     char *body = packet->Data();
     char *p = body;
@@ -1057,20 +1038,14 @@ void RtmpContext::HandleCreateStream(AMFObject &obj)
     
     p += AMFAny::EncodeNumber(p, kRtmpMsID1);
 
-    header->msg_len = p - body;
-    packet->SetPacketSize(header->msg_len);
-    RTMP_DEBUG << "create stream result msg_len:" << header->msg_len << " to host:" << connection_->PeerAddr().ToIpPort();
+    packet->SetPacketSize(p - body);
+    RTMP_DEBUG << "create stream result msg_len:" << packet->PacketSize() << " to host:" << connection_->PeerAddr().ToIpPort();
     PushOutQueue(std::move(packet));
 }
 void RtmpContext::SendStatus(const std::string &level, const std::string &code, const std::string &description)
 {
     PacketPtr packet = Packet::NewPacket(1024);
-    RtmpMsgHeaderPtr header = std::make_shared<RtmpMsgHeader>();
-    header->cs_id = kRtmpCSIDAMFIni;
-    header->msg_sid = 1;
-    header->msg_len = 0;
-    header->msg_type = kRtmpMsgTypeAMFMessage; 
-    packet->SetExt(header);
+    packet->SetRtmpHeader(kRtmpCSIDAMFIni,kRtmpMsgTypeAMFMessage,1);
 
     char *body = packet->Data();
     char *p = body;
@@ -1087,8 +1062,7 @@ void RtmpContext::SendStatus(const std::string &level, const std::string &code,
     *p++ = 0x09;
 
 
-    header->msg_len = p - body;
-    packet->SetPacketSize(header->msg_len);
+    packet->SetPacketSize(p - body);
     RTMP_DEBUG << "send status level:" << level << " code:" << code << " desc:" << description << " to host:" << connection_->PeerAddr().ToIpPort();
     PushOutQueue(std::move(packet));
 }
@@ -1096,12 +1070,7 @@ void RtmpContext::SendStatus(const std::string &level, const std::string &code,
 void RtmpContext::SendPlay()
 {
     PacketPtr packet = Packet::NewPacket(1024);
-    RtmpMsgHeaderPtr header = std::make_shared<RtmpMsgHeader>();
-    header->cs_id = kRtmpCSIDAMFIni;
-    header->msg_sid = 1;
-    header->msg_len = 0;
-    header->msg_type = kRtmpMsgTypeAMFMessage; 
-    packet->SetExt(header);
+    packet->SetRtmpHeader(kRtmpCSIDAMFIni,kRtmpMsgTypeAMFMessage,1);
 
     char *body = packet->Data();
     char *p = body;
@@ -1112,10 +1081,9 @@ void RtmpContext::SendPlay()
     p += AMFAny::EncodeString(p, name_);
     p += AMFAny::EncodeNumber(p, -1000.0);
 
-    header->msg_len = p - body;
-    packet->SetPacketSize(header->msg_len);
+    packet->SetPacketSize(p - body);
     RTMP_DEBUG << "send play name:"<< name_ 
-            << " msg_len:" << header->msg_len 
+            << " msg_len:" << packet->PacketSize() 
             << " to host:" << connection_->PeerAddr().ToIpPort();
     PushOutQueue(std::move(packet));
 }
@@ -1194,12 +1162,7 @@ void RtmpContext::ParseNameAndTcUrl()
 void RtmpContext::SendPublish()
 {
     PacketPtr packet = Packet::NewPacket(1024);
-    RtmpMsgHeaderPtr header = std::make_shared<RtmpMsgHeader>();
-    header->cs_id = kRtmpCSIDAMFIni;
-    header->msg_sid = 1;
-    header->msg_len = 0;
-    header->msg_type = kRtmpMsgTypeAMFMessage; 
-    packet->SetExt(header);
+    packet->SetRtmpHeader(kRtmpCSIDAMFIni,kRtmpMsgTypeAMFMessage,1);
 
     char *body = packet->Data();
     char *p = body;
@@ -1211,10 +1174,9 @@ void RtmpContext::SendPublish()
     p += AMFAny::EncodeString(p, "live");
 
 
-    header->msg_len = p - body;
-    packet->SetPacketSize(header->msg_len);
+    packet->SetPacketSize(p - body);
     RTMP_DEBUG << "send publish name:"<< name_ 
-            << " msg_len:" << header->msg_len 
+            << " msg_len:" << packet->PacketSize() 
             << " to host:" << connection_->PeerAddr().ToIpPort();
     PushOutQueue(std::move(packet));
 }
@@ -32,6 +32,8 @@ namespace tmms
                     kRtmpEventTypePingResponse,
         };
         using CommandFunc = std::function<void (AMFObject &obj)>;
+        // 等待发送的控制/命令消息上限，对端一直不读时断开而不是无限堆积
+        const size_t kRtmpMaxWaitingBytes = 1024*1024;
         class RtmpContext
         {
         public:
@@ -96,8 +98,8 @@ namespace tmms
             std::unordered_map<uint32_t,RtmpMsgHeaderPtr> out_message_headers_;
             int32_t out_chunk_size_{4096};
             std::list<PacketPtr> out_waiting_queue_;
+            size_t out_waiting_bytes_{0};
             std::list<BufferNodePtr> sending_bufs_;
-            std::list<PacketPtr> out_sending_packets_;
             bool sending_{false};
             int32_t ack_size_{2500000};
             int32_t in_bytes_{0};
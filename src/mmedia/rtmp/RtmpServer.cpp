@@ -79,6 +79,10 @@ void RtmpServer::OnNewConnection(const TcpConnectionPtr &conn)
         // Notify the handler that a new connection has been established.
     }
 
+    // 推流的音视频消息直接从 slab 读缓冲区里切片，不再拷贝进 Packet
+    // Media messages are sliced out of a slab read buffer instead of being copied into Packets.
+    conn->EnableSlabBuffer();
+
     // 创建一个RtmpContext，用于管理RTMP握手和上下文
     RtmpContextPtr shake = std::make_shared<RtmpContext>(conn, rtmp_handler_);
     // Create an RtmpContext to manage RTMP handshakes and connection context.
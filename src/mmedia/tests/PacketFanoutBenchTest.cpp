@@ -0,0 +1,330 @@
+#include "mmedia/base/Packet.h"
+#include "mmedia/base/PacketPool.h"
+#include "network/net/BufferHolder.h"
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <list>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+
+using namespace tmms::mm;
+using namespace tmms::network;
+
+// 包分发基准测试：模拟直播分发路径上一个包被拷贝的地方。
+// 推流线程把包放进 1000 帧的环形缓冲区（Stream::packet_buffer_），每个播放者在锁里把新帧拷进
+// out_frames_，再像 RtmpContext::BuildChunk 一样按块切成发送节点，节点持有包，写出时由发送队列
+// （OutputChain）再持有一次，直到“写出”。
+// 对比 std::shared_ptr<Packet>（每个节点拷贝一次包的 shared_ptr）和侵入式的 PacketPtr
+// （每个节点通过 Hold 持有包自己的一个引用，不分配控制块）。两种放置方式：播放者和推流在同一个循环（本地引用，不需要原子操作），
+// 播放者分散在 4 个其他线程。两种句柄的包都从包内存池分配，只比较句柄的开销。每项取几轮里最好的一次。
+// Packet fan-out benchmark: models the places where the live fan-out path copies a packet.
+// A publisher thread puts packets into a 1000-frame ring (Stream::packet_buffer_); each player
+// copies new frames into out_frames_ under the lock, then splits them into send nodes the way
+// RtmpContext::BuildChunk does; the nodes hold the packet, and the send queue (OutputChain) holds it
+// once more until "written".
+// std::shared_ptr<Packet> (every node copies the packet's shared_ptr) is compared with the
+// intrusive PacketPtr (every node holds a reference of the packet's own through Hold, with no
+// control block allocated). Two placements: players on the
+// publisher's loop (local references, no atomics) and players spread over 4 other threads. Both
+// handles allocate from the packet pool, so only the handles differ. Each figure is the best of a
+// few rounds.
+
+namespace
+{
+    const int kRing = 1000;
+    const int kPackets = 20000;
+    const int kPlayers = 64;
+    const int kPlayerThreads = 4;
+    const int kChunkSize = 4096;
+    const int32_t kSizes[] = {1500, 3000, 400, 6000, 400, 12000, 400, 60000};
+    const int kRounds = 3;
+
+    // 和 network::BufferNode 一样的发送节点 (a send node shaped like network::BufferNode)
+    struct Node
+    {
+        Node(const char *a, size_t s, const BufferHolder &h)
+        : addr(a), size(s), holder(h)
+        {
+        }
+        const char *addr;
+        size_t size;
+        BufferHolder holder;
+    };
+    using Nodes = std::list<std::shared_ptr<Node>>;
+
+    // 像 BuildChunk 一样切块 (split into chunks the way BuildChunk does)
+    void Split(Packet &packet, const BufferHolder &holder, Nodes &out)
+    {
+        for(int32_t off = 0; off < packet.PacketSize(); off += kChunkSize)
+        {
+            out.emplace_back(std::make_shared<Node>(packet.Data() + off,
+                                                    std::min(kChunkSize, packet.PacketSize() - off), holder));
+        }
+    }
+
+    struct SharedOps
+    {
+        using Ptr = std::shared_ptr<Packet>;
+        static Ptr New(int32_t size)
+        {
+            Packet *packet = (Packet*)PacketPool::Allocate(size + sizeof(Packet));
+            memset((void*)packet, 0x00, sizeof(Packet));
+            packet->SetIndex(-1);
+            return Ptr(packet, [](Packet *p) {
+                p->~Packet();
+                PacketPool::Free(p);
+            });
+        }
+        // 原来的 BuildChunk 每个节点都拷贝一次 (the old BuildChunk copies the packet into every node)
+        static void Slices(const Ptr &packet, Nodes &out)
+        {
+            Split(*packet, packet, out);
+        }
+    };
+
+    struct IntrusiveOps
+    {
+        using Ptr = PacketPtr;
+        static Ptr New(int32_t size)
+        {
+            return Packet::NewPacket(size);
+        }
+        static void Slices(const Ptr &packet, Nodes &out)
+        {
+            Split(*packet, packet.Hold(), out);
+        }
+    };
+
+    template <typename Ops>
+    struct Player
+    {
+        int64_t out_index{-1};
+        std::vector<typename Ops::Ptr> out_frames;
+        Nodes nodes;
+        std::vector<BufferHolder> chain;
+        uint64_t delivered{0};
+    };
+
+    template <typename Ops>
+    struct Ring
+    {
+        std::mutex lock;
+        std::vector<typename Ops::Ptr> packets{kRing};
+        std::atomic<int64_t> last{-1};
+    };
+
+    // 播放者取帧和“发送”，返回取到的帧数 (Fetch and "send" for one player; returns frames taken)
+    template <typename Ops>
+    int Serve(Ring<Ops> &ring, Player<Ops> &player)
+    {
+        {
+            std::lock_guard<std::mutex> lk(ring.lock);
+            int64_t last = ring.last.load();
+            if(player.out_index < last - kRing + 1)
+            {
+                player.out_index = last - kRing;  // 掉队就跳 (skip ahead when overrun)
+            }
+            for(int i = 0; i < 10 && player.out_index < last; i++)
+            {
+                player.out_index++;
+                player.out_frames.emplace_back(ring.packets[player.out_index % kRing]);
+            }
+        }
+        int n = player.out_frames.size();
+        for(auto &packet : player.out_frames)
+        {
+            Ops::Slices(packet, player.nodes);
+        }
+        player.out_frames.clear();
+        // 节点进发送队列，队列持有 holder (nodes go into the send queue, which keeps the holders)
+        for(auto &node : player.nodes)
+        {
+            player.chain.emplace_back(node->holder);
+        }
+        player.nodes.clear();
+        player.delivered += n;
+        player.chain.clear();    // 写出完成 (write complete)
+        return n;
+    }
+
+    template <typename Ops>
+    void Publish(Ring<Ops> &ring, int i)
+    {
+        int32_t size = kSizes[i % (sizeof(kSizes) / sizeof(kSizes[0]))];
+        auto packet = Ops::New(size);
+        packet->SetPacketSize(size);
+        packet->SetIndex(i);
+        std::lock_guard<std::mutex> lk(ring.lock);
+        ring.packets[i % kRing] = std::move(packet);
+        ring.last = i;
+    }
+
+    // 播放者和推流在同一个线程 (Players on the publisher's thread)
+    template <typename Ops>
+    double RunLocal(uint64_t &delivered)
+    {
+        Ring<Ops> ring;
+        std::vector<Player<Ops>> players(kPlayers);
+        auto start = std::chrono::steady_clock::now();
+        for(int i = 0; i < kPackets; i++)
+        {
+            Publish(ring, i);
+            for(auto &p : players)
+            {
+                Serve(ring, p);
+            }
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        delivered = 0;
+        for(auto &p : players)
+        {
+            delivered += p.delivered;
+        }
+        return ns / delivered;
+    }
+
+    // 播放者分散在其他线程 (Players spread over other threads)
+    template <typename Ops>
+    double RunSpread(uint64_t &delivered)
+    {
+        Ring<Ops> ring;
+        std::atomic<bool> done{false};
+        std::vector<std::vector<Player<Ops>>> groups(kPlayerThreads, std::vector<Player<Ops>>(kPlayers / kPlayerThreads));
+        std::vector<std::thread> threads;
+        auto start = std::chrono::steady_clock::now();
+        for(auto &group : groups)
+        {
+            threads.emplace_back([&ring, &done, &group](){
+                while(true)
+                {
+                    bool finished = done.load();
+                    int got = 0;
+                    for(auto &p : group)
+                    {
+                        got += Serve(ring, p);
+                    }
+                    if(got == 0)
+                    {
+                        if(finished)
+                        {
+                            break;
+                        }
+                        std::this_thread::yield();
+                    }
+                }
+                Packet::ReclaimDeferred();
+                PacketPool::Flush();
+            });
+        }
+        for(int i = 0; i < kPackets; i++)
+        {
+            Publish(ring, i);
+            if(i % 8 == 0)
+            {
+                std::this_thread::yield();  // 给播放者留时间，不让它们掉队太多 (let players keep up)
+            }
+        }
+        done = true;
+        for(auto &t : threads)
+        {
+            t.join();
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        delivered = 0;
+        for(auto &group : groups)
+        {
+            for(auto &p : group)
+            {
+                delivered += p.delivered;
+            }
+        }
+        return ns / delivered;
+    }
+
+    // 引用计数的正确性：本地、跨线程拷贝、在别的线程释放本地引用、Hold 出去的所有者和它在别的线程的拷贝
+    // Refcount correctness: local copies, cross-thread copies, local references released on another
+    // thread, and holders handed out by Hold along with copies of them on another thread
+    bool TestRefs()
+    {
+        // 用引用外部数据的包，看外部数据什么时候释放 (a slice packet shows when the packet is destroyed)
+        std::weak_ptr<char> watch;
+        PacketPtr packet;
+        {
+            std::shared_ptr<char> slice(new char[100], std::default_delete<char[]>());
+            watch = slice;
+            packet = Packet::NewPacket(slice, 100, 100);
+        }
+        bool ok = packet.IsLocal();
+        PacketPtr local_copy = packet;
+        BufferHolder held = packet.Hold();
+        ok = ok && held.get() == packet.get();
+        PacketPtr remote_copy;
+        PacketPtr moved_local;
+        BufferHolder remote_held;
+        std::thread t([&](){
+            remote_copy = packet;                 // 别的线程拷贝，走共享计数 (copied on another thread: shared count)
+            remote_held = held;                   // 所有者在别的线程拷贝也一样 (so is a holder copied there)
+            ok = ok && !remote_copy.IsLocal();
+            moved_local = std::move(local_copy);  // 本地引用被挪到这个线程释放 (a local reference moved here and released)
+            moved_local.reset();
+        });
+        t.join();
+        ok = ok && !local_copy && !watch.expired();
+        packet.reset();
+        held.reset();
+        ok = ok && !watch.expired();              // remote_copy 和还没处理的本地引用还在 (remote_copy and the deferred local one remain)
+        remote_copy.reset();
+        ok = ok && !watch.expired();
+        remote_held.reset();
+        ok = ok && !watch.expired();
+        Packet::ReclaimDeferred();                // 创建线程处理延后的本地释放 (the creating thread settles it)
+        ok = ok && watch.expired();
+
+        // 创建线程退出后，别的线程释放它的本地引用 (local references released after the creating thread exited)
+        PacketPtr orphan;
+        std::thread creator([&](){
+            std::shared_ptr<char> slice(new char[100], std::default_delete<char[]>());
+            watch = slice;
+            orphan = Packet::NewPacket(slice, 100, 100);
+        });
+        creator.join();
+        ok = ok && orphan.IsLocal() && !watch.expired();
+        orphan.reset();
+        ok = ok && watch.expired();
+        std::cout << "refs: " << (ok ? "ok" : "failed") << std::endl;
+        return ok;
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    bool ok = TestRefs();
+
+    uint64_t delivered_shared = 0, delivered_intrusive = 0;
+    double shared_ns = 1e18, intrusive_ns = 1e18;
+    for(int r = 0; r < kRounds; r++)
+    {
+        shared_ns = std::min(shared_ns, RunLocal<SharedOps>(delivered_shared));
+        intrusive_ns = std::min(intrusive_ns, RunLocal<IntrusiveOps>(delivered_intrusive));
+    }
+    std::cout << "same loop:  shared_ptr " << shared_ns << " ns, PacketPtr " << intrusive_ns
+              << " ns per packet per player (" << delivered_intrusive << " deliveries)" << std::endl;
+    ok = ok && delivered_shared == delivered_intrusive;
+
+    shared_ns = intrusive_ns = 1e18;
+    for(int r = 0; r < kRounds; r++)
+    {
+        shared_ns = std::min(shared_ns, RunSpread<SharedOps>(delivered_shared));
+        intrusive_ns = std::min(intrusive_ns, RunSpread<IntrusiveOps>(delivered_intrusive));
+    }
+    std::cout << "4 threads:  shared_ptr " << shared_ns << " ns, PacketPtr " << intrusive_ns
+              << " ns per packet per player (" << delivered_shared << "/" << delivered_intrusive
+              << " deliveries)" << std::endl;
+
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
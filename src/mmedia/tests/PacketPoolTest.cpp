@@ -0,0 +1,267 @@
+#include "mmedia/base/Packet.h"
+#include "mmedia/base/PacketPool.h"
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <chrono>
+#include <cstring>
+
+using namespace tmms::mm;
+
+// 包内存池测试：
+// 1. 复用的块只清零包头：重新分配到的包头和元数据是干净的，容量正确，包头和数据区按缓存行对齐。
+// 2. 同线程分配释放命中线程缓存；跨线程释放成批交还给分配线程后再命中。
+// 3. 超过最大级的包直接分配；开启大页 arena 后分配正常。
+// 4. 对比原来的 new char[] + 整块 memset 和内存池：推流线程分配，一半包留在本线程的 GOP 里，一半交给播放线程释放。
+// Packet pool test:
+// 1. Reused blocks only get their header zeroed: reallocated headers and metadata are clean, capacity
+//    is right, and the header and data area are cache-line aligned.
+// 2. Same-thread alloc/free hits the thread cache; blocks freed on another thread come back to the
+//    allocating thread in batches and hit again.
+// 3. Packets above the largest class are allocated directly; huge-page arenas work when enabled.
+// 4. Compares the old new char[] plus whole-block memset with the pool: a publisher thread allocates,
+//    keeps half of the packets in its own GOP and hands the other half to a player thread to free.
+
+namespace
+{
+    const int kRounds = 200000;
+    const int32_t kSizes[] = {64, 1200, 1200, 1200, 400, 4800, 16000, 60000};
+    const int kSizeCount = sizeof(kSizes) / sizeof(kSizes[0]);
+
+    // 原来的分配方式，句柄也还是原来的 std::shared_ptr (The previous allocation path, with the previous std::shared_ptr handle)
+    std::shared_ptr<Packet> OldNewPacket(int32_t size)
+    {
+        auto block_size = size + sizeof(Packet);
+        Packet *packet = (Packet*)new char[block_size];
+        memset((void*)packet, 0x00, block_size);
+        packet->SetIndex(-1);
+        packet->SetPacketType(kPacketTypeUnknowed);
+        return std::shared_ptr<Packet>(packet, [](Packet *p) {
+            p->~Packet();
+            delete [](char*)p;
+        });
+    }
+
+    void Totals(uint64_t &hits, uint64_t &misses, int64_t &held)
+    {
+        std::vector<PacketPoolClassStats> stats;
+        PacketPool::GetStats(stats);
+        hits = misses = 0;
+        held = 0;
+        for(auto &s : stats)
+        {
+            hits += s.hits;
+            misses += s.misses;
+            held += s.bytes_held;
+        }
+    }
+
+    bool TestHeader()
+    {
+        bool ok = true;
+        for(int i = 0; i < 100; i++)
+        {
+            PacketPtr p = Packet::NewPacket(1000);
+            ok = ok && p->PacketSize() == 0 && p->Index() == -1 && p->PacketType() == kPacketTypeUnknowed
+                    && p->TimeStamp() == 0 && p->Space() == 1000 && !p->IsSlice()
+                    && !p->HasRtmpHeader() && !p->DestAddr() && p->IngestTime() == 0 && p->CodecFlags() == 0
+                    && (uintptr_t)p.get() % 64 == 0 && (uintptr_t)p->Data() % 64 == 0;
+            // 内存按所在大小级的整块算 (memory counts the whole size-class block)
+            int64_t mem = p->MemoryBytes();
+            ok = ok && mem >= 1000 + (int64_t)sizeof(Packet) && (mem & (mem - 1)) == 0;
+            memset(p->Data(), 0xff, 1000);
+            p->SetPacketSize(1000);
+            p->SetIndex(i);
+            p->SetTimeStamp(i);
+            p->SetPacketType(kPacketTypeVideo);
+            p->SetRtmpHeader(6, 9, 1);
+            struct sockaddr_in6 addr;
+            memset(&addr, 0xff, sizeof(addr));
+            p->SetDestAddr(addr);
+            p->SetIngestTime(i);
+            p->SetCodecFlags(kCodecFlagHeader);
+        }
+        // 不进池的大块按实际分配的大小算 (oversized blocks count what was really allocated)
+        int64_t large = Packet::NewPacket(5 * 1024 * 1024)->MemoryBytes();
+        ok = ok && large >= 5 * 1024 * 1024 + (int64_t)sizeof(Packet) && large < 5 * 1024 * 1024 + 4096;
+        std::cout << "header: " << (ok ? "ok" : "failed") << std::endl;
+        return ok;
+    }
+
+    bool TestSameThread()
+    {
+        uint64_t h0, m0, h1, m1;
+        int64_t held;
+        Totals(h0, m0, held);
+        for(int i = 0; i < 10000; i++)
+        {
+            PacketPtr p = Packet::NewPacket(kSizes[i % kSizeCount]);
+        }
+        Totals(h1, m1, held);
+        bool ok = h1 - h0 >= 10000 - kSizeCount && held > 0;
+        std::cout << "same thread: hits:" << h1 - h0 << " misses:" << m1 - m0
+                  << " held:" << held << (ok ? " ok" : " failed") << std::endl;
+        return ok;
+    }
+
+    bool TestCrossThread()
+    {
+        std::mutex lock;
+        std::condition_variable cond;
+        std::deque<PacketPtr> queue;
+        bool done = false;
+        uint64_t h0, m0, h1, m1;
+        int64_t held;
+        Totals(h0, m0, held);
+
+        // 播放线程只负责释放 (the player thread only frees)
+        std::thread player([&](){
+            while(true)
+            {
+                std::deque<PacketPtr> batch;
+                {
+                    std::unique_lock<std::mutex> lk(lock);
+                    cond.wait(lk, [&](){ return !queue.empty() || done; });
+                    batch.swap(queue);
+                    if(batch.empty() && done)
+                    {
+                        break;
+                    }
+                }
+                batch.clear();
+            }
+            PacketPool::Flush();
+        });
+        int corrupted = 0;
+        for(int i = 0; i < kRounds; i++)
+        {
+            int32_t size = kSizes[i % kSizeCount];
+            PacketPtr p = Packet::NewPacket(size);
+            if(p->PacketSize() != 0 || p->Index() != -1)
+            {
+                corrupted++;
+            }
+            memset(p->Data(), (char)i, size);
+            p->SetPacketSize(size);
+            std::lock_guard<std::mutex> lk(lock);
+            queue.emplace_back(std::move(p));
+            if(queue.size() >= 64)
+            {
+                cond.notify_one();
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lk(lock);
+            done = true;
+        }
+        cond.notify_one();
+        player.join();
+        Totals(h1, m1, held);
+        // 释放在另一个线程，命中只能来自交还的批 (frees happen elsewhere, so hits come from handed-back batches)
+        bool ok = corrupted == 0 && h1 - h0 > (uint64_t)kRounds / 2 && held > 0;
+        std::cout << "cross thread: hits:" << h1 - h0 << " misses:" << m1 - m0
+                  << " held:" << held << (ok ? " ok" : " failed") << std::endl;
+        return ok;
+    }
+
+    bool TestLargeAndHugePages()
+    {
+        uint64_t large = PacketPool::LargeAllocs();
+        {
+            PacketPtr p = Packet::NewPacket(8 * 1024 * 1024);
+            memset(p->Data(), 1, 8 * 1024 * 1024);
+        }
+        bool ok = PacketPool::LargeAllocs() == large + 1;
+
+        PacketPool::EnableHugePages(true);
+        std::thread t([&](){
+            std::vector<PacketPtr> packets;
+            for(int i = 0; i < 20000; i++)
+            {
+                int32_t size = kSizes[i % kSizeCount];
+                packets.emplace_back(Packet::NewPacket(size));
+                memset(packets.back()->Data(), 2, size);
+            }
+        });
+        t.join();
+        PacketPool::EnableHugePages(false);
+        std::cout << "large and huge pages: " << (ok ? "ok" : "failed") << std::endl;
+        return ok;
+    }
+
+    template <typename Ptr, typename F>
+    double Bench(F alloc)
+    {
+        std::mutex lock;
+        std::condition_variable cond;
+        std::deque<Ptr> queue;
+        bool done = false;
+        auto start = std::chrono::steady_clock::now();
+        std::thread player([&](){
+            while(true)
+            {
+                std::deque<Ptr> batch;
+                {
+                    std::unique_lock<std::mutex> lk(lock);
+                    cond.wait(lk, [&](){ return !queue.empty() || done; });
+                    batch.swap(queue);
+                    if(batch.empty() && done)
+                    {
+                        break;
+                    }
+                }
+                batch.clear();
+            }
+        });
+        std::deque<Ptr> gop;   // 本线程也留一组 GOP (this thread keeps a GOP as well)
+        for(int i = 0; i < kRounds * 5; i++)
+        {
+            int32_t size = kSizes[i % kSizeCount];
+            Ptr p = alloc(size);
+            memcpy(p->Data(), &i, sizeof(i));
+            p->SetPacketSize(size);
+            if(i % 2)
+            {
+                gop.emplace_back(std::move(p));
+                if(gop.size() > 60)
+                {
+                    gop.pop_front();
+                }
+                continue;
+            }
+            std::lock_guard<std::mutex> lk(lock);
+            queue.emplace_back(std::move(p));
+            if(queue.size() >= 64)
+            {
+                cond.notify_one();
+            }
+        }
+        gop.clear();
+        {
+            std::lock_guard<std::mutex> lk(lock);
+            done = true;
+        }
+        cond.notify_one();
+        player.join();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        return ns / (kRounds * 5);
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    bool ok = TestHeader();
+    ok = TestSameThread() && ok;
+    ok = TestCrossThread() && ok;
+    ok = TestLargeAndHugePages() && ok;
+
+    double old_ns = Bench<std::shared_ptr<Packet>>(OldNewPacket);
+    double pool_ns = Bench<PacketPtr>([](int32_t size){ return Packet::NewPacket(size); });
+    std::cout << "new+memset: " << old_ns << " ns/packet, pool: " << pool_ns << " ns/packet" << std::endl;
+
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
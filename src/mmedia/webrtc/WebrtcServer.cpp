@@ -70,12 +70,12 @@ void WebrtcServer::OnSend()
     udp_outs_.clear();
     for(auto &p:out_waiting_)
     {
-        std::shared_ptr<struct sockaddr_in6> addr = p->Ext<struct sockaddr_in6>();
+        const struct sockaddr_in6 *addr = p->DestAddr();
         if(addr)
         {
             UdpBufferNodePtr up = std::make_shared<UdpBufferNode>(p->Data(),
                                                                 p->PacketSize(),
-                                                                (struct sockaddr*)addr.get(),
+                                                                (struct sockaddr*)addr,
                                                                 sizeof(struct sockaddr_in6));
             udp_outs_.emplace_back(std::move(up));
             sending_.emplace_back(p);
@@ -110,12 +110,12 @@ void WebrtcServer::SendPacket(const PacketPtr &packet)
         return;
     }
     udp_outs_.clear();
-    std::shared_ptr<struct sockaddr_in6> addr = packet->Ext<struct sockaddr_in6>();
+    const struct sockaddr_in6 *addr = packet->DestAddr();
     if(addr)
     {
         UdpBufferNodePtr up = std::make_shared<UdpBufferNode>(packet->Data(),
                                                             packet->PacketSize(),
-                                                            (struct sockaddr*)addr.get(),
+                                                            (struct sockaddr*)addr,
                                                             sizeof(struct sockaddr_in6));
         udp_outs_.emplace_back(std::move(up));
         sending_.emplace_back(packet);
@@ -141,12 +141,12 @@ void WebrtcServer::SendPacket(std::list<PacketPtr> &list)
     udp_outs_.clear();
     for(auto &p:list)
     {
-        std::shared_ptr<struct sockaddr_in6> addr = p->Ext<struct sockaddr_in6>();
+        const struct sockaddr_in6 *addr = p->DestAddr();
         if(addr)
         {
             UdpBufferNodePtr up = std::make_shared<UdpBufferNode>(p->Data(),
                                                                 p->PacketSize(),
-                                                                (struct sockaddr*)addr.get(),
+                                                                (struct sockaddr*)addr,
                                                                 sizeof(struct sockaddr_in6));
             udp_outs_.emplace_back(std::move(up));
             sending_.emplace_back(p);
@@ -111,24 +111,12 @@ void DnsService::GetHostInfo(const std::string &host, std::vector<InetAddressPtr
     struct addrinfo *rp = res;
     for (; rp != nullptr; rp = rp->ai_next) // 遍历查询结果 // Iterate over the results.
     {
-        InetAddressPtr peeraddr = std::make_shared<InetAddress>(); // 创建地址对象 // Create an address object.
-        if (rp->ai_family == AF_INET) // 处理 IPv4 地址 // Handle IPv4.
+        if (rp->ai_family != AF_INET && rp->ai_family != AF_INET6)
         {
-            char ip[16] = {0,};
-            struct sockaddr_in *saddr = (struct sockaddr_in*)rp->ai_addr;
-            ::inet_ntop(AF_INET, &(saddr->sin_addr.s_addr), ip, sizeof(ip));
-            peeraddr->SetAddr(ip);
-            peeraddr->SetPort(ntohs(saddr->sin_port));
-        }
-        else if (rp->ai_family == AF_INET6) // 处理 IPv6 地址 // Handle IPv6.
-        {
-            char ip[INET6_ADDRSTRLEN] = {0,};
-            struct sockaddr_in6 *saddr = (struct sockaddr_in6*)rp->ai_addr;
-            ::inet_ntop(AF_INET6, &(saddr->sin6_addr), ip, sizeof(ip));
-            peeraddr->SetAddr(ip);
-            peeraddr->SetPort(ntohs(saddr->sin6_port));
-            peeraddr->SetIsIPV6(true);
+            continue;
         }
+        // 直接用结果里的二进制地址创建地址对象 // Create the address object straight from the binary result.
+        InetAddressPtr peeraddr = std::make_shared<InetAddress>(rp->ai_addr);
         list.push_back(peeraddr); // 将结果添加到列表 // Add result to the list.
     }
 }
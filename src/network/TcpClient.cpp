@@ -11,6 +11,7 @@ using namespace tmms::network;
 TcpClient::TcpClient(EventLoop *loop,const InetAddress &server)
 :TcpConnection(loop,-1,InetAddress(),server),server_addr_(server)
 {
+    stream_ = false; // 连接过程靠可写通知，客户端连接一直用普通读写 (connecting relies on writability, so clients keep plain reads and writes)
     // Nothing specific to do here, 初始化工作在基类中已经完成  
     // Example: 传入的 server 地址是目标服务器的 IP 和端口  
 }
@@ -43,7 +44,7 @@ void TcpClient::Connect()
 {
     // 在 EventLoop 线程中执行连接操作  
     // Ensure the connection logic is executed within the EventLoop thread  
-    loop_->RunInLoop([this](){
+    Loop()->RunInLoop([this](){
         ConnectInLoop();
     });
 }
@@ -52,7 +53,7 @@ void TcpClient::Connect()
 // Internal method to handle the connection process
 void TcpClient::ConnectInLoop()
 {
-    loop_->AssertInLoopThread();  // 确保当前线程是 EventLoop 线程  
+    Loop()->AssertInLoopThread();  // 确保当前线程是 EventLoop 线程  
     fd_ = SocketOpt::CreateNonblockingTcpSocket(AF_INET); // 创建非阻塞套接字 (TCP socket)
     if(fd_ < 0)  // 如果套接字创建失败  
     {
@@ -60,7 +61,7 @@ void TcpClient::ConnectInLoop()
         return ;
     }
     status_ = kTcpConStatusConnecting;  // 更新状态为 "正在连接"  
-    loop_->AddEvent(std::dynamic_pointer_cast<TcpClient>(shared_from_this()));  
+    Loop()->AddEvent(std::dynamic_pointer_cast<TcpClient>(shared_from_this()));  
     EnableWriting(true);  // 监听可写事件，以完成非阻塞连接  
     SocketOpt opt(fd_);  // 设置套接字选项  
     auto ret = opt.Connect(server_addr_);  // 发起连接请求  
@@ -151,7 +152,7 @@ void TcpClient::OnClose()
     if(status_ == kTcpConStatusConnecting ||
         status_ == kTcpConStatusConnected) // 如果连接未完成或已连接  
     {
-        loop_->DelEvent(std::dynamic_pointer_cast<TcpClient>(shared_from_this()));
+        Loop()->DelEvent(std::dynamic_pointer_cast<TcpClient>(shared_from_this()));
         // 从事件循环中删除当前连接  
     }
     status_ = kTcpConStatusDisConnected;  // 更新状态为 "已断开"  
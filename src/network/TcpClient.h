@@ -88,6 +88,10 @@ namespace tmms // 定义命名空间 tmms，避免与其他代码冲突。
             // 发送数据，参数为指向字符的指针和数据大小。
             // Sends data using a character pointer and the size of the data.
 
+            using TcpConnection::Send;
+            // 其余的发送重载（带所有者、字符串）直接用基类的。
+            // The remaining overloads (with an owner, or a string) come straight from the base class.
+
         private:
             void ConnectInLoop();  
             // 在事件循环中执行连接操作，确保线程安全。
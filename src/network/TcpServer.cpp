@@ -1,5 +1,6 @@
 #include "TcpServer.h"
 #include "network/base/Network.h"
+#include "network/base/SocketOpt.h"
 using namespace tmms::network;
 
 // 构造函数：初始化 TcpServer 对象  
@@ -97,6 +98,14 @@ void TcpServer::OnAccet(int fd, const InetAddress &addr)
     // Create a new TcpConnection object representing the new client connection
     TcpConnectionPtr con = std::make_shared<TcpConnection>(loop_, fd, addr_, addr);
 
+    // 忙轮询的循环上，连接也开启 SO_BUSY_POLL  
+    // On busy-polling loops the socket busy-polls as well
+    if (loop_->BusyPollUs() > 0)
+    {
+        SocketOpt opt(fd);
+        opt.SetBusyPoll(loop_->BusyPollUs());
+    }
+
     // 设置连接关闭的回调函数  
     // Bind the close callback to handle connection closure
     con->SetCloseCallback(std::bind(&TcpServer::OnConnectionClose, this, std::placeholders::_1));
@@ -144,9 +153,21 @@ void TcpServer::OnAccet(int fd, const InetAddress &addr)
 void TcpServer::OnConnectionClose(const TcpConnectionPtr &con)
 {
     NETWORK_TRACE << "host:" << con->PeerAddr().ToIpPort() << " closed."; // 打印关闭连接的信息
-    loop_->AssertInLoopThread(); // 确保当前线程是事件循环线程
-    connections_.erase(con); // 从连接集合中移除关闭的连接
-    loop_->DelEvent(con); // 从事件循环中删除事件
+    EventLoop *owner = con->Loop(); // 连接可能已经迁移到其他循环，在它当前所属的循环里关闭
+    owner->AssertInLoopThread(); // 确保当前线程是连接所属的事件循环线程
+    owner->DelEvent(con); // 从事件循环中删除事件
+    if (owner == loop_)
+    {
+        connections_.erase(con); // 从连接集合中移除关闭的连接
+    }
+    else
+    {
+        // 连接集合属于服务器所在的循环，回到那里移除
+        // The connection set belongs to the server's loop, so erase it there.
+        loop_->RunInLoop([this, con]() {
+            connections_.erase(con);
+        });
+    }
     if (destroy_connection_cb_) // 如果销毁回调函数存在，调用它
     {
         destroy_connection_cb_(con);
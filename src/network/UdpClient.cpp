@@ -14,7 +14,7 @@ UdpClient::~UdpClient()
 }
 void UdpClient::Connect()
 {
-    loop_->RunInLoop([this](){
+    Loop()->RunInLoop([this](){
         ConnectInLoop();
     });
 }
@@ -28,7 +28,7 @@ void UdpClient::SetConnectedCallback(ConnectedCallback &&cb)
 }
 void UdpClient::ConnectInLoop()
 {
-    loop_->AssertInLoopThread();
+    Loop()->AssertInLoopThread();
     fd_ = SocketOpt::CreateNonblockingUdpSocket(AF_INET);
     if(fd_<0)
     {
@@ -36,7 +36,7 @@ void UdpClient::ConnectInLoop()
         return;
     }
     connected_ = true;
-    loop_->AddEvent(std::dynamic_pointer_cast<UdpClient>(shared_from_this()));
+    Loop()->AddEvent(std::dynamic_pointer_cast<UdpClient>(shared_from_this()));
     SocketOpt opt(fd_);
     opt.Connect(server_addr_);
     server_addr_.GetSockAddr((struct sockaddr*)&sock_addr_);
@@ -57,7 +57,7 @@ void UdpClient::OnClose()
 {
     if(connected_)
     {
-        loop_->DelEvent(std::dynamic_pointer_cast<UdpClient>(shared_from_this()));
+        Loop()->DelEvent(std::dynamic_pointer_cast<UdpClient>(shared_from_this()));
         connected_ = false;
         UdpSocket::OnClose();
     }
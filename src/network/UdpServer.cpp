@@ -14,27 +14,27 @@ UdpServer::~UdpServer()
 }
 void UdpServer::Start()
 {
-    loop_->RunInLoop([this](){
+    Loop()->RunInLoop([this](){
         Open();
     });
 }
 void UdpServer::Stop()
 {
-    loop_->RunInLoop([this](){
-        loop_->DelEvent(std::dynamic_pointer_cast<UdpServer>(shared_from_this()));
+    Loop()->RunInLoop([this](){
+        Loop()->DelEvent(std::dynamic_pointer_cast<UdpServer>(shared_from_this()));
         OnClose();
     });
 }
 void UdpServer::Open()
 {
-    loop_->AssertInLoopThread();
+    Loop()->AssertInLoopThread();
     fd_ = SocketOpt::CreateNonblockingUdpSocket(AF_INET);
     if(fd_ < 0)
     {
         OnClose();
         return ;
     }
-    loop_->AddEvent(std::dynamic_pointer_cast<UdpServer>(shared_from_this()));
+    Loop()->AddEvent(std::dynamic_pointer_cast<UdpServer>(shared_from_this()));
     SocketOpt opt(fd_);
     opt.BindAddress(server_);
 }
\ No newline at end of file
@@ -23,140 +23,216 @@ void InetAddress::GetIpAndPort(const std::string &host, std::string &ip, std::st
     // 输入: "127.0.0.1:8080"，输出: ip="127.0.0.1"，port="8080"
 }
 
+InetAddress::InetAddress()
+{
+    memset(&addr_, 0x00, sizeof(addr_));
+    addr_.v4.sin_family = AF_INET;
+}
+
 // 构造函数：用于初始化 InetAddress 对象的 IP 地址、端口号和是否为 IPv6 的标志
 // Constructor to initialize InetAddress object with IP address, port, and IPv6 flag
 InetAddress::InetAddress(const std::string &ip, uint16_t port, bool bv6)
-    : addr_(ip),                        // 使用传入的 ip 参数初始化 addr_  (Initialize addr_ with the provided IP)
-      port_(std::to_string(port)),      // 将 port 转换为字符串，初始化 port_ (Convert port to string and initialize port_)
-      is_ipv6_(bv6)                     // 使用传入的 bv6 布尔值初始化 is_ipv6_ (Initialize is_ipv6_ with the provided bv6 boolean)
+    : InetAddress()
 {
-    // 例子：输入参数 ip="127.0.0.1", port=8080, bv6=false
-    // Example: Input ip="127.0.0.1", port=8080, bv6=false
-    // 初始化结果：
-    // addr_ = "127.0.0.1"    -> IP 地址直接赋值
-    // port_ = "8080"         -> 通过 std::to_string 转换端口号为字符串
-    // is_ipv6_ = false       -> 标记地址是否为 IPv6
-
-    // 构造函数体为空，因为所有成员变量的初始化都已在成员初始化列表完成
-    // The function body is empty as all member variables are initialized in the initializer list
+    // 例子：输入参数 ip="127.0.0.1", port=8080, bv6=false，地址以二进制保存
+    // Example: ip="127.0.0.1", port=8080, bv6=false, stored in binary form
+    ParseAddr(ip, bv6);
+    SetPort(port);
 }
 
-
 // 构造函数，输入 `host` 字符串并解析 IP 和端口
 InetAddress::InetAddress(const std::string &host, bool is_v6)
+    : InetAddress()
+{
+    std::string ip, port;
+    GetIpAndPort(host, ip, port); // 解析 IP 和端口号
+    ParseAddr(ip, is_v6);
+    SetPort(std::atoi(port.c_str()));
+}
+
+InetAddress::InetAddress(const struct sockaddr *saddr)
+    : InetAddress()
+{
+    SetSockAddr(saddr);
+}
+
+// 解析 IP 字符串到二进制地址，解析失败的当作域名保存
+void InetAddress::ParseAddr(const std::string &addr, bool is_v6)
 {
-    GetIpAndPort(host, addr_, port_); // 解析 IP 和端口号
-    is_ipv6_ = is_v6;                 // 设置是否为 IPv6
+    uint16_t port = Port();
+    memset(&addr_, 0x00, sizeof(addr_));
+    host_.clear();
+    if (is_v6 || addr.find(':') != std::string::npos)
+    {
+        addr_.v6.sin6_family = AF_INET6;
+        addr_.v6.sin6_port = htons(port);
+        if (::inet_pton(AF_INET6, addr.c_str(), &addr_.v6.sin6_addr) == 1)
+        {
+            return;
+        }
+    }
+    else
+    {
+        addr_.v4.sin_family = AF_INET;
+        addr_.v4.sin_port = htons(port);
+        if (::inet_pton(AF_INET, addr.c_str(), &addr_.v4.sin_addr) == 1)
+        {
+            return;
+        }
+    }
+    host_ = addr; // 域名，等 DNS 解析后再 SetAddr (a domain name, replaced by SetAddr after DNS)
 }
 
 // 设置主机地址，解析 IP 和端口
 void InetAddress::SetHost(const std::string &host)
 {
-    GetIpAndPort(host, addr_, port_);
+    std::string ip, port;
+    GetIpAndPort(host, ip, port);
+    ParseAddr(ip, IsIpV6());
+    SetPort(std::atoi(port.c_str()));
 }
 
 // 设置 IP 地址
 void InetAddress::SetAddr(const std::string &addr)
 {
-    addr_ = addr; // 直接设置 addr_
+    ParseAddr(addr, false);
 }
 
 // 设置端口号
 void InetAddress::SetPort(uint16_t port)
 {
-    port_ = std::to_string(port); // 将端口号转为字符串
+    // sin_port 和 sin6_port 在同一个偏移 (sin_port and sin6_port share the same offset)
+    addr_.v4.sin_port = htons(port);
 }
 
-// 设置是否为 IPv6
-void InetAddress::SetIsIPV6(bool is_v6)
+// 从 sockaddr 直接拷贝地址，不做字符串转换
+void InetAddress::SetSockAddr(const struct sockaddr *saddr)
 {
-    is_ipv6_ = is_v6;
+    host_.clear();
+    memset(&addr_, 0x00, sizeof(addr_));
+    if (saddr->sa_family == AF_INET6)
+    {
+        memcpy(&addr_.v6, saddr, sizeof(struct sockaddr_in6));
+    }
+    else if (saddr->sa_family == AF_INET)
+    {
+        memcpy(&addr_.v4, saddr, sizeof(struct sockaddr_in));
+    }
+    else
+    {
+        addr_.v4.sin_family = AF_INET;
+    }
 }
 
-// 获取 IP 地址
-const std::string &InetAddress::IP() const
+// 设置是否为 IPv6
+void InetAddress::SetIsIPV6(bool is_v6)
 {
-    return addr_;
+    if (is_v6 != IsIpV6())
+    {
+        ParseAddr(IP(), is_v6);
+    }
 }
 
-// 将 IPv4 地址字符串转换为无符号 32 位整数表示
-uint32_t InetAddress::IPv4(const char *ip) const
+// 获取 IP 地址
+std::string InetAddress::IP() const
 {
-    struct sockaddr_in addr_in;
-    memset(&addr_in, 0x00, sizeof(struct sockaddr_in)); // 初始化为 0
-    addr_in.sin_family = AF_INET;                      // 设置为 IPv4 协议族
-    addr_in.sin_port = 0;
-    if (::inet_pton(AF_INET, ip, &addr_in.sin_addr) < 0) // 将字符串转换为网络地址
+    if (!host_.empty())
+    {
+        return host_;
+    }
+    char ip[INET6_ADDRSTRLEN] = {0,};
+    if (IsIpV6())
+    {
+        ::inet_ntop(AF_INET6, &addr_.v6.sin6_addr, ip, sizeof(ip));
+    }
+    else
     {
-        NETWORK_ERROR << "ipv4 ip:" << ip << " convert failed.";
+        ::inet_ntop(AF_INET, &addr_.v4.sin_addr, ip, sizeof(ip));
     }
-    return ntohl(addr_in.sin_addr.s_addr); // 返回主机字节序的整数表示
+    return ip;
 }
 
-// 将当前的 IP 地址转换为整数形式（IPv4）
+// 将当前的 IP 地址转换为整数形式（IPv4，IPv6 返回 0）
 uint32_t InetAddress::IPv4() const
 {
-    return IPv4(addr_.c_str()); // 调用上面的 IPv4 方法
+    return IsIpV6() ? 0 : ntohl(addr_.v4.sin_addr.s_addr);
 }
 
-// 将 IP 和端口组合成字符串格式 "IP:端口"
+// 将 IP 和端口组合成字符串格式 "IP:端口"，只在打日志时用
 std::string InetAddress::ToIpPort() const
 {
     std::stringstream ss;
-    ss << addr_ << ":" << port_;
+    ss << IP() << ":" << Port();
     return ss.str();
-    // 举例: addr_="127.0.0.1", port_="8080"，输出: "127.0.0.1:8080"
+    // 举例: 127.0.0.1 和 8080，输出: "127.0.0.1:8080"
 }
 
-// 将字符串端口号转换为整数
+// 获取端口号
 uint16_t InetAddress::Port() const
 {
-    return std::atoi(port_.c_str()); // 将字符串转换为整数
+    return ntohs(addr_.v4.sin_port);
 }
 
 // 将当前地址信息填充到 sockaddr 结构中
 void InetAddress::GetSockAddr(struct sockaddr *saddr) const
 {
-    if (is_ipv6_) // 如果是 IPv6
+    memcpy(saddr, &addr_, SockAddrLen());
+}
+
+socklen_t InetAddress::SockAddrLen() const
+{
+    return IsIpV6() ? sizeof(struct sockaddr_in6) : sizeof(struct sockaddr_in);
+}
+
+bool InetAddress::operator==(const InetAddress &other) const
+{
+    if (addr_.sa.sa_family != other.addr_.sa.sa_family || Port() != other.Port())
     {
-        struct sockaddr_in6 *addr_in6 = (struct sockaddr_in6 *)saddr;
-        memset(addr_in6, 0x00, sizeof(struct sockaddr_in6));
-        addr_in6->sin6_family = AF_INET6;
-        addr_in6->sin6_port = htons(std::atoi(port_.c_str())); // 设置端口号
-        ::inet_pton(AF_INET6, addr_.c_str(), &addr_in6->sin6_addr);
-        return;
+        return false;
     }
+    if (IsIpV6())
+    {
+        return memcmp(&addr_.v6.sin6_addr, &other.addr_.v6.sin6_addr, sizeof(struct in6_addr)) == 0
+               && addr_.v6.sin6_scope_id == other.addr_.v6.sin6_scope_id
+               && host_ == other.host_;
+    }
+    return addr_.v4.sin_addr.s_addr == other.addr_.v4.sin_addr.s_addr && host_ == other.host_;
+}
 
-    // 如果是 IPv4
-    struct sockaddr_in *addr_in = (struct sockaddr_in *)saddr;
-    memset(addr_in, 0x00, sizeof(struct sockaddr_in));
-    addr_in->sin_family = AF_INET;
-    addr_in->sin_port = htons(std::atoi(port_.c_str()));
-    ::inet_pton(AF_INET, addr_.c_str(), &addr_in->sin_addr);
+size_t InetAddress::Hash() const
+{
+    // 地址和端口拼成 64 位再打散 (pack address and port into 64 bits, then mix)
+    uint64_t h = addr_.v4.sin_port;
+    if (IsIpV6())
+    {
+        const uint32_t *w = (const uint32_t *)&addr_.v6.sin6_addr;
+        h ^= ((uint64_t)(w[0] ^ w[2]) << 32 | (w[1] ^ w[3])) * 0x9E3779B97F4A7C15ULL;
+    }
+    else
+    {
+        h |= (uint64_t)addr_.v4.sin_addr.s_addr << 16;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t)h;
 }
 
 // 判断是否为 IPv6 地址
 bool InetAddress::IsIpV6() const
 {
-    return is_ipv6_;
+    return addr_.sa.sa_family == AF_INET6;
 }
 
 // 判断是否为外网 IP
 bool InetAddress::IsWanIp() const
 {
-    // 定义私有 IP 范围 (A, B, C 类)
-    uint32_t a_start = IPv4("10.0.0.0");
-    uint32_t a_end = IPv4("10.255.255.255");
-    uint32_t b_start = IPv4("172.16.0.0");
-    uint32_t b_end = IPv4("172.31.255.255");
-    uint32_t c_start = IPv4("192.168.0.0");
-    uint32_t c_end = IPv4("192.168.255.255");
+    // 私有 IP 范围 (A, B, C 类)：10.0.0.0/8, 172.16.0.0/12, 192.168.0.0/16
     uint32_t ip = IPv4();
 
-    // 检查是否属于私有 IP 范围
-    bool is_a = ip >= a_start && ip <= a_end;
-    bool is_b = ip >= b_start && ip <= b_end;
-    bool is_c = ip >= c_start && ip <= c_end;
+    bool is_a = (ip & 0xff000000) == 0x0a000000;
+    bool is_b = (ip & 0xfff00000) == 0xac100000;
+    bool is_c = (ip & 0xffff0000) == 0xc0a80000;
 
     return !is_a && !is_b && !is_c && ip != INADDR_LOOPBACK;
 }
@@ -171,5 +247,5 @@ bool InetAddress::IsLanIp() const
 // 判断是否为回环地址 (127.0.0.1)
 bool InetAddress::IsLoopbackIp() const
 {
-    return addr_ == "127.0.0.1";
+    return !IsIpV6() && host_.empty() && IPv4() == INADDR_LOOPBACK;
 }
@@ -16,12 +16,17 @@
 #include <string>  // 提供 `std::string` 类型，用于字符串操作。
 // Provides the `std::string` type for string operations.
 
+#include <functional>  // std::hash
+
 namespace tmms  // 命名空间 `tmms`，避免与其他代码冲突。
 // Namespace `tmms` to avoid name conflicts with other code.
 {
     namespace network  // 子命名空间 `network`，表示网络相关的功能模块。
 // Sub-namespace `network` for network-related functionalities.
     {
+        // 地址以二进制的 sockaddr 保存，比较和哈希不需要格式化字符串，只有打日志时才转成文本。
+        // The address is kept as a binary sockaddr, so comparing and hashing never format strings;
+        // text is only produced for logging.
         class InetAddress  // 定义 `InetAddress` 类，用于管理 IP 地址和端口信息。
 // Defines the `InetAddress` class for managing IP addresses and port information.
         {
@@ -34,9 +39,13 @@ namespace tmms  // 命名空间 `tmms`，避免与其他代码冲突。
             // Constructor: Initializes the object with a hostname, supports IPv6.
             InetAddress(const std::string &host, bool is_v6 = false);
 
-            // 默认构造函数：不做任何初始化。
-            // Default constructor: Performs no initialization.
-            InetAddress() = default;
+            // 构造函数：直接用内核返回的 sockaddr 初始化（accept、recvfrom、getaddrinfo 的结果）。
+            // Constructor: Initializes from a sockaddr returned by the kernel (accept, recvfrom, getaddrinfo).
+            explicit InetAddress(const struct sockaddr *saddr);
+
+            // 默认构造函数：0.0.0.0:0。
+            // Default constructor: 0.0.0.0:0.
+            InetAddress();
 
             // 默认析构函数：用于资源清理。
             // Default destructor: Cleans up resources.
@@ -54,13 +63,17 @@ namespace tmms  // 命名空间 `tmms`，避免与其他代码冲突。
             // Sets the port number.
             void SetPort(uint16_t port);
 
+            // 从 sockaddr 设置地址和端口，不做字符串转换。
+            // Sets address and port from a sockaddr without any string conversion.
+            void SetSockAddr(const struct sockaddr *saddr);
+
             // 设置是否为 IPv6。
             // Sets whether the address is IPv6.
             void SetIsIPV6(bool is_v6);
 
-            // 获取 IP 地址字符串。
-            // Returns the IP address as a string.
-            const std::string &IP() const;
+            // 获取 IP 地址字符串（现场格式化，用于日志和 DNS）。
+            // Returns the IP address as a string (formatted on demand, for logging and DNS).
+            std::string IP() const;
 
             // 将 IP 地址转换为 32 位整数，仅适用于 IPv4。
             // Converts the IP address to a 32-bit integer, applicable for IPv4 only.
@@ -78,6 +91,23 @@ namespace tmms  // 命名空间 `tmms`，避免与其他代码冲突。
             // Retrieves the socket address structure, used for socket communication.
             void GetSockAddr(struct sockaddr *saddr) const;
 
+            // 内部保存的 sockaddr 和它的长度，可以直接传给 bind/connect/sendto。
+            // The stored sockaddr and its length, ready for bind/connect/sendto.
+            const struct sockaddr *SockAddr() const
+            {
+                return &addr_.sa;
+            }
+            socklen_t SockAddrLen() const;
+
+            // 按地址族、地址和端口比较与哈希，用作哈希表的键。
+            // Equality and hash over family, address and port, for use as a hash-table key.
+            bool operator==(const InetAddress &other) const;
+            bool operator!=(const InetAddress &other) const
+            {
+                return !(*this == other);
+            }
+            size_t Hash() const;
+
             // 判断是否为 IPv6 地址。
             // Determines if the address is IPv6.
             bool IsIpV6() const;
@@ -99,21 +129,34 @@ namespace tmms  // 命名空间 `tmms`，避免与其他代码冲突。
             static void GetIpAndPort(const std::string &host, std::string &ip, std::string &port);
 
         private:
-            // 将字符串形式的 IP 地址转换为 32 位整数（仅适用于 IPv4）。
-            // Converts an IP address in string form to a 32-bit integer (IPv4 only).
-            uint32_t IPv4(const char *ip) const;
-
-            // 成员变量：存储 IP 地址字符串。
-            // Member variable: Stores the IP address as a string.
-            std::string addr_;
-
-            // 成员变量：存储端口号字符串。
-            // Member variable: Stores the port number as a string.
-            std::string port_;
-
-            // 成员变量：标记是否为 IPv6 地址。
-            // Member variable: Indicates whether the address is IPv6.
-            bool is_ipv6_{false};
+            // 解析 IP 字符串，解析不了的（还没解析的域名）存进 host_。
+            // Parses an IP string; anything that does not parse (an unresolved domain) goes into host_.
+            void ParseAddr(const std::string &addr, bool is_v6);
+
+            // 成员变量：二进制地址，IPv4 和 IPv6 共用一块空间。
+            // Member variable: The binary address; IPv4 and IPv6 share the storage.
+            union
+            {
+                struct sockaddr sa;
+                struct sockaddr_in v4;
+                struct sockaddr_in6 v6;
+            } addr_;
+
+            // 成员变量：还没解析成 IP 的域名，平时为空。
+            // Member variable: A domain name not yet resolved to an IP; normally empty.
+            std::string host_;
         };
     }
 }
+
+namespace std
+{
+    template <>
+    struct hash<tmms::network::InetAddress>
+    {
+        size_t operator()(const tmms::network::InetAddress &addr) const
+        {
+            return addr.Hash();
+        }
+    };
+}
@@ -4,6 +4,8 @@
 #include <netinet/in.h>
 #include <errno.h>
 #include <assert.h>
+#include <unistd.h>
+#include <mutex>
 
 using namespace tmms::network;
 
@@ -12,15 +14,131 @@ namespace tmms::network
     static constexpr size_t kBufferOffset{8};
 }
 
+namespace
+{
+    // slab 池：切片可能在任何线程释放，所以用锁；一块 slab 装很多条消息，锁的开销可以忽略。
+    // 池对象故意不析构，退出时其他线程还可能在归还 slab。
+    // Slab pool. Slices may be released on any thread, hence the lock; one slab carries many
+    // messages so the cost is negligible. The pool is deliberately leaked because other threads may
+    // still return slabs during exit.
+    class SlabPool
+    {
+    public:
+        static const size_t kMaxFreeSlabs = 256;
+
+        std::shared_ptr<char> Get()
+        {
+            char *slab = nullptr;
+            {
+                std::lock_guard<std::mutex> lk(lock_);
+                if(!free_.empty())
+                {
+                    slab = free_.back();
+                    free_.pop_back();
+                }
+            }
+            if(!slab)
+            {
+                slab = new char[kMsgBufferSlabSize];
+            }
+            return std::shared_ptr<char>(slab,[this](char *s){
+                Put(s);
+            });
+        }
+
+    private:
+        void Put(char *slab)
+        {
+            {
+                std::lock_guard<std::mutex> lk(lock_);
+                if(free_.size() < kMaxFreeSlabs)
+                {
+                    free_.push_back(slab);
+                    return;
+                }
+            }
+            delete [] slab;
+        }
+
+        std::mutex lock_;
+        std::vector<char*> free_;
+    };
+
+    SlabPool &Slabs()
+    {
+        static SlabPool *pool = new SlabPool();
+        return *pool;
+    }
+}
+
 MsgBuffer::MsgBuffer(size_t len)
     : head_(kBufferOffset), initCap_(len), buffer_(len + head_), tail_(head_)
 {
 }
 
+void MsgBuffer::EnableSlab()
+{
+    if (slab_mode_)
+        return;
+    slab_mode_ = true;
+    Reslab(0);
+    std::vector<char>().swap(buffer_);
+}
+std::shared_ptr<char> MsgBuffer::Slice(const char *data) const
+{
+    if (!slab_)
+        return std::shared_ptr<char>();
+    assert(data >= begin() && data <= BeginWrite());
+    return std::shared_ptr<char>(slab_, const_cast<char *>(data));
+}
+void MsgBuffer::Reslab(size_t len, const char *front, size_t frontLen)
+{
+    size_t readable = ReadableBytes();
+    size_t need = kBufferOffset + frontLen + readable + len;
+    // 没有切片引用并且放得下：在原地前移 (No slice holds it and it fits: compact in place)
+    if (slab_ && slab_.use_count() == 1 && frontLen == 0 && slabSize_ >= need)
+    {
+        std::copy(begin() + head_, begin() + tail_, begin() + kBufferOffset);
+        tail_ = kBufferOffset + readable;
+        head_ = kBufferOffset;
+        return;
+    }
+    std::shared_ptr<char> slab;
+    size_t size = kMsgBufferSlabSize;
+    if (need <= kMsgBufferSlabSize)
+    {
+        slab = Slabs().Get();
+    }
+    else
+    {
+        // 放不进一块 slab 的大消息单独分配 (Messages larger than a slab get their own block)
+        size = need;
+        slab.reset(new char[size], std::default_delete<char[]>());
+    }
+    char *dst = slab.get() + kBufferOffset;
+    if (frontLen > 0)
+    {
+        memcpy(dst, front, frontLen);
+    }
+    if (readable > 0)
+    {
+        memcpy(dst + frontLen, Peek(), readable);
+    }
+    slab_ = std::move(slab);
+    slabSize_ = size;
+    head_ = kBufferOffset;
+    tail_ = kBufferOffset + frontLen + readable;
+}
+
 void MsgBuffer::EnsureWritableBytes(size_t len)
 {
     if (WritableBytes() >= len)
         return;
+    if (slab_mode_)
+    {
+        Reslab(len);
+        return;
+    }
     if (head_ + WritableBytes() >=
         (len + kBufferOffset))  // move Readable bytes
     {
@@ -42,6 +160,9 @@ void MsgBuffer::EnsureWritableBytes(size_t len)
 void MsgBuffer::Swap(MsgBuffer &buf) noexcept
 {
     buffer_.swap(buf.buffer_);
+    slab_.swap(buf.slab_);
+    std::swap(slabSize_, buf.slabSize_);
+    std::swap(slab_mode_, buf.slab_mode_);
     std::swap(head_, buf.head_);
     std::swap(tail_, buf.tail_);
     std::swap(initCap_, buf.initCap_);
@@ -49,13 +170,13 @@ void MsgBuffer::Swap(MsgBuffer &buf) noexcept
 void MsgBuffer::Append(const MsgBuffer &buf)
 {
     EnsureWritableBytes(buf.ReadableBytes());
-    memcpy(&buffer_[tail_], buf.Peek(), buf.ReadableBytes());
+    memcpy(begin() + tail_, buf.Peek(), buf.ReadableBytes());
     tail_ += buf.ReadableBytes();
 }
 void MsgBuffer::Append(const char *buf, size_t len)
 {
     EnsureWritableBytes(len);
-    memcpy(&buffer_[tail_], buf, len);
+    memcpy(begin() + tail_, buf, len);
     tail_ += len;
 }
 void MsgBuffer::AppendInt16(const uint16_t s)
@@ -120,6 +241,25 @@ void MsgBuffer::Retrieve(size_t len)
 }
 void MsgBuffer::RetrieveAll()
 {
+    if (slab_mode_)
+    {
+        // 还有切片引用时接着往后写，不回头覆盖 (While slices hold the slab keep appending instead of rewinding)
+        head_ = tail_;
+        if (slab_.use_count() == 1)
+        {
+            if (slabSize_ == kMsgBufferSlabSize)
+            {
+                tail_ = head_ = kBufferOffset;
+            }
+            else
+            {
+                // 单独分配的大块用完就换回池里的 slab (Give back an oversized block once it is drained)
+                slab_.reset();
+                Reslab(0);
+            }
+        }
+        return;
+    }
     if (buffer_.size() > (initCap_ * 2))
     {
         buffer_.resize(initCap_);
@@ -128,6 +268,18 @@ void MsgBuffer::RetrieveAll()
 }
 ssize_t MsgBuffer::ReadFd(int fd, int *retErrno)
 {
+    if (slab_mode_)
+    {
+        // 直接读进 slab，不经过栈上的中转缓冲区 (Read straight into the slab, no stack bounce buffer)
+        if (WritableBytes() < kMsgBufferSlabMinRead)
+            EnsureWritableBytes(kMsgBufferSlabMinRead);
+        ssize_t n = ::read(fd, BeginWrite(), WritableBytes());
+        if (n < 0)
+            *retErrno = errno;
+        else
+            tail_ += n;
+        return n;
+    }
     char extBuffer[8192];
     struct iovec vec[2];
     size_t writable = WritableBytes();
@@ -188,6 +340,18 @@ uint64_t MsgBuffer::ReadInt64()
 
 void MsgBuffer::AddInFront(const char *buf, size_t len)
 {
+    if (slab_mode_)
+    {
+        // 队头前面的数据可能被切片引用，不能原地写 (Bytes before the head may be sliced; never write there in place)
+        if (head_ >= len && slab_.use_count() == 1)
+        {
+            memcpy(begin() + head_ - len, buf, len);
+            head_ -= len;
+            return;
+        }
+        Reslab(0, buf, len);
+        return;
+    }
     if (head_ >= len)
     {
         memcpy(begin() + head_ - len, buf, len);
@@ -1,6 +1,7 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <memory>
 #include <algorithm>
 #include <stdio.h>
 #include <assert.h>
@@ -12,6 +13,10 @@ namespace tmms
     {
         
         static constexpr size_t kBufferDefaultLength{2048};
+        // slab 模式下每块的大小，从池里复用 (Size of the pooled slabs used in slab mode)
+        static constexpr size_t kMsgBufferSlabSize{64 * 1024};
+        // slab 模式下一次 ReadFd 至少留出的空间 (Minimum room left for one ReadFd in slab mode)
+        static constexpr size_t kMsgBufferSlabMinRead{16 * 1024};
         static constexpr char CRLF[]{"\r\n"};
 
         /**
@@ -145,7 +150,41 @@ namespace tmms
              */
             size_t WritableBytes() const
             {
-                return buffer_.size() - tail_;
+                return Capacity() - tail_;
+            }
+
+            /**
+             * @brief Switch the buffer to slab mode. Data is read straight into
+             * fixed-size pooled slabs (no bounce buffer, no reallocation of the
+             * whole buffer), and bytes already consumed can be handed out as
+             * refcounted slices with Slice(). A slab is never written again while
+             * a slice still references it; the buffer moves on to a fresh slab
+             * and only the unread tail is copied over.
+             * 切换到 slab 模式：数据直接读进池里的定长 slab，读过的数据可以用 Slice()
+             * 切成带引用计数的片交给上层。有切片引用的 slab 不会再被覆盖，缓冲区换一块新的，
+             * 只拷贝还没读的尾部。
+             */
+            void EnableSlab();
+            bool SlabEnabled() const
+            {
+                return slab_mode_;
+            }
+
+            /**
+             * @brief Return a pointer to data inside the current slab that keeps the
+             * slab alive. Empty when the buffer is not in slab mode.
+             *
+             * @param data A position between the start of the slab and BeginWrite().
+             * @return std::shared_ptr<char>
+             */
+            std::shared_ptr<char> Slice(const char *data) const;
+            /**
+             * @brief Size of the slab a Slice() would keep alive, 0 when not in slab mode.
+             * 切片会保活的 slab 大小，不是 slab 模式时为 0。
+             */
+            size_t SlabSize() const
+            {
+                return slab_ ? slabSize_ : 0;
             }
 
             /**
@@ -330,17 +369,27 @@ namespace tmms
             }
 
         private:
+            size_t Capacity() const
+            {
+                return slab_ ? slabSize_ : buffer_.size();
+            }
+            // 换一块至少能再写 len 字节的 slab，front 放在可读数据前面 (Move to a slab with room for len more bytes, front goes before the readable data)
+            void Reslab(size_t len, const char *front = nullptr, size_t frontLen = 0);
+
             size_t head_;
             size_t initCap_;
             std::vector<char> buffer_;
             size_t tail_;
+            bool slab_mode_{false};
+            std::shared_ptr<char> slab_;
+            size_t slabSize_{0};
             const char *begin() const
             {
-                return &buffer_[0];
+                return slab_ ? slab_.get() : &buffer_[0];
             }
             char *begin()
             {
-                return &buffer_[0];
+                return slab_ ? slab_.get() : &buffer_[0];
             }
         };
 
@@ -1,5 +1,7 @@
 #include "SocketOpt.h"
 #include "Network.h"
+#include <sys/ioctl.h>
+#include <linux/sockios.h>  // SIOCOUTQ
 
 using namespace tmms::network;
 
@@ -42,20 +44,8 @@ int SocketOpt::CreateNonblockingUdpSocket(int family)
 // Bind the socket to a local address
 int SocketOpt::BindAddress(const InetAddress &localaddr)
 {
-    if(localaddr.IsIpV6()) // 检查是否为 IPv6 地址
-    {
-        struct sockaddr_in6 addr; // 定义 IPv6 地址结构体
-        localaddr.GetSockAddr((struct sockaddr*)&addr); // 获取地址
-        socklen_t size = sizeof(struct sockaddr_in6); // 地址长度
-        return ::bind(sock_,(struct sockaddr*)&addr,size); // 绑定地址
-    }
-    else 
-    {
-        struct sockaddr_in addr; // 定义 IPv4 地址结构体
-        localaddr.GetSockAddr((struct sockaddr*)&addr);
-        socklen_t size = sizeof(struct sockaddr_in);
-        return ::bind(sock_,(struct sockaddr*)&addr,size);
-    }
+    // 地址本身就是 sockaddr，长度随地址族 (the address already is a sockaddr; its length follows the family)
+    return ::bind(sock_,localaddr.SockAddr(),localaddr.SockAddrLen()); // 绑定地址
 }
 
 // 将套接字设置为监听状态（仅适用于 TCP）
@@ -75,22 +65,7 @@ int SocketOpt::Accept(InetAddress *peeraddr)
     int sock = ::accept4(sock_,(struct sockaddr*)&addr,&len,SOCK_CLOEXEC|SOCK_NONBLOCK);
     if(sock>0) // 如果接收成功
     {
-        if(addr.sin6_family == AF_INET) // 如果是 IPv4 地址
-        {
-            char ip[16] = {0,};
-            struct sockaddr_in *saddr = (struct sockaddr_in*)&addr;
-            ::inet_ntop(AF_INET,&(saddr->sin_addr.s_addr),ip,sizeof(ip)); // 将地址转换为字符串格式
-            peeraddr->SetAddr(ip); // 设置地址
-            peeraddr->SetPort(ntohs(saddr->sin_port)); // 设置端口
-        }
-        else if(addr.sin6_family == AF_INET6) // 如果是 IPv6 地址
-        {
-            char ip[INET6_ADDRSTRLEN] = {0,};
-            ::inet_ntop(AF_INET6,&(addr.sin6_addr),ip,sizeof(ip));
-            peeraddr->SetAddr(ip);
-            peeraddr->SetPort(ntohs(addr.sin6_port));
-            peeraddr->SetIsIPV6(true); // 设置为 IPv6
-        }
+        peeraddr->SetSockAddr((struct sockaddr*)&addr); // 直接保存二进制地址 (keep the binary address as is)
     }
     return sock; // 返回新连接的套接字描述符
 }
@@ -99,9 +74,7 @@ int SocketOpt::Accept(InetAddress *peeraddr)
 // Connect to a remote address
 int SocketOpt::Connect(const InetAddress &addr)
 {
-    struct sockaddr_in6 addr_in; // 存储目标地址
-    addr.GetSockAddr((struct sockaddr*)&addr_in); // 获取地址
-    return ::connect(sock_,(struct sockaddr*)&addr_in,sizeof(struct sockaddr_in6)); // 发起连接
+    return ::connect(sock_,addr.SockAddr(),addr.SockAddrLen()); // 发起连接
 }
 
 // 获取本地地址
@@ -111,24 +84,7 @@ InetAddressPtr SocketOpt::GetLocalAddr()
     struct sockaddr_in6 addr_in;
     socklen_t len = sizeof(struct sockaddr_in6);
     ::getsockname(sock_,(struct sockaddr*)&addr_in,&len); // 获取本地地址信息
-    InetAddressPtr peeraddr = std::make_shared<InetAddress>();
-    if(addr_in.sin6_family == AF_INET)
-    {
-        char ip[16] = {0,};
-        struct sockaddr_in *saddr = (struct sockaddr_in*)&addr_in;
-        ::inet_ntop(AF_INET,&(saddr->sin_addr.s_addr),ip,sizeof(ip));
-        peeraddr->SetAddr(ip);
-        peeraddr->SetPort(ntohs(saddr->sin_port));
-    }
-    else if(addr_in.sin6_family == AF_INET6)
-    {
-        char ip[INET6_ADDRSTRLEN] = {0,};
-        ::inet_ntop(AF_INET6,&(addr_in.sin6_addr),ip,sizeof(ip));
-        peeraddr->SetAddr(ip);
-        peeraddr->SetPort(ntohs(addr_in.sin6_port));
-        peeraddr->SetIsIPV6(true);
-    }
-    return peeraddr;
+    return std::make_shared<InetAddress>((struct sockaddr*)&addr_in);
 }
 
 // 设置 TCP_NODELAY 属性，禁用 Nagle 算法，减少延迟
@@ -194,3 +150,70 @@ void SocketOpt::SetNonBlocking(bool on)
     // 参数2: F_SETFL -> 设置套接字的标志位。
     // 参数3: flag    -> 更新后的标志位，添加或移除 O_NONBLOCK。
 }
+
+void SocketOpt::SetBusyPoll(int usec)
+{
+    int optvalue = usec > 0 ? usec : 0;
+    if (::setsockopt(sock_, SOL_SOCKET, SO_BUSY_POLL, &optvalue, sizeof(optvalue)) < 0)
+    {
+        // 需要 CAP_NET_ADMIN 才能超过 net.core.busy_read，失败不影响连接
+        // Raising it above net.core.busy_read needs CAP_NET_ADMIN; failing is harmless.
+        NETWORK_DEBUG << "set SO_BUSY_POLL failed. error:" << errno;
+    }
+}
+
+bool SocketOpt::SetZeroCopy(bool on)
+{
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+    int optvalue = on ? 1 : 0;
+    if (::setsockopt(sock_, SOL_SOCKET, SO_ZEROCOPY, &optvalue, sizeof(optvalue)) < 0)
+    {
+        // 4.14 之前的内核或非 TCP/UDP 套接字不支持 (unsupported before 4.14 or on non TCP/UDP sockets)
+        NETWORK_DEBUG << "set SO_ZEROCOPY failed. error:" << errno;
+        return false;
+    }
+    return true;
+}
+
+bool SocketOpt::SetNotSentLowat(int bytes)
+{
+#ifndef TCP_NOTSENT_LOWAT
+#define TCP_NOTSENT_LOWAT 25
+#endif
+    int optvalue = bytes;
+    if (::setsockopt(sock_, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &optvalue, sizeof(optvalue)) < 0)
+    {
+        NETWORK_DEBUG << "set TCP_NOTSENT_LOWAT failed. error:" << errno;
+        return false;
+    }
+    return true;
+}
+
+bool SocketOpt::SetSendBuffer(int bytes)
+{
+    int optvalue = bytes;
+    if (::setsockopt(sock_, SOL_SOCKET, SO_SNDBUF, &optvalue, sizeof(optvalue)) < 0)
+    {
+        NETWORK_DEBUG << "set SO_SNDBUF failed. error:" << errno;
+        return false;
+    }
+    return true;
+}
+
+void SocketOpt::SetCork(bool on)
+{
+    int optvalue = on ? 1 : 0;
+    ::setsockopt(sock_, IPPROTO_TCP, TCP_CORK, &optvalue, sizeof(optvalue));
+}
+
+int SocketOpt::GetOutQueue()
+{
+    int bytes = 0;
+    if (::ioctl(sock_, SIOCOUTQ, &bytes) < 0)
+    {
+        return -1;
+    }
+    return bytes;
+}
@@ -82,6 +82,30 @@ namespace tmms // 命名空间 "tmms"，用于防止命名冲突
             // 设置套接字为非阻塞模式
             // Sets the socket to non-blocking mode.
 
+            void SetBusyPoll(int usec);
+            // 设置 SO_BUSY_POLL，阻塞读或 epoll 等待时先在网卡队列上忙轮询 usec 微秒
+            // Sets SO_BUSY_POLL so receives spin on the device queue for usec microseconds before sleeping.
+
+            bool SetZeroCopy(bool on);
+            // 设置 SO_ZEROCOPY，之后带 MSG_ZEROCOPY 的发送不再把数据拷贝进内核，内核或协议不支持时返回 false
+            // Sets SO_ZEROCOPY so sends flagged MSG_ZEROCOPY skip the copy into the kernel; false when unsupported.
+
+            bool SetNotSentLowat(int bytes);
+            // 设置 TCP_NOTSENT_LOWAT，发送队列里还没发出的数据少于 bytes 时才报告可写
+            // Sets TCP_NOTSENT_LOWAT so the socket only reports writable while fewer than bytes are unsent.
+
+            bool SetSendBuffer(int bytes);
+            // 设置 SO_SNDBUF，内核实际使用的是两倍（另一半给内核的簿记）
+            // Sets SO_SNDBUF; the kernel doubles it to leave room for its own bookkeeping.
+
+            void SetCork(bool on);
+            // 设置 TCP_CORK，开启时不发不满的报文段，关闭时把攒下的数据一起发出
+            // Sets TCP_CORK: partial segments are held while on and flushed together when turned off.
+
+            int GetOutQueue();
+            // 用 SIOCOUTQ 取发送队列里还没被对端确认的字节数，失败返回 -1
+            // Returns the bytes in the send queue not yet acknowledged by the peer (SIOCOUTQ), or -1.
+
         private:
             int sock_{-1};   // 套接字文件描述符，初始化为 -1，表示无效
             // Socket file descriptor initialized to -1 (invalid).
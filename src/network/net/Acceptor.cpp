@@ -73,7 +73,7 @@ void Acceptor::Open()
     }
 
     // 5. 添加事件到事件循环（EventLoop）中
-    loop_->AddEvent(std::dynamic_pointer_cast<Acceptor>(shared_from_this()));
+    Loop()->AddEvent(std::dynamic_pointer_cast<Acceptor>(shared_from_this()));
 
     // 6. 初始化 socket_opt_ 并设置套接字选项
     socket_opt_ = new SocketOpt(fd_);
@@ -87,7 +87,7 @@ void Acceptor::Open()
 // Starts the Acceptor in the EventLoop, ensuring thread safety.
 void Acceptor::Start()
 {
-    loop_->RunInLoop([this](){
+    Loop()->RunInLoop([this](){
         Open(); // 在事件循环线程中执行 Open 方法
     });
 }
@@ -96,7 +96,7 @@ void Acceptor::Start()
 // Stops the Acceptor and removes it from the event loop.
 void Acceptor::Stop()
 {
-    loop_->DelEvent(std::dynamic_pointer_cast<Acceptor>(shared_from_this())); // 从事件循环中删除当前对象
+    Loop()->DelEvent(std::dynamic_pointer_cast<Acceptor>(shared_from_this())); // 从事件循环中删除当前对象
 }
 
 // 处理可读事件，接受新连接。
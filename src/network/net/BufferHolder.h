@@ -0,0 +1,124 @@
+#pragma once
+
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+namespace tmms
+{
+    namespace network
+    {
+        // 侵入式所有者的引用操作：add_ref 加一个引用并返回它的标记，release 按标记放掉一个引用
+        // Reference operations of an intrusive owner: add_ref takes a reference and returns its tag,
+        // release drops one reference given its tag.
+        struct BufferHolderOps
+        {
+            uintptr_t (*add_ref)(void *obj);
+            void (*release)(void *obj, uintptr_t tag);
+        };
+
+        // BufferHolder：发送队列里一段数据的所有者，发送期间一直持有。
+        // 可以是任意的 std::shared_ptr，也可以是自己带引用计数的对象（比如包，计数在包头里），后者拷贝时只
+        // 调用对象自己的加引用，不分配控制块，适合每个播放者每一帧都要持有一次的媒体数据。
+        // BufferHolder: the owner of a piece of data in an output queue, held while it is being sent.
+        // Either any std::shared_ptr, or an object with its own reference count (such as a packet,
+        // whose count lives in its header); copying the latter only calls the object's own add-ref and
+        // allocates no control block, which suits media data held once per player per frame.
+        class BufferHolder
+        {
+        public:
+            BufferHolder() = default;
+            BufferHolder(std::nullptr_t)
+            {
+            }
+            template <typename T>
+            BufferHolder(const std::shared_ptr<T> &shared)
+            : shared_(shared)
+            {
+            }
+            template <typename T>
+            BufferHolder(std::shared_ptr<T> &&shared)
+            : shared_(std::move(shared))
+            {
+            }
+            // 接管一个已经计过数的侵入式引用 (Adopts an intrusive reference that is already counted)
+            static BufferHolder Adopt(void *obj, uintptr_t tag, const BufferHolderOps *ops)
+            {
+                BufferHolder h;
+                h.obj_ = obj;
+                h.tag_ = tag;
+                h.ops_ = ops;
+                return h;
+            }
+
+            BufferHolder(const BufferHolder &other)
+            : shared_(other.shared_), obj_(other.obj_), ops_(other.ops_)
+            {
+                if(ops_)
+                {
+                    tag_ = ops_->add_ref(obj_);
+                }
+            }
+            BufferHolder(BufferHolder &&other) noexcept
+            : shared_(std::move(other.shared_)), obj_(other.obj_), tag_(other.tag_), ops_(other.ops_)
+            {
+                other.obj_ = nullptr;
+                other.ops_ = nullptr;
+            }
+            ~BufferHolder()
+            {
+                if(ops_)
+                {
+                    ops_->release(obj_,tag_);
+                }
+            }
+            BufferHolder &operator=(const BufferHolder &other)
+            {
+                BufferHolder(other).swap(*this);
+                return *this;
+            }
+            BufferHolder &operator=(BufferHolder &&other) noexcept
+            {
+                BufferHolder(std::move(other)).swap(*this);
+                return *this;
+            }
+
+            void reset()
+            {
+                BufferHolder().swap(*this);
+            }
+            void swap(BufferHolder &other) noexcept
+            {
+                shared_.swap(other.shared_);
+                std::swap(obj_,other.obj_);
+                std::swap(tag_,other.tag_);
+                std::swap(ops_,other.ops_);
+            }
+            // 被持有的对象 (The object being held)
+            void *get() const
+            {
+                return ops_ ? obj_ : shared_.get();
+            }
+            explicit operator bool() const
+            {
+                return get() != nullptr;
+            }
+
+        private:
+            std::shared_ptr<void> shared_;
+            void *obj_{nullptr};
+            uintptr_t tag_{0};
+            const BufferHolderOps *ops_{nullptr};
+        };
+
+        inline bool operator==(const BufferHolder &a, const BufferHolder &b)
+        {
+            return a.get() == b.get();
+        }
+        inline bool operator!=(const BufferHolder &a, const BufferHolder &b)
+        {
+            return a.get() != b.get();
+        }
+    }
+}
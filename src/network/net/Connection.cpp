@@ -51,20 +51,32 @@ const InetAddress &Connection::PeerAddr() const
 /// 设置上下文信息（带共享指针） Set Context with shared_ptr (Copy)
 void Connection::SetContext(int type,const std::shared_ptr<void> &context)
 {
-    contexts_[type] = context; // 将上下文信息存储在 map 容器中
-    // Store the shared context pointer into a map, indexed by type
+    if(type < 0 || type >= kMaxContext)
+    {
+        return;
+    }
+    contexts_[type] = context; // 将上下文信息存储在对应类型的槽里
+    // Store the shared context pointer into the slot of its type
 }
 
 /// 设置上下文信息（使用移动语义） Set Context with shared_ptr (Move)
 void Connection::SetContext(int type,std::shared_ptr<void> &&context)
 {
+    if(type < 0 || type >= kMaxContext)
+    {
+        return;
+    }
     contexts_[type] = std::move(context); // 使用移动语义存储上下文，减少拷贝开销
-    // Move the context pointer into the map for efficiency
+    // Move the context pointer into its slot for efficiency
 }
 
 /// 清除特定类型的上下文信息 Clear Context by type
 void Connection::ClearContext(int type)
 {
+    if(type < 0 || type >= kMaxContext)
+    {
+        return;
+    }
     contexts_[type].reset(); // 将指定类型的上下文指针置空
     // Reset (clear) the context pointer for the specified type
 }
@@ -72,8 +84,11 @@ void Connection::ClearContext(int type)
 /// 清除所有上下文信息 Clear All Context
 void Connection::ClearContext()
 {
-    contexts_.clear(); // 清空整个上下文 map
-    // Clear the entire map of contexts
+    for(auto &c:contexts_) // 清空所有的槽
+    {
+        c.reset();
+    }
+    // Clear every context slot
 }
 
 /// 设置活动回调函数（拷贝版本） Set Active Callback (Copy)
@@ -95,20 +110,53 @@ void Connection::Active()
 {
     if(!active_.load()) // 检查连接是否未被激活
     {
-        loop_->RunInLoop([this](){ 
-            // 将激活操作提交到事件循环中，保证线程安全
-            // Submit the activation operation to the event loop for thread safety
+        // 在连接所属的循环里执行激活，保证线程安全；投递之后连接迁移了会转投到新的循环
+        // Activation runs on the connection's own loop for thread safety; if the connection
+        // migrates after this is posted, it is forwarded to the new loop.
+        RunInOwnLoop([this](){ 
             active_.store(true); // 设置 active_ 状态为 true
             if(active_cb_) // 如果设置了回调函数
             {
                 // 执行回调函数，传入当前 Connection 的智能指针
-                active_cb_(std::dynamic_pointer_cast<Connection>(shared_from_this()));
+                active_cb_(std::static_pointer_cast<Connection>(shared_from_this()));
                 // Execute the callback function with the current Connection's shared_ptr
             }
         });
     }
 }
 
+/// 当前线程是不是连接所属的循环线程，迁移途中谁都不是
+/// Whether this is the connection's loop thread; while a move is in flight no thread is.
+bool Connection::InOwnLoop() const
+{
+    return Loop()->IsInLoopThread() && !transit_loop_.load(std::memory_order_acquire);
+}
+
+/// 在连接所属的循环里执行 task。迁移途中落在旧循环的任务转给目标循环：目标循环先注册连接再公布
+/// loop_，转过去的任务排在注册之后，不会在旧循环里和新循环同时碰连接，也不会在注册之前开写事件。
+/// Runs task on the connection's own loop. While a move is in flight, tasks that land on the old
+/// loop are forwarded to the target, which registers the connection before publishing loop_; a
+/// forwarded task queues behind the registration, so it neither touches the connection on the old
+/// loop alongside the new one nor enables writing before the connection is registered there.
+void Connection::RunInOwnLoop(Func &&task)
+{
+    EventLoop *loop = Loop();
+    if(loop->IsInLoopThread())
+    {
+        EventLoop *target = transit_loop_.load(std::memory_order_acquire);
+        if(!target)
+        {
+            task();
+            return;
+        }
+        loop = target;
+    }
+    auto self = std::static_pointer_cast<Connection>(shared_from_this());
+    loop->RunInLoop([self, task]() mutable {
+        self->RunInOwnLoop(std::move(task));
+    });
+}
+
 /// 取消激活当前连接 Deactivate the Connection
 void Connection::Deactive()
 {
@@ -5,8 +5,9 @@
 #include "network/base/InetAddress.h" // 引入用于存储网络地址的类
 #include "Event.h"                    // 引入事件基类
 #include "EventLoop.h"                // 引入事件循环类
+#include "BufferHolder.h"             // 发送数据的所有者 (owner of the data being sent)
 #include <functional>                 // 引入 std::function 处理回调函数
-#include <unordered_map>              // 引入哈希表，用于存储上下文
+#include <array>                      // 引入定长数组，上下文按类型存放在固定的槽里
 #include <memory>                     // 引入智能指针 std::shared_ptr
 #include <atomic>                     // 引入原子操作类，用于线程安全
 
@@ -23,6 +24,7 @@ namespace tmms // 定义命名空间 tmms
             kHttpContext,        // HTTP 协议上下文
             kUserContext,        // 用户自定义上下文
             kFlvContext,         // FLV 协议上下文
+            kMaxContext,         // 上下文槽的个数 (number of context slots)
         };
 
         // 定义一个结构体 BufferNode，用于存储缓冲区数据的地址和大小
@@ -32,11 +34,15 @@ namespace tmms // 定义命名空间 tmms
             BufferNode(void *buf,size_t s)
             :addr(buf),size(s)
             {} 
+            BufferNode(void *buf,size_t s,const BufferHolder &h)
+            :addr(buf),size(s),holder(h)
+            {} 
             // 构造函数，初始化地址和大小
             // Constructor to initialize buffer address and size.
 
             void *addr{nullptr}; // 缓冲区地址 (Buffer address)
             size_t size{0};      // 缓冲区大小 (Buffer size)
+            BufferHolder holder;          // 缓冲区的所有者（比如 PacketPtr），发送时持有它；没有所有者的节点会被拷贝 (Owner of the memory, e.g. a PacketPtr, kept while sending; nodes without one are copied)
         };
 
         using BufferNodePtr = std::shared_ptr<BufferNode>; // 定义智能指针类型，管理 BufferNode
@@ -88,12 +94,11 @@ namespace tmms // 定义命名空间 tmms
             template <typename T> 
             std::shared_ptr<T> GetContext(int type) const
             {
-                auto iter = contexts_.find(type); // 查找指定类型的上下文
-                if(iter!=contexts_.end()) // 如果找到了
+                if(type < 0 || type >= kMaxContext) // 不认识的类型
                 {
-                    return std::static_pointer_cast<T>(iter->second); // 类型转换并返回
+                    return std::shared_ptr<T>(); // 返回空指针
                 }
-                return std::shared_ptr<T>(); // 返回空指针
+                return std::static_pointer_cast<T>(contexts_[type]); // 直接按类型取槽，不查哈希表
             }
 
             // 清除指定类型的上下文
@@ -124,14 +129,43 @@ namespace tmms // 定义命名空间 tmms
             // Force close the connection. A pure virtual function to be implemented by derived classes.
             virtual void ForceClose() = 0;
 
+            // 已交给连接但还没写进内核的字节数，默认没有输出队列
+            // Bytes handed to the connection but not yet written to the kernel; none by default.
+            virtual size_t PendingBytes() const
+            {
+                return 0;
+            }
+
+            // 已经写进内核但对端还没确认的字节数，默认不可知
+            // Bytes written to the kernel but not yet acknowledged by the peer; unknown by default.
+            virtual size_t SocketBacklogBytes() const
+            {
+                return 0;
+            }
+
+            // 按码率设置发送缓冲区，能装下 target_ms 毫秒的数据，默认不支持
+            // Sizes the send buffer to hold target_ms of data at the given bitrate; unsupported by default.
+            virtual void SetSendBufferForBitrate(int64_t bytes_per_sec, uint32_t target_ms)
+            {
+            }
+
         private:
-            std::unordered_map<int,ContextPtr> contexts_; // 存储上下文的哈希表
+            std::array<ContextPtr,kMaxContext> contexts_; // 每种上下文一个槽，按类型下标访问
             ActiveCallback active_cb_; // 激活时调用的回调函数
             std::atomic<bool> active_{false}; // 原子布尔变量，表示连接是否处于激活状态
 
         protected:
+            // 当前线程是连接所属的循环线程并且没有在迁移 (On the connection's loop thread, with no move in flight)
+            bool InOwnLoop() const;
+            // 在连接所属的循环里执行，迁移途中转给目标循环 (Runs on the connection's loop; forwarded to the target mid-move)
+            void RunInOwnLoop(Func &&task);
+
             InetAddress local_addr_; // 本地地址
             InetAddress peer_addr_;  // 对端地址
+            // 迁移途中的目标循环：旧循环已经删掉事件，目标循环还没注册，空表示没有在迁移
+            // Target loop of a move in flight: the old loop has dropped the event and the target has
+            // not registered it yet; null when no move is in flight.
+            std::atomic<EventLoop*> transit_loop_{nullptr};
         };
     }
 }
@@ -167,16 +201,16 @@ namespace tmms // 定义命名空间 tmms
 
 // local_addr_ 和 peer_addr_：存储本地地址和对端地址。
 // Stores local and peer addresses.
-// contexts_：存储任意类型的上下文数据（通过类型作为键）。
-// A map to store arbitrary context data by type.
+// contexts_：存储任意类型的上下文数据，每种类型一个固定的槽。
+// Fixed slots holding arbitrary context data, one per type.
 // active_cb_：当连接激活时调用的回调函数。
 // A callback function triggered when the connection becomes active.
 // active_：使用 atomic 类型，标记连接是否激活，确保多线程安全。
 // An atomic variable marking the connection's active status for thread safety.
 // 激活流程（Active 方法）：
 
-// 如果连接未激活，调用 loop_->RunInLoop 异步执行激活逻辑。
-// If the connection is inactive, it uses loop_->RunInLoop to execute the activation logic asynchronously.
+// 如果连接未激活，在连接所属的循环里异步执行激活逻辑。
+// If the connection is inactive, it runs the activation logic asynchronously on the connection's loop.
 // 执行回调函数 active_cb_，并将当前连接对象作为参数传入。
 // Executes the callback active_cb_ with the current connection object as a parameter.
 // 去激活（Deactive 方法）：
@@ -0,0 +1,70 @@
+#include "EpollPoller.h"
+#include "network/base/Network.h"
+#include <cstring>
+#include <unistd.h>
+#include <errno.h>
+
+using namespace tmms::network;
+
+EpollPoller::~EpollPoller()
+{
+    if(epoll_fd_ >= 0)
+    {
+        ::close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+}
+
+bool EpollPoller::Init()
+{
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if(epoll_fd_ < 0)
+    {
+        NETWORK_ERROR << "epoll_create1 failed. error:" << errno;
+        return false;
+    }
+    return true;
+}
+
+int EpollPoller::Poll(int timeout_ms, std::vector<struct epoll_event> &events)
+{
+    return ::epoll_wait(epoll_fd_,
+                        (struct epoll_event*)&events[0],
+                        static_cast<int>(events.size()),
+                        timeout_ms);
+}
+
+bool EpollPoller::Ctl(int op, int fd, uint32_t events, uint64_t token)
+{
+    struct epoll_event ev;
+    memset(&ev, 0x00, sizeof(struct epoll_event));
+    ev.events = events;     // 设置事件类型
+    ev.data.u64 = token;    // 槽下标 + 代数
+    if(::epoll_ctl(epoll_fd_, op, fd, &ev) < 0)
+    {
+        // fd 已经先关闭时删除会失败，内核已经自动移除了，不算错误
+        // Deleting an fd that was already closed fails, but the kernel has dropped it anyway.
+        if(op == EPOLL_CTL_DEL && (errno == EBADF || errno == ENOENT))
+        {
+            return true;
+        }
+        NETWORK_ERROR << "epoll_ctl op:" << op << " fd:" << fd << " error:" << errno;
+        return false;
+    }
+    return true;
+}
+
+bool EpollPoller::AddFd(int fd, uint32_t events, uint64_t token)
+{
+    return Ctl(EPOLL_CTL_ADD, fd, events, token);
+}
+
+bool EpollPoller::ModifyFd(int fd, uint32_t events, uint64_t token)
+{
+    return Ctl(EPOLL_CTL_MOD, fd, events, token);
+}
+
+bool EpollPoller::RemoveFd(int fd, uint64_t token)
+{
+    return Ctl(EPOLL_CTL_DEL, fd, 0, token);
+}
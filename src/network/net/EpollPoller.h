@@ -0,0 +1,35 @@
+#pragma once
+// 防止头文件被重复包含
+// Prevents this header file from being included multiple times.
+
+#include "Poller.h"
+
+namespace tmms
+{
+    namespace network
+    {
+        // EpollPoller：基于 epoll 的默认后端，也是 io_uring 不可用时的回退方案
+        // EpollPoller: the default epoll backend, also the fallback when io_uring is unavailable.
+        class EpollPoller : public Poller
+        {
+        public:
+            EpollPoller() = default;
+            ~EpollPoller();
+
+            bool Init() override;
+            int Poll(int timeout_ms, std::vector<struct epoll_event> &events) override;
+            bool AddFd(int fd, uint32_t events, uint64_t token) override;
+            bool ModifyFd(int fd, uint32_t events, uint64_t token) override;
+            bool RemoveFd(int fd, uint64_t token) override;
+            const char *Name() const override
+            {
+                return "epoll";
+            }
+
+        private:
+            bool Ctl(int op, int fd, uint32_t events, uint64_t token);
+
+            int epoll_fd_{-1}; // epoll 文件描述符
+        };
+    }
+}
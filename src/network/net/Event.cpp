@@ -42,7 +42,7 @@ void Event::Close()
 bool Event::EnableWriting(bool enable)
 {
     // 调用 EventLoop 对象的 EnableEventWriting 方法，开启或关闭写事件监听。
-    return loop_->EnableEventWriting(shared_from_this(), enable);
+    return Loop()->EnableEventWriting(shared_from_this(), enable);
     // shared_from_this()：获取当前 Event 对象的 shared_ptr 指针，确保对象生命周期安全。
     // enable：布尔值，true 表示开启写事件监听，false 表示关闭。
     // 示例：event.EnableWriting(true); 表示监听当前事件对应 fd_ 的写操作。
@@ -52,7 +52,7 @@ bool Event::EnableWriting(bool enable)
 bool Event::EnableReading(bool enable)
 {
     // 调用 EventLoop 对象的 EnableEventReading 方法，开启或关闭读事件监听。
-    return loop_->EnableEventReading(shared_from_this(), enable);
+    return Loop()->EnableEventReading(shared_from_this(), enable);
     // 类似于 EnableWriting，但作用于读事件。
     // 示例：event.EnableReading(true); 表示监听当前事件对应 fd_ 的读操作。
 }
@@ -64,3 +64,9 @@ int Event::Fd() const
     // 解释：该函数用于获取当前事件关联的文件描述符。
     // 示例：int fd = event.Fd(); 获取事件关联的文件描述符，用于后续操作。
 }
+
+// 获取当前 Event 对象所属的事件循环。
+EventLoop *Event::Loop() const
+{
+    return loop_.load(std::memory_order_acquire); // 连接迁移到其他循环后返回新的循环。
+}
@@ -2,6 +2,8 @@
 #include <string>
 #include <sys/epoll.h>
 #include <memory>
+#include <cstdint>
+#include <atomic>
 
 namespace tmms
 {
@@ -22,14 +24,30 @@ namespace tmms
             virtual void OnWrite() {};
             virtual void OnClose() {};
             virtual void OnError(const std::string &msg) {};
+            // 收到 EPOLLERR 时先调用：错误队列里可能只是通知（比如零拷贝发送完成），
+            // 事件自己处理了就返回 true，循环继续分发读写；返回 false 按套接字错误处理
+            // Called first on EPOLLERR: the error queue may only hold notifications (such as
+            // zero-copy completions). Return true once handled and dispatch carries on with
+            // read/write; false treats it as a socket error.
+            virtual bool OnErrorQueue() { return false; };
             bool EnableWriting(bool enable);
             bool EnableReading(bool enable);
             int Fd() const;
+            EventLoop *Loop() const;  // 当前所属的事件循环，连接迁移后会变化
             void Close();
         protected:
-            EventLoop * loop_{nullptr};
+            // 连接迁移时由目标循环改写，其他线程（Send、Active、会话分组）随时会读
+            // Rewritten by the target loop when a connection moves; other threads (Send, Active,
+            // session grouping) read it at any time.
+            std::atomic<EventLoop*> loop_{nullptr};
             int fd_{-1};
             int event_{0};
+            int32_t slot_{-1};  // 在所属 EventLoop 事件槽数组中的下标，-1 表示未注册
+            bool stream_{false}; // 已连接的字节流，后端有数据通路时由后端收数据 (a connected stream; the backend receives for it when it has a data path)
+            // 以下只在所属循环线程里访问 (only touched on the owning loop thread)
+            bool read_pending_{false};  // 已经在循环的继续读队列里 (already queued for a continued read)
+            bool read_again_{false};    // 最近一次读回调又用完了预算 (the last read callback used up its budget again)
+            uint64_t read_round_{0};    // 最近一次由 epoll 分发读的轮次 (the round epoll last dispatched a read in)
         };
     }
 }
\ No newline at end of file
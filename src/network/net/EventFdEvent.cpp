@@ -0,0 +1,45 @@
+#include "EventFdEvent.h"         // 包含 EventFdEvent 类的头文件
+#include "network/base/Network.h" // 网络模块日志宏
+#include <sys/eventfd.h>          // eventfd 系统调用
+#include <unistd.h>               // read / write
+#include <errno.h>
+
+using namespace tmms::network;
+
+// 构造函数：创建非阻塞的 eventfd
+// Constructor: creates a non-blocking eventfd.
+EventFdEvent::EventFdEvent(EventLoop *loop)
+:Event(loop)
+{
+    fd_ = ::eventfd(0, EFD_NONBLOCK|EFD_CLOEXEC);
+    if(fd_ < 0)
+    {
+        NETWORK_ERROR << "eventfd open failed. error:" << errno;
+        exit(-1);
+    }
+}
+
+// 读出计数器，一次 read 就能消费掉所有合并的唤醒
+// A single read consumes every coalesced wakeup.
+void EventFdEvent::OnRead()
+{
+    uint64_t count = 0;
+    auto ret = ::read(fd_, &count, sizeof(count));
+    if(ret < 0 && errno != EAGAIN)
+    {
+        NETWORK_ERROR << "eventfd read error. error:" << errno;
+    }
+}
+
+void EventFdEvent::OnError(const std::string &msg)
+{
+    NETWORK_ERROR << "eventfd error:" << msg;
+}
+
+// 写入 1，计数器累加，epoll 只会报告一次可读
+// Writes 1; the counter accumulates and epoll reports a single readable event.
+void EventFdEvent::Notify()
+{
+    uint64_t one = 1;
+    ::write(fd_, &one, sizeof(one));
+}
@@ -0,0 +1,37 @@
+#pragma once  
+// 防止头文件被重复包含，避免编译错误  
+// Prevent the header file from being included multiple times, avoiding compilation errors.
+
+#include "Event.h"  
+// 包含 Event 基类  
+// Includes the Event base class.
+
+#include <memory>  
+
+namespace tmms  
+{  
+    namespace network  
+    {  
+        // EventFdEvent：基于 eventfd 的唤醒事件，替代 PipeEvent 做跨线程唤醒  
+        // 一个 fd、一个 8 字节计数器，多次写入会在内核中合并为一次可读事件  
+        // EventFdEvent: an eventfd based wakeup event replacing PipeEvent for cross-thread wakeups.  
+        // One fd and one 8-byte counter; repeated writes coalesce into a single readable event in the kernel.
+        class EventFdEvent: public Event  
+        {  
+        public:  
+            EventFdEvent(EventLoop *loop);  
+            ~EventFdEvent() = default;  
+
+            // 读出计数器，清除可读状态  
+            // Drains the counter and clears the readable state.  
+            void OnRead() override;  
+            void OnError(const std::string &msg) override;  
+
+            // 计数器加一，唤醒等待中的 epoll_wait  
+            // Increments the counter, waking up a blocked epoll_wait.  
+            void Notify();  
+        };  
+
+        using EventFdEventPtr = std::shared_ptr<EventFdEvent>;  
+    }  
+}
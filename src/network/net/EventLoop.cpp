@@ -5,17 +5,30 @@
 #include <fcntl.h>
 #include <sys/socket.h>
 #include <unistd.h>
+#include <ctime>
+#include <algorithm>
 
 using namespace tmms::network;
 
+namespace
+{
+    // 单调时钟微秒，用于统计忙碌时间 (Monotonic microseconds, for busy-time accounting)
+    int64_t NowUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+}
+
 // 使用 thread_local 保证每个线程只能有一个 EventLoop 实例。
 // Ensures that each thread has its own EventLoop instance.
 static thread_local EventLoop * t_local_eventloop = nullptr;
 
-// EventLoop 构造函数: 初始化 epoll 实例，并设置事件列表大小为 1024。
-// EventLoop constructor: Initializes the epoll instance and event list size to 1024.
+// EventLoop 构造函数: 按配置创建 I/O 后端（epoll 或 io_uring），并设置事件列表大小为 1024。
+// EventLoop constructor: Creates the configured I/O backend (epoll or io_uring) and sizes the event list to 1024.
 EventLoop::EventLoop()
-:epoll_fd_(::epoll_create(1024)), // 创建 epoll 文件描述符
+:poller_(Poller::NewPoller(Poller::DefaultType())), // io_uring 不可用时回退到 epoll
 epoll_events_(1024)              // 分配初始事件列表大小为 1024
 {
     if(t_local_eventloop) // 如果当前线程已有 EventLoop，则报错退出
@@ -24,6 +37,23 @@ epoll_events_(1024)              // 分配初始事件列表大小为 1024
         exit(-1);
     }
     t_local_eventloop = this; // 将当前 EventLoop 赋给线程局部变量
+    data_path_ = poller_->HasDataPath();
+
+    // 唤醒事件在构造时就注册好，其他线程投递任务时不用再创建
+    // The wakeup event is registered up front so posting threads never have to create it.
+    wakeup_event_ = std::make_shared<EventFdEvent>(this);
+    AddEvent(wakeup_event_);
+
+    // 定时器由 timerfd 驱动；秒级时间轮挂在一个 1 秒的周期定时器上，保证至少每秒醒一次
+    // Timers are driven by the timerfd; the second-granularity wheel rides on a 1 s periodic
+    // timer, so the loop still wakes at least once a second.
+    timer_event_ = std::make_shared<TimerFdEvent>(this);
+    AddEvent(timer_event_);
+    load_ts_ = NowUs();
+    RunEvery(1.0, [this](){
+        wheel_.OnTimer(tmms::base::TTime::NowMS());
+        UpdateLoad();
+    });
 }
 
 // EventLoop 析构函数，调用 Quit() 停止事件循环。
@@ -38,65 +68,58 @@ EventLoop::~EventLoop()
 void EventLoop::Loop()
 {
     looping_ = true; // 标记进入事件循环
-    int64_t timeout = 1000; // epoll_wait 超时时间为 1000 毫秒
 
     while(looping_) // 无限循环，直到调用 Quit()
     {
-        // 清零事件数组，避免旧数据影响
-        memset(&epoll_events_[0],0x00,sizeof(struct epoll_event)*epoll_events_.size());
+        // 统计开关每轮只读一次，关闭时下面的计时全部跳过
+        // The stats switch is read once per iteration; with it off every timing below is skipped.
+        collect_stats_ = stats_enabled_.load(std::memory_order_relaxed);
+        int64_t wait_start = collect_stats_ ? NowUs() : 0;
 
-        // 调用 epoll_wait 等待事件触发
-        auto ret = ::epoll_wait(epoll_fd_,
-                                (struct epoll_event*)&epoll_events_[0],
-                                static_cast<int>(epoll_events_.size()),
-                               timeout);
+        // 只处理 Poll 返回的前 ret 项，不需要每轮清零整个事件数组
+        // Only the first ret entries returned by Poll are read, so the array is never cleared.
+        auto ret = WaitEvents();
 
         if(ret >= 0) // 成功返回有事件触发
         {
+            int64_t busy_start = NowUs(); // 从这里到下一次等待之前都算忙碌时间
+            iterations_.store(iterations_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if(collect_stats_)
+            {
+                stats_.RecordPollWait(busy_start - wait_start);
+            }
+            // 先取出之前几轮排队的继续读，分发期间新排进来的留到下一轮
+            // Take the continued reads queued in earlier rounds first; ones queued while dispatching wait.
+            running_reads_.swap(pending_reads_);
             for(int i = 0; i < ret; i++) // 遍历每个触发的事件
             {
                 struct epoll_event &ev = epoll_events_[i];
-                if(ev.data.fd <= 0) // 如果文件描述符无效，跳过
-                {
-                    continue;
-                }
-
-                // 查找当前事件对应的 Event
-                auto iter = events_.find(ev.data.fd);
-                if(iter == events_.end())
-                {
-                    continue;
-                }
 
-                EventPtr &event = iter->second; // 获取事件对象
-
-                // 处理错误事件
-                if(ev.events & EPOLLERR)
-                {
-                    int error = 0;
-                    socklen_t len = sizeof(error);
-                    getsockopt(event->Fd(), SOL_SOCKET, SO_ERROR, &error, &len);
-                    event->OnError(strerror(error)); // 调用错误回调
-                    continue;
-                }
-                
-                // 处理连接关闭事件
-                if((ev.events & EPOLLHUP) && !(ev.events & EPOLLIN))
+                // 从 data.u64 取出槽下标和代数，直接定位事件，不做哈希查找
+                // Slot index and generation come straight out of data.u64; no hash lookup.
+                uint32_t slot = (uint32_t)(ev.data.u64 & 0xffffffff);
+                uint32_t generation = (uint32_t)(ev.data.u64 >> 32);
+                if(slot >= slots_.size()
+                    || slots_[slot].generation != generation
+                    || !slots_[slot].event)
                 {
-                    event->OnClose(); // 调用关闭回调
+                    // 槽已经被释放或复用，是同一批结果里已关闭 fd 的旧事件，丢弃
+                    // The slot was freed or reused: a stale result for an fd closed earlier in this batch.
                     continue;
                 }
 
-                // 处理读事件
-                if(ev.events & (EPOLLIN | EPOLLPRI))
+                // 持有一份引用，回调里 DelEvent 也不会让事件在本次处理中途析构
+                // Hold a reference so a DelEvent from inside a callback cannot destroy the event mid-dispatch.
+                EventPtr event = slots_[slot].event;
+                if(collect_stats_)
                 {
-                    event->OnRead(); // 调用读回调
+                    int64_t cb_start = NowUs();
+                    DispatchEvent(event, ev.events, (int32_t)slot);
+                    stats_.RecordCallback(NowUs() - cb_start);
                 }
-                
-                // 处理写事件
-                if(ev.events & EPOLLOUT)
+                else
                 {
-                    event->OnWrite(); // 调用写回调
+                    DispatchEvent(event, ev.events, (int32_t)slot);
                 }
             }
 
@@ -106,9 +129,58 @@ void EventLoop::Loop()
                 epoll_events_.resize(epoll_events_.size()*2);
             }
 
-            RunFuctions(); // 执行通过 RunInLoop 添加的回调函数
+            // 之前几轮读预算用完的连接继续读，每个连接每轮最多读一个预算：本轮 epoll 已经分发过读的
+            // 不再读，还要继续的留到下一轮；本轮里新排进来的也留到下一轮
+            // Connections that used up their read budget in an earlier round continue, one budget per
+            // round: one epoll already dispatched a read to this round is not read again and stays
+            // queued if it still has more; ones queued during this round wait for the next.
+            if(!running_reads_.empty())
+            {
+                uint64_t round = iterations_.load(std::memory_order_relaxed);
+                for(auto &event : running_reads_)
+                {
+                    // 期间可能已经被删除，或者已经迁移到其他循环，DelEvent 已经清掉了标记
+                    // It may have been deleted meanwhile, or migrated to another loop; DelEvent has
+                    // already cleared its flag.
+                    if(event->loop_ != this || event->slot_ < 0)
+                    {
+                        continue;
+                    }
+                    if(event->read_round_ == round)
+                    {
+                        if(event->read_again_)
+                        {
+                            pending_reads_.emplace_back(std::move(event));
+                        }
+                        else
+                        {
+                            event->read_pending_ = false;
+                        }
+                        continue;
+                    }
+                    event->read_pending_ = false;
+                    event->read_again_ = false;
+                    int64_t cb_start = collect_stats_ ? NowUs() : 0;
+                    event->OnRead();
+                    if(collect_stats_)
+                    {
+                        stats_.RecordCallback(NowUs() - cb_start);
+                    }
+                }
+                running_reads_.clear();
+            }
+
+            RunFunctions(); // 执行通过 RunInLoop 添加的回调函数
+            RunTimers();    // 执行到期的毫秒定时器
             int64_t now = tmms::base::TTime::NowMS();
             wheel_.OnTimer(now); // 定时任务管理
+            timer_event_->ArmAt(timers_.NextDeadline()); // 下一次唤醒时间
+            int64_t busy = NowUs() - busy_start;
+            busy_us_ += busy;
+            if(collect_stats_)
+            {
+                stats_.RecordIteration(busy);
+            }
         }
         else if(ret < 0) // 处理 epoll_wait 错误
         {
@@ -117,54 +189,339 @@ void EventLoop::Loop()
     }
 }
 
+// 按就绪类型调用事件回调：错误、关闭、读、写
+// Calls the event callbacks matching the ready bits: error, close, read, write.
+void EventLoop::DispatchEvent(const EventPtr &event, uint32_t revents, int32_t slot)
+{
+    // 处理错误事件，错误队列里只有通知时由事件自己处理后继续
+    // Error events; when the error queue only holds notifications the event handles them and dispatch goes on.
+    if((revents & EPOLLERR) && event->OnErrorQueue())
+    {
+        if(event->slot_ != slot) // 处理中发现了真正的错误，连接已关闭
+        {
+            return;
+        }
+    }
+    else if(revents & EPOLLERR)
+    {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        getsockopt(event->Fd(), SOL_SOCKET, SO_ERROR, &error, &len);
+        event->OnError(strerror(error)); // 调用错误回调
+        return;
+    }
+    
+    // 处理连接关闭事件
+    if((revents & EPOLLHUP) && !(revents & EPOLLIN))
+    {
+        event->OnClose(); // 调用关闭回调
+        return;
+    }
+
+    // 处理读事件
+    if(revents & (EPOLLIN | EPOLLPRI))
+    {
+        // 记下本轮已经读过，排队的继续读这一轮就跳过
+        // Note the read this round so a queued continued read skips it.
+        event->read_round_ = iterations_.load(std::memory_order_relaxed);
+        event->read_again_ = false;
+        event->OnRead(); // 调用读回调
+    }
+    
+    // 处理写事件，读回调里可能已经把事件删除了，需要重新校验
+    // The read callback may have deleted the event, so check the slot again before writing.
+    if((revents & EPOLLOUT) && event->slot_ == slot)
+    {
+        event->OnWrite(); // 调用写回调
+    }
+}
+
+// 执行到期的毫秒定时器。开启统计时把最近到期时间和当前时间的差记为定时器延迟，
+// 整批定时器回调算作一个回调计时
+// Runs due millisecond timers. With stats on, the gap between the earliest deadline and now is
+// recorded as timer lag, and the whole batch of timer callbacks is timed as one callback.
+void EventLoop::RunTimers()
+{
+    if(!collect_stats_)
+    {
+        timers_.Advance(HashedWheelTimer::NowMs());
+        return;
+    }
+    int64_t start = NowUs();
+    int64_t deadline = timers_.NextDeadline();
+    if(deadline >= 0 && deadline * 1000 <= start)
+    {
+        stats_.RecordTimerLag(start - deadline * 1000);
+        timers_.Advance(start / 1000);
+        stats_.RecordCallback(NowUs() - start);
+    }
+    else
+    {
+        timers_.Advance(start / 1000);
+    }
+}
+
+// 等待就绪事件。有待继续读的连接时不阻塞；开启忙轮询时先用 0 超时转一段时间再睡眠，
+// 转圈窗口按效果自适应：转圈期间接到事件或睡下后很快被唤醒就加倍，否则减半。
+// Waits for ready events. Never blocks while connections are waiting to continue reading. With
+// busy polling enabled it spins on zero-timeout polls before sleeping; the spin window adapts,
+// doubling when spinning catches events or a sleep ends quickly, halving otherwise.
+int EventLoop::WaitEvents()
+{
+    if(!pending_reads_.empty())
+    {
+        return poller_->Poll(0, epoll_events_);
+    }
+    if(busy_poll_us_ <= 0)
+    {
+        return poller_->Poll(-1, epoll_events_); // 不设超时，定时器到期由 timerfd 唤醒
+    }
+
+    int ret = 0;
+    int64_t spin_end = NowUs() + spin_window_us_;
+    do
+    {
+        ret = poller_->Poll(0, epoll_events_);
+    } while(ret == 0 && looping_ && NowUs() < spin_end);
+
+    if(ret != 0)
+    {
+        if(ret > 0)
+        {
+            spin_hits_.store(spin_hits_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            spin_window_us_ = std::min<int64_t>(spin_window_us_ * 2, busy_poll_us_);
+        }
+        return ret;
+    }
+
+    int64_t sleep_start = NowUs();
+    ret = poller_->Poll(-1, epoll_events_);
+    if(ret > 0 && NowUs() - sleep_start < busy_poll_us_)
+    {
+        spin_window_us_ = std::min<int64_t>(spin_window_us_ * 2, busy_poll_us_);
+    }
+    else
+    {
+        spin_window_us_ = std::max<int64_t>(spin_window_us_ / 2, 1);
+    }
+    return ret;
+}
+
+void EventLoop::RearmRead(const EventPtr &event)
+{
+    read_yields_.store(read_yields_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    event->read_again_ = true;
+    // 已经在队列里的不再排一次 (already queued ones are not queued twice)
+    if(!event->read_pending_)
+    {
+        event->read_pending_ = true;
+        pending_reads_.emplace_back(event);
+    }
+}
+
+void EventLoop::SetBusyPoll(int32_t us)
+{
+    RunInLoop([this, us](){
+        busy_poll_us_ = us > 0 ? us : 0;
+        spin_window_us_ = busy_poll_us_;
+    });
+}
+
+int32_t EventLoop::BusyPollUs() const
+{
+    return busy_poll_us_;
+}
+
+uint64_t EventLoop::Iterations() const
+{
+    return iterations_.load(std::memory_order_relaxed);
+}
+
+uint64_t EventLoop::ReadYields() const
+{
+    return read_yields_.load(std::memory_order_relaxed);
+}
+
+uint64_t EventLoop::SpinHits() const
+{
+    return spin_hits_.load(std::memory_order_relaxed);
+}
+
+void EventLoop::EnableStats(bool enable)
+{
+    RunInLoop([this, enable](){
+        if(enable && !stats_enabled_.load(std::memory_order_relaxed))
+        {
+            stats_.Start(Iterations());
+        }
+        stats_enabled_.store(enable, std::memory_order_relaxed);
+    });
+}
+
+bool EventLoop::StatsEnabled() const
+{
+    return stats_enabled_.load(std::memory_order_relaxed);
+}
+
+const LoopStats &EventLoop::Stats() const
+{
+    return stats_;
+}
+
 // 退出事件循环
 // Exits the event loop.
 void EventLoop::Quit()
 {
     looping_ = false; // 设置循环标志为 false，事件循环会退出
+    if(!IsInLoopThread()) // 从其他线程退出时唤醒 epoll_wait，不必等到超时
+    {
+        WakeUp();
+    }
 }
 
 // 添加事件到 epoll 监听中
 // Adds an event to the epoll instance for monitoring.
 void EventLoop::AddEvent(const EventPtr &event)
 {
-    auto iter = events_.find(event->Fd());
-    if(iter != events_.end()) // 如果事件已存在，直接返回
+    if(event->slot_ >= 0) // 如果事件已注册，直接返回
     {
         return;
     }
+
+    // 优先复用空闲槽，没有再扩展槽数组
+    // Reuse a free slot first and grow the slab only when none is left.
+    int32_t slot = 0;
+    if(!free_slots_.empty())
+    {
+        slot = free_slots_.back();
+        free_slots_.pop_back();
+    }
+    else
+    {
+        slot = (int32_t)slots_.size();
+        slots_.emplace_back();
+    }
+    slots_[slot].event = event;
+    event->slot_ = slot;
     event->event_ |= kEventRead; // 默认启用读事件
-    events_[event->Fd()] = event; // 添加到事件映射
 
-    struct epoll_event ev;
-    memset(&ev, 0x00, sizeof(struct epoll_event));
-    ev.events = event->event_; // 设置事件类型
-    ev.data.fd = event->fd_;   // 设置事件关联的文件描述符
-    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, event->fd_, &ev); // 添加到 epoll
+    uint64_t token = MakeToken(slot, slots_[slot].generation); // 槽下标 + 代数
+    if(event->stream_)
+    {
+        poller_->AddStreamFd(event->fd_, event->event_, token);
+    }
+    else
+    {
+        poller_->AddFd(event->fd_, event->event_, token);
+    }
 }
 
 // 删除事件
 // Removes an event from the epoll instance.
 void EventLoop::DelEvent(const EventPtr &event)
 {
-    auto iter = events_.find(event->Fd());
-    if(iter == events_.end()) // 如果事件不存在，直接返回
+    int32_t slot = event->slot_;
+    if(slot < 0 || slot >= (int32_t)slots_.size() || slots_[slot].event != event) // 如果事件不存在，直接返回
     {
         return;
     }
-    events_.erase(iter); // 从事件映射中删除
 
-    struct epoll_event ev;
-    memset(&ev, 0x00, sizeof(struct epoll_event));
-    ev.events = event->event_;
-    ev.data.fd = event->fd_;
-    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, event->fd_, &ev); // 从 epoll 删除
+    poller_->RemoveFd(event->fd_, MakeToken(slot, slots_[slot].generation)); // 从后端删除
+
+    // 代数加一后再放回空闲列表，本批次里指向这个槽的旧结果都会失效
+    // Bump the generation before recycling so older results for this slot no longer match.
+    slots_[slot].event.reset();
+    slots_[slot].generation = (slots_[slot].generation + 1) & kTokenGenerationMask;
+    free_slots_.push_back(slot);
+    event->slot_ = -1;
+
+    // 从继续读队列里拿掉，迁移到别的循环后标记由新循环接管
+    // Drop it from the continued-read queue; after a move the flag belongs to the new loop.
+    if(event->read_pending_)
+    {
+        auto iter = std::find(pending_reads_.begin(), pending_reads_.end(), event);
+        if(iter != pending_reads_.end())
+        {
+            pending_reads_.erase(iter);
+        }
+        event->read_pending_ = false;
+    }
+    event->read_again_ = false;
+}
+
+bool EventLoop::TokenOf(const EventPtr &event, uint64_t *token) const
+{
+    int32_t slot = event->slot_;
+    if(slot < 0 || slot >= (int32_t)slots_.size() || slots_[slot].event != event)
+    {
+        return false;
+    }
+    *token = MakeToken(slot, slots_[slot].generation);
+    return true;
+}
+
+ssize_t EventLoop::RecvQueued(const EventPtr &event, MsgBuffer &buf, size_t max, int *err)
+{
+    uint64_t token = 0;
+    if(!TokenOf(event, &token))
+    {
+        *err = EBADF;
+        return -1;
+    }
+    return poller_->Recv(token, buf, max, err);
+}
+
+void EventLoop::StopRecv(const EventPtr &event)
+{
+    uint64_t token = 0;
+    if(TokenOf(event, &token))
+    {
+        poller_->StopRecv(token);
+    }
+}
+
+bool EventLoop::SubmitWritev(const EventPtr &event, const struct iovec *iov, int count, const std::shared_ptr<void> &owner)
+{
+    uint64_t token = 0;
+    return TokenOf(event, &token) && poller_->SubmitWritev(token, event->fd_, iov, count, owner);
+}
+
+bool EventLoop::TakeWriteResult(const EventPtr &event, ssize_t *result)
+{
+    uint64_t token = 0;
+    return TokenOf(event, &token) && poller_->TakeWriteResult(token, result);
+}
+
+bool EventLoop::SubmitSendmsg(const EventPtr &event, const void *buf, size_t size, const struct sockaddr *addr, socklen_t len)
+{
+    uint64_t token = 0;
+    return TokenOf(event, &token) && poller_->SubmitSendmsg(token, event->fd_, buf, size, addr, len);
+}
+
+bool EventLoop::TakeSendResults(const EventPtr &event, size_t *bytes, int *err, uint32_t *in_flight)
+{
+    uint64_t token = 0;
+    return TokenOf(event, &token) && poller_->TakeSendResults(token, bytes, err, in_flight);
+}
+
+// 把事件当前的监听类型同步到 I/O 后端
+// Pushes the event's current interest set to the I/O backend.
+bool EventLoop::UpdateEvent(const EventPtr &event)
+{
+    int32_t slot = event->slot_;
+    if (slot < 0 || slot >= (int32_t)slots_.size()) // 事件没有注册
+    {
+        NETWORK_ERROR << "cant find event fd:" << event->Fd();
+        return false;
+    }
+
+    // 修改事件监听状态（包含读/写事件标志位）
+    return poller_->ModifyFd(event->fd_, event->event_, MakeToken(slot, slots_[slot].generation));
 }
 
 bool EventLoop::EnableEventWriting(const EventPtr &event, bool enable)
 {
-    auto iter = events_.find(event->Fd()); // 检查事件的文件描述符是否在事件列表中
-    if (iter == events_.end())             // 如果找不到该事件，输出错误并返回 false
+    if (event->slot_ < 0) // 如果事件没有注册，输出错误并返回 false
     {
         NETWORK_ERROR << "cant find event fd:" << event->Fd();
         return false;
@@ -178,22 +535,13 @@ bool EventLoop::EnableEventWriting(const EventPtr &event, bool enable)
     {
         event->event_ &= ~kEventWrite; // 否则清除写事件的标志位
     }
-
-    struct epoll_event ev;
-    memset(&ev, 0x00, sizeof(struct epoll_event)); // 初始化 epoll 事件结构体
-    ev.events = event->event_;  // 设置事件类型（包含读/写事件标志位）
-    ev.data.fd = event->fd_;    // 设置文件描述符
-
-    // 使用 epoll_ctl 修改事件监听状态：EPOLL_CTL_MOD 表示修改事件
-    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, event->fd_, &ev);
-    return true; // 成功返回 true
+    return UpdateEvent(event);
 }
 
 // 启用或禁用事件的读取功能
 bool EventLoop::EnableEventReading(const EventPtr &event, bool enable)
 {
-    auto iter = events_.find(event->Fd()); // 在事件集合中查找对应文件描述符 (fd)
-    if (iter == events_.end()) // 如果未找到，记录错误日志并返回 false
+    if (event->slot_ < 0) // 如果事件没有注册，记录错误日志并返回 false
     {
         NETWORK_ERROR << "cant find event fd:" << event->Fd();
         return false;
@@ -207,15 +555,7 @@ bool EventLoop::EnableEventReading(const EventPtr &event, bool enable)
     {
         event->event_ &= ~kEventRead; // 使用位与和取反操作，移除可读事件标志位
     }
-
-    struct epoll_event ev; // 定义 epoll 事件结构体
-    memset(&ev, 0x00, sizeof(struct epoll_event)); // 将结构体内存清零
-    ev.events = event->event_; // 设置事件的类型 (读/写/错误等)
-    ev.data.fd = event->fd_; // 设置文件描述符
-
-    // 修改 epoll 中对应 fd 的事件状态，EPOLL_CTL_MOD 表示修改操作
-    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, event->fd_, &ev);
-    return true; // 操作成功，返回 true
+    return UpdateEvent(event);
 }
 void EventLoop::AssertInLoopThread()
 {
@@ -238,11 +578,10 @@ void EventLoop::RunInLoop(const Func &f)
     {
         f();
     }
-    else // 如果不是事件循环线程
+    else // 如果不是事件循环线程，拷贝一份投递到队列
     {
-        std::lock_guard<std::mutex> lk(lock_); // 加锁保护任务队列
-        functions_.push(f); // 将任务放入队列中
-        WakeUp(); // 唤醒事件循环，确保任务能被执行
+        Func task(f);
+        QueueInLoop(std::move(task));
     }
 }
 
@@ -255,30 +594,127 @@ void EventLoop::RunInLoop(Func &&f)
     }
     else 
     {
-        std::lock_guard<std::mutex> lk(lock_); // 加锁保护任务队列
-        functions_.push(std::move(f)); // 移动任务到任务队列
-        WakeUp(); // 唤醒事件循环
+        QueueInLoop(std::move(f));
     }
 }
-void EventLoop::RunFunctions()
+
+// 跨线程投递任务：优先放入无锁队列，满了才进入加锁的溢出队列
+// Cross-thread post: the lock-free ring first, the locked overflow list only when it is full.
+void EventLoop::QueueInLoop(Func &&f)
 {
-    std::lock_guard<std::mutex> lk(lock_); // 加锁保护任务队列
-    while (!functions_.empty()) // 当任务队列不为空时，依次执行队列中的任务
+    // 溢出的任务还没执行完时，新任务也进溢出队列，保证同一个生产者的任务顺序
+    // While overflowed tasks have not all run, new tasks follow them, keeping per-producer order.
+    if (has_overflow_.load(std::memory_order_acquire) || !functions_.TryPush(std::move(f)))
     {
-        const Func &f = functions_.front();
-        f();
-        functions_.pop(); // 执行后弹出任务
+        std::lock_guard<std::mutex> lk(overflow_lock_);
+        overflow_functions_.emplace_back(std::move(f));
+        has_overflow_.store(true, std::memory_order_release);
+    }
+    // 记下这批任务中第一个的投递时间，循环取任务时算出排队时间。时间要在下面的 exchange 之前写，
+    // 循环在清除标记时才一定能看到它
+    // Stamp the first task of this batch; the loop derives its queueing time on drain. The stamp
+    // is written before the exchange below, so the loop is sure to see it when it clears the flag.
+    if (stats_enabled_.load(std::memory_order_relaxed) && !wakeup_pending_.load(std::memory_order_acquire))
+    {
+        pending_since_us_.store(NowUs(), std::memory_order_relaxed);
+    }
+    // 只有从“无待处理唤醒”变成“有”的那个生产者才写 eventfd
+    // Only the producer that flips the flag from idle to pending writes the eventfd.
+    if (!wakeup_pending_.exchange(true, std::memory_order_acq_rel))
+    {
+        WakeUp();
     }
 }
-void EventLoop::WakeUp()
+
+// 取出所有待执行任务后在锁外执行，执行期间新投递的任务留到下一轮
+// Takes every pending task and runs them outside any lock; tasks posted meanwhile wait for the next round.
+void EventLoop::RunFunctions()
 {
-    if (!pipe_event_) // 如果 pipe_event_ 未初始化，创建一个用于唤醒事件循环的 PipeEvent
+    // 先清除唤醒标记再取任务，之后投递的任务会重新唤醒
+    // Clear the flag before draining so that later posts trigger a fresh wakeup.
+    if (!wakeup_pending_.exchange(false, std::memory_order_acq_rel))
+    {
+        return;
+    }
+    int64_t pending_since = collect_stats_ ? pending_since_us_.load(std::memory_order_relaxed) : 0;
+
+    // 溢出队列里一个任务之前由同一个生产者放进无锁队列的任务，在取溢出队列时一定已经占了无锁队列的位置。
+    // 所以先取溢出队列，等无锁队列取空（所有占了位置的任务都取走了）再把它们排在后面执行；没取空就留到
+    // 下一轮。取走之后标记不清除，新任务继续进溢出队列，排在这一批之后。
+    // Whatever a producer put in the ring before one of its overflow tasks has claimed its ring
+    // position by the time the overflow list is taken. So the list is taken first and its tasks
+    // run after the ring, once the ring is empty (every claimed position popped); until then they
+    // wait for a later round. The flag stays set after the take, so new tasks keep going to the
+    // overflow list, behind this batch.
+    if (!overflow_held_ && has_overflow_.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lk(overflow_lock_);
+        overflow_taken_.swap(overflow_functions_);
+        overflow_held_ = true;
+    }
+    Func f;
+    size_t max = functions_.Capacity(); // 最多取一圈，避免生产者持续投递时饿死其他事件
+    while (max-- > 0 && functions_.TryPop(f))
+    {
+        running_functions_.emplace_back(std::move(f));
+    }
+    if (overflow_held_ && functions_.SizeApprox() == 0)
+    {
+        for (auto &task : overflow_taken_)
+        {
+            running_functions_.emplace_back(std::move(task));
+        }
+        overflow_taken_.clear();
+        overflow_held_ = false;
+        // 取走之后没有新的溢出任务才回到无锁队列；有的话投递它的生产者已经重新唤醒了循环
+        // Back to the ring only if nothing overflowed since the take; if something did, its
+        // producer has already woken the loop again.
+        std::lock_guard<std::mutex> lk(overflow_lock_);
+        if (overflow_functions_.empty())
+        {
+            has_overflow_.store(false, std::memory_order_release);
+        }
+    }
+    if (functions_.SizeApprox() > 0)
+    {
+        // 本轮没取完，保持唤醒状态让下一轮继续
+        // Ring not fully drained this round; stay awake for the next one.
+        if (collect_stats_ && !wakeup_pending_.load(std::memory_order_acquire))
+        {
+            pending_since_us_.store(NowUs(), std::memory_order_relaxed); // 剩下的任务从现在算起
+        }
+        if (!wakeup_pending_.exchange(true, std::memory_order_acq_rel))
+        {
+            WakeUp();
+        }
+    }
+
+    if (!collect_stats_)
+    {
+        for (auto &task : running_functions_) // 在锁外依次执行
+        {
+            task();
+        }
+        running_functions_.clear();
+        return;
+    }
+
+    int64_t now = NowUs();
+    stats_.RecordWakeup();
+    stats_.RecordTasks(running_functions_.size(), pending_since > 0 ? now - pending_since : -1);
+    for (auto &task : running_functions_)
     {
-        pipe_event_ = std::make_shared<PipeEvent>(this);
-        AddEvent(pipe_event_); // 将 pipe_event_ 添加到事件循环中
+        task();
+        int64_t end = NowUs();
+        stats_.RecordCallback(end - now);
+        now = end;
     }
-    int64_t tmp = 1;
-    pipe_event_->Write((const char*)&tmp, sizeof(tmp)); // 写入数据，触发唤醒
+    running_functions_.clear();
+}
+
+void EventLoop::WakeUp()
+{
+    wakeup_event_->Notify(); // eventfd 计数器加一，触发唤醒
 }
 
 
@@ -296,62 +732,141 @@ void EventLoop::InsertEntry(uint32_t delay, EntryPtr entryPtr)
         });
     }
 }
-// 设定延迟任务（常量引用版本）
-void EventLoop::RunAfter(double delay, const Func &cb)
+// 分配句柄后在循环线程中插入毫秒定时器，interval 为 0 表示只执行一次
+// Allocates a handle and inserts the millisecond timer in the loop thread; interval 0 means one-shot.
+TimerId EventLoop::AddTimer(double delay, double interval, Func &&cb)
 {
-    if (IsInLoopThread()) // 如果是事件循环线程，直接执行
+    TimerId id = next_timer_id_.fetch_add(1, std::memory_order_relaxed);
+    int64_t delay_ms = delay > 0 ? (int64_t)(delay * 1000 + 0.5) : 0;
+    int64_t interval_ms = 0;
+    if (interval > 0)
     {
-        wheel_.RunAfter(delay, cb);
+        interval_ms = (int64_t)(interval * 1000 + 0.5);
+        if (interval_ms < 1)
+        {
+            interval_ms = 1; // 最小间隔 1 毫秒
+        }
+    }
+
+    if (IsInLoopThread()) // 如果是事件循环线程，直接插入
+    {
+        timers_.Add(id, HashedWheelTimer::NowMs() + delay_ms, interval_ms, std::move(cb));
     }
-    else // 否则异步执行任务
+    else // 否则在投递时就确定到期时间，异步插入
     {
-        RunInLoop([this, delay, cb] {
-            wheel_.RunAfter(delay, cb);
+        int64_t when = HashedWheelTimer::NowMs() + delay_ms;
+        RunInLoop([this, id, when, interval_ms, cb] {
+            Func task(cb);
+            timers_.Add(id, when, interval_ms, std::move(task));
         });
     }
+    return id;
+}
+
+// 设定延迟任务（常量引用版本）
+TimerId EventLoop::RunAfter(double delay, const Func &cb)
+{
+    Func task(cb);
+    return AddTimer(delay, 0, std::move(task));
 }
 
 // 设定延迟任务（右值引用版本）
-void EventLoop::RunAfter(double delay, Func &&cb)
+TimerId EventLoop::RunAfter(double delay, Func &&cb)
 {
-    if (IsInLoopThread()) // 如果是事件循环线程，直接执行
-    {
-        wheel_.RunAfter(delay, cb);
-    }
-    else // 否则异步执行任务
-    {
-        RunInLoop([this, delay, cb] {
-            wheel_.RunAfter(delay, cb);
-        });
-    }
+    return AddTimer(delay, 0, std::move(cb));
 }
 
 // 设定周期性任务（常量引用版本）
-void EventLoop::RunEvery(double interval, const Func &cb)
+TimerId EventLoop::RunEvery(double interval, const Func &cb)
+{
+    Func task(cb);
+    return AddTimer(interval, interval, std::move(task));
+}
+
+// 设定周期性任务（右值引用版本）
+TimerId EventLoop::RunEvery(double interval, Func &&cb)
+{
+    return AddTimer(interval, interval, std::move(cb));
+}
+
+// 取消定时器
+void EventLoop::CancelTimer(TimerId id)
 {
-    if (IsInLoopThread()) // 如果是事件循环线程，直接执行
+    if (IsInLoopThread())
     {
-        wheel_.RunEvery(interval, cb);
+        timers_.Cancel(id);
     }
-    else // 否则异步执行任务
+    else
     {
-        RunInLoop([this, interval, cb] {
-            wheel_.RunEvery(interval, cb);
+        RunInLoop([this, id] {
+            timers_.Cancel(id);
         });
     }
 }
 
-// 设定周期性任务（右值引用版本）
-void EventLoop::RunEvery(double interval, Func &&cb)
+void EventLoop::AddConnection(int32_t delta)
+{
+    connections_.fetch_add(delta, std::memory_order_relaxed);
+}
+
+int32_t EventLoop::Connections() const
+{
+    return connections_.load(std::memory_order_relaxed);
+}
+
+uint64_t EventLoop::BytesInPerSec() const
+{
+    return bytes_in_rate_.load(std::memory_order_relaxed);
+}
+
+uint64_t EventLoop::BytesOutPerSec() const
 {
-    if (IsInLoopThread()) // 如果是事件循环线程，直接执行
+    return bytes_out_rate_.load(std::memory_order_relaxed);
+}
+
+size_t EventLoop::QueueDepth() const
+{
+    return functions_.SizeApprox();
+}
+
+uint32_t EventLoop::BusyPermille() const
+{
+    return busy_permille_.load(std::memory_order_relaxed);
+}
+
+// 综合负载分：忙碌千分比为主，每个待执行任务、每个连接、每 1MB/s 收发流量各加 1 分
+// Combined load score: mostly the busy permille, plus one point per queued task, per connection
+// and per MB/s of traffic in either direction.
+uint64_t EventLoop::LoadScore() const
+{
+    uint64_t score = BusyPermille();
+    score += QueueDepth();
+    int32_t conns = Connections();
+    score += conns > 0 ? conns : 0;
+    score += (BytesInPerSec() + BytesOutPerSec()) >> 20;
+    return score;
+}
+
+// 每秒计算一次收发速率和忙碌比例
+void EventLoop::UpdateLoad()
+{
+    int64_t now = NowUs();
+    int64_t elapsed = now - load_ts_;
+    if (elapsed <= 0)
     {
-        wheel_.RunEvery(interval, cb);
+        return;
     }
-    else // 否则异步执行任务
+    bytes_in_rate_.store((bytes_in_ - last_bytes_in_) * 1000000 / elapsed, std::memory_order_relaxed);
+    bytes_out_rate_.store((bytes_out_ - last_bytes_out_) * 1000000 / elapsed, std::memory_order_relaxed);
+    int64_t busy = busy_us_ * 1000 / elapsed;
+    busy_permille_.store(busy > 1000 ? 1000 : (uint32_t)busy, std::memory_order_relaxed);
+
+    last_bytes_in_ = bytes_in_;
+    last_bytes_out_ = bytes_out_;
+    busy_us_ = 0;
+    load_ts_ = now;
+    if (collect_stats_)
     {
-        RunInLoop([this, interval, cb] {
-            wheel_.RunEvery(interval, cb);
-        });
+        stats_.Roll(elapsed, Iterations());
     }
-}
\ No newline at end of file
+}
@@ -3,15 +3,19 @@
 // Prevents this header file from being included multiple times
 
 #include "Event.h"         // 引入事件类的头文件，用于表示事件  
-#include "PipeEvent.h"     // 引入管道事件的头文件，处理线程间通信的唤醒机制  
+#include "EventFdEvent.h"  // 引入 eventfd 事件的头文件，处理线程间通信的唤醒机制  
 #include "TimingWheel.h"   // 引入时间轮定时器的头文件，用于定时任务管理  
+#include "HashedWheelTimer.h" // 毫秒精度的分层时间轮  
+#include "TimerFdEvent.h"  // timerfd 事件，按最近的定时器到期时间唤醒  
+#include "Poller.h"        // I/O 多路复用后端（epoll / io_uring）  
+#include "LoopStats.h"     // 循环延迟和饱和度统计  
 #include <vector>          // 使用 vector 容器  
 #include <sys/epoll.h>     // epoll 系统调用，用于高效 I/O 事件监听  
 #include <memory>          // 智能指针 std::shared_ptr  
-#include <unordered_map>   // 使用哈希表存储事件  
 #include <functional>      // std::function 用于存储回调函数  
-#include <queue>           // 使用队列存储任务  
-#include <mutex>           // 互斥锁，保护共享数据线程安全  
+#include <mutex>           // 互斥锁，保护溢出队列  
+#include <atomic>          // 原子变量，用于合并唤醒  
+#include "base/MpscQueue.h" // 无锁多生产者单消费者任务队列  
 
 namespace tmms  // 声明一个命名空间 `tmms`  
 // Namespace 是一个逻辑分区，用来组织代码，避免命名冲突  
@@ -27,6 +31,10 @@ namespace tmms  // 声明一个命名空间 `tmms`
         // 定义 Func 为无参无返回值的回调函数类型  
         // Func is an alias for a callable function object that takes no arguments and returns void.
 
+        const size_t kMaxPendingFunctions = 8192;  
+        // 无锁任务队列的容量，超出部分进入加锁的溢出队列  
+        // Capacity of the lock-free task ring; anything beyond it goes to the locked overflow list.
+
         // 定义 EventLoop 类，负责事件的监听、处理和调度  
         class EventLoop  
         {
@@ -60,34 +68,178 @@ namespace tmms  // 声明一个命名空间 `tmms`
             // 在时间轮中插入一个延时任务  
             // Adds a delayed task into the timing wheel.
 
-            void RunAfter(double delay, const Func &cb);  
-            void RunAfter(double delay, Func &&cb);  
-            // 在指定延迟后执行回调函数  
-            // Executes a callback function after a specific delay.
-
-            void RunEvery(double interval, const Func &cb);  
-            void RunEvery(double interval, Func &&cb);  
-            // 每隔指定时间间隔重复执行回调函数  
-            // Executes a callback function repeatedly at a fixed interval.
+            uint64_t WheelTick() const
+            {
+                return wheel_.Tick();
+            }
+            bool Looping() const
+            {
+                return looping_;
+            }
+            // 时间轮的当前刻度（秒）和循环是否还在运行，空闲检测用  
+            // Current timing-wheel tick (seconds) and whether the loop still runs; used by idle checks.
+
+            TimerId RunAfter(double delay, const Func &cb);  
+            TimerId RunAfter(double delay, Func &&cb);  
+            // 在指定延迟（秒，可以是小数，精度 1 毫秒）后执行回调函数，返回可取消的句柄  
+            // Runs a callback after a delay in seconds (fractions allowed, 1 ms resolution); returns a cancellable handle.
+
+            TimerId RunEvery(double interval, const Func &cb);  
+            TimerId RunEvery(double interval, Func &&cb);  
+            // 每隔指定时间间隔（秒，精度 1 毫秒）重复执行回调函数  
+            // Runs a callback repeatedly at a fixed interval in seconds (1 ms resolution).
+
+            void CancelTimer(TimerId id);  
+            // 取消 RunAfter/RunEvery 返回的定时器，任意线程都可以调用  
+            // Cancels a timer returned by RunAfter/RunEvery; callable from any thread.
+
+            // 负载统计：连接数、每秒收发字节数、任务队列深度、最近一秒的忙碌比例。
+            // 计数只在循环线程中累加，速率每秒计算一次，其他线程（线程池选择循环时）只读。
+            // Load metrics: connections, bytes/s in and out, task queue depth and the busy ratio of
+            // the last second. Counters are bumped on the loop thread, rates are computed once a
+            // second, and other threads (the pool picking a loop) only read them.
+            void AddConnection(int32_t delta);  
+            void AddBytesIn(size_t bytes)  
+            {
+                bytes_in_ += bytes;
+            }
+            void AddBytesOut(size_t bytes)  
+            {
+                bytes_out_ += bytes;
+            }
+            int32_t Connections() const;  
+            uint64_t BytesInPerSec() const;  
+            uint64_t BytesOutPerSec() const;  
+            size_t QueueDepth() const;  
+            uint32_t BusyPermille() const;  // 忙碌时间千分比 (busy time in permille)  
+            uint64_t LoadScore() const;     // 综合负载分，越小越空闲 (combined load score, lower is idler)  
+
+            void RearmRead(const EventPtr &event);  
+            // 读预算用完但还没读到 EAGAIN 的事件，下一轮循环继续调用它的 OnRead（边缘触发不会再通知）  
+            // Re-queues an event that ran out of read budget before EAGAIN; its OnRead is called again
+            // next iteration, since edge-triggered polling will not report it again.
+
+            // io_uring 数据通路（HasDataPath 为真时）：流式事件的数据由后端的多次触发 recv 收好，
+            // 就绪时用 RecvQueued 取；writev 和 sendmsg 只提交请求，本轮结束等待时一起发出，
+            // 完成后以可写通知，再用 TakeWriteResult/TakeSendResults 取结果。只能在循环线程里调用。
+            // io_uring data path (when HasDataPath is true): a stream event's data is received by the
+            // backend's multishot recv and taken with RecvQueued when ready; writev and sendmsg are
+            // only submitted, going out together with this iteration's wait, and their completion is
+            // reported as writable, with the result taken by TakeWriteResult/TakeSendResults.
+            // Loop thread only.
+            bool HasDataPath() const
+            {
+                return data_path_;
+            }
+            ssize_t RecvQueued(const EventPtr &event, MsgBuffer &buf, size_t max, int *err);
+            void StopRecv(const EventPtr &event);
+            bool SubmitWritev(const EventPtr &event, const struct iovec *iov, int count, const std::shared_ptr<void> &owner);
+            bool TakeWriteResult(const EventPtr &event, ssize_t *result);
+            bool SubmitSendmsg(const EventPtr &event, const void *buf, size_t size, const struct sockaddr *addr, socklen_t len);
+            bool TakeSendResults(const EventPtr &event, size_t *bytes, int *err, uint32_t *in_flight);
+
+            void SetBusyPoll(int32_t us);  
+            int32_t BusyPollUs() const;  
+            // 忙轮询窗口（微秒），0 表示关闭；开启后等待前先用 0 超时轮询，窗口按命中情况自适应  
+            // Busy-poll window in microseconds, 0 disables it. When enabled the loop spins on
+            // zero-timeout polls before sleeping, adapting the window to how often spinning pays off.
+
+            // 公平性计数：循环轮数、读预算用完让出的次数、忙轮询命中次数  
+            // Fairness counters: loop iterations, reads that yielded on budget, busy-poll hits.
+            uint64_t Iterations() const;  
+            uint64_t ReadYields() const;  
+            uint64_t SpinHits() const;  
+
+            void EnableStats(bool enable);  
+            bool StatsEnabled() const;  
+            const LoopStats &Stats() const;  
+            // 延迟和饱和度统计（等待/回调时间分布、单个回调最长时间、任务排队时间、唤醒次数、定时器延迟），
+            // 默认关闭，关闭时每轮只多一次分支判断；统计数据可以在任意线程读取  
+            // Latency and saturation statistics (wait vs callback time, longest callback, task queueing
+            // time, wakeups, timer lag). Off by default, costing one branch per iteration when off;
+            // the numbers can be read from any thread.
 
         private:
-            void RunFuctions();  // 运行队列中的任务函数  
-            void WakeUp();       // 唤醒事件循环，例如通过管道事件  
+            void QueueInLoop(Func &&f); // 跨线程投递任务，只在队列由空变非空时唤醒  
+            void RunFunctions();  // 取出队列中的任务，在锁外执行  
+            void WakeUp();       // 唤醒事件循环，通过 eventfd  
+            bool UpdateEvent(const EventPtr &event); // 把已注册事件的监听类型同步到后端  
+            TimerId AddTimer(double delay, double interval, Func &&cb); // 分配句柄并在循环线程中插入定时器  
+            void UpdateLoad();   // 每秒计算一次收发速率和忙碌比例  
+            int WaitEvents();    // 等待就绪事件，处理待继续读和忙轮询  
+            void DispatchEvent(const EventPtr &event, uint32_t revents, int32_t slot); // 按就绪类型调用事件回调  
+            void RunTimers();    // 执行到期定时器，开启统计时记录定时器延迟  
+            static uint64_t MakeToken(int32_t slot, uint32_t generation)
+            {
+                return ((uint64_t)generation << 32) | (uint32_t)slot;
+            }
+            bool TokenOf(const EventPtr &event, uint64_t *token) const; // 已注册事件的后端 token (the backend token of a registered event)
             
             bool looping_{false};  // 事件循环是否正在运行  
-            int epoll_fd_{-1};     // epoll 文件描述符，用于监听事件  
+            PollerPtr poller_;     // I/O 多路复用后端，epoll 或 io_uring  
+            bool data_path_{false}; // 后端是否提供数据通路 (whether the backend has a data path)
             std::vector<struct epoll_event> epoll_events_;  
             // epoll 返回的事件列表，用于处理就绪事件  
 
-            std::unordered_map<int, EventPtr> events_;  
-            // 哈希表存储事件，key 是文件描述符，value 是事件的智能指针  
-            // A hash map to store events with file descriptor as the key.
-
-            std::queue<Func> functions_;  // 存储需要执行的任务队列  
-            std::mutex lock_;             // 互斥锁，保护任务队列的线程安全  
-
-            PipeEventPtr pipe_event_;     // 管道事件，用于跨线程唤醒事件循环  
-            TimingWheel wheel_;           // 时间轮，用于管理定时任务  
+            // 事件槽：slab 方式存储事件，下标和代数一起放进 epoll_event.data.u64，
+            // 分发时直接按下标取，不需要哈希查找；删除时代数加一，
+            // 同一批 epoll_wait 结果里已关闭（fd 可能已被复用）的旧事件会因为代数不匹配被丢弃。
+            // Event slab: the slot index and its generation travel together in epoll_event.data.u64,
+            // so dispatch indexes straight into the slab with no hash lookup. Deleting an event bumps
+            // the generation, so stale results for a closed (and possibly reused) fd in the same
+            // epoll_wait batch fail the generation check and are dropped.
+            struct EventSlot
+            {
+                EventPtr event;          // 槽中的事件，空表示槽空闲
+                uint32_t generation{0};  // 槽的代数，每次释放加一
+            };
+            std::vector<EventSlot> slots_;      // 事件槽数组
+            std::vector<int32_t> free_slots_;   // 空闲槽下标
+
+            base::MpscQueue<Func> functions_{kMaxPendingFunctions};  
+            // 无锁任务队列，生产者是其他线程，消费者是事件循环线程  
+            // Lock-free task ring: producers are other threads, the consumer is the loop thread.
+
+            std::mutex overflow_lock_;              // 只保护溢出队列，不会在执行任务时持有  
+            std::vector<Func> overflow_functions_;  // 无锁队列满时的溢出队列  
+            std::atomic<bool> has_overflow_{false}; // 溢出队列里的任务还没跑完，新任务也进溢出队列以保持顺序  
+            std::vector<Func> overflow_taken_;      // 从溢出队列取出、等无锁队列取空后执行的任务  
+            bool overflow_held_{false};             // overflow_taken_ 里有一批还没执行（只有循环线程读写）  
+            std::vector<Func> running_functions_;   // 本轮要执行的任务（swap-and-run）  
+
+            std::atomic<bool> wakeup_pending_{false};  
+            // 已经发出唤醒但循环还没开始处理任务，后续投递不再重复写 eventfd  
+            // A wakeup is in flight and not yet consumed; further posts skip the eventfd write.
+
+            EventFdEventPtr wakeup_event_; // eventfd 事件，用于跨线程唤醒事件循环  
+            HashedWheelTimer timers_;        // 毫秒定时器  
+            TimerFdEventPtr timer_event_;    // 按最近到期时间设置的 timerfd  
+            std::atomic<uint64_t> next_timer_id_{1}; // 定时器句柄分配，其他线程也能立即拿到句柄  
+            TimingWheel wheel_;           // 秒级时间轮，用于连接空闲超时等 InsertEntry 任务  
+
+            std::atomic<int32_t> connections_{0};      // 当前连接数  
+            uint64_t bytes_in_{0};                     // 累计收到的字节数，只在循环线程中修改  
+            uint64_t bytes_out_{0};                    // 累计发送的字节数，只在循环线程中修改  
+            uint64_t last_bytes_in_{0};  
+            uint64_t last_bytes_out_{0};  
+            std::atomic<uint64_t> bytes_in_rate_{0};   // 最近一秒收到的字节数  
+            std::atomic<uint64_t> bytes_out_rate_{0};  // 最近一秒发送的字节数  
+            std::atomic<uint32_t> busy_permille_{0};   // 最近一秒的忙碌比例  
+            int64_t busy_us_{0};                       // 本统计周期内处理事件的累计时间  
+            int64_t load_ts_{0};                       // 本统计周期开始时间  
+
+            std::vector<EventPtr> pending_reads_;      // 读预算用完、下一轮继续读的事件  
+            std::vector<EventPtr> running_reads_;      // 本轮正在继续读的事件  
+            int32_t busy_poll_us_{0};                  // 忙轮询窗口上限，0 表示关闭  
+            int64_t spin_window_us_{0};                // 当前自适应的忙轮询窗口  
+            std::atomic<uint64_t> iterations_{0};  
+            std::atomic<uint64_t> read_yields_{0};  
+            std::atomic<uint64_t> spin_hits_{0};  
+
+            LoopStats stats_;                          // 延迟和饱和度统计  
+            std::atomic<bool> stats_enabled_{false};   // 统计开关，其他线程也会读  
+            bool collect_stats_{false};                // 本轮是否统计，每轮开始时从开关读一次  
+            std::atomic<int64_t> pending_since_us_{0}; // 队列由空变非空的时间，用于计算任务排队时间  
         };
     }
 }
@@ -1,7 +1,9 @@
 #include "EventLoopThreadPool.h"   // 包含 EventLoopThreadPool 类的头文件。
 // #include 头文件是为了使用 EventLoopThreadPool 类定义和实现。
 
+#include "network/base/Network.h"  // 网络模块日志宏
 #include <pthread.h>  // 包含 pthread 线程库，用于线程操作和 CPU 绑定。
+#include <random>     // power of two choices 的随机选择
 
 using namespace tmms::network;   // 使用 tmms::network 命名空间，简化代码书写。
 
@@ -68,14 +70,98 @@ std::vector<EventLoop *> EventLoopThreadPool::GetLoops() const
 
 EventLoop *EventLoopThreadPool::GetNextLoop()
 {
-    // **GetNextLoop 方法**: 获取下一个可用的 EventLoop。
-    int index = loop_index_;  // 记录当前的索引。
-    loop_index_++;            // 索引加 1，为下一个调用做准备。
+    // **GetNextLoop 方法**: 按选择策略获取下一个可用的 EventLoop。
+    switch (policy_.load(std::memory_order_relaxed))
+    {
+        case kLoopSelectLeastLoaded:
+            return GetLeastLoadedLoop();
+        case kLoopSelectPowerOfTwo:
+            return GetPowerOfTwoLoop();
+        default:
+            return GetRoundRobinLoop();
+    }
+}
+
+EventLoop *EventLoopThreadPool::GetRoundRobinLoop()
+{
+    // 原子地取得并递增索引，多个线程同时调用也不会拿到同一个位置。
+    // Fetch-and-increment atomically so concurrent callers never share a slot.
+    uint32_t index = loop_index_.fetch_add(1, std::memory_order_relaxed);
 
     // 通过取模运算，循环获取线程池中的线程。
     return threads_[index % threads_.size()]->Loop();
 }
 
+EventLoop *EventLoopThreadPool::GetLeastLoadedLoop()
+{
+    // 遍历所有循环，取负载分最低的；分数相同时从轮询位置开始，避免总是落在第一个。
+    // Scan every loop for the lowest load score; ties start from the round-robin position
+    // so they do not always land on the first loop.
+    size_t size = threads_.size();
+    size_t start = loop_index_.fetch_add(1, std::memory_order_relaxed) % size;
+    EventLoop *best = threads_[start]->Loop();
+    uint64_t best_score = best->LoadScore();
+    for (size_t i = 1; i < size; i++)
+    {
+        EventLoop *loop = threads_[(start + i) % size]->Loop();
+        uint64_t score = loop->LoadScore();
+        if (score < best_score)
+        {
+            best = loop;
+            best_score = score;
+        }
+    }
+    return best;
+}
+
+EventLoop *EventLoopThreadPool::GetPowerOfTwoLoop()
+{
+    // 随机取两个不同的循环，选负载低的：只读两份统计，效果接近全局最低，
+    // 且多个线程同时放置时不会一起挤到同一个“最空闲”的循环上。
+    // Pick two distinct loops at random and keep the less loaded one: only two reads, close to
+    // the global minimum, and concurrent placements do not all pile onto the same idlest loop.
+    size_t size = threads_.size();
+    if (size < 2)
+    {
+        return threads_[0]->Loop();
+    }
+    static thread_local std::minstd_rand rng(std::random_device{}());
+    size_t a = rng() % size;
+    size_t b = rng() % (size - 1);
+    if (b >= a)
+    {
+        b++;
+    }
+    EventLoop *la = threads_[a]->Loop();
+    EventLoop *lb = threads_[b]->Loop();
+    return la->LoadScore() <= lb->LoadScore() ? la : lb;
+}
+
+void EventLoopThreadPool::SetPolicy(LoopSelectPolicy policy)
+{
+    policy_.store(policy, std::memory_order_relaxed);
+}
+
+void EventLoopThreadPool::SetPolicy(const std::string &name)
+{
+    if (name == "least_loaded")
+    {
+        SetPolicy(kLoopSelectLeastLoaded);
+    }
+    else if (name == "p2c" || name == "power_of_two")
+    {
+        SetPolicy(kLoopSelectPowerOfTwo);
+    }
+    else
+    {
+        if (name != "round_robin")
+        {
+            NETWORK_WARN << "unknown loop policy:" << name << ", use round_robin.";
+        }
+        SetPolicy(kLoopSelectRoundRobin);
+    }
+}
+
 size_t EventLoopThreadPool::Size()
 {
     // **Size 方法**：返回线程池中线程的数量。
@@ -18,6 +18,10 @@
 // 引入 vector 容器，用于存储多个 EventLoopThread 对象。
 // Includes the vector container to store multiple EventLoopThread objects.
 
+#include <string>  
+// 引入 string，用于按名字设置选择策略。
+// Includes string for setting the selection policy by name.
+
 #include <atomic>  
 // 引入 atomic 库，用于线程安全的原子操作，主要用于 loop_index_。
 // Includes atomic for thread-safe atomic operations, primarily for loop_index_.
@@ -30,6 +34,13 @@ namespace tmms
         // 定义别名 EventLoopThreadPtr，简化 shared_ptr<EventLoopThread> 的使用。
         // Defines an alias for shared_ptr<EventLoopThread> to simplify its usage.
 
+        enum LoopSelectPolicy
+        {
+            kLoopSelectRoundRobin = 0,   // 轮询 (round robin)
+            kLoopSelectLeastLoaded = 1,  // 负载最低的循环 (the loop with the lowest load score)
+            kLoopSelectPowerOfTwo = 2,   // 随机取两个，选负载低的 (power of two choices)
+        };
+
         class EventLoopThreadPool : public base::NonCopyable  
         // EventLoopThreadPool 类继承 NonCopyable，表示该类不能被拷贝或赋值。
         // The EventLoopThreadPool class inherits from NonCopyable, making it non-copyable.
@@ -55,8 +66,13 @@ namespace tmms
             // Returns pointers to all EventLoop objects in a vector.
 
             EventLoop *GetNextLoop();
-            // 轮询获取下一个 EventLoop 对象指针，确保负载均衡。
-            // Returns the next EventLoop pointer in a round-robin fashion for load balancing.
+            // 按选择策略获取下一个 EventLoop 对象指针，默认轮询。
+            // Returns the next EventLoop according to the selection policy (round robin by default).
+
+            void SetPolicy(LoopSelectPolicy policy);
+            void SetPolicy(const std::string &name);
+            // 设置选择策略，名字可以是 round_robin、least_loaded、p2c。
+            // Sets the selection policy; names are round_robin, least_loaded and p2c.
 
             size_t Size();
             // 返回线程池中线程的数量。
@@ -71,9 +87,17 @@ namespace tmms
             // 线程池中存储所有 EventLoopThread 的智能指针。
             // A vector to store shared pointers to EventLoopThread objects in the thread pool.
 
-            std::atomic_int32_t loop_index_{0};
+            EventLoop *GetRoundRobinLoop();
+            EventLoop *GetLeastLoadedLoop();
+            EventLoop *GetPowerOfTwoLoop();
+
+            std::atomic_uint32_t loop_index_{0};
             // 原子操作变量 loop_index_，用于轮询获取下一个 EventLoop，确保线程安全。
             // Atomic variable loop_index_ to safely retrieve the next EventLoop in a thread-safe way.
+
+            std::atomic_int policy_{kLoopSelectRoundRobin};
+            // 当前的选择策略。
+            // The current selection policy.
         };
     }
 }
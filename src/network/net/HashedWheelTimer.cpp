@@ -0,0 +1,282 @@
+#include "HashedWheelTimer.h"
+#include <ctime>
+#include <utility>
+
+using namespace tmms::network;
+
+namespace
+{
+    const int kLevels = 5;             // 层数 (number of levels)
+    const int kRootBits = 8;           // 第 0 层 256 个槽 (level 0 has 256 slots)
+    const int kLevelBits = 6;          // 其余每层 64 个槽 (every other level has 64 slots)
+    const int64_t kRootSize = 1 << kRootBits;
+    const int64_t kLevelSize = 1 << kLevelBits;
+    const int64_t kRootMask = kRootSize - 1;
+    const int64_t kLevelMask = kLevelSize - 1;
+    const int64_t kMaxDelay = (1LL << (kRootBits + (kLevels - 1) * kLevelBits)) - 1;
+
+    // 第 level 层（>= 1）每个槽覆盖的毫秒数的位数 (log2 of the span of one slot at level >= 1)
+    inline int LevelShift(int level)
+    {
+        return kRootBits + (level - 1) * kLevelBits;
+    }
+    // 第 level 层（>= 1）第 slot 个槽在 buckets_ 中的下标 (Index of a level >= 1 slot in buckets_)
+    inline int32_t LevelBucket(int level, int64_t slot)
+    {
+        return (int32_t)(kRootSize + (level - 1) * kLevelSize + slot);
+    }
+}
+
+HashedWheelTimer::HashedWheelTimer()
+:buckets_(kRootSize + (kLevels - 1) * kLevelSize, -1),current_(NowMs())
+{
+}
+
+int64_t HashedWheelTimer::NowMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 按剩余时间挂到对应层的槽上 (Hangs the node on the slot of the level matching its remaining time)
+void HashedWheelTimer::Link(int32_t index)
+{
+    TimerNode &node = nodes_[index];
+    int64_t expire = node.expire;
+    int64_t delta = expire - current_;
+    int32_t bucket = 0;
+    if(delta < 0)
+    {
+        bucket = (int32_t)(current_ & kRootMask); // 已经过期，下一次推进就执行
+    }
+    else if(delta < kRootSize)
+    {
+        bucket = (int32_t)(expire & kRootMask);
+    }
+    else
+    {
+        if(delta > kMaxDelay)
+        {
+            delta = kMaxDelay;
+            expire = current_ + delta;
+        }
+        int level = 1;
+        while(level < kLevels - 1 && delta >= (1LL << LevelShift(level + 1)))
+        {
+            level++;
+        }
+        bucket = LevelBucket(level, (expire >> LevelShift(level)) & kLevelMask);
+    }
+
+    node.bucket = bucket;
+    node.prev = -1;
+    node.next = buckets_[bucket];
+    if(node.next >= 0)
+    {
+        nodes_[node.next].prev = index;
+    }
+    buckets_[bucket] = index;
+    deadline_dirty_ = true;
+}
+
+void HashedWheelTimer::Unlink(int32_t index)
+{
+    TimerNode &node = nodes_[index];
+    if(node.prev >= 0)
+    {
+        nodes_[node.prev].next = node.next;
+    }
+    else if(node.bucket >= 0)
+    {
+        buckets_[node.bucket] = node.next;
+    }
+    if(node.next >= 0)
+    {
+        nodes_[node.next].prev = node.prev;
+    }
+    node.prev = -1;
+    node.next = -1;
+    node.bucket = -1;
+    deadline_dirty_ = true;
+}
+
+void HashedWheelTimer::Release(int32_t index)
+{
+    TimerNode &node = nodes_[index];
+    ids_.erase(node.id);
+    node.cb = nullptr;
+    node.id = kInvalidTimerId;
+    free_nodes_.push_back(index);
+}
+
+void HashedWheelTimer::Add(TimerId id, int64_t when_ms, int64_t interval_ms, TimerCallback &&cb)
+{
+    int32_t index = 0;
+    if(!free_nodes_.empty())
+    {
+        index = free_nodes_.back();
+        free_nodes_.pop_back();
+    }
+    else
+    {
+        index = (int32_t)nodes_.size();
+        nodes_.emplace_back();
+    }
+    TimerNode &node = nodes_[index];
+    node.cb = std::move(cb);
+    node.id = id;
+    node.expire = when_ms;
+    node.interval = interval_ms;
+    ids_[id] = index;
+    Link(index);
+}
+
+bool HashedWheelTimer::Cancel(TimerId id)
+{
+    if(id == running_id_)
+    {
+        running_cancelled_ = true; // 回调结束后不再重新插入 (not re-armed once the callback returns)
+        return true;
+    }
+    auto iter = ids_.find(id);
+    if(iter == ids_.end())
+    {
+        return false;
+    }
+    int32_t index = iter->second;
+    Unlink(index);
+    Release(index);
+    return true;
+}
+
+// 把第 level 层当前槽的定时器重新挂到更低的层 (Re-hangs the current slot of a level onto lower levels)
+void HashedWheelTimer::Cascade(int level, int64_t tick)
+{
+    int32_t bucket = LevelBucket(level, (tick >> LevelShift(level)) & kLevelMask);
+    int32_t index = buckets_[bucket];
+    buckets_[bucket] = -1;
+    while(index >= 0)
+    {
+        int32_t next = nodes_[index].next;
+        Link(index);
+        index = next;
+    }
+}
+
+void HashedWheelTimer::RunTick(int64_t tick)
+{
+    // 第 0 层转完一圈时从高层降级，和内核一样只有低一层也回到 0 才继续降级更高层
+    // When level 0 wraps, cascade from above; like the kernel, a higher level cascades only
+    // when the level below it wrapped as well.
+    if((tick & kRootMask) == 0)
+    {
+        for(int level = 1; level < kLevels; level++)
+        {
+            Cascade(level, tick);
+            if(((tick >> LevelShift(level)) & kLevelMask) != 0)
+            {
+                break;
+            }
+        }
+    }
+
+    int32_t bucket = (int32_t)(tick & kRootMask);
+    while(buckets_[bucket] >= 0)
+    {
+        int32_t index = buckets_[bucket];
+        Unlink(index);
+        TimerNode &node = nodes_[index];
+        TimerId id = node.id;
+        TimerCallback cb = std::move(node.cb);
+
+        running_id_ = id;
+        running_cancelled_ = false;
+        cb(); // 回调里可能增删定时器，nodes_ 可能扩容，之后重新取引用
+        running_id_ = kInvalidTimerId;
+
+        TimerNode &after = nodes_[index];
+        if(after.interval > 0 && !running_cancelled_)
+        {
+            // 周期定时器按计划时间累加，落后太多时从当前时间重新开始，避免补发一串
+            // Periodic timers advance on schedule; if far behind they restart from now instead of bursting.
+            after.expire += after.interval;
+            if(after.expire <= tick)
+            {
+                after.expire = tick + after.interval;
+            }
+            after.cb = std::move(cb);
+            Link(index);
+        }
+        else
+        {
+            Release(index);
+        }
+    }
+}
+
+void HashedWheelTimer::Advance(int64_t now_ms)
+{
+    while(current_ <= now_ms)
+    {
+        int64_t deadline = NextDeadline();
+        if(deadline < 0 || deadline > now_ms)
+        {
+            // 中间没有任何到期或需要降级的槽，直接跳过
+            // Nothing expires or cascades in between, so skip straight ahead.
+            current_ = now_ms + 1;
+            break;
+        }
+        if(deadline > current_)
+        {
+            current_ = deadline;
+        }
+        RunTick(current_);
+        current_++;
+        deadline_dirty_ = true;
+    }
+}
+
+int64_t HashedWheelTimer::NextDeadline()
+{
+    if(!deadline_dirty_)
+    {
+        return next_deadline_;
+    }
+    deadline_dirty_ = false;
+    next_deadline_ = -1;
+    if(ids_.empty())
+    {
+        return next_deadline_;
+    }
+
+    // 第 0 层的槽就是精确的到期时间 (Level 0 slots are exact expiry times)
+    for(int64_t k = 0; k < kRootSize; k++)
+    {
+        if(buckets_[(current_ + k) & kRootMask] >= 0)
+        {
+            next_deadline_ = current_ + k;
+            break;
+        }
+    }
+    // 高层取最近一个非空槽的降级时间 (Higher levels contribute the cascade time of their nearest non-empty slot)
+    for(int level = 1; level < kLevels; level++)
+    {
+        int shift = LevelShift(level);
+        int64_t start = (current_ + (1LL << shift) - 1) >> shift;
+        for(int64_t m = 0; m < kLevelSize; m++)
+        {
+            int64_t block = start + m;
+            if(buckets_[LevelBucket(level, block & kLevelMask)] >= 0)
+            {
+                int64_t when = block << shift;
+                if(next_deadline_ < 0 || when < next_deadline_)
+                {
+                    next_deadline_ = when;
+                }
+                break;
+            }
+        }
+    }
+    return next_deadline_;
+}
@@ -0,0 +1,81 @@
+#pragma once
+// 防止头文件被重复包含
+// Prevents this header file from being included multiple times.
+
+#include "base/NonCopyable.h"  // 禁止拷贝 (Non-copyable base class)
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace tmms
+{
+    namespace network
+    {
+        using TimerId = uint64_t;            // 定时器句柄，可用于取消 (Timer handle, used to cancel)
+        const TimerId kInvalidTimerId = 0;   // 无效句柄 (Invalid handle)
+
+        // HashedWheelTimer：毫秒精度的分层哈希时间轮（Linux 内核 timer wheel 的做法）
+        // 第 0 层 256 个槽，每槽 1 毫秒；第 1~4 层各 64 个槽，每层粒度是上一层的 64 倍，共覆盖 2^32 毫秒。
+        // 高层槽到期时整体“降级”到低层，插入和取消都是 O(1)。只在所属 EventLoop 线程中使用。
+        // HashedWheelTimer: a millisecond hierarchical hashed wheel (the Linux kernel timer wheel scheme).
+        // Level 0 has 256 one-millisecond slots; levels 1-4 have 64 slots each, every level 64 times
+        // coarser than the one below, covering 2^32 ms in total. Higher slots cascade down as they come
+        // due; insert and cancel are O(1). Only used from the owning EventLoop thread.
+        class HashedWheelTimer : public base::NonCopyable
+        {
+        public:
+            using TimerCallback = std::function<void()>;
+
+            HashedWheelTimer();
+            ~HashedWheelTimer() = default;
+
+            // 在绝对时间 when_ms（单调时钟毫秒）触发；interval_ms > 0 时按该间隔重复
+            // Fires at the absolute monotonic time when_ms; repeats every interval_ms when it is > 0.
+            void Add(TimerId id, int64_t when_ms, int64_t interval_ms, TimerCallback &&cb);
+            // 取消定时器，回调中取消自己也是安全的 (Cancels a timer; safe from inside its own callback)
+            bool Cancel(TimerId id);
+            // 推进到 now_ms，执行所有到期的定时器 (Advances to now_ms, running every due timer)
+            void Advance(int64_t now_ms);
+            // 最近一个需要处理的时间点（到期或降级），没有定时器返回 -1
+            // The next instant needing work (an expiry or a cascade); -1 when no timer is pending.
+            int64_t NextDeadline();
+            size_t Size() const
+            {
+                return ids_.size();
+            }
+
+            // 单调时钟毫秒 (Monotonic clock in milliseconds)
+            static int64_t NowMs();
+
+        private:
+            struct TimerNode
+            {
+                TimerCallback cb;
+                TimerId id{kInvalidTimerId};
+                int64_t expire{0};
+                int64_t interval{0};
+                int32_t prev{-1};
+                int32_t next{-1};
+                int32_t bucket{-1};
+            };
+
+            void Link(int32_t index);
+            void Unlink(int32_t index);
+            void Release(int32_t index);
+            void Cascade(int level, int64_t tick);
+            void RunTick(int64_t tick);
+
+            std::vector<TimerNode> nodes_;        // 定时器节点池 (Timer node pool)
+            std::vector<int32_t> free_nodes_;     // 空闲节点下标 (Free node indices)
+            std::vector<int32_t> buckets_;        // 各层槽的链表头 (List heads of every slot of every level)
+            std::unordered_map<TimerId, int32_t> ids_; // 句柄到节点下标 (Handle to node index)
+            int64_t current_{0};                  // 下一个待处理的毫秒 (Next millisecond to process)
+            int64_t next_deadline_{-1};
+            bool deadline_dirty_{true};
+            TimerId running_id_{kInvalidTimerId}; // 正在执行回调的定时器 (Timer whose callback is running)
+            bool running_cancelled_{false};
+        };
+    }
+}
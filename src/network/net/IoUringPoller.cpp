@@ -0,0 +1,871 @@
+#include "IoUringPoller.h"
+#include "network/base/Network.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <signal.h>
+#include <cstring>
+#include <algorithm>
+#include <errno.h>
+
+using namespace tmms::network;
+
+namespace
+{
+    const uint32_t kRingEntries = 1024;       // 提交队列大小 (submission queue size)
+    const uint32_t kCompletionEntries = 8192; // 完成队列大小，多次触发 poll 每次就绪都占一个 (CQ size; every multishot wakeup takes one)
+    const uint64_t kInternalToken = ~0ULL;    // 修改/删除请求自身的完成事件，直接忽略 (completions of update/remove requests themselves)
+    const uint32_t kRecvBuffers = 256;        // 接收缓冲区个数，2 的幂 (receive buffers, a power of two)
+    const uint32_t kRecvBufferSize = 8192;    // 每个接收缓冲区的大小 (size of each receive buffer)
+    const uint16_t kRecvGroup = 0;            // 接收缓冲区组号 (receive buffer group id)
+
+    // user_data 最高两位是请求类型，poll 和 recv 带 token，写请求带 WriteOp 的地址
+    // The top two bits of user_data are the request kind; poll and recv carry the token, writes the WriteOp address.
+    const int kKindShift = 62;
+    const uint64_t kPayloadMask = (1ULL << kKindShift) - 1;
+    const uint64_t kKindPoll = 0;
+    const uint64_t kKindRecv = 1;
+    const uint64_t kKindWrite = 2;
+
+    uint64_t UserData(uint64_t kind, uint64_t payload)
+    {
+        return (kind << kKindShift) | (payload & kPayloadMask);
+    }
+
+    int IoUringSetup(unsigned entries, struct io_uring_params *p)
+    {
+        return (int)::syscall(__NR_io_uring_setup, entries, p);
+    }
+
+    int IoUringEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, const void *arg, size_t argsz)
+    {
+        return (int)::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+    }
+
+    int IoUringRegister(int fd, unsigned opcode, const void *arg, unsigned nr_args)
+    {
+        return (int)::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+    }
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    // 先关掉环，内核不再引用接收缓冲区和写请求，再释放它们
+    // Close the ring first so the kernel no longer references receive buffers or writes, then free them.
+    if(ring_fd_ >= 0)
+    {
+        ::close(ring_fd_);
+        ring_fd_ = -1;
+    }
+    if(recv_buffers_)
+    {
+        ::munmap(recv_buffers_, recv_buffers_size_);
+    }
+    if(buf_ring_)
+    {
+        ::munmap(buf_ring_, buf_ring_size_);
+    }
+    if(sqes_)
+    {
+        ::munmap(sqes_, sqes_size_);
+    }
+    if(cq_ring_ && cq_ring_ != sq_ring_)
+    {
+        ::munmap(cq_ring_, cq_ring_size_);
+    }
+    if(sq_ring_)
+    {
+        ::munmap(sq_ring_, sq_ring_size_);
+    }
+    if(ring_fd_ >= 0)
+    {
+        ::close(ring_fd_);
+    }
+}
+
+bool IoUringPoller::Init()
+{
+    struct io_uring_params params;
+    memset(&params, 0x00, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = kCompletionEntries;
+    ring_fd_ = IoUringSetup(kRingEntries, &params);
+    if(ring_fd_ < 0)
+    {
+        NETWORK_WARN << "io_uring_setup failed. error:" << errno;
+        return false;
+    }
+
+    // 需要：带超时的等待 (EXT_ARG, 5.11)、CQ 不丢事件 (NODROP)、多次触发 poll (5.13，用同版本的 RSRC_TAGS 判断)
+    // Requires timed waits (EXT_ARG, 5.11), a lossless CQ (NODROP) and multishot poll
+    // (5.13, detected through RSRC_TAGS which landed in the same release).
+    uint32_t required = IORING_FEAT_EXT_ARG | IORING_FEAT_NODROP | IORING_FEAT_RSRC_TAGS;
+    if((params.features & required) != required)
+    {
+        NETWORK_WARN << "io_uring lacks required features:" << params.features;
+        return false;
+    }
+
+    sq_entries_ = params.sq_entries;
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if(single_mmap && cq_ring_size_ > sq_ring_size_)
+    {
+        sq_ring_size_ = cq_ring_size_;
+    }
+
+    void *ptr = ::mmap(nullptr, sq_ring_size_, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if(ptr == MAP_FAILED)
+    {
+        NETWORK_WARN << "io_uring mmap sq ring failed. error:" << errno;
+        return false;
+    }
+    sq_ring_ = ptr;
+    if(single_mmap)
+    {
+        cq_ring_ = sq_ring_;
+    }
+    else
+    {
+        ptr = ::mmap(nullptr, cq_ring_size_, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+        if(ptr == MAP_FAILED)
+        {
+            NETWORK_WARN << "io_uring mmap cq ring failed. error:" << errno;
+            return false;
+        }
+        cq_ring_ = ptr;
+    }
+    sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+    ptr = ::mmap(nullptr, sqes_size_, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if(ptr == MAP_FAILED)
+    {
+        NETWORK_WARN << "io_uring mmap sqes failed. error:" << errno;
+        return false;
+    }
+    sqes_ = (struct io_uring_sqe*)ptr;
+
+    char *sq = (char*)sq_ring_;
+    char *cq = (char*)cq_ring_;
+    sq_head_ = (unsigned*)(sq + params.sq_off.head);
+    sq_ktail_ = (unsigned*)(sq + params.sq_off.tail);
+    sq_mask_ = *(unsigned*)(sq + params.sq_off.ring_mask);
+    sq_array_ = (unsigned*)(sq + params.sq_off.array);
+    cq_head_ = (unsigned*)(cq + params.cq_off.head);
+    cq_tail_ = (unsigned*)(cq + params.cq_off.tail);
+    cq_mask_ = *(unsigned*)(cq + params.cq_off.ring_mask);
+    cqes_ = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    sq_tail_ = *sq_ktail_;
+
+    // 数据通路需要 provided buffer ring (5.19) 和同步取消 (6.0，和多次触发 recv 同一版本)；
+    // 没有时只用 poll，连接照常自己读写
+    // The data path needs a provided buffer ring (5.19) and sync cancel (6.0, the same release as
+    // multishot recv); without them only poll is used and connections read and write themselves.
+    data_path_ = SetupRecvBuffers();
+    if(!data_path_)
+    {
+        NETWORK_WARN << "io_uring data path not supported, poll only.";
+    }
+    return true;
+}
+
+bool IoUringPoller::SetupRecvBuffers()
+{
+    // 取消一个不存在的请求：支持同步取消时返回 ENOENT，不支持时是 EINVAL
+    // Cancel a request that does not exist: ENOENT with sync cancel, EINVAL without it.
+    struct io_uring_sync_cancel_reg cancel;
+    memset(&cancel, 0x00, sizeof(cancel));
+    cancel.addr = UserData(kKindRecv, kPayloadMask);
+    cancel.fd = -1;
+    cancel.timeout.tv_sec = -1;
+    cancel.timeout.tv_nsec = -1;
+    if(IoUringRegister(ring_fd_, IORING_REGISTER_SYNC_CANCEL, &cancel, 1) == 0 || errno != ENOENT)
+    {
+        return false;
+    }
+
+    recv_buffer_count_ = kRecvBuffers;
+    recv_buffer_size_ = kRecvBufferSize;
+    buf_ring_size_ = recv_buffer_count_ * sizeof(struct io_uring_buf);
+    void *ptr = ::mmap(nullptr, buf_ring_size_, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(ptr == MAP_FAILED)
+    {
+        return false;
+    }
+    buf_ring_ = (struct io_uring_buf_ring*)ptr;
+    recv_buffers_size_ = (size_t)recv_buffer_count_ * recv_buffer_size_;
+    ptr = ::mmap(nullptr, recv_buffers_size_, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+    if(ptr == MAP_FAILED)
+    {
+        return false;
+    }
+    recv_buffers_ = (char*)ptr;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0x00, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)buf_ring_;
+    reg.ring_entries = recv_buffer_count_;
+    reg.bgid = kRecvGroup;
+    if(IoUringRegister(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+    {
+        return false;
+    }
+    buf_tail_ = 0;
+    for(uint32_t i = 0; i < recv_buffer_count_; i++)
+    {
+        RecycleBuffer((uint16_t)i);
+    }
+    PublishBuffers();
+    return true;
+}
+
+// 把缓冲区放回环里，PublishBuffers 时才让内核看到 (Puts a buffer back; the kernel sees it after PublishBuffers)
+void IoUringPoller::RecycleBuffer(uint16_t bid)
+{
+    // 不用 buf_ring_->bufs：内核头文件的柔性数组宏在 C++ 下前面多一个空结构体，偏移不是 0
+    // Not buf_ring_->bufs: in C++ the uapi flex-array macro puts an empty struct before it, so its offset is not 0.
+    struct io_uring_buf *buf = (struct io_uring_buf*)buf_ring_ + (buf_tail_ & (recv_buffer_count_ - 1));
+    buf->addr = (uint64_t)(uintptr_t)RecvBuffer(bid);
+    buf->len = recv_buffer_size_;
+    buf->bid = bid;
+    buf_tail_++;
+}
+
+// 公布还回的缓冲区，因为缓冲区用完停下的 recv 重新提交
+// Publishes returned buffers and re-arms recvs that stopped because buffers ran out.
+void IoUringPoller::PublishBuffers()
+{
+    __atomic_store_n(&buf_ring_->tail, buf_tail_, __ATOMIC_RELEASE);
+    if(starved_.empty())
+    {
+        return;
+    }
+    std::vector<uint64_t> starved;
+    starved.swap(starved_);
+    for(auto token : starved)
+    {
+        PollEntry *entry = FindEntry(token);
+        if(entry && entry->stream && !entry->recv_armed && !entry->recv_stopped && !entry->recv_eof)
+        {
+            ArmRecv(*entry);
+        }
+    }
+}
+
+// 取一个空闲的提交项，提交队列满时先把已有的提交给内核
+// Grabs a free SQE, flushing the queue to the kernel first when it is full.
+struct io_uring_sqe *IoUringPoller::GetSqe()
+{
+    unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if(sq_tail_ - head >= sq_entries_)
+    {
+        SubmitPending();
+        head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+        if(sq_tail_ - head >= sq_entries_)
+        {
+            return nullptr;
+        }
+    }
+    unsigned index = sq_tail_ & sq_mask_;
+    struct io_uring_sqe *sqe = &sqes_[index];
+    memset(sqe, 0x00, sizeof(struct io_uring_sqe));
+    sq_array_[index] = index;
+    sq_tail_++;
+    return sqe;
+}
+
+// 只提交，不等待 (Submits without waiting)
+void IoUringPoller::SubmitPending()
+{
+    __atomic_store_n(sq_ktail_, sq_tail_, __ATOMIC_RELEASE);
+    unsigned pending = sq_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if(pending > 0)
+    {
+        IoUringEnter(ring_fd_, pending, 0, 0, nullptr, 0);
+    }
+}
+
+void IoUringPoller::ArmPoll(PollEntry &entry)
+{
+    struct io_uring_sqe *sqe = GetSqe();
+    if(!sqe)
+    {
+        NETWORK_ERROR << "io_uring submission queue full. fd:" << entry.fd;
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = entry.fd;
+    // 流式连接的读由 recv 负责，poll 只管写 (a stream's reads belong to its recv; its poll only watches writes)
+    sqe->poll32_events = entry.stream ? (entry.events & ~(EPOLLIN | EPOLLPRI | EPOLLRDHUP)) : entry.events;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = UserData(kKindPoll, entry.token);
+    entry.poll_armed = true;
+}
+
+void IoUringPoller::DisarmPoll(PollEntry &entry)
+{
+    struct io_uring_sqe *sqe = GetSqe();
+    if(!sqe)
+    {
+        NETWORK_ERROR << "io_uring submission queue full. fd:" << entry.fd;
+        return;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->addr = UserData(kKindPoll, entry.token);
+    sqe->user_data = kInternalToken;
+    entry.poll_armed = false;
+}
+
+// 多次触发 recv，每次收到的数据放进内核从缓冲区环里挑的一个缓冲区
+// A multishot recv; each piece of data lands in a buffer the kernel picks from the ring.
+void IoUringPoller::ArmRecv(PollEntry &entry)
+{
+    struct io_uring_sqe *sqe = GetSqe();
+    if(!sqe)
+    {
+        NETWORK_ERROR << "io_uring submission queue full. fd:" << entry.fd;
+        return;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = entry.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = kRecvGroup;
+    sqe->user_data = UserData(kKindRecv, entry.token);
+    entry.recv_armed = true;
+}
+
+IoUringPoller::PollEntry *IoUringPoller::FindEntry(uint64_t token)
+{
+    uint32_t slot = (uint32_t)(token & 0xffffffff);
+    if(slot >= entries_.size() || !entries_[slot].active || entries_[slot].token != token)
+    {
+        return nullptr;
+    }
+    return &entries_[slot];
+}
+
+int IoUringPoller::Poll(int timeout_ms, std::vector<struct epoll_event> &events)
+{
+    int count = 0;
+    int max = static_cast<int>(events.size());
+    if(!deferred_.empty())
+    {
+        size_t n = std::min(deferred_.size(), (size_t)max);
+        std::copy(deferred_.begin(), deferred_.begin() + n, events.begin());
+        deferred_.erase(deferred_.begin(), deferred_.begin() + n);
+        count = (int)n;
+    }
+
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+    // 提交积累的请求（包括这一轮所有连接的写）并等待完成，已有结果时不阻塞
+    // Submit whatever is queued (every write of this iteration included) and wait for
+    // completions, without blocking if some are already there.
+    __atomic_store_n(sq_ktail_, sq_tail_, __ATOMIC_RELEASE);
+    unsigned pending = sq_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    unsigned min_complete = (head == tail && count == 0) ? 1 : 0;
+    if(pending > 0 || min_complete > 0)
+    {
+        struct __kernel_timespec ts;
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0x00, sizeof(arg));
+        arg.sigmask_sz = _NSIG / 8;
+        arg.ts = timeout_ms >= 0 ? (uint64_t)(uintptr_t)&ts : 0; // 负数表示一直等待
+        int ret = IoUringEnter(ring_fd_, pending, min_complete,
+                               IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+        if(ret < 0 && errno != ETIME && errno != EINTR && errno != EBUSY)
+        {
+            return count > 0 ? count : -1;
+        }
+    }
+    return Reap(events, count, max);
+}
+
+// 把完成队列里的结果转成就绪事件，从 events[count] 开始写，最多写到 max
+// Turns completions into ready events, written from events[count] up to max.
+int IoUringPoller::Reap(std::vector<struct epoll_event> &events, int count, int max)
+{
+    round_++;
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    while(head != tail && count < max)
+    {
+        struct io_uring_cqe *cqe = &cqes_[head & cq_mask_];
+        uint64_t user_data = cqe->user_data;
+        int32_t res = cqe->res;
+        uint32_t flags = cqe->flags;
+        head++;
+
+        if(user_data == kInternalToken)
+        {
+            continue;
+        }
+        uint64_t kind = user_data >> kKindShift;
+        if(kind == kKindWrite)
+        {
+            OnWriteDone((WriteOp*)(uintptr_t)(user_data & kPayloadMask), res, events, count, max);
+            continue;
+        }
+        uint64_t token = user_data & kPayloadMask;
+        PollEntry *entry = FindEntry(token);
+        if(kind == kKindRecv)
+        {
+            OnRecv(entry, res, flags, events, count, max);
+            continue;
+        }
+        if(res < 0)
+        {
+            // 被取消的 poll 是删除/修改留下的，其他错误按 EPOLLERR 上报
+            // Cancelled polls are leftovers of remove/update; other errors are reported as EPOLLERR.
+            if(res != -ECANCELED && res != -ENOENT && entry)
+            {
+                if(!(flags & IORING_CQE_F_MORE))
+                {
+                    entry->poll_armed = false;
+                }
+                Report(events, count, max, *entry, EPOLLERR);
+            }
+            continue;
+        }
+        if(!entry)
+        {
+            continue;
+        }
+        uint32_t ready = (uint32_t)res;
+        if(entry->stream)
+        {
+            // 对端关闭由 recv 的 0 上报，排在已经收到的数据后面
+            // The peer's close comes from recv returning 0, after the data already received.
+            ready &= ~(EPOLLIN | EPOLLPRI | EPOLLRDHUP | EPOLLHUP);
+        }
+        if(ready)
+        {
+            Report(events, count, max, *entry, ready);
+        }
+        if(!(flags & IORING_CQE_F_MORE) && entry->poll_armed)
+        {
+            // 内核结束了这次多次触发 poll（例如完成队列溢出），重新提交
+            // The kernel ended this multishot poll (e.g. CQ overflow); arm it again.
+            entry->poll_armed = false;
+            ArmPoll(*entry);
+        }
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    return count;
+}
+
+// 同一个 fd 在一批结果里只占一项，后来的就绪位合并进去
+// One fd takes one entry per batch; later ready bits are merged into it.
+void IoUringPoller::Report(std::vector<struct epoll_event> &events, int &count, int max, PollEntry &entry, uint32_t bits)
+{
+    if(entry.report_round == round_ && entry.report_index >= 0 && entry.report_index < count
+        && events[entry.report_index].data.u64 == entry.token)
+    {
+        events[entry.report_index].events |= bits;
+        return;
+    }
+    if(count >= max)
+    {
+        return;
+    }
+    events[count].events = bits;
+    events[count].data.u64 = entry.token;
+    entry.report_round = round_;
+    entry.report_index = count;
+    count++;
+}
+
+void IoUringPoller::OnRecv(PollEntry *entry, int32_t res, uint32_t flags, std::vector<struct epoll_event> &events, int &count, int max)
+{
+    bool more = flags & IORING_CQE_F_MORE;
+    if(!entry || !entry->stream)
+    {
+        // fd 已经删除，数据没人要了，缓冲区直接还回去 (the fd is gone; nobody wants the data, so return the buffer)
+        if(flags & IORING_CQE_F_BUFFER)
+        {
+            RecycleBuffer((uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT));
+            PublishBuffers();
+        }
+        return;
+    }
+    if(!more)
+    {
+        entry->recv_armed = false;
+    }
+    if(res > 0 && (flags & IORING_CQE_F_BUFFER))
+    {
+        RecvChunk chunk;
+        chunk.bid = (uint16_t)(flags >> IORING_CQE_BUFFER_SHIFT);
+        chunk.len = (uint32_t)res;
+        entry->chunks.push_back(chunk);
+        Report(events, count, max, *entry, EPOLLIN);
+        if(!more && !entry->recv_stopped)
+        {
+            ArmRecv(*entry);
+        }
+    }
+    else if(res == 0)
+    {
+        entry->recv_eof = true;
+        Report(events, count, max, *entry, EPOLLIN);
+    }
+    else if(res == -ENOBUFS)
+    {
+        // 缓冲区都在连接手里，还回来后再收 (all buffers are held by connections; resume once some come back)
+        if(!more)
+        {
+            starved_.push_back(entry->token);
+        }
+    }
+    else if(res < 0 && res != -ECANCELED)
+    {
+        entry->recv_error = -res;
+        Report(events, count, max, *entry, EPOLLIN);
+    }
+}
+
+void IoUringPoller::OnWriteDone(WriteOp *op, int32_t res, std::vector<struct epoll_event> &events, int &count, int max)
+{
+    PollEntry *entry = FindEntry(op->token);
+    if(entry)
+    {
+        if(op->datagram)
+        {
+            entry->sends--;
+            if(res >= 0)
+            {
+                entry->sent_bytes += res;
+            }
+            else
+            {
+                entry->send_error = -res;
+            }
+        }
+        else
+        {
+            entry->write_done = true;
+            entry->write_result = res;
+        }
+        Report(events, count, max, *entry, EPOLLOUT);
+    }
+    FreeOp(op);
+}
+
+bool IoUringPoller::AddFd(int fd, uint32_t events, uint64_t token)
+{
+    uint32_t slot = (uint32_t)(token & 0xffffffff);
+    if(slot >= entries_.size())
+    {
+        entries_.resize(slot + 1);
+    }
+    PollEntry &entry = entries_[slot];
+    entry = PollEntry();
+    entry.fd = fd;
+    entry.events = events;
+    entry.token = token;
+    entry.active = true;
+    ArmPoll(entry);
+    return true;
+}
+
+bool IoUringPoller::AddStreamFd(int fd, uint32_t events, uint64_t token)
+{
+    if(!data_path_)
+    {
+        return AddFd(fd, events, token);
+    }
+    uint32_t slot = (uint32_t)(token & 0xffffffff);
+    if(slot >= entries_.size())
+    {
+        entries_.resize(slot + 1);
+    }
+    PollEntry &entry = entries_[slot];
+    entry = PollEntry();
+    entry.fd = fd;
+    entry.events = events;
+    entry.token = token;
+    entry.active = true;
+    entry.stream = true;
+    // 注册时已经在套接字里的数据 recv 也会收到 (recv also picks up data already in the socket)
+    ArmRecv(entry);
+    if(events & EPOLLOUT)
+    {
+        ArmPoll(entry);
+    }
+    return true;
+}
+
+bool IoUringPoller::ModifyFd(int fd, uint32_t events, uint64_t token)
+{
+    PollEntry *entry = FindEntry(token);
+    if(!entry)
+    {
+        return false;
+    }
+    if(entry->events == events)
+    {
+        return true;
+    }
+    entry->events = events;
+
+    if(entry->stream)
+    {
+        // 流式连接只在要写可写通知时挂 poll (a stream only keeps a poll while it wants write readiness)
+        if((events & EPOLLOUT) && !entry->poll_armed)
+        {
+            ArmPoll(*entry);
+        }
+        else if(!(events & EPOLLOUT) && entry->poll_armed)
+        {
+            DisarmPoll(*entry);
+        }
+        return true;
+    }
+
+    // 原地更新已提交 poll 的监听类型，不用删除再添加
+    // Update the armed poll's mask in place instead of removing and re-adding it.
+    struct io_uring_sqe *sqe = GetSqe();
+    if(!sqe)
+    {
+        NETWORK_ERROR << "io_uring submission queue full. fd:" << fd;
+        return false;
+    }
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->addr = UserData(kKindPoll, token);
+    sqe->len = IORING_POLL_UPDATE_EVENTS | IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = events;
+    sqe->user_data = kInternalToken;
+    return true;
+}
+
+bool IoUringPoller::RemoveFd(int fd, uint64_t token)
+{
+    PollEntry *entry = FindEntry(token);
+    if(!entry)
+    {
+        return false;
+    }
+    entry->active = false;
+    if(entry->poll_armed)
+    {
+        DisarmPoll(*entry);
+    }
+    if(entry->recv_armed)
+    {
+        struct io_uring_sqe *sqe = GetSqe();
+        if(sqe)
+        {
+            sqe->opcode = IORING_OP_ASYNC_CANCEL;
+            sqe->addr = UserData(kKindRecv, token);
+            sqe->user_data = kInternalToken;
+        }
+        entry->recv_armed = false;
+    }
+    // 没取走的数据随连接一起丢掉 (data not taken goes away with the connection)
+    if(!entry->chunks.empty())
+    {
+        for(auto &c : entry->chunks)
+        {
+            RecycleBuffer(c.bid);
+        }
+        entry->chunks.clear();
+        PublishBuffers();
+    }
+    return true;
+}
+
+ssize_t IoUringPoller::Recv(uint64_t token, MsgBuffer &buf, size_t max, int *err)
+{
+    PollEntry *entry = FindEntry(token);
+    if(!entry || !entry->stream)
+    {
+        *err = EBADF;
+        return -1;
+    }
+    size_t total = 0;
+    bool recycled = false;
+    while(!entry->chunks.empty() && total < max)
+    {
+        RecvChunk &c = entry->chunks.front();
+        size_t n = std::min<size_t>(c.len - c.offset, max - total);
+        buf.Append(RecvBuffer(c.bid) + c.offset, n);
+        c.offset += n;
+        total += n;
+        if(c.offset == c.len)
+        {
+            RecycleBuffer(c.bid);
+            entry->chunks.pop_front();
+            recycled = true;
+        }
+    }
+    if(recycled)
+    {
+        PublishBuffers();
+    }
+    if(total > 0)
+    {
+        return total;
+    }
+    if(entry->recv_error)
+    {
+        *err = entry->recv_error;
+        return -1;
+    }
+    if(entry->recv_eof)
+    {
+        return 0;
+    }
+    *err = EAGAIN;
+    return -1;
+}
+
+void IoUringPoller::StopRecv(uint64_t token)
+{
+    PollEntry *entry = FindEntry(token);
+    if(!entry || !entry->stream)
+    {
+        return;
+    }
+    entry->recv_stopped = true;
+    if(!entry->recv_armed)
+    {
+        return;
+    }
+    // recv 可能还在提交队列里，先提交；同步取消返回时它的结果都已经进了完成队列，
+    // 这时把完成队列收完，这个连接的数据留在它的 chunks 里，其他结果留到下一次 Poll
+    // The recv may still sit in the submission queue, so submit first. Once the sync cancel
+    // returns, all its results are in the completion queue; reap it now, leaving this connection's
+    // data in its chunks and every other result for the next Poll.
+    SubmitPending();
+    struct io_uring_sync_cancel_reg cancel;
+    memset(&cancel, 0x00, sizeof(cancel));
+    cancel.addr = UserData(kKindRecv, token);
+    cancel.fd = -1;
+    cancel.timeout.tv_sec = -1;
+    cancel.timeout.tv_nsec = -1;
+    IoUringRegister(ring_fd_, IORING_REGISTER_SYNC_CANCEL, &cancel, 1);
+    IoUringEnter(ring_fd_, 0, 0, IORING_ENTER_GETEVENTS, nullptr, 0); // 把溢出的结果刷进完成队列 (flush overflowed completions)
+    entry->recv_armed = false;
+
+    std::vector<struct epoll_event> reaped(kCompletionEntries);
+    int n = 0;
+    do
+    {
+        n = Reap(reaped, 0, (int)reaped.size());
+        deferred_.insert(deferred_.end(), reaped.begin(), reaped.begin() + n);
+    } while(n == (int)reaped.size());
+}
+
+bool IoUringPoller::SubmitWritev(uint64_t token, int fd, const struct iovec *iov, int count, const std::shared_ptr<void> &owner)
+{
+    if(!data_path_ || !FindEntry(token))
+    {
+        return false;
+    }
+    struct io_uring_sqe *sqe = GetSqe();
+    if(!sqe)
+    {
+        return false;
+    }
+    WriteOp *op = NewOp();
+    op->token = token;
+    op->owner = owner;
+    op->iov.assign(iov, iov + count);
+    sqe->opcode = IORING_OP_WRITEV;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)op->iov.data();
+    sqe->len = count;
+    sqe->off = 0;
+    sqe->user_data = UserData(kKindWrite, (uint64_t)(uintptr_t)op);
+    return true;
+}
+
+bool IoUringPoller::TakeWriteResult(uint64_t token, ssize_t *result)
+{
+    PollEntry *entry = FindEntry(token);
+    if(!entry || !entry->write_done)
+    {
+        return false;
+    }
+    entry->write_done = false;
+    *result = entry->write_result;
+    return true;
+}
+
+bool IoUringPoller::SubmitSendmsg(uint64_t token, int fd, const void *buf, size_t size, const struct sockaddr *addr, socklen_t len)
+{
+    PollEntry *entry = FindEntry(token);
+    if(!data_path_ || !entry || len > sizeof(struct sockaddr_in6))
+    {
+        return false;
+    }
+    struct io_uring_sqe *sqe = GetSqe();
+    if(!sqe)
+    {
+        return false;
+    }
+    WriteOp *op = NewOp();
+    op->token = token;
+    op->datagram = true;
+    op->data.assign((const char*)buf, size);
+    op->iov.resize(1);
+    op->iov[0].iov_base = &op->data[0];
+    op->iov[0].iov_len = size;
+    memset(&op->msg, 0x00, sizeof(op->msg));
+    if(addr)
+    {
+        memcpy(&op->addr, addr, len);
+        op->msg.msg_name = &op->addr;
+        op->msg.msg_namelen = len;
+    }
+    op->msg.msg_iov = op->iov.data();
+    op->msg.msg_iovlen = 1;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)&op->msg;
+    sqe->len = 1;
+    sqe->user_data = UserData(kKindWrite, (uint64_t)(uintptr_t)op);
+    entry->sends++;
+    return true;
+}
+
+bool IoUringPoller::TakeSendResults(uint64_t token, size_t *bytes, int *err, uint32_t *in_flight)
+{
+    PollEntry *entry = FindEntry(token);
+    if(!entry)
+    {
+        return false;
+    }
+    *bytes = entry->sent_bytes;
+    *err = entry->send_error;
+    *in_flight = entry->sends;
+    entry->sent_bytes = 0;
+    entry->send_error = 0;
+    return true;
+}
+
+// 写请求对象复用，稳定状态下提交写不分配内存 (WriteOps are reused, so steady-state writes allocate nothing)
+IoUringPoller::WriteOp *IoUringPoller::NewOp()
+{
+    if(free_ops_.empty())
+    {
+        ops_.emplace_back(new WriteOp());
+        return ops_.back().get();
+    }
+    WriteOp *op = free_ops_.back();
+    free_ops_.pop_back();
+    return op;
+}
+
+void IoUringPoller::FreeOp(WriteOp *op)
+{
+    op->owner.reset();
+    op->datagram = false;
+    op->iov.clear();
+    op->data.clear();
+    free_ops_.push_back(op);
+}
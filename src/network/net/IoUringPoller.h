@@ -0,0 +1,155 @@
+#pragma once
+// 防止头文件被重复包含
+// Prevents this header file from being included multiple times.
+
+#include "Poller.h"
+#include <linux/io_uring.h>  // io_uring 结构体和常量 (io_uring structures and constants)
+#include <netinet/in.h>
+#include <deque>
+
+namespace tmms
+{
+    namespace network
+    {
+        // IoUringPoller：基于 io_uring 的后端，直接使用系统调用，不依赖 liburing
+        // 每个 fd 只提交一次 POLL_ADD(IORING_POLL_ADD_MULTI)，之后每次就绪都产生一个 CQE；
+        // 添加、修改、删除都只是写进提交队列，和等待合并在同一次 io_uring_enter 里提交。
+        // 内核支持时（6.0 起：provided buffer ring、多次触发 recv、同步取消）还提供数据通路：
+        // 流式连接用一个多次触发 recv 收数据，数据直接落进注册的接收缓冲区环，一次等待就带回所有连接
+        // 收到的数据，不再每个连接一次 readv；writev 和数据报的 sendmsg 也只写进提交队列，
+        // 一轮里所有连接的写在下一次 io_uring_enter 里一起提交。
+        // IoUringPoller: an io_uring backend on raw syscalls (no liburing).
+        // Each fd is armed once with POLL_ADD(IORING_POLL_ADD_MULTI) and every readiness change then
+        // posts a CQE. Add/modify/remove only queue SQEs, which are submitted by the same
+        // io_uring_enter call that waits for completions.
+        // When the kernel has it (6.0 on: provided buffer rings, multishot recv, sync cancel) there
+        // is also a data path: stream connections receive through one multishot recv whose data lands
+        // in a registered ring of receive buffers, so one wait brings back what every connection
+        // received instead of a readv per connection; writev and datagram sendmsg are only queued as
+        // SQEs too, and every write of an iteration goes out with the next io_uring_enter.
+        class IoUringPoller : public Poller
+        {
+        public:
+            IoUringPoller() = default;
+            ~IoUringPoller();
+
+            bool Init() override;
+            int Poll(int timeout_ms, std::vector<struct epoll_event> &events) override;
+            bool AddFd(int fd, uint32_t events, uint64_t token) override;
+            bool ModifyFd(int fd, uint32_t events, uint64_t token) override;
+            bool RemoveFd(int fd, uint64_t token) override;
+            const char *Name() const override
+            {
+                return "io_uring";
+            }
+
+            bool HasDataPath() const override
+            {
+                return data_path_;
+            }
+            bool AddStreamFd(int fd, uint32_t events, uint64_t token) override;
+            ssize_t Recv(uint64_t token, MsgBuffer &buf, size_t max, int *err) override;
+            void StopRecv(uint64_t token) override;
+            bool SubmitWritev(uint64_t token, int fd, const struct iovec *iov, int count, const std::shared_ptr<void> &owner) override;
+            bool TakeWriteResult(uint64_t token, ssize_t *result) override;
+            bool SubmitSendmsg(uint64_t token, int fd, const void *buf, size_t size, const struct sockaddr *addr, socklen_t len) override;
+            bool TakeSendResults(uint64_t token, size_t *bytes, int *err, uint32_t *in_flight) override;
+
+        private:
+            // recv 收到、还没被连接取走的一段 (A piece received and not yet taken by the connection)
+            struct RecvChunk
+            {
+                uint16_t bid{0};
+                uint32_t offset{0};
+                uint32_t len{0};
+            };
+            // 已注册 fd 的信息，按 token 低 32 位（事件槽下标）存放，用于多次触发请求被内核终止后重新提交
+            // Per-fd state indexed by the token's slot bits, used to re-arm a multishot request the kernel ended.
+            struct PollEntry
+            {
+                int fd{-1};
+                uint32_t events{0};
+                uint64_t token{0};
+                bool active{false};
+                bool stream{false};       // 由多次触发 recv 收数据 (received through a multishot recv)
+                bool poll_armed{false};
+                bool recv_armed{false};
+                bool recv_stopped{false};
+                bool recv_eof{false};
+                int recv_error{0};
+                std::deque<RecvChunk> chunks;
+                bool write_done{false};   // 有一个 writev 结果等着取 (a writev result is waiting)
+                ssize_t write_result{0};
+                uint32_t sends{0};        // 还没完成的数据报 (datagrams in flight)
+                size_t sent_bytes{0};
+                int send_error{0};
+                uint64_t report_round{0}; // 本批结果里已经上报过的位置，同一 fd 合并成一项 (merges reports of one fd in a batch)
+                int report_index{-1};
+            };
+            // 提交出去的 writev/sendmsg，完成前 iovec、数据和地址都在这里 (A writev/sendmsg in flight and everything it points at)
+            struct WriteOp
+            {
+                uint64_t token{0};
+                bool datagram{false};
+                std::shared_ptr<void> owner;
+                std::vector<struct iovec> iov;
+                std::string data;
+                struct sockaddr_in6 addr;
+                struct msghdr msg;
+            };
+
+            struct io_uring_sqe *GetSqe();
+            void ArmPoll(PollEntry &entry);
+            void DisarmPoll(PollEntry &entry);
+            void ArmRecv(PollEntry &entry);
+            void SubmitPending();
+            PollEntry *FindEntry(uint64_t token);
+            bool SetupRecvBuffers();
+            char *RecvBuffer(uint16_t bid)
+            {
+                return recv_buffers_ + (size_t)bid * recv_buffer_size_;
+            }
+            void RecycleBuffer(uint16_t bid);
+            void PublishBuffers();
+            int Reap(std::vector<struct epoll_event> &events, int count, int max);
+            void Report(std::vector<struct epoll_event> &events, int &count, int max, PollEntry &entry, uint32_t bits);
+            void OnRecv(PollEntry *entry, int32_t res, uint32_t flags, std::vector<struct epoll_event> &events, int &count, int max);
+            void OnWriteDone(WriteOp *op, int32_t res, std::vector<struct epoll_event> &events, int &count, int max);
+            WriteOp *NewOp();
+            void FreeOp(WriteOp *op);
+
+            int ring_fd_{-1};
+            uint32_t sq_entries_{0};
+            uint32_t sq_mask_{0};
+            uint32_t cq_mask_{0};
+            uint32_t sq_tail_{0};        // 本地提交队列尾，提交时才写回内核 (local SQ tail, published on submit)
+            void *sq_ring_{nullptr};
+            void *cq_ring_{nullptr};
+            size_t sq_ring_size_{0};
+            size_t cq_ring_size_{0};
+            struct io_uring_sqe *sqes_{nullptr};
+            size_t sqes_size_{0};
+            unsigned *sq_head_{nullptr};
+            unsigned *sq_ktail_{nullptr};
+            unsigned *sq_array_{nullptr};
+            unsigned *cq_head_{nullptr};
+            unsigned *cq_tail_{nullptr};
+            struct io_uring_cqe *cqes_{nullptr};
+            std::vector<PollEntry> entries_;
+            uint64_t round_{0};          // 每收一批结果加一 (bumped for every batch of results)
+            std::vector<struct epoll_event> deferred_; // 同步取消时顺带收下的结果，下一次 Poll 先返回 (results reaped during a sync cancel)
+
+            bool data_path_{false};
+            struct io_uring_buf_ring *buf_ring_{nullptr};
+            size_t buf_ring_size_{0};
+            char *recv_buffers_{nullptr};
+            size_t recv_buffers_size_{0};
+            uint32_t recv_buffer_count_{0};
+            uint32_t recv_buffer_size_{0};
+            uint16_t buf_tail_{0};       // 本地接收缓冲区环尾，PublishBuffers 时写回 (local buffer ring tail)
+            std::vector<uint64_t> starved_; // 接收缓冲区用完而停下的 recv，还回缓冲区后重新提交 (recvs stopped for lack of buffers)
+            std::vector<std::unique_ptr<WriteOp>> ops_;
+            std::vector<WriteOp*> free_ops_;
+        };
+    }
+}
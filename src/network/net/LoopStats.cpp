@@ -0,0 +1,203 @@
+#include "LoopStats.h"
+
+using namespace tmms::network;
+
+namespace
+{
+    // 单写者计数：循环线程独占写，用 load + store 代替原子读改写
+    // Single-writer update: the loop thread owns the counter, so load + store replaces an atomic RMW.
+    inline void AddRelaxed(std::atomic<uint64_t> &counter, uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    inline int BucketIndex(uint64_t value)
+    {
+        if(value == 0)
+        {
+            return 0;
+        }
+        int index = 64 - __builtin_clzll(value);
+        return index < Log2Histogram::kBuckets ? index : Log2Histogram::kBuckets - 1;
+    }
+}
+
+Log2Histogram::Log2Histogram()
+{
+    for(int i = 0; i < kBuckets; i++)
+    {
+        buckets_[i].store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+}
+
+void Log2Histogram::Record(uint64_t value)
+{
+    AddRelaxed(buckets_[BucketIndex(value)], 1);
+    AddRelaxed(count_, 1);
+    AddRelaxed(sum_, value);
+    if(value > max_.load(std::memory_order_relaxed))
+    {
+        max_.store(value, std::memory_order_relaxed);
+    }
+}
+
+uint64_t Log2Histogram::Count() const
+{
+    return count_.load(std::memory_order_relaxed);
+}
+
+uint64_t Log2Histogram::Sum() const
+{
+    return sum_.load(std::memory_order_relaxed);
+}
+
+uint64_t Log2Histogram::Max() const
+{
+    return max_.load(std::memory_order_relaxed);
+}
+
+uint64_t Log2Histogram::Bucket(int index) const
+{
+    if(index < 0 || index >= kBuckets)
+    {
+        return 0;
+    }
+    return buckets_[index].load(std::memory_order_relaxed);
+}
+
+uint64_t Log2Histogram::BucketLimit(int index)
+{
+    return index <= 0 ? 0 : (1ULL << index) - 1;
+}
+
+uint64_t Log2Histogram::Percentile(double p) const
+{
+    uint64_t count = Count();
+    if(count == 0)
+    {
+        return 0;
+    }
+    uint64_t target = (uint64_t)(p * count);
+    if(target >= count)
+    {
+        target = count - 1;
+    }
+    uint64_t seen = 0;
+    for(int i = 0; i < kBuckets; i++)
+    {
+        seen += Bucket(i);
+        if(seen > target)
+        {
+            // 桶上界可能超过实际最大值，取两者较小的 (The bucket bound may exceed the real max)
+            uint64_t limit = BucketLimit(i);
+            uint64_t max = Max();
+            return limit < max ? limit : max;
+        }
+    }
+    return Max();
+}
+
+void LoopStats::RecordPollWait(int64_t us)
+{
+    poll_wait_.Record(us > 0 ? us : 0);
+}
+
+void LoopStats::RecordIteration(int64_t callback_us)
+{
+    iteration_callbacks_.Record(callback_us > 0 ? callback_us : 0);
+}
+
+void LoopStats::RecordCallback(int64_t us)
+{
+    if(us < 0)
+    {
+        us = 0;
+    }
+    callback_.Record(us);
+    if(us > window_callback_max_)
+    {
+        window_callback_max_ = us;
+    }
+}
+
+void LoopStats::RecordTasks(size_t count, int64_t oldest_age_us)
+{
+    task_batch_.Record(count);
+    if(oldest_age_us >= 0)
+    {
+        task_age_.Record(oldest_age_us);
+        if(oldest_age_us > window_task_age_max_)
+        {
+            window_task_age_max_ = oldest_age_us;
+        }
+    }
+}
+
+void LoopStats::RecordTimerLag(int64_t us)
+{
+    if(us < 0)
+    {
+        us = 0;
+    }
+    timer_lag_.Record(us);
+    if(us > window_timer_lag_max_)
+    {
+        window_timer_lag_max_ = us;
+    }
+}
+
+void LoopStats::Start(uint64_t iterations)
+{
+    last_iterations_ = iterations;
+    last_wakeups_ = wakeups_;
+    window_callback_max_ = 0;
+    window_task_age_max_ = 0;
+    window_timer_lag_max_ = 0;
+}
+
+void LoopStats::Roll(int64_t elapsed_us, uint64_t iterations)
+{
+    if(elapsed_us <= 0)
+    {
+        return;
+    }
+    iterations_per_sec_.store((iterations - last_iterations_) * 1000000 / elapsed_us, std::memory_order_relaxed);
+    wakeups_per_sec_.store((wakeups_ - last_wakeups_) * 1000000 / elapsed_us, std::memory_order_relaxed);
+    callback_max_us_.store(window_callback_max_, std::memory_order_relaxed);
+    task_age_max_us_.store(window_task_age_max_, std::memory_order_relaxed);
+    timer_lag_max_us_.store(window_timer_lag_max_, std::memory_order_relaxed);
+
+    last_iterations_ = iterations;
+    last_wakeups_ = wakeups_;
+    window_callback_max_ = 0;
+    window_task_age_max_ = 0;
+    window_timer_lag_max_ = 0;
+}
+
+uint64_t LoopStats::CallbackMaxUs() const
+{
+    return callback_max_us_.load(std::memory_order_relaxed);
+}
+
+uint64_t LoopStats::TaskAgeMaxUs() const
+{
+    return task_age_max_us_.load(std::memory_order_relaxed);
+}
+
+uint64_t LoopStats::TimerLagMaxUs() const
+{
+    return timer_lag_max_us_.load(std::memory_order_relaxed);
+}
+
+uint64_t LoopStats::IterationsPerSec() const
+{
+    return iterations_per_sec_.load(std::memory_order_relaxed);
+}
+
+uint64_t LoopStats::WakeupsPerSec() const
+{
+    return wakeups_per_sec_.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,122 @@
+#pragma once
+// 防止头文件被重复包含
+// Prevents this header file from being included multiple times.
+
+#include "base/NonCopyable.h"  // 禁止拷贝 (Non-copyable base class)
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace tmms
+{
+    namespace network
+    {
+        // Log2Histogram：按 2 的幂分桶的直方图，第 0 桶是 0，第 i 桶是 [2^(i-1), 2^i)。
+        // 只有事件循环线程写（普通的 load + store，没有原子读改写），其他线程随时可以读，
+        // 读到的是近似快照，用于观察分布，不用于精确计量。
+        // Log2Histogram: power-of-two buckets, bucket 0 holds 0 and bucket i holds [2^(i-1), 2^i).
+        // Only the loop thread writes (plain load + store, no atomic read-modify-write) while any
+        // thread may read; readers get an approximate snapshot, fine for distributions, not accounting.
+        class Log2Histogram : public base::NonCopyable
+        {
+        public:
+            static const int kBuckets = 32;
+
+            Log2Histogram();
+
+            void Record(uint64_t value);
+            uint64_t Count() const;
+            uint64_t Sum() const;
+            uint64_t Max() const;
+            uint64_t Bucket(int index) const;
+            // 第 p（0~1）分位所在桶的上界 (Upper bound of the bucket holding quantile p, 0 to 1)
+            uint64_t Percentile(double p) const;
+            // 第 index 桶的上界 (Upper bound of bucket index)
+            static uint64_t BucketLimit(int index);
+
+        private:
+            std::atomic<uint64_t> buckets_[kBuckets];
+            std::atomic<uint64_t> count_;
+            std::atomic<uint64_t> sum_;
+            std::atomic<uint64_t> max_;
+        };
+
+        // LoopStats：单个 EventLoop 的延迟和饱和度统计，时间单位都是微秒。
+        // 直方图从开启起累计；各项最大值和每秒速率按 1 秒窗口计算，由循环的 1 秒定时器调用 Roll 发布。
+        // LoopStats: latency and saturation statistics of one EventLoop, all times in microseconds.
+        // Histograms accumulate from the moment stats are enabled; window maxima and per-second
+        // rates cover one-second windows published by Roll from the loop's 1 s timer.
+        class LoopStats : public base::NonCopyable
+        {
+        public:
+            LoopStats() = default;
+            ~LoopStats() = default;
+
+            // 以下记录接口只在循环线程中调用 (Recording is loop-thread only)
+            void RecordPollWait(int64_t us);
+            void RecordIteration(int64_t callback_us);
+            void RecordCallback(int64_t us);
+            void RecordTasks(size_t count, int64_t oldest_age_us);
+            void RecordTimerLag(int64_t us);
+            void RecordWakeup()
+            {
+                wakeups_++;
+            }
+            // 开启统计时调用，从当前轮数开始第一个窗口 (Called on enable; opens the first window at the current iteration count)
+            void Start(uint64_t iterations);
+            // 结束一个统计窗口，elapsed_us 为窗口长度，iterations 为循环累计轮数
+            // Closes a window of elapsed_us; iterations is the loop's running iteration count.
+            void Roll(int64_t elapsed_us, uint64_t iterations);
+
+            const Log2Histogram &PollWait() const
+            {
+                return poll_wait_;
+            }
+            const Log2Histogram &IterationCallbacks() const
+            {
+                return iteration_callbacks_;
+            }
+            const Log2Histogram &Callback() const
+            {
+                return callback_;
+            }
+            const Log2Histogram &TaskBatch() const
+            {
+                return task_batch_;
+            }
+            const Log2Histogram &TaskAge() const
+            {
+                return task_age_;
+            }
+            const Log2Histogram &TimerLag() const
+            {
+                return timer_lag_;
+            }
+            uint64_t CallbackMaxUs() const;     // 最近窗口里单个回调的最长时间 (longest single callback of the last window)
+            uint64_t TaskAgeMaxUs() const;      // 最近窗口里任务排队的最长时间 (oldest queued task of the last window)
+            uint64_t TimerLagMaxUs() const;     // 最近窗口里定时器的最大延迟 (worst timer lag of the last window)
+            uint64_t IterationsPerSec() const;  // 每秒从等待中返回的次数 (returns from the wait per second)
+            uint64_t WakeupsPerSec() const;     // 每秒跨线程投递引起的唤醒次数 (cross-thread task wakeups per second)
+
+        private:
+            Log2Histogram poll_wait_;            // 每轮在 epoll_wait / io_uring 中等待的时间
+            Log2Histogram iteration_callbacks_;  // 每轮执行回调的总时间
+            Log2Histogram callback_;             // 单个回调（事件、任务、一批定时器）的时间
+            Log2Histogram task_batch_;           // 每次唤醒取出的任务数（队列深度）
+            Log2Histogram task_age_;             // 每批任务中最早一个的排队时间
+            Log2Histogram timer_lag_;            // 定时器实际处理时间比到期时间晚多少
+
+            int64_t window_callback_max_{0};
+            int64_t window_task_age_max_{0};
+            int64_t window_timer_lag_max_{0};
+            uint64_t wakeups_{0};
+            uint64_t last_wakeups_{0};
+            uint64_t last_iterations_{0};
+            std::atomic<uint64_t> callback_max_us_{0};
+            std::atomic<uint64_t> task_age_max_us_{0};
+            std::atomic<uint64_t> timer_lag_max_us_{0};
+            std::atomic<uint64_t> iterations_per_sec_{0};
+            std::atomic<uint64_t> wakeups_per_sec_{0};
+        };
+    }
+}
@@ -0,0 +1,174 @@
+#include "OutputChain.h"
+#include <mutex>
+#include <cstring>
+#include <algorithm>
+
+using namespace tmms::network;
+
+namespace
+{
+    struct HeaderBlock
+    {
+        char data[kOutputHeaderBlockSize];
+    };
+
+    // 头部块池：块在哪个线程释放都可能，所以用锁；一个块能装几百个协议头，锁的开销可以忽略。
+    // 池对象故意不析构，退出时其他线程的连接还可能在归还块。
+    // Header block pool. Blocks may be released on any thread, hence the lock; one block holds
+    // hundreds of protocol headers so the cost is negligible. The pool is deliberately leaked because
+    // connections on other threads may still return blocks during exit.
+    class HeaderBlockPool
+    {
+    public:
+        static const size_t kMaxFreeBlocks = 1024;
+
+        HeaderBlock *Get()
+        {
+            {
+                std::lock_guard<std::mutex> lk(lock_);
+                if(!free_.empty())
+                {
+                    HeaderBlock *block = free_.back();
+                    free_.pop_back();
+                    return block;
+                }
+            }
+            return new HeaderBlock();
+        }
+        void Put(HeaderBlock *block)
+        {
+            {
+                std::lock_guard<std::mutex> lk(lock_);
+                if(free_.size() < kMaxFreeBlocks)
+                {
+                    free_.push_back(block);
+                    return;
+                }
+            }
+            delete block;
+        }
+
+    private:
+        std::mutex lock_;
+        std::vector<HeaderBlock*> free_;
+    };
+
+    HeaderBlockPool &BlockPool()
+    {
+        static HeaderBlockPool *pool = new HeaderBlockPool();
+        return *pool;
+    }
+
+    // 大于这个长度的拷贝不进头部块，单独分配 (Copies larger than this get their own buffer)
+    const size_t kMaxHeaderCopy = kOutputHeaderBlockSize / 4;
+}
+
+void OutputChain::Push(const void *data, size_t size, const BufferHolder &holder)
+{
+    struct iovec vec;
+    vec.iov_base = const_cast<void*>(data);
+    vec.iov_len = size;
+    vecs_.push_back(vec);
+    holders_.push_back(holder);
+    bytes_ += size;
+}
+
+void OutputChain::Append(const void *data, size_t size, const BufferHolder &holder)
+{
+    if(size == 0)
+    {
+        return;
+    }
+    Push(data,size,holder);
+}
+
+void OutputChain::AppendCopy(const void *data, size_t size)
+{
+    if(size == 0)
+    {
+        return;
+    }
+    if(size > kMaxHeaderCopy)
+    {
+        Append(std::string((const char*)data,size));
+        return;
+    }
+    if(block_ && block_.use_count() == 1)
+    {
+        block_used_ = 0;  // 块里的分片都已写出，从头复用 (every slice in the block is written; reuse it from the start)
+    }
+    if(!block_ || block_used_ + size > kOutputHeaderBlockSize)
+    {
+        HeaderBlock *block = BlockPool().Get();
+        block_.reset(block,[](HeaderBlock *b){
+            BlockPool().Put(b);
+        });
+        block_data_ = block->data;
+        block_used_ = 0;
+    }
+    char *dst = block_data_ + block_used_;
+    memcpy(dst,data,size);
+    block_used_ += size;
+
+    // 紧接着同一个块里上一段的拷贝合并成一个 iovec (Merge with the previous slice when it ends right here in the same block)
+    if(!Empty())
+    {
+        struct iovec &last = vecs_.back();
+        if((char*)last.iov_base + last.iov_len == dst && holders_.back().get() == block_.get())
+        {
+            last.iov_len += size;
+            bytes_ += size;
+            return;
+        }
+    }
+    Push(dst,size,block_);
+}
+
+void OutputChain::Append(std::string &&data)
+{
+    if(data.empty())
+    {
+        return;
+    }
+    auto owned = std::make_shared<std::string>(std::move(data));
+    Push(owned->data(),owned->size(),owned);
+}
+
+void OutputChain::Consume(size_t bytes)
+{
+    bytes_ -= std::min(bytes,bytes_);
+    while(bytes > 0 && head_ < vecs_.size())
+    {
+        struct iovec &vec = vecs_[head_];
+        if(vec.iov_len > bytes)
+        {
+            vec.iov_base = (char*)vec.iov_base + bytes;
+            vec.iov_len -= bytes;
+            break;
+        }
+        bytes -= vec.iov_len;
+        holders_[head_].reset();
+        head_++;
+    }
+    if(head_ == vecs_.size())
+    {
+        vecs_.clear();
+        holders_.clear();
+        head_ = 0;
+    }
+    else if(head_ >= 64 && head_ * 2 >= vecs_.size())
+    {
+        // 队头过半再前移，均摊 O(1) (Compact once the head passes half; amortised O(1))
+        vecs_.erase(vecs_.begin(),vecs_.begin() + head_);
+        holders_.erase(holders_.begin(),holders_.begin() + head_);
+        head_ = 0;
+    }
+}
+
+void OutputChain::Clear()
+{
+    vecs_.clear();
+    holders_.clear();
+    head_ = 0;
+    bytes_ = 0;
+}
@@ -0,0 +1,89 @@
+#pragma once
+// 防止头文件被重复包含
+// Prevents this header file from being included multiple times.
+
+#include "base/NonCopyable.h"  // 禁止拷贝 (Non-copyable base class)
+#include "BufferHolder.h"
+#include <sys/uio.h>           // struct iovec
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+namespace tmms
+{
+    namespace network
+    {
+        // 小块拷贝进头部块，一个头部块的大小 (Size of the header blocks small copies go into)
+        const size_t kOutputHeaderBlockSize = 4096;
+
+        // OutputChain：连接的输出队列，由引用计数的分片组成。每个分片是一段 iovec 和它的所有者：
+        // 引用的包体（持有 PacketPtr 等）、从池里取的头部块（小块数据拷贝进去）或者独占的字符串。
+        // 入队之后调用方的缓冲区马上可以复用，不需要等写完成。
+        // 待发送的 iovec 在数组里连续存放，写出后只移动队头，队头过半时再整体前移，
+        // 所以 Consume 是均摊 O(1)，writev 直接用 Iovecs() 开头最多 IOV_MAX 个。
+        // OutputChain: a connection's output queue made of refcounted slices. Each slice is an iovec
+        // plus its owner: a referenced body (holding a PacketPtr or similar), a pooled header block that
+        // small pieces are copied into, or an owned string. Callers may reuse their buffers as soon as
+        // a slice is queued, with no need to wait for write-complete.
+        // Pending iovecs are contiguous in an array; consuming only advances the head and the array is
+        // compacted once the head passes half of it, so Consume is amortised O(1) and writev can take
+        // up to IOV_MAX straight from Iovecs().
+        class OutputChain : public base::NonCopyable
+        {
+        public:
+            OutputChain() = default;
+            ~OutputChain() = default;
+
+            // 引用 data，holder 一直持有到这段数据写出 (References data; holder is kept until it is written)
+            void Append(const void *data, size_t size, const BufferHolder &holder);
+            // 拷贝 data：小块进头部块，大块进独占的缓冲区 (Copies data: small pieces into a header block, large ones into an owned buffer)
+            void AppendCopy(const void *data, size_t size);
+            // 接管字符串 (Takes ownership of the string)
+            void Append(std::string &&data);
+
+            bool Empty() const
+            {
+                return head_ == vecs_.size();
+            }
+            // 待发送的分片数 (Number of pending slices)
+            size_t Count() const
+            {
+                return vecs_.size() - head_;
+            }
+            // 待发送的字节数 (Number of pending bytes)
+            size_t Bytes() const
+            {
+                return bytes_;
+            }
+            // 第一个待发送的 iovec，后面 Count() 个连续 (First pending iovec; Count() of them are contiguous)
+            struct iovec *Iovecs()
+            {
+                return vecs_.data() + head_;
+            }
+            const struct iovec &Iovec(size_t index) const
+            {
+                return vecs_[head_ + index];
+            }
+            // 第 index 个待发送分片的所有者 (Owner of the index-th pending slice)
+            const BufferHolder &Holder(size_t index) const
+            {
+                return holders_[head_ + index];
+            }
+            // 去掉已经写出的 bytes 字节，写完的分片释放所有者 (Drops bytes that were written, releasing finished slices)
+            void Consume(size_t bytes);
+            void Clear();
+
+        private:
+            void Push(const void *data, size_t size, const BufferHolder &holder);
+
+            std::vector<struct iovec> vecs_;
+            std::vector<BufferHolder> holders_;
+            size_t head_{0};
+            size_t bytes_{0};
+            std::shared_ptr<void> block_;   // 当前的头部块 (current header block)
+            char *block_data_{nullptr};
+            size_t block_used_{0};
+        };
+    }
+}
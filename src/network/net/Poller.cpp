@@ -0,0 +1,58 @@
+#include "Poller.h"
+#include "EpollPoller.h"
+#include "IoUringPoller.h"
+#include "network/base/Network.h"
+#include <atomic>
+
+using namespace tmms::network;
+
+namespace
+{
+    std::atomic<int> default_poller_type{kPollerEpoll};
+}
+
+std::unique_ptr<Poller> Poller::NewPoller(PollerType type)
+{
+    if(type == kPollerIoUring)
+    {
+        std::unique_ptr<Poller> poller(new IoUringPoller());
+        if(poller->Init())
+        {
+            return poller;
+        }
+        NETWORK_WARN << "io_uring poller not supported by this kernel, fall back to epoll.";
+    }
+    std::unique_ptr<Poller> poller(new EpollPoller());
+    if(!poller->Init())
+    {
+        NETWORK_ERROR << "epoll poller init failed.";
+        exit(-1);
+    }
+    return poller;
+}
+
+void Poller::SetDefaultType(PollerType type)
+{
+    default_poller_type.store(type);
+}
+
+void Poller::SetDefaultType(const std::string &name)
+{
+    if(name == "io_uring" || name == "iouring" || name == "uring")
+    {
+        SetDefaultType(kPollerIoUring);
+    }
+    else
+    {
+        if(name != "epoll")
+        {
+            NETWORK_WARN << "unknown poller:" << name << ", use epoll.";
+        }
+        SetDefaultType(kPollerEpoll);
+    }
+}
+
+PollerType Poller::DefaultType()
+{
+    return (PollerType)default_poller_type.load();
+}
@@ -0,0 +1,123 @@
+#pragma once
+// 防止头文件被重复包含
+// Prevents this header file from being included multiple times.
+
+#include "base/NonCopyable.h"  // 禁止拷贝 (Non-copyable base class)
+#include "network/base/MsgBuffer.h" // 后端收到的数据交给连接的读缓冲区 (data the backend received goes into the connection's read buffer)
+#include <sys/epoll.h>         // epoll_event 作为各后端统一的就绪事件格式 (epoll_event is the common ready-event format)
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <vector>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <cerrno>
+
+namespace tmms
+{
+    namespace network
+    {
+        // I/O 多路复用后端类型 (I/O multiplexing backend type)
+        enum PollerType
+        {
+            kPollerEpoll = 0,    // epoll_wait
+            kPollerIoUring = 1,  // io_uring，内核支持时带数据通路 (io_uring, with the data path where the kernel has it)
+        };
+
+        // token 只用低 62 位（代数 30 位），最高两位留给后端区分请求类型
+        // Tokens only use the low 62 bits (a 30-bit generation); the top two are left to backends
+        // to tell their request kinds apart.
+        const uint32_t kTokenGenerationMask = 0x3fffffff;
+
+        // Poller：EventLoop 的 I/O 多路复用后端抽象
+        // EventLoop 只和 token 打交道：token 的低 32 位是 EventLoop 事件槽下标，高 32 位是槽的代数。
+        // 就绪结果统一写成 epoll_event（events 为 EPOLLIN/EPOLLOUT 等位，data.u64 为 token），
+        // 所以 EventLoop 的分发逻辑和 Event 的 OnRead/OnWrite/OnClose 接口在各后端下完全一致。
+        // Poller: the I/O multiplexing backend behind EventLoop.
+        // EventLoop only deals in tokens: the low 32 bits are its event slot index, the high 32 bits
+        // the slot generation. Ready results are always reported as epoll_event (EPOLLIN/EPOLLOUT bits
+        // in events, the token in data.u64), so dispatch and the Event callbacks are backend agnostic.
+        class Poller : public base::NonCopyable
+        {
+        public:
+            Poller() = default;
+            virtual ~Poller() = default;
+
+            // 初始化后端，内核不支持时返回 false (Returns false when the kernel lacks support)
+            virtual bool Init() = 0;
+            // 等待就绪事件，最多 timeout_ms 毫秒；返回就绪数量，出错返回 -1，结果写入 events
+            // Waits up to timeout_ms; returns the ready count (-1 on error) and fills events.
+            virtual int Poll(int timeout_ms, std::vector<struct epoll_event> &events) = 0;
+            virtual bool AddFd(int fd, uint32_t events, uint64_t token) = 0;
+            virtual bool ModifyFd(int fd, uint32_t events, uint64_t token) = 0;
+            virtual bool RemoveFd(int fd, uint64_t token) = 0;
+            virtual const char *Name() const = 0;
+
+            // 数据通路：后端替流式连接收发数据，就绪回调不变。用 AddStreamFd 注册的 fd 由后端收数据，
+            // 收到的数据先放在后端，以 EPOLLIN 上报，连接在 OnRead 里用 Recv 取走；写和数据报发送提交给
+            // 后端，完成时以 EPOLLOUT 上报，连接在 OnWrite 里取结果。epoll 后端没有数据通路。
+            // Data path: the backend receives and sends for stream connections while the readiness
+            // callbacks stay the same. For fds added with AddStreamFd the backend does the receiving;
+            // received data waits in the backend, is reported as EPOLLIN and taken by the connection's
+            // OnRead with Recv. Writes and datagram sends are submitted to the backend and reported as
+            // EPOLLOUT on completion, where OnWrite collects the result. The epoll backend has none.
+            virtual bool HasDataPath() const
+            {
+                return false;
+            }
+            virtual bool AddStreamFd(int fd, uint32_t events, uint64_t token)
+            {
+                return AddFd(fd, events, token);
+            }
+            // 取走最多 max 字节已收到的数据追加到 buf，返回字节数；对端关闭返回 0，没有数据时返回 -1 并把
+            // err 置为 EAGAIN，接收出错时返回 -1 和错误码
+            // Appends up to max bytes of received data to buf and returns the count; 0 once the peer
+            // has closed, -1 with err EAGAIN when nothing is queued, -1 with the error when receive failed.
+            virtual ssize_t Recv(uint64_t token, MsgBuffer &buf, size_t max, int *err)
+            {
+                *err = EOPNOTSUPP;
+                return -1;
+            }
+            // 停止收数据并把已经收到的结果都留在后端，之后 Recv 只会取到这些 (迁移前调用)
+            // Stops receiving and keeps every result already received; Recv then only returns those
+            // (called before a move).
+            virtual void StopRecv(uint64_t token)
+            {
+            }
+            // 提交一次 writev，iovec 数组马上拷走，数据由 owner 持有到完成；结果用 TakeWriteResult 取
+            // Submits a writev. The iovec array is copied at once and owner keeps the data alive until
+            // completion; the result is collected with TakeWriteResult.
+            virtual bool SubmitWritev(uint64_t token, int fd, const struct iovec *iov, int count, const std::shared_ptr<void> &owner)
+            {
+                return false;
+            }
+            virtual bool TakeWriteResult(uint64_t token, ssize_t *result)
+            {
+                return false;
+            }
+            // 提交一个数据报，数据和地址马上拷走；结果用 TakeSendResults 取：发出的字节数、最近的错误、还没完成的个数
+            // Submits a datagram; data and address are copied at once. TakeSendResults collects the
+            // bytes sent, the last error and how many are still in flight.
+            virtual bool SubmitSendmsg(uint64_t token, int fd, const void *buf, size_t size, const struct sockaddr *addr, socklen_t len)
+            {
+                return false;
+            }
+            virtual bool TakeSendResults(uint64_t token, size_t *bytes, int *err, uint32_t *in_flight)
+            {
+                return false;
+            }
+
+            // 按类型创建后端，初始化失败时回退到 epoll
+            // Creates the requested backend, falling back to epoll when it cannot be initialised.
+            static std::unique_ptr<Poller> NewPoller(PollerType type);
+
+            // 进程级默认后端，由配置文件设置，之后创建的 EventLoop 使用
+            // Process-wide default backend, set from the config file and used by EventLoops created afterwards.
+            static void SetDefaultType(PollerType type);
+            static void SetDefaultType(const std::string &name);
+            static PollerType DefaultType();
+        };
+
+        using PollerPtr = std::unique_ptr<Poller>;
+    }
+}
@@ -1,10 +1,52 @@
 #include "TcpConnection.h"  
 #include "network/base/Network.h"  
+#include "network/base/SocketOpt.h"  
 #include <unistd.h>  // 引入unistd库，提供系统调用功能，如 close()  
+#include <sys/socket.h>
+#include <linux/errqueue.h>  // sock_extended_err，零拷贝完成通知
+#include <netinet/in.h>
+#include <climits>
+#include <cstring>
+#include <algorithm>
+#include <cstdlib>
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
 #include <iostream>  // 用于打印信息  
 
 using namespace tmms::network;  // 使用 tmms::network 命名空间，避免写长路径名  
 
+namespace
+{
+    // 作用域内开启 TCP_CORK，离开时关闭，把攒下的数据一起发出；连接在中途关闭就不再碰 fd
+    // Turns TCP_CORK on for a scope and off on exit, flushing what was held; leaves the fd alone
+    // if the connection closed meanwhile.
+    class CorkGuard
+    {
+    public:
+        CorkGuard(int fd, bool on, const bool &closed)
+        :fd_(fd),on_(on),closed_(closed)
+        {
+            if(on_)
+            {
+                SocketOpt(fd_).SetCork(true);
+            }
+        }
+        ~CorkGuard()
+        {
+            if(on_ && !closed_)
+            {
+                SocketOpt(fd_).SetCork(false);
+            }
+        }
+    private:
+        int fd_;
+        bool on_;
+        const bool &closed_;
+    };
+}
+
 // 构造函数：初始化 TcpConnection 对象  
 TcpConnection::TcpConnection(EventLoop *loop, 
             int socketfd, 
@@ -13,15 +55,18 @@ TcpConnection::TcpConnection(EventLoop *loop,
 :Connection(loop,socketfd,localAddr,peerAddr)            
 {
     // 初始化基类 Connection，传入事件循环、socket 文件描述符、本地地址、对端地址  
-    // 相当于新建一个 TCP 连接的管理对象，但此处未做其他初始化逻辑  
+    // 相当于新建一个 TCP 连接的管理对象  
+    Loop()->AddConnection(1);  // 计入所属事件循环的连接数  
+    stream_ = true;  // 后端有数据通路时由后端收发 (the backend receives and sends when it has a data path)
 }
 
 // 析构函数：当对象销毁时执行  
 TcpConnection::~TcpConnection()
 {
-    loop_->RunInLoop([this](){
-        OnClose();  // 在事件循环中调用关闭连接的函数
-    });
+    // 析构时已经拿不到 shared_ptr，不能再走 OnClose 回调；描述符由 ~Event 关闭
+    // No shared_ptr can be taken while destructing, so OnClose and its callback are skipped; ~Event closes the fd.
+    closed_ = true;
+    Loop()->AddConnection(-1);
     NETWORK_DEBUG << "TcpConnection:" << peer_addr_.ToIpPort() <<" destroy.";  
     // 打印调试信息，标识连接被销毁，显示对端地址
 }
@@ -41,13 +86,13 @@ void TcpConnection::SetCloseCallback(CloseConnectionCallback &&cb)
 // 处理关闭事件  
 void TcpConnection::OnClose()
 {
-    loop_->AssertInLoopThread();  // 确保当前操作在事件循环线程中执行  
+    Loop()->AssertInLoopThread();  // 确保当前操作在事件循环线程中执行  
     if(!closed_)  // 判断是否已经关闭过，避免重复关闭  
     {
         closed_ = true;  // 标记连接已关闭  
         if(close_cb_)  // 如果设置了关闭回调函数，则执行回调  
         {
-            close_cb_(std::dynamic_pointer_cast<TcpConnection>(shared_from_this()));
+            close_cb_(std::static_pointer_cast<TcpConnection>(shared_from_this()));
         }
         Event::Close();  // 执行基类 Event 的关闭逻辑
     }
@@ -56,7 +101,7 @@ void TcpConnection::OnClose()
 // 强制关闭连接  
 void TcpConnection::ForceClose()
 {
-    loop_->RunInLoop([this](){
+    RunInOwnLoop([this](){
         OnClose();  // 在事件循环中触发关闭事件  
     });
 }
@@ -82,16 +127,30 @@ void TcpConnection::OnRead()
         return;
     }
     ExtendLife();  // 扩展连接的生命周期（防止超时断开）  
-    while (true)  // 循环读取数据  
+    size_t budget = read_budget_;  // 本轮可读的字节数  
+    while (true)  // 循环读取数据，直到 EAGAIN 或预算用完  
     {
         int err = 0;
-        auto ret = message_buffer_.ReadFd(fd_,&err);  // 从 socket 读取数据到缓冲区  
+        // 从 socket 读取数据到缓冲区；数据通路下从后端已经收好的数据里取，最多取到预算
+        // Read from the socket; on the data path take from what the backend already received, up to the budget.
+        auto ret = DataPath() ? Loop()->RecvQueued(shared_from_this(),message_buffer_,budget,&err)
+                              : message_buffer_.ReadFd(fd_,&err);
         if(ret > 0)  // 成功读取到数据  
         {
+            Loop()->AddBytesIn(ret);
             if(message_cb_)  // 如果有消息回调函数，调用回调处理数据  
             {
-                message_cb_(std::dynamic_pointer_cast<TcpConnection>(shared_from_this()),message_buffer_);
+                message_cb_(std::static_pointer_cast<TcpConnection>(shared_from_this()),message_buffer_);
             }
+            if((size_t)ret >= budget)  // 预算用完，让出给其他连接，下一轮继续读  
+            {
+                if(!closed_)
+                {
+                    Loop()->RearmRead(shared_from_this());
+                }
+                break;
+            }
+            budget -= ret;
         }
         else if( ret == 0)  // 如果读取返回 0，表示对端关闭连接  
         {
@@ -109,6 +168,11 @@ void TcpConnection::OnRead()
     }
 }
 
+void TcpConnection::SetReadBudget(size_t bytes)
+{
+    read_budget_ = bytes > 0 ? bytes : kDefaultReadBudget;
+}
+
 // 处理错误的回调函数  
 void TcpConnection::OnError(const std::string &msg)
 {
@@ -137,33 +201,28 @@ void TcpConnection::OnWrite()
         return;
     }
     ExtendLife();  // 扩展连接的生命周期  
-    if(!io_vec_list_.empty())  // 如果有待写入的数据  
+    if(DataPath())  // 可写通知是提交的 writev 完成了 (writability means the submitted writev completed)
+    {
+        OnWriteDone();
+        return;
+    }
+    if(!output_.Empty())  // 如果有待写入的数据  
     {
+        // 延迟模式下这批要分几次写（零拷贝分段或超过 IOV_MAX）时先塞住，避免协议头单独成段
+        CorkGuard cork(fd_,latency_mode_ && (zerocopy_ || output_.Count() > IOV_MAX),closed_);
         while(true)
         {
-            auto ret = ::writev(fd_,&io_vec_list_[0],io_vec_list_.size());  // 批量写入数据  
+            auto ret = WriteIovecs();  // 批量写入数据  
             if(ret >= 0)
             {
-                while(ret > 0)
-                {
-                    if(io_vec_list_.front().iov_len > ret)  
-                    {
-                        io_vec_list_.front().iov_base =(char*)io_vec_list_.front().iov_base+ret;
-                        io_vec_list_.front().iov_len -= ret;  
-                        break;
-                    }
-                    else 
-                    {
-                        ret -= io_vec_list_.front().iov_len;
-                        io_vec_list_.erase(io_vec_list_.begin());
-                    }
-                }
-                if(io_vec_list_.empty())  // 如果所有数据写完  
+                Loop()->AddBytesOut(ret);
+                output_.Consume(ret);
+                if(output_.Empty())  // 如果所有数据写完  
                 {
                     EnableWriting(false);  // 停止写入事件  
                     if(write_complete_cb_)  // 触发写入完成回调  
                     {
-                        write_complete_cb_(std::dynamic_pointer_cast<TcpConnection>(shared_from_this()));
+                        write_complete_cb_(std::static_pointer_cast<TcpConnection>(shared_from_this()));
                     }
                     return;
                 }
@@ -185,25 +244,353 @@ void TcpConnection::OnWrite()
         EnableWriting(false);  // 如果没有数据待写，停止写入事件  
         if(write_complete_cb_)  // 触发写入完成回调  
         {
-            write_complete_cb_(std::dynamic_pointer_cast<TcpConnection>(shared_from_this()));
+            write_complete_cb_(std::static_pointer_cast<TcpConnection>(shared_from_this()));
+        }
+    }
+}
+
+void TcpConnection::FlushOutput()
+{
+    if(DataPath())
+    {
+        SubmitWrite();
+    }
+    else
+    {
+        EnableWriting(true);
+    }
+}
+
+// 把 output_ 开头最多 IOV_MAX 个分片作为一个 writev 提交，本轮结束等待时和其他连接的写一起发出。
+// 分片的所有者在 output_ 里，写完成前不会消费；连接自己由请求持有。迁移时不提交，到目标循环再提交
+// Submits a writev of up to IOV_MAX leading slices of output_, which goes out together with other
+// connections' writes when this iteration waits. The slices' owners stay in output_ and are not
+// consumed before the write completes; the request holds the connection itself. Nothing is
+// submitted during a move; the target loop submits instead.
+void TcpConnection::SubmitWrite()
+{
+    if(write_in_flight_ || moving_to_ || closed_ || output_.Empty())
+    {
+        return;
+    }
+    size_t count = std::min<size_t>(output_.Count(), IOV_MAX);
+    if(Loop()->SubmitWritev(shared_from_this(),output_.Iovecs(),(int)count,shared_from_this()))
+    {
+        write_in_flight_ = true;
+        return;
+    }
+    EnableWriting(true); // 提交不了就等可写通知再试 (if it cannot be submitted, retry once writable)
+}
+
+void TcpConnection::OnWriteDone()
+{
+    ssize_t ret = 0;
+    if(!Loop()->TakeWriteResult(shared_from_this(),&ret))
+    {
+        // 提交失败后等来的可写通知 (the writability awaited after a failed submission)
+        if(!write_in_flight_)
+        {
+            EnableWriting(false);
+            SubmitWrite();
+        }
+        return;
+    }
+    write_in_flight_ = false;
+    if(ret < 0)
+    {
+        if(ret != -EINTR && ret != -EAGAIN)
+        {
+            NETWORK_ERROR << "host:" << peer_addr_.ToIpPort() << " write err:" << -ret;
+            OnClose();
+            return;
+        }
+        ret = 0;
+    }
+    Loop()->AddBytesOut(ret);
+    output_.Consume(ret);
+    if(move_after_write_)
+    {
+        move_after_write_ = false;
+        MoveInLoop();
+        return;
+    }
+    if(!output_.Empty())
+    {
+        SubmitWrite();
+    }
+    else if(write_complete_cb_)
+    {
+        write_complete_cb_(std::static_pointer_cast<TcpConnection>(shared_from_this()));
+    }
+}
+
+// 写出 output_ 开头的一段。关闭零拷贝时一次 writev 最多 IOV_MAX 个；开启时把可零拷贝和
+// 不可零拷贝的连续分片分开发送，小块（拷贝进头部块的协议头）照常拷贝，大块媒体数据用 MSG_ZEROCOPY
+// Writes a leading run of output_. Without zero-copy it is one writev of up to IOV_MAX
+// slices; with it, eligible and ineligible runs go out separately, so small pieces (protocol
+// headers copied into header blocks) are copied as usual and large media payloads use MSG_ZEROCOPY.
+ssize_t TcpConnection::WriteIovecs()
+{
+    size_t count = std::min<size_t>(output_.Count(), IOV_MAX);
+    if(!zerocopy_)
+    {
+        return ::writev(fd_,output_.Iovecs(),count);
+    }
+    bool eligible = IsZeroCopyEligible(0);
+    size_t run = 1;
+    while(run < count && IsZeroCopyEligible(run) == eligible)
+    {
+        run++;
+    }
+    if(!eligible)
+    {
+        return ::writev(fd_,output_.Iovecs(),run);
+    }
+
+    struct msghdr msg;
+    memset(&msg,0,sizeof(msg));
+    msg.msg_iov = output_.Iovecs();
+    msg.msg_iovlen = run;
+    auto ret = ::sendmsg(fd_,&msg,MSG_ZEROCOPY);
+    if(ret > 0)
+    {
+        // 内核引用了已发出部分的用户内存，持有这些分片的所有者直到完成通知
+        // The kernel now references the user memory that went out; pin the owners until the completion.
+        ZeroCopyPin pin;
+        pin.seq = zc_next_seq_++;
+        size_t left = ret;
+        for(size_t i = 0; i < run && left > 0; i++)
+        {
+            pin.holders.push_back(output_.Holder(i));
+            left -= std::min(left,output_.Iovec(i).iov_len);
+        }
+        zc_pins_.emplace_back(std::move(pin));
+        zc_sends_++;
+    }
+    else if(ret < 0 && errno == ENOBUFS)
+    {
+        // 超过 optmem 限制，这一批按普通方式发送 (over the optmem limit; this run is copied instead)
+        return ::writev(fd_,output_.Iovecs(),run);
+    }
+    return ret;
+}
+
+bool TcpConnection::IsZeroCopyEligible(size_t index) const
+{
+    return output_.Iovec(index).iov_len >= zerocopy_threshold_;
+}
+
+void TcpConnection::SetMaxPendingBytes(size_t bytes)
+{
+    max_pending_bytes_ = bytes;
+}
+
+bool TcpConnection::CheckPendingLimit()
+{
+    if(max_pending_bytes_ == 0 || output_.Bytes() <= max_pending_bytes_)
+    {
+        return false;
+    }
+    NETWORK_WARN << "host:" << peer_addr_.ToIpPort() << " output queue " << output_.Bytes()
+                 << " bytes over limit " << max_pending_bytes_ << ", close it.";
+    OnClose();
+    return true;
+}
+
+bool TcpConnection::EnableLatencyMode(uint32_t notsent_lowat)
+{
+    SocketOpt opt(fd_);
+    latency_mode_ = opt.SetNotSentLowat(notsent_lowat);
+    return latency_mode_;
+}
+
+void TcpConnection::SetSendBufferForBitrate(int64_t bytes_per_sec, uint32_t target_ms)
+{
+    if(bytes_per_sec <= 0)
+    {
+        return;
+    }
+    int64_t bytes = std::max<int64_t>(bytes_per_sec * target_ms / 1000,kMinLatencySendBuffer);
+    bytes = std::min<int64_t>(bytes,INT_MAX / 2);
+    if(send_buffer_ > 0 && std::abs(bytes - send_buffer_) * 4 < send_buffer_)
+    {
+        return;
+    }
+    SocketOpt opt(fd_);
+    if(opt.SetSendBuffer((int32_t)bytes))
+    {
+        send_buffer_ = (int32_t)bytes;
+    }
+}
+
+size_t TcpConnection::SocketBacklogBytes() const
+{
+    SocketOpt opt(fd_);
+    int bytes = opt.GetOutQueue();
+    return bytes > 0 ? bytes : 0;
+}
+
+bool TcpConnection::EnableZeroCopy(size_t threshold)
+{
+    Loop()->AssertInLoopThread();
+    if(threshold == 0 || DataPath())
+    {
+        zerocopy_ = false;
+        zerocopy_threshold_ = 0;
+        return false;
+    }
+    SocketOpt opt(fd_);
+    if(!opt.SetZeroCopy(true))
+    {
+        return false;
+    }
+    zerocopy_threshold_ = threshold;
+    zerocopy_ = true;
+    zc_copied_streak_ = 0;
+    return true;
+}
+
+bool TcpConnection::OnErrorQueue()
+{
+    if(!zerocopy_ && zc_pins_.empty())
+    {
+        return false;
+    }
+    // 取完错误队列里的所有通知，边缘触发下下一个通知会重新触发 EPOLLERR
+    // Drain the whole error queue; with edge triggering the next notification raises EPOLLERR again.
+    char control[128];
+    while(true)
+    {
+        struct msghdr msg;
+        memset(&msg,0,sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if(::recvmsg(fd_,&msg,MSG_ERRQUEUE) < 0)
+        {
+            break;
+        }
+        for(struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg,cm))
+        {
+            if(!(cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                && !(cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR))
+            {
+                continue;
+            }
+            auto serr = (struct sock_extended_err*)CMSG_DATA(cm);
+            if(serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+            OnZeroCopyComplete(serr->ee_info,serr->ee_data,serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED);
         }
     }
+
+    int error = 0;
+    socklen_t len = sizeof(error);
+    ::getsockopt(fd_,SOL_SOCKET,SO_ERROR,&error,&len);
+    if(error != 0)  // 除了通知还有真正的套接字错误 (a real socket error besides the notifications)
+    {
+        OnError(strerror(error));
+    }
+    return true;
+}
+
+// 序号 lo 到 hi 的零拷贝发送已经完成，释放它们持有的缓冲区。通知可能乱序，按序号标记后从队头释放
+// Zero-copy sends lo..hi completed, so their buffers are released. Notifications may come out of
+// order, so they are marked by sequence number and released from the head of the queue.
+void TcpConnection::OnZeroCopyComplete(uint32_t lo, uint32_t hi, bool copied)
+{
+    if(zc_pins_.empty())
+    {
+        return;
+    }
+    uint32_t first = zc_pins_.front().seq;
+    for(uint32_t seq = lo; seq != hi + 1; seq++)
+    {
+        uint32_t index = seq - first;
+        if(index < zc_pins_.size())
+        {
+            zc_pins_[index].done = true;
+        }
+    }
+    while(!zc_pins_.empty() && zc_pins_.front().done)
+    {
+        zc_pins_.pop_front();
+    }
+
+    if(copied)
+    {
+        // 内核还是拷贝了：零拷贝只多了通知的开销，连续多次就回退到普通发送
+        // The kernel copied anyway, so zero-copy only added notification overhead; fall back after a streak.
+        zc_copied_ += hi - lo + 1;
+        zc_copied_streak_ += hi - lo + 1;
+        if(zerocopy_ && zc_copied_streak_ >= kZeroCopyCopiedLimit)
+        {
+            NETWORK_DEBUG << "host:" << peer_addr_.ToIpPort() << " zero copy falls back to copying.";
+            zerocopy_ = false;
+        }
+    }
+    else
+    {
+        zc_copied_streak_ = 0;
+    }
 }
 
 void TcpConnection::Send(std::list<BufferNodePtr>&list)
 {
-    loop_->RunInLoop([this,&list](){
+    if(InOwnLoop())
+    {
         SendInLoop(list);
+        return;
+    }
+    // 跨线程发送：没有所有者的节点先拷贝，调用方返回后就可以复用缓冲区
+    std::list<BufferNodePtr> owned;
+    for(auto &l:list)
+    {
+        if(l->holder)
+        {
+            owned.push_back(l);
+        }
+        else 
+        {
+            auto copy = std::make_shared<std::string>((const char*)l->addr,l->size);
+            owned.push_back(std::make_shared<BufferNode>((void*)copy->data(),copy->size(),copy));
+        }
+    }
+    auto self = std::static_pointer_cast<TcpConnection>(shared_from_this());
+    RunInOwnLoop([self,owned]() mutable {
+        self->SendInLoop(owned);
     });
 }
 void TcpConnection::Send(const char *buf,size_t size)
 {
-    loop_->RunInLoop([this,buf,size](){
-        SendInLoop(buf,size);
+    if(InOwnLoop())
+    {
+        SendInLoop(buf,size,nullptr);
+        return;
+    }
+    Send(std::string(buf,size));
+}
+void TcpConnection::Send(const char *buf,size_t size,const BufferHolder &holder)
+{
+    if(InOwnLoop())
+    {
+        SendInLoop(buf,size,holder);
+        return;
+    }
+    auto self = std::static_pointer_cast<TcpConnection>(shared_from_this());
+    RunInOwnLoop([self,buf,size,holder](){
+        self->SendInLoop(buf,size,holder);
     });
 }
+void TcpConnection::Send(std::string &&data)
+{
+    auto owned = std::make_shared<std::string>(std::move(data));
+    Send(owned->data(),owned->size(),owned);
+}
 
-void TcpConnection::SendInLoop(const char *buf,size_t size)
+// holder 为空时没有写出的部分拷贝进输出队列 (Without a holder the unwritten part is copied into the output queue)
+void TcpConnection::SendInLoop(const char *buf,size_t size,const BufferHolder &holder)
 {
     if(closed_)
     {
@@ -211,10 +598,10 @@ void TcpConnection::SendInLoop(const char *buf,size_t size)
         return;
     }
     size_t send_len = 0;
-    if(io_vec_list_.empty())
+    if(output_.Empty() && !DataPath())  // 数据通路下不直接写，排进队列一起提交 (the data path queues instead of writing directly)
     {
-        send_len = ::write(fd_,buf,size);
-        if(send_len<0)
+        ssize_t ret = ::write(fd_,buf,size);
+        if(ret<0)
         {
             if(errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK)
             {
@@ -222,26 +609,35 @@ void TcpConnection::SendInLoop(const char *buf,size_t size)
                 OnClose();
                 return;
             }
-            send_len = 0;
+            ret = 0;
         }
+        send_len = ret;
+        Loop()->AddBytesOut(send_len);
         size -= send_len;
         if(size==0)
         {
             if(write_complete_cb_)
             {
-                write_complete_cb_(std::dynamic_pointer_cast<TcpConnection>(shared_from_this()));
+                write_complete_cb_(std::static_pointer_cast<TcpConnection>(shared_from_this()));
             }
             return;
         }
     }
     if(size>0)
     {
-        struct iovec vec;
-        vec.iov_base = (void*)(buf+send_len);
-        vec.iov_len = size;
-        
-        io_vec_list_.push_back(vec);
-        EnableWriting(true);
+        if(holder)
+        {
+            output_.Append(buf+send_len,size,holder);
+        }
+        else 
+        {
+            output_.AppendCopy(buf+send_len,size);
+        }
+        if(CheckPendingLimit())
+        {
+            return;
+        }
+        FlushOutput();
     }
 }
 void TcpConnection::SendInLoop(std::list<BufferNodePtr>&list)
@@ -253,28 +649,35 @@ void TcpConnection::SendInLoop(std::list<BufferNodePtr>&list)
     }
     for(auto &l:list)
     {
-        struct iovec vec;
-        vec.iov_base = (void*)l->addr;
-        vec.iov_len = l->size;
-        
-        io_vec_list_.push_back(vec);
+        if(l->holder)
+        {
+            output_.Append(l->addr,l->size,l->holder);
+        }
+        else 
+        {
+            output_.AppendCopy(l->addr,l->size); // 没有所有者的小块（协议头等）拷贝
+        }
+    }
+    if(CheckPendingLimit())
+    {
+        return;
     }
-    if(!io_vec_list_.empty())
+    if(!output_.Empty())
     {
-        EnableWriting(true);
+        FlushOutput();
     }
 }
 void TcpConnection::SetTimeoutCallback(int timeout,const TimeoutCallback &cb)
 {
-    auto cp = std::dynamic_pointer_cast<TcpConnection>(shared_from_this());
-    loop_->RunAfter(timeout,[&cp,&cb](){
+    auto cp = std::static_pointer_cast<TcpConnection>(shared_from_this());
+    Loop()->RunAfter(timeout,[&cp,&cb](){
         cb(cp);
     });
 }
 void TcpConnection::SetTimeoutCallback(int timeout,TimeoutCallback &&cb)
 {
-    auto cp = std::dynamic_pointer_cast<TcpConnection>(shared_from_this());
-    loop_->RunAfter(timeout,[&cp,cb](){
+    auto cp = std::static_pointer_cast<TcpConnection>(shared_from_this());
+    Loop()->RunAfter(timeout,[&cp,cb](){
         cb(cp);
     });
 }
@@ -286,145 +689,160 @@ void TcpConnection::OnTimeout()
 }
 void TcpConnection::EnableCheckIdleTimeout(int32_t max_time)
 {
-    auto tp = std::make_shared<TimeoutEntry>(std::dynamic_pointer_cast<TcpConnection>(shared_from_this()));
     max_idle_time_ = max_time;
+    ExtendLife();
+    ArmIdleCheck(max_time);
+}
+void TcpConnection::ArmIdleCheck(int32_t delay)
+{
+    auto tp = std::make_shared<TimeoutEntry>(std::static_pointer_cast<TcpConnection>(shared_from_this()));
     timeout_entry_ = tp;
-    loop_->InsertEntry(max_time,tp);
-}
-void TcpConnection::ExtendLife()
-{
-    auto tp = timeout_entry_.lock();
-    if(tp)
-    {
-        loop_->InsertEntry(max_idle_time_,tp);
-    }
-}
-
-
-// TcpConnection::Send：发送数据，支持 std::list<BufferNodePtr> 类型
-void TcpConnection::Send(std::list<BufferNodePtr>&list)  
-{  
-    // 将发送操作通过事件循环执行  
-    // [this, &list] 表示捕获当前对象指针和列表引用  
-    loop_->RunInLoop([this,&list](){  
-        SendInLoop(list);  // 调用内部发送函数，真正执行发送逻辑  
-    });  
-}  
-
-// TcpConnection::Send：发送数据，支持 const char* 数据缓冲区  
-void TcpConnection::Send(const char *buf,size_t size)  
-{  
-    // 同样将发送操作通过事件循环执行  
-    // 捕获参数 buf 和 size，确保数据被传递到事件循环中  
-    loop_->RunInLoop([this,buf,size](){  
-        SendInLoop(buf,size);  // 调用内部发送函数，真正执行发送逻辑  
-    });  
-}  
-
-// TcpConnection::SendInLoop：内部发送函数（字符缓冲区版本）  
-void TcpConnection::SendInLoop(const char *buf,size_t size)  
-{  
-    if(closed_) // 检查连接是否已经关闭  
-    {  
-        NETWORK_TRACE << "host:" << peer_addr_.ToIpPort() << " had closed.";  
-        return; // 如果关闭，直接返回  
-    }  
-    size_t send_len = 0;  // 已发送字节数  
-
-    if(io_vec_list_.empty()) // 如果之前没有未发送的数据  
-    {  
-        send_len = ::write(fd_,buf,size);  // 尝试发送数据到套接字  
-        if(send_len<0) // 检查发送是否出错  
-        {  
-            if(errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) // 非可重试错误  
-            {  
-                NETWORK_ERROR << "host:" << peer_addr_.ToIpPort() << " write err:" << errno;  
-                OnClose(); // 关闭连接  
-                return;  
-            }  
-            send_len = 0;  // 如果是临时错误，已发送字节数设为 0  
-        }  
-        size -= send_len; // 更新剩余未发送字节数  
-        if(size==0) // 如果数据发送完毕  
-        {  
-            if(write_complete_cb_) // 如果有写完成回调，执行回调  
-            {  
-                write_complete_cb_(std::dynamic_pointer_cast<TcpConnection>(shared_from_this()));  
-            }  
-            return;  
-        }  
-    }  
-    if(size>0) // 如果还有数据未发送  
-    {  
-        struct iovec vec; // 定义 iovec 结构存储未发送数据  
-        vec.iov_base = (void*)(buf+send_len);  // 未发送数据的起始地址  
-        vec.iov_len = size;  // 未发送数据的长度  
-        io_vec_list_.push_back(vec);  // 将 iovec 添加到发送队列  
-        EnableWriting(true); // 启用可写事件，等待下一次发送  
-    }  
-}  
-
-// TcpConnection::SendInLoop：内部发送函数（列表版本）  
-void TcpConnection::SendInLoop(std::list<BufferNodePtr>&list)  
-{  
-    if(closed_) // 检查连接是否关闭  
-    {  
-        NETWORK_TRACE << "host:" << peer_addr_.ToIpPort() << " had closed.";  
-        return;  
-    }  
-    for(auto &l:list) // 遍历传入的列表  
-    {  
-        struct iovec vec; // 定义 iovec 结构  
-        vec.iov_base = (void*)l->addr; // 数据起始地址  
-        vec.iov_len = l->size; // 数据长度  
-        io_vec_list_.push_back(vec); // 将数据存入发送队列  
-    }  
-    if(!io_vec_list_.empty()) // 如果有未发送数据  
-    {  
-        EnableWriting(true); // 启用写事件，等待发送  
-    }  
-}  
-
-// TcpConnection::SetTimeoutCallback：设置超时回调（左值版本）  
-void TcpConnection::SetTimeoutCallback(int timeout,const TimeoutCallback &cb)  
-{  
-    auto cp = std::dynamic_pointer_cast<TcpConnection>(shared_from_this());  
-    loop_->RunAfter(timeout,[&cp,&cb](){  
-        cb(cp); // 触发回调函数，处理超时事件  
-    });  
-}  
-
-// TcpConnection::SetTimeoutCallback：设置超时回调（右值版本）  
-void TcpConnection::SetTimeoutCallback(int timeout,TimeoutCallback &&cb)  
-{  
-    auto cp = std::dynamic_pointer_cast<TcpConnection>(shared_from_this());  
-    loop_->RunAfter(timeout,[&cp,cb](){  
-        cb(cp); // 触发回调函数，处理超时事件  
-    });  
-}  
-
-// TcpConnection::OnTimeout：处理连接超时事件  
-void TcpConnection::OnTimeout()  
-{  
-    NETWORK_ERROR << "host:" << peer_addr_.ToIpPort() << " timeout and close it.";  
-    OnClose(); // 调用关闭函数，关闭连接  
-}  
-
-// TcpConnection::EnableCheckIdleTimeout：启用空闲超时检查  
-void TcpConnection::EnableCheckIdleTimeout(int32_t max_time)  
-{  
-    auto tp = std::make_shared<TimeoutEntry>(std::dynamic_pointer_cast<TcpConnection>(shared_from_this()));  
-    max_idle_time_ = max_time;  // 设置最大空闲时间  
-    timeout_entry_ = tp; // 保存超时条目  
-    loop_->InsertEntry(max_time,tp); // 将超时条目插入事件循环中  
-}  
-
-// TcpConnection::ExtendLife：延长连接的生命周期  
-void TcpConnection::ExtendLife()  
-{  
-    auto tp = timeout_entry_.lock(); // 获取超时条目的弱引用  
-    if(tp) // 如果超时条目有效  
-    {  
-        loop_->InsertEntry(max_idle_time_,tp); // 重新插入事件循环，延长生命周期  
-    }  
-}  
+    Loop()->InsertEntry(delay,tp);
+}
+void TcpConnection::CheckIdleTimeout()
+{
+    int64_t idle = Loop()->WheelTick() - last_active_;
+    // 循环退出时时间轮正在析构，不能再插入 (the wheel is being torn down once the loop has quit)
+    if(idle >= max_idle_time_ || !Loop()->Looping())
+    {
+        OnTimeout();
+        return;
+    }
+    ArmIdleCheck(max_idle_time_ - idle);
+}
+void TcpConnection::MoveToLoop(EventLoop *loop, MoveCompleteCallback &&cb)
+{
+    Loop()->AssertInLoopThread();
+    auto self = std::static_pointer_cast<TcpConnection>(shared_from_this());
+    if(moving_to_)
+    {
+        if(cb)
+        {
+            move_callbacks_.emplace_back(std::move(cb));
+        }
+        return;
+    }
+    if(loop == loop_ || closed_)
+    {
+        if(cb)
+        {
+            cb(self,!closed_);
+        }
+        return;
+    }
+    // 不在当前回调里直接迁移：调用方（比如 RTMP 的 play 处理）返回后还要在本循环里发送响应，
+    // 所以放到本轮的定时器阶段，那时本轮的事件和任务都已经处理完
+    // Not moved from inside the current callback: the caller (e.g. RTMP play handling) still
+    // sends its replies on this loop after returning, so the move waits for this iteration's
+    // timer phase, after every event and task of the iteration has run.
+    moving_to_ = loop;
+    if(cb)
+    {
+        move_callbacks_.emplace_back(std::move(cb));
+    }
+    Loop()->RunAfter(0, [self]() {
+        self->MoveInLoop();
+    });
+}
+
+// 停掉后端的 recv，把已经收到的数据交给上层，迁移后由目标循环的后端接着收
+// Stops the backend's recv and hands what it received to the upper layer; the target loop's backend
+// receives from there on.
+void TcpConnection::DrainReceived()
+{
+    auto self = shared_from_this();
+    Loop()->StopRecv(self);
+    while(!closed_)
+    {
+        int err = 0;
+        auto ret = Loop()->RecvQueued(self,message_buffer_,SIZE_MAX,&err);
+        if(ret > 0)
+        {
+            Loop()->AddBytesIn(ret);
+            if(message_cb_)
+            {
+                message_cb_(std::static_pointer_cast<TcpConnection>(self),message_buffer_);
+            }
+        }
+        else
+        {
+            if(ret == 0 || err != EAGAIN)
+            {
+                OnClose();
+            }
+            break;
+        }
+    }
+}
+
+void TcpConnection::MoveInLoop()
+{
+    if(!closed_ && write_in_flight_)
+    {
+        // 提交中的 writev 属于当前循环的后端，完成后再迁移 (the writev belongs to this loop's backend; move once it completes)
+        move_after_write_ = true;
+        return;
+    }
+    if(!closed_ && DataPath())
+    {
+        DrainReceived();
+    }
+    EventLoop *loop = moving_to_;
+    moving_to_ = nullptr;
+    std::vector<MoveCompleteCallback> callbacks;
+    callbacks.swap(move_callbacks_);
+    auto self = std::static_pointer_cast<TcpConnection>(shared_from_this());
+    if(closed_)
+    {
+        // 迁移前关闭了，告诉调用方没迁成 (closed before the move; tell the callers it did not happen)
+        for(auto &cb : callbacks)
+        {
+            cb(self,false);
+        }
+        return;
+    }
+    EventLoop *from = loop_;
+    from->DelEvent(self); // 只从后端删除，fd 保持打开
+
+    // 旧时间轮里的超时条目作废，到目标循环后重新开始计时
+    // Entries in the old timing wheel are disarmed; the idle check restarts on the target.
+    auto entry = timeout_entry_.lock();
+    bool check_idle = !!entry;
+    if(entry)
+    {
+        entry->conn.reset();
+    }
+    timeout_entry_.reset();
+    from->AddConnection(-1);
+
+    // 目标循环先注册再公布 loop_：公布之前投到旧循环的 Send、Active 都转给目标循环，排在注册之后，
+    // 公布之后其他线程直接投到目标循环，这时连接已经注册，开写事件不会找不到
+    // The target registers before publishing loop_: Send and Active posted to the old loop until
+    // then are forwarded to the target and queue behind the registration, and once it is published
+    // other threads post straight to the target, where the connection is already registered, so
+    // enabling writing always finds it.
+    transit_loop_.store(loop, std::memory_order_release);
+    loop->RunInLoop([self, loop, check_idle, callbacks]() {
+        loop->AddConnection(1);
+        // 边缘触发下注册时已就绪的读写也会上报，迁移期间到达的数据不会丢
+        // Readiness at registration time is reported even when edge triggered, so data that
+        // arrived during the move is not missed.
+        loop->AddEvent(self);
+        self->loop_.store(loop, std::memory_order_release);
+        self->transit_loop_.store(nullptr, std::memory_order_release);
+        if(check_idle)
+        {
+            self->EnableCheckIdleTimeout(self->max_idle_time_);
+        }
+        // 迁移期间排进队列的数据在这里开始写 (output queued during the move starts going out here)
+        if(!self->output_.Empty() && !self->closed_)
+        {
+            self->FlushOutput();
+        }
+        for(auto &cb : callbacks)
+        {
+            cb(self,!self->closed_);
+        }
+    });
+}
+
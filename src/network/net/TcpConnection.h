@@ -5,10 +5,12 @@
 #include "Connection.h"  // 包含基础连接类的定义
 #include "network/base/InetAddress.h"  // 包含网络地址类的定义
 #include "network/base/MsgBuffer.h"    // 包含消息缓冲区类的定义
+#include "OutputChain.h"               // 输出分片队列
 #include <functional>   // 用于 std::function（回调函数）
 #include <memory>       // 用于智能指针 std::shared_ptr 和 std::weak_ptr
 #include <list>         // 用于 std::list 容器
-#include <sys/uio.h>    // 用于 I/O 向量操作
+#include <deque>        // 用于零拷贝发送的待完成队列
+#include <string>
 
 namespace tmms
 {
@@ -28,6 +30,21 @@ namespace tmms
         using MessageCallback = std::function<void(const TcpConnectionPtr &, MsgBuffer &buffer)>;
         using WriteCompleteCallback = std::function<void(const TcpConnectionPtr &)>;
         using TimeoutCallback = std::function<void(const TcpConnectionPtr &)>;
+        // moved 为 false 表示连接在迁移完成前关闭了 (moved is false when the connection closed before the move completed)
+        using MoveCompleteCallback = std::function<void(const TcpConnectionPtr &, bool moved)>;
+
+        // 每个连接每轮循环最多读取的字节数，避免一个高码率推流连接饿死同一循环上的其他连接  
+        // Bytes a connection may read per loop iteration, so one fast publisher cannot starve the rest of the loop.
+        const size_t kDefaultReadBudget = 128 * 1024;
+
+        // 连续这么多次零拷贝完成通知都报告内核还是拷贝了（比如回环或网卡不支持 scatter-gather），就回退到普通发送  
+        // After this many consecutive zero-copy completions reporting that the kernel copied anyway
+        // (loopback, or a NIC without scatter-gather), the connection falls back to plain sends.
+        const uint32_t kZeroCopyCopiedLimit = 8;
+
+        // 延迟模式下按码率算出的发送缓冲区的下限  
+        // Floor of the bitrate-derived send buffer in latency mode.
+        const int32_t kMinLatencySendBuffer = 64 * 1024;
 
         // 定义一个超时条目结构体，用于管理连接的超时  
         // TimeoutEntry is a structure for managing connection timeouts.
@@ -85,32 +102,144 @@ namespace tmms
             // Handle errors (e.g., logging an error message).
             void OnError(const std::string &msg) override;
 
+            // 读取错误队列里的零拷贝完成通知，释放对应的缓冲区  
+            // Reads zero-copy completions from the error queue and releases the buffers they pinned.
+            bool OnErrorQueue() override;
+
             // 处理写事件  
             // Handle write events (e.g., data sent to the network).
             void OnWrite() override;
 
-            // 发送数据：支持两种形式  
-            // Send data with two overloads: using a list or a buffer.
+            // 发送数据。入队的数据由连接持有：带 holder 的节点和 Send(buf,size,holder) 只引用数据并持有 holder，
+            // 其他的拷贝进输出队列，所以调用返回后缓冲区就可以复用，不需要等写完成  
+            // Sends data. Queued data is owned by the connection: nodes with a holder and
+            // Send(buf,size,holder) reference the bytes and keep the holder, everything else is copied
+            // into the output queue, so buffers may be reused as soon as the call returns.
             void Send(std::list<BufferNodePtr>& list);
             void Send(const char *buf, size_t size);
+            void Send(const char *buf, size_t size, const BufferHolder &holder);
+            void Send(std::string &&data);
 
             // 处理超时事件  
             // Handle timeout events.
             void OnTimeout();
 
-            // 启用空闲超时检测  
-            // Enable idle timeout checks with a maximum idle time.
+            // 启用空闲超时检测。读写只给最后活跃时间打戳，时间轮条目到期时再检查：
+            // 空闲够了就超时，不够就按剩下的时间重新插入  
+            // Enable idle timeout checks with a maximum idle time. Reads and writes only stamp the
+            // last-activity tick; when the wheel entry expires the idle time is checked and the entry
+            // is either turned into a timeout or re-inserted for the remaining time.
             void EnableCheckIdleTimeout(int32_t max_time);
+            // 时间轮条目到期时调用 (Called when the wheel entry expires)
+            void CheckIdleTimeout();
+
+            // 设置每轮循环的读预算（字节）  
+            // Set the per-iteration read budget in bytes.
+            void SetReadBudget(size_t bytes);
+
+            // 把连接迁移到另一个事件循环，只能在当前所属循环中调用。本轮事件处理结束后从当前循环摘下，
+            // 在目标循环重新注册（fd、缓冲区和待发送数据都保留），然后在目标循环中调用 cb(conn, true)。
+            // 迁移已经在进行时再调用不会改变目标，cb 在这次迁移完成后调用。迁移完成前连接关闭了，
+            // cb 在原来的循环中以 moved 为 false 调用，调用方据此清理  
+            // Moves the connection to another event loop; call it on the owning loop. Once the current
+            // iteration's dispatch is over it is detached here and registered on the target (fd, buffers
+            // and pending output all kept), then cb(conn, true) runs on the target loop. Calls made while a
+            // move is pending keep its target; their cb runs once that move completes. If the connection
+            // closes before the move completes, cb runs on the old loop with moved false so the caller
+            // can clean up.
+            void MoveToLoop(EventLoop *loop, MoveCompleteCallback &&cb);
+
+            // 输出队列中还没写出的字节数  
+            // Bytes queued in the output list and not yet written.
+            size_t PendingBytes() const override
+            {
+                return output_.Bytes();
+            }
+            // 输出队列的硬上限（字节），超过时直接关闭连接，0 表示不限  
+            // Hard cap on the output queue in bytes; exceeding it closes the connection. 0 means no cap.
+            void SetMaxPendingBytes(size_t bytes);
+            // 读缓冲区切换到 slab 模式，解析器可以把收到的数据切片交给上层而不拷贝  
+            // Switch the read buffer to pooled slabs so parsers can hand received bytes upwards as slices.
+            void EnableSlabBuffer()
+            {
+                message_buffer_.EnableSlab();
+            }
+
+            // 延迟模式：设置 TCP_NOTSENT_LOWAT，让内核里没发出的数据不超过 notsent_lowat，
+            // 一批数据要分几次写时用 TCP_CORK 把协议头和包体攒成完整的报文段  
+            // Latency mode: sets TCP_NOTSENT_LOWAT so no more than notsent_lowat bytes wait unsent in the
+            // kernel, and corks a batch that takes several writes so headers and payloads share segments.
+            bool EnableLatencyMode(uint32_t notsent_lowat);
+            bool LatencyMode() const
+            {
+                return latency_mode_;
+            }
+            // 按码率设置 SO_SNDBUF，正好装下 target_ms 的数据；和当前值相差不到四分之一时不重新设置  
+            // Sizes SO_SNDBUF to hold target_ms of data at the given bitrate; changes under a quarter are skipped.
+            void SetSendBufferForBitrate(int64_t bytes_per_sec, uint32_t target_ms) override;
+            size_t SocketBacklogBytes() const override;
+
+            // 开启 MSG_ZEROCOPY 发送：不小于 threshold 字节的分片不拷贝进内核，
+            // 分片的所有者一直持有到内核的完成通知到达。套接字不支持或走 io_uring 数据通路时返回 false，
+            // threshold 为 0 表示关闭  
+            // Enables MSG_ZEROCOPY sends: slices of at least threshold bytes skip the copy into the
+            // kernel, and their owners are kept until the kernel's completion arrives. Returns false
+            // when the socket cannot do it or the connection uses the io_uring data path; threshold 0
+            // turns it off.
+            bool EnableZeroCopy(size_t threshold);
+            bool ZeroCopyEnabled() const
+            {
+                return zerocopy_;
+            }
+            uint64_t ZeroCopySends() const
+            {
+                return zc_sends_;
+            }
+            uint64_t ZeroCopyCopied() const  // 内核报告仍然拷贝了的发送次数 (sends the kernel reported as copied)
+            {
+                return zc_copied_;
+            }
+            size_t ZeroCopyPending() const   // 还在等完成通知的发送次数 (sends still awaiting completion)
+            {
+                return zc_pins_.size();
+            }
 
         private:
             // 内部发送数据函数  
             // Internal functions to send data in the loop.
-            void SendInLoop(const char *buf, size_t size);
+            void SendInLoop(const char *buf, size_t size, const BufferHolder &holder);
             void SendInLoop(std::list<BufferNodePtr>& list);
 
-            // 扩展连接的生命周期  
-            // Extend the life of the connection (e.g., reset timeout).
-            void ExtendLife();
+            // 扩展连接的生命周期：只记下当前刻度  
+            // Extend the life of the connection: just records the current tick.
+            void ExtendLife()
+            {
+                last_active_ = Loop()->WheelTick();
+            }
+            void ArmIdleCheck(int32_t delay);
+
+            // 从当前循环摘下并交给目标循环  
+            // Detaches from the current loop and hands over to the target.
+            void MoveInLoop();
+
+            // 写出 output_ 开头的一段，开启零拷贝时可零拷贝的连续 iovec 单独用 MSG_ZEROCOPY 发送  
+            // Writes a leading run of output_; with zero-copy on, a run of eligible iovecs goes out alone with MSG_ZEROCOPY.
+            ssize_t WriteIovecs();
+            bool IsZeroCopyEligible(size_t index) const;
+            // 输出队列超过上限时关闭连接，返回是否超限 (Closes the connection when the queue is over the cap)
+            bool CheckPendingLimit();
+            // io_uring 数据通路：收发都交给循环的后端，写一次只提交一个 writev，完成后再提交下一个  
+            // io_uring data path: the loop's backend receives and sends; one writev is in flight at a
+            // time and the next is submitted when it completes.
+            bool DataPath() const
+            {
+                return stream_ && Loop()->HasDataPath();
+            }
+            void FlushOutput();     // 让输出队列开始往外写 (Gets the output queue moving)
+            void SubmitWrite();
+            void OnWriteDone();
+            void DrainReceived();   // 迁移前取完后端已经收到的数据 (Takes what the backend received before a move)
+            void OnZeroCopyComplete(uint32_t lo, uint32_t hi, bool copied);
 
             // 成员变量  
             // Member variables
@@ -118,10 +247,36 @@ namespace tmms
             CloseConnectionCallback close_cb_;  // 关闭回调 Close callback function.
             MsgBuffer message_buffer_;  // 消息缓冲区 Message buffer.
             MessageCallback message_cb_; // 消息回调 Message callback.
-            std::vector<struct iovec> io_vec_list_;  // I/O 向量列表 I/O vector list for batch data transfer.
+            OutputChain output_;  // 输出分片队列 Output queue of owned slices.
             WriteCompleteCallback write_complete_cb_; // 写完成回调 Write complete callback.
             std::weak_ptr<TimeoutEntry> timeout_entry_; // 弱指针管理超时条目 Weak pointer to manage timeout entries.
             int32_t max_idle_time_{30}; // 最大空闲时间，单位秒 Maximum idle time in seconds (default 30).
+            uint64_t last_active_{0};   // 最后活跃时的时间轮刻度 Wheel tick of the last activity.
+            size_t read_budget_{kDefaultReadBudget}; // 每轮循环的读预算 Per-iteration read budget.
+            size_t max_pending_bytes_{0}; // 输出队列上限 Output queue cap.
+            bool latency_mode_{false}; // 延迟模式 Latency mode.
+            int32_t send_buffer_{0};   // 按码率设置的发送缓冲区 Bitrate-derived send buffer.
+            EventLoop *moving_to_{nullptr}; // 正在迁移的目标循环 Target loop of a pending move.
+            std::vector<MoveCompleteCallback> move_callbacks_; // 迁移完成后的回调 Callbacks run once the move completes.
+            bool write_in_flight_{false};  // 有一个 writev 提交给了后端 A writev is in flight in the backend.
+            bool move_after_write_{false}; // 迁移等这个 writev 完成 The move waits for that writev.
+
+            // 零拷贝发送：每次带 MSG_ZEROCOPY 的 sendmsg 占一个内核序号，完成通知按序号区间返回  
+            // Zero-copy sends: every MSG_ZEROCOPY sendmsg takes one kernel sequence number and
+            // completions come back as ranges of them.
+            struct ZeroCopyPin
+            {
+                uint32_t seq{0};
+                bool done{false};
+                std::vector<BufferHolder> holders; // 内核还在引用的缓冲区 Buffers the kernel still references.
+            };
+            bool zerocopy_{false};
+            size_t zerocopy_threshold_{0};
+            std::deque<ZeroCopyPin> zc_pins_;
+            uint32_t zc_next_seq_{0};
+            uint32_t zc_copied_streak_{0};
+            uint64_t zc_sends_{0};
+            uint64_t zc_copied_{0};
         };
 
         // TimeoutEntry 结构体：用于管理超时的连接条目  
@@ -142,7 +297,7 @@ namespace tmms
                 auto c = conn.lock(); // 锁定弱指针为共享指针 Lock the weak pointer to a shared pointer.
                 if (c)
                 {
-                    c->OnTimeout(); // 执行超时逻辑 Trigger the timeout logic.
+                    c->CheckIdleTimeout(); // 检查空闲时间，够了才超时 Time out only if idle long enough.
                 }
             }
 
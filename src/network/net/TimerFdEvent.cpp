@@ -0,0 +1,64 @@
+#include "TimerFdEvent.h"         // 包含 TimerFdEvent 类的头文件
+#include "network/base/Network.h" // 网络模块日志宏
+#include <sys/timerfd.h>          // timerfd 系统调用
+#include <unistd.h>               // read
+#include <cstring>
+#include <errno.h>
+
+using namespace tmms::network;
+
+// 构造函数：创建基于单调时钟的非阻塞 timerfd
+// Constructor: creates a non-blocking timerfd on the monotonic clock.
+TimerFdEvent::TimerFdEvent(EventLoop *loop)
+:Event(loop)
+{
+    fd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC);
+    if(fd_ < 0)
+    {
+        NETWORK_ERROR << "timerfd create failed. error:" << errno;
+        exit(-1);
+    }
+}
+
+// 读出超时次数，到期的定时器由 EventLoop 在本轮循环末尾统一执行
+// Drains the expiration count; due timers are run by EventLoop at the end of the iteration.
+void TimerFdEvent::OnRead()
+{
+    uint64_t count = 0;
+    auto ret = ::read(fd_, &count, sizeof(count));
+    if(ret < 0 && errno != EAGAIN)
+    {
+        NETWORK_ERROR << "timerfd read error. error:" << errno;
+    }
+}
+
+void TimerFdEvent::OnError(const std::string &msg)
+{
+    NETWORK_ERROR << "timerfd error:" << msg;
+}
+
+void TimerFdEvent::ArmAt(int64_t deadline_ms)
+{
+    if(deadline_ms == armed_deadline_)
+    {
+        return;
+    }
+    armed_deadline_ = deadline_ms;
+
+    struct itimerspec spec;
+    memset(&spec, 0x00, sizeof(spec));
+    if(deadline_ms >= 0)
+    {
+        // 全零表示停止，所以到期时间至少为 1 纳秒 (An all-zero value disarms, so keep it at least 1 ns)
+        spec.it_value.tv_sec = deadline_ms / 1000;
+        spec.it_value.tv_nsec = (deadline_ms % 1000) * 1000000;
+        if(spec.it_value.tv_sec == 0 && spec.it_value.tv_nsec == 0)
+        {
+            spec.it_value.tv_nsec = 1;
+        }
+    }
+    if(::timerfd_settime(fd_, TFD_TIMER_ABSTIME, &spec, nullptr) < 0)
+    {
+        NETWORK_ERROR << "timerfd settime error. error:" << errno;
+    }
+}
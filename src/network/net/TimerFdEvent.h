@@ -0,0 +1,41 @@
+#pragma once  
+// 防止头文件被重复包含，避免编译错误  
+// Prevent the header file from being included multiple times, avoiding compilation errors.
+
+#include "Event.h"  
+// 包含 Event 基类  
+// Includes the Event base class.
+
+#include <memory>  
+#include <cstdint>  
+
+namespace tmms  
+{  
+    namespace network  
+    {  
+        // TimerFdEvent：基于 timerfd 的定时唤醒事件，EventLoop 把它设置为最近一个定时器的到期时间，
+        // epoll_wait 正好睡到那一刻，不再依赖固定的超时轮询。
+        // TimerFdEvent: a timerfd based wakeup. EventLoop arms it for the next timer deadline so
+        // epoll_wait sleeps exactly until then instead of polling on a fixed timeout.
+        class TimerFdEvent: public Event  
+        {  
+        public:  
+            TimerFdEvent(EventLoop *loop);  
+            ~TimerFdEvent() = default;  
+
+            // 读出超时次数，清除可读状态  
+            // Drains the expiration count and clears the readable state.  
+            void OnRead() override;  
+            void OnError(const std::string &msg) override;  
+
+            // 设置单调时钟下的绝对到期时间（毫秒），-1 表示停止；和上次相同时不做系统调用  
+            // Arms an absolute monotonic deadline in milliseconds, -1 disarms; no syscall if unchanged.  
+            void ArmAt(int64_t deadline_ms);  
+
+        private:  
+            int64_t armed_deadline_{-1};  
+        };  
+
+        using TimerFdEventPtr = std::shared_ptr<TimerFdEvent>;  
+    }  
+}
@@ -84,6 +84,13 @@ namespace tmms // Namespace to group related code and avoid naming conflicts
             // 英文: Called periodically to advance the timing wheel and process entries.  
             // 中文: 定期调用以推动时间轮并处理已到期的条目。
 
+            uint64_t Tick() const
+            {
+                return tick_;
+            }
+            // 英文: Seconds the wheel has advanced; connections stamp their last activity with it.  
+            // 中文: 时间轮走过的秒数，连接用它给最后活跃时间打戳。
+
             void PopUp(Wheel &bq);
             // 英文: Processes all entries in the current time slot.  
             // 中文: 处理当前时间槽中的所有条目。
@@ -45,25 +45,10 @@ void UdpSocket::OnRead()
                         &len);
         if(ret > 0)
         {
-            InetAddress peeraddr;
+            // 每个数据报都直接用二进制地址，不做 inet_ntop (binary address per datagram, no inet_ntop)
+            InetAddress peeraddr((struct sockaddr *)&sock_addr);
+            Loop()->AddBytesIn(ret);
             message_buffer_.HasWritten(ret);
-
-            if(sock_addr.sin6_family == AF_INET)
-            {
-                char ip[16] = {0,};
-                struct sockaddr_in *saddr = (struct sockaddr_in*)&sock_addr;
-                ::inet_ntop(AF_INET,&(saddr->sin_addr.s_addr),ip,sizeof(ip));
-                peeraddr.SetAddr(ip);
-                peeraddr.SetPort(ntohs(saddr->sin_port));
-            }
-            else if(sock_addr.sin6_family == AF_INET6)
-            {
-                char ip[INET6_ADDRSTRLEN] = {0,};
-                ::inet_ntop(AF_INET6,&(sock_addr.sin6_addr),ip,sizeof(ip));
-                peeraddr.SetAddr(ip);
-                peeraddr.SetPort(ntohs(sock_addr.sin6_port));
-                peeraddr.SetIsIPV6(true);
-            }
             if(message_cb_)
             {
                 message_cb_(std::dynamic_pointer_cast<UdpSocket>(shared_from_this()),peeraddr,message_buffer_);
@@ -90,6 +75,27 @@ void UdpSocket::OnWrite()
         return;
     }
     ExtendLife();
+    if(Loop()->HasDataPath())
+    {
+        // 提交的 sendmsg 完成了：记下发出的字节，全部完成后再按队列继续 (submitted sendmsgs completed)
+        size_t bytes = 0;
+        int err = 0;
+        uint32_t in_flight = 0;
+        if(Loop()->TakeSendResults(shared_from_this(),&bytes,&err,&in_flight))
+        {
+            Loop()->AddBytesOut(bytes);
+            if(err != 0 && err != EINTR && err != EAGAIN && err != EWOULDBLOCK)
+            {
+                NETWORK_ERROR << "host:" << peer_addr_.ToIpPort() << " error:" << err;
+                OnClose();
+                return;
+            }
+            if(in_flight > 0)
+            {
+                return;
+            }
+        }
+    }
     while(true)
     {
         if(!buffer_list_.empty())
@@ -98,6 +104,7 @@ void UdpSocket::OnWrite()
             auto ret = ::sendto(fd_,buf->addr,buf->size,0,buf->sock_addr,buf->sock_len);
             if(ret > 0)
             {
+                Loop()->AddBytesOut(ret);
                 buffer_list_.pop_front();
             }
             else if(ret < 0)
@@ -161,37 +168,57 @@ void UdpSocket::SetWriteCompleteCallback(UdpSocketWriteCompleteCallback &&cb)
 void UdpSocket::SetTimeoutCallback(int timeout, const UdpSocketTimeoutCallback &cb)
 {
     auto us = std::dynamic_pointer_cast<UdpSocket>(shared_from_this());
-    loop_->RunAfter(timeout,[this,cb,us](){
+    Loop()->RunAfter(timeout,[this,cb,us](){
         cb(us);
     });
 }
 void UdpSocket::SetTimeoutCallback(int timeout, UdpSocketTimeoutCallback &&cb)
 {
     auto us = std::dynamic_pointer_cast<UdpSocket>(shared_from_this());
-    loop_->RunAfter(timeout,[this,cb,us](){
+    Loop()->RunAfter(timeout,[this,cb,us](){
         cb(us);
     });
 }
 void UdpSocket::EnableCheckIdleTimeout(int32_t max_time)
 {
-    auto tp = std::make_shared<UdpTimeoutEntry>(std::dynamic_pointer_cast<UdpSocket>(shared_from_this()));
     max_idle_time_ = max_time;
+    ExtendLife();
+    ArmIdleCheck(max_time);
+}
+void UdpSocket::ArmIdleCheck(int32_t delay)
+{
+    auto tp = std::make_shared<UdpTimeoutEntry>(std::dynamic_pointer_cast<UdpSocket>(shared_from_this()));
     timeout_entry_ = tp;
-    loop_->InsertEntry(max_time,tp);
+    Loop()->InsertEntry(delay,tp);
 }
-void UdpSocket::ExtendLife()
+void UdpSocket::CheckIdleTimeout()
 {
-    auto tp = timeout_entry_.lock();
-    if(tp)
+    int64_t idle = Loop()->WheelTick() - last_active_;
+    if(idle >= max_idle_time_ || !Loop()->Looping())
     {
-        loop_->InsertEntry(max_idle_time_,tp);
+        OnTimeOut();
+        return;
     }
+    ArmIdleCheck(max_idle_time_ - idle);
+}
+// 后端有数据通路时每个数据报提交一个 sendmsg（数据和地址拷进请求），本轮结束等待时一起发出；
+// 前面还有排队的数据报时不提交，保持顺序
+// With a backend data path each datagram is submitted as a sendmsg (data and address copied into the
+// request) and they all go out with this iteration's wait; nothing is submitted while earlier
+// datagrams are still queued, so order is kept.
+bool UdpSocket::SubmitDatagram(const char *buf,size_t size,struct sockaddr *saddr,socklen_t len)
+{
+    return Loop()->HasDataPath() && buffer_list_.empty()
+        && Loop()->SubmitSendmsg(shared_from_this(),buf,size,saddr,len);
 }
 void UdpSocket::SendInLoop(std::list<UdpBufferNodePtr>&list)
 {
     for(auto &i:list)
     {
-        buffer_list_.emplace_back(i);
+        if(!SubmitDatagram((const char*)i->addr,i->size,i->sock_addr,i->sock_len))
+        {
+            buffer_list_.emplace_back(i);
+        }
     }
     if(!buffer_list_.empty())
     {
@@ -200,11 +227,16 @@ void UdpSocket::SendInLoop(std::list<UdpBufferNodePtr>&list)
 }
 void UdpSocket::SendInLoop(const char *buf,size_t size,struct sockaddr*saddr,socklen_t len)
 {
+    if(SubmitDatagram(buf,size,saddr,len))
+    {
+        return;
+    }
     if(buffer_list_.empty())
     {
         auto ret = ::sendto(fd_,buf,size,0,saddr,len);
         if(ret > 0)
         {
+            Loop()->AddBytesOut(ret);
             return ;
         }
     }
@@ -214,20 +246,20 @@ void UdpSocket::SendInLoop(const char *buf,size_t size,struct sockaddr*saddr,soc
 }
 void UdpSocket::Send(std::list<UdpBufferNodePtr>&list)
 {
-    loop_->RunInLoop([this,&list](){
+    Loop()->RunInLoop([this,&list](){
         SendInLoop(list);
     });
 }
 void UdpSocket::Send(const char *buf,size_t size,struct sockaddr * addr,socklen_t len)
 {
-    loop_->RunInLoop([this,buf,size,addr,len](){
+    Loop()->RunInLoop([this,buf,size,addr,len](){
         SendInLoop(buf,size,addr,len);
     });
 }
 
 void UdpSocket::ForceClose()
 {
-    loop_->RunInLoop([this](){
+    Loop()->RunInLoop([this](){
         OnClose();
     });
 }
\ No newline at end of file
@@ -135,8 +135,12 @@ namespace tmms  // 定义顶层命名空间 tmms，避免与其他代码冲突
             // Handles connection closure events.
 
             void EnableCheckIdleTimeout(int32_t max_time);  
-            // 启用空闲超时检测。
-            // Enables idle timeout checking.
+            // 启用空闲超时检测。收发只打戳，时间轮条目到期时再检查空闲时间。
+            // Enables idle timeout checking. I/O only stamps a tick; the idle time is checked when the wheel entry expires.
+
+            void CheckIdleTimeout();  
+            // 时间轮条目到期时调用。
+            // Called when the wheel entry expires.
 
             void Send(std::list<UdpBufferNodePtr>&list);  
             // 发送一组缓冲区数据。
@@ -151,12 +155,18 @@ namespace tmms  // 定义顶层命名空间 tmms，避免与其他代码冲突
             // Forcibly closes the connection.
 
         private:
-            void ExtendLife();  
-            // 延长连接的生命周期。
-            // Extends the life of the connection.
+            void ExtendLife()
+            {
+                last_active_ = Loop()->WheelTick();
+            }
+            // 延长连接的生命周期：只记下当前刻度。
+            // Extends the life of the connection: just records the current tick.
+
+            void ArmIdleCheck(int32_t delay);
 
             void SendInLoop(std::list<UdpBufferNodePtr>&list);  
             void SendInLoop(const char *buf, size_t size, struct sockaddr*saddr, socklen_t len);  
+            bool SubmitDatagram(const char *buf, size_t size, struct sockaddr *saddr, socklen_t len);
             // 在事件循环中发送数据。
             // Sends data in the event loop.
 
@@ -169,6 +179,9 @@ namespace tmms  // 定义顶层命名空间 tmms，避免与其他代码冲突
             int32_t max_idle_time_{30};  // 最大空闲时间。
 // Maximum idle time.
 
+            uint64_t last_active_{0};  // 最后活跃时的时间轮刻度。
+// Wheel tick of the last activity.
+
             std::weak_ptr<UdpTimeoutEntry> timeout_entry_;  // 弱指针，关联超时事件。
 // Weak pointer to manage timeout entries.
 
@@ -196,7 +209,7 @@ namespace tmms  // 定义顶层命名空间 tmms，避免与其他代码冲突
                 auto c = conn.lock();
                 if(c)
                 {
-                    c->OnTimeOut();
+                    c->CheckIdleTimeout();
                 }
             }
             std::weak_ptr<UdpSocket> conn;  
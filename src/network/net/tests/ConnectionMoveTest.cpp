@@ -0,0 +1,193 @@
+#include "network/net/EventLoop.h"       // 事件循环
+#include "network/net/EventLoopThread.h" // 单个事件循环线程
+#include "network/net/TcpConnection.h"   // TCP 连接
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace tmms::network;
+
+// 连接迁移测试：连接在循环 A 上收到消息后迁移到循环 B（迁移完成前在 A 上收到的每条消息都会请求一次），
+// 检查迁移后的消息都在 B 的线程里处理、迁移期间写入的数据没有丢、之后关闭也在 B 上完成。
+// 同时另一个线程一直往连接上发数据，迁移前后投递的发送都要一个不少、不重复地到达对端。
+// 另一个连接在迁移还没进行时关闭，回调仍然要在 A 上调用，并告知没有迁移成功。
+// Connection move test: a message on loop A moves the connection to loop B (every message seen on
+// A before the move completes requests it again).
+// Checks that later messages are handled on B's thread, that data written during the move is
+// not lost, and that the close happens on B as well.
+// Meanwhile another thread keeps sending on the connection; every send posted before, during and
+// after the move must reach the peer exactly once.
+// A second connection is closed while its move is pending; its callback must still run, on A,
+// saying the move did not happen.
+
+int main(int argc, const char **argv)
+{
+    EventLoopThread thread_a, thread_b;
+    thread_a.Run();
+    thread_b.Run();
+    EventLoop *loop_a = thread_a.Loop();
+    EventLoop *loop_b = thread_b.Loop();
+
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+
+    std::atomic<int> on_a{0}, on_b{0}, bytes{0}, moved{0}, closed_on_b{0};
+    std::atomic<bool> ready{false};
+    TcpConnectionPtr conn;
+    loop_a->RunInLoop([&](){
+        conn = std::make_shared<TcpConnection>(loop_a, fds[0], InetAddress(), InetAddress());
+        conn->SetRecvMsgCallback([&](const TcpConnectionPtr &c, MsgBuffer &buf){
+            bytes += buf.ReadableBytes();
+            buf.RetrieveAll();
+            if(loop_a->IsInLoopThread())
+            {
+                on_a++;
+                c->MoveToLoop(loop_b, [&](const TcpConnectionPtr &, bool ok){
+                    if(ok)
+                    {
+                        moved++;
+                    }
+                });
+            }
+            else if(loop_b->IsInLoopThread())
+            {
+                on_b++;
+            }
+        });
+        conn->SetCloseCallback([&](const TcpConnectionPtr &c){
+            if(c->Loop() == loop_b && loop_b->IsInLoopThread())
+            {
+                closed_on_b++;
+            }
+            c->Loop()->DelEvent(c);
+        });
+        loop_a->AddEvent(conn);
+        conn->EnableCheckIdleTimeout(30);
+        ready = true;
+    });
+    while(!ready)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // 对端一直读，发送线程的每块数据开头是序号 (the peer keeps reading; each chunk starts with its index)
+    const int kChunks = 400;
+    const size_t kChunkSize = 1024;
+    std::atomic<bool> sending{true};
+    std::atomic<int64_t> received{0}, index_sum{0};
+    std::thread reader([&](){
+        std::string pending;
+        char buf[16 * 1024];
+        while(sending || received < (int64_t)(kChunks * kChunkSize))
+        {
+            ssize_t n = ::read(fds[1], buf, sizeof(buf));
+            if(n <= 0)
+            {
+                if(!sending)
+                {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                continue;
+            }
+            pending.append(buf, n);
+            received += n;
+            while(pending.size() >= kChunkSize)
+            {
+                int32_t index = 0;
+                memcpy(&index, pending.data(), sizeof(index));
+                index_sum += index;
+                pending.erase(0, kChunkSize);
+            }
+        }
+    });
+    std::thread sender([&](){
+        std::string chunk(kChunkSize, 'x');
+        for(int32_t i = 0; i < kChunks; i++)
+        {
+            memcpy(&chunk[0], &i, sizeof(i));
+            conn->Send(chunk.data(), chunk.size());
+            if(i % 20 == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    });
+
+    ::write(fds[1], "first", 5);
+    ::write(fds[1], "-during-move", 12); // 可能在迁移过程中到达 (may arrive mid-move)
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    for(int i = 0; i < 10; i++)
+    {
+        ::write(fds[1], "0123456789", 10);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    int a_conns = loop_a->Connections(), b_conns = loop_b->Connections();
+    sender.join();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    sending = false;
+    reader.join();
+    int64_t expect_sum = (int64_t)kChunks * (kChunks - 1) / 2;
+    ::close(fds[1]);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    std::cout << "reads on A:" << on_a << " reads on B:" << on_b
+              << " bytes:" << bytes << "/117"
+              << " moved:" << moved
+              << " connections A/B:" << a_conns << "/" << b_conns
+              << " sent:" << received << "/" << kChunks * kChunkSize
+              << " closed on B:" << closed_on_b << std::endl;
+    bool ok = on_a >= 1 && on_b >= 10 && bytes == 117 && moved == on_a
+              && a_conns == 0 && b_conns == 1 && closed_on_b == 1
+              && received == (int64_t)(kChunks * kChunkSize) && index_sum == expect_sum;
+    loop_b->RunInLoop([&](){
+        conn.reset();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // 迁移途中关闭 (closed mid-move)
+    int fds2[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds2);
+    std::atomic<int> aborted_on_a{0}, completed{0};
+    std::atomic<bool> closed_done{false};
+    TcpConnectionPtr conn2;
+    loop_a->RunInLoop([&](){
+        conn2 = std::make_shared<TcpConnection>(loop_a, fds2[0], InetAddress(), InetAddress());
+        conn2->SetCloseCallback([](const TcpConnectionPtr &c){
+            c->Loop()->DelEvent(c);
+        });
+        loop_a->AddEvent(conn2);
+        conn2->MoveToLoop(loop_b, [&](const TcpConnectionPtr &, bool ok){
+            if(ok)
+            {
+                completed++;
+            }
+            else if(loop_a->IsInLoopThread())
+            {
+                aborted_on_a++;
+            }
+        });
+        conn2->ForceClose();
+        closed_done = true;
+    });
+    while(!closed_done)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::cout << "closed mid-move: aborted on A:" << aborted_on_a << " completed:" << completed
+              << " connections A/B:" << loop_a->Connections() << "/" << loop_b->Connections() << std::endl;
+    ok = ok && aborted_on_a == 1 && completed == 0 && loop_b->Connections() == 0;
+    loop_a->RunInLoop([&](){
+        conn2.reset();
+    });
+    ::close(fds2[1]);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
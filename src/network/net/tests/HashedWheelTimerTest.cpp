@@ -0,0 +1,114 @@
+#include "network/net/HashedWheelTimer.h" // 毫秒分层时间轮
+#include "network/net/EventLoop.h"        // 事件循环
+#include "network/net/EventLoopThread.h"  // 单个事件循环线程
+#include <iostream>
+#include <random>
+#include <atomic>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace tmms::network;
+
+// 用模拟时间检查时间轮：每个定时器都不早于、也不晚于到期时间所在的那一次推进触发，取消的不触发
+// Drives the wheel with simulated time: every timer fires in exactly the Advance() step that
+// crosses its expiry, never earlier or later, and cancelled timers never fire.
+bool TestWheelAccuracy()
+{
+    HashedWheelTimer wheel;
+    std::mt19937_64 rng(1);
+    int64_t now = HashedWheelTimer::NowMs();
+    int64_t last = now;
+    std::unordered_map<TimerId, int64_t> pending;
+    std::unordered_set<TimerId> cancelled;
+    int fired = 0, early = 0, late = 0, fired_cancelled = 0;
+
+    TimerId id = 1;
+    for(int i = 0; i < 20000; i++, id++)
+    {
+        // 三分之一的定时器跨越 1 小时以上，覆盖多层降级
+        // A third of the timers span more than an hour to exercise multi-level cascades.
+        int64_t delay = rng() % (i % 3 == 0 ? 5000000 : 70000);
+        int64_t expire = now + delay;
+        TimerId tid = id;
+        pending[tid] = expire;
+        wheel.Add(tid, expire, 0, [&, expire, tid](){
+            fired++;
+            if(now < expire)
+            {
+                early++;
+            }
+            if(last >= expire)
+            {
+                late++;
+            }
+            if(cancelled.count(tid))
+            {
+                fired_cancelled++;
+            }
+            pending.erase(tid);
+        });
+    }
+    for(TimerId c = 2; c < id; c += 7)
+    {
+        if(wheel.Cancel(c))
+        {
+            pending.erase(c);
+            cancelled.insert(c);
+        }
+    }
+
+    int64_t end = now + 5100000;
+    while(now < end)
+    {
+        last = now;
+        now += 1 + rng() % 50;
+        wheel.Advance(now);
+    }
+    bool ok = fired + (int)cancelled.size() == (int)(id - 1) && early == 0 && late == 0 && fired_cancelled == 0
+              && pending.empty() && wheel.Size() == 0;
+    std::cout << "fired:" << fired << " early:" << early << " late:" << late
+              << " cancelled:" << cancelled.size() << " fired after cancel:" << fired_cancelled
+              << " never fired:" << pending.size() << " left in wheel:" << wheel.Size()
+              << (ok ? " ok" : " failed") << std::endl;
+    return ok;
+}
+
+// 真实事件循环上的毫秒定时器：timerfd 唤醒误差和取消。机器忙的时候唤醒会晚，所以晚到的上限放得宽
+// Millisecond timers on a real loop: timerfd wakeup error and cancellation. Wakeups run late on
+// a busy machine, so the lateness bounds are loose.
+bool TestLoopTimers()
+{
+    EventLoopThread eventloop_thread;
+    eventloop_thread.Run();
+    EventLoop *loop = eventloop_thread.Loop();
+
+    int64_t start = HashedWheelTimer::NowMs();
+    std::atomic<int64_t> after5{0}, after300{0};
+    std::atomic<int> every{0}, cancelled{0};
+    loop->RunAfter(0.005, [&](){ after5 = HashedWheelTimer::NowMs() - start; });
+    loop->RunAfter(0.3, [&](){ after300 = HashedWheelTimer::NowMs() - start; });
+    TimerId c = loop->RunAfter(0.1, [&](){ cancelled++; });
+    loop->CancelTimer(c);
+    TimerId e = loop->RunEvery(0.01, [&](){ every++; });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(505));
+    loop->CancelTimer(e);
+    const int64_t kSlackMs = 100;
+    bool ok = after5 >= 5 && after5 <= 5 + kSlackMs
+              && after300 >= 300 && after300 <= 300 + kSlackMs
+              && every >= 25 && every <= 51
+              && cancelled == 0;
+    std::cout << "run after 5ms at:" << after5 << "ms, 300ms at:" << after300
+              << "ms, every 10ms ran " << every << " times in 505ms, cancelled ran " << cancelled << " times"
+              << (ok ? " ok" : " failed") << std::endl;
+    return ok;
+}
+
+int main(int argc, const char **argv)
+{
+    bool ok = TestWheelAccuracy();
+    ok = TestLoopTimers() && ok;
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
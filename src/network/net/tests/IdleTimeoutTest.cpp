@@ -0,0 +1,123 @@
+#include "network/net/EventLoop.h"       // 事件循环
+#include "network/net/EventLoopThread.h" // 单个事件循环线程
+#include "network/net/TcpConnection.h"   // TCP 连接
+#include "network/net/TimingWheel.h"     // 时间轮
+#include "base/TTime.h"
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace tmms::network;
+
+// 空闲超时测试：
+// 1. 热路径开销：旧做法每次读写都把超时条目重新插入时间轮（哈希插入 + 引用计数），
+//    新做法只给最后活跃刻度打戳，对比同样次数的 ExtendLife 耗时。
+// 2. 语义：对端持续发送时连接不超时，停止发送后在 max_idle 秒左右超时关闭。
+// Idle timeout test:
+// 1. Hot-path cost: the old ExtendLife re-inserted the timeout entry into the wheel on every read
+//    and write (hash insert plus refcount traffic); the new one only stamps the last-activity
+//    tick. The same number of calls is timed for both.
+// 2. Semantics: a connection whose peer keeps sending does not time out, and once the peer goes
+//    quiet it is closed after about max_idle seconds.
+
+namespace
+{
+    const int kConnections = 10000;
+    const int kCalls = 10000000;
+    const int kMaxIdle = 2;
+
+    void BenchHotPath()
+    {
+        TimingWheel wheel;
+        std::vector<EntryPtr> entries;
+        for(int i = 0; i < kConnections; i++)
+        {
+            entries.emplace_back(std::make_shared<int>(i));
+        }
+        int64_t start = tmms::base::TTime::NowMS();
+        for(int i = 0; i < kCalls; i++)
+        {
+            wheel.InsertEntry(30, entries[i % kConnections]);
+        }
+        int64_t reinsert_ms = tmms::base::TTime::NowMS() - start;
+
+        std::vector<uint64_t> last_active(kConnections);
+        start = tmms::base::TTime::NowMS();
+        for(int i = 0; i < kCalls; i++)
+        {
+            last_active[i % kConnections] = wheel.Tick();
+            asm volatile("" ::: "memory");
+        }
+        int64_t stamp_ms = tmms::base::TTime::NowMS() - start;
+        std::cout << kCalls << " ExtendLife calls over " << kConnections << " connections: "
+                  << "re-insert " << reinsert_ms << "ms, stamp " << stamp_ms << "ms" << std::endl;
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    BenchHotPath();
+
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    EventLoopThread eventloop_thread;
+    eventloop_thread.Run();
+    EventLoop *loop = eventloop_thread.Loop();
+
+    std::atomic<bool> closed{false};
+    std::atomic<bool> ready{false};
+    TcpConnectionPtr conn;
+    loop->RunInLoop([&](){
+        conn = std::make_shared<TcpConnection>(loop, fds[0], InetAddress(), InetAddress());
+        conn->SetCloseCallback([&](const TcpConnectionPtr &){
+            closed = true;
+        });
+        loop->AddEvent(conn);
+        conn->EnableCheckIdleTimeout(kMaxIdle);
+        ready = true;
+    });
+    while(!ready)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // 持续发送比 max_idle 更久 (keep sending for longer than max_idle)
+    for(int i = 0; i < 12; i++)
+    {
+        ::write(fds[1], "x", 1);
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    }
+    bool alive_while_active = !closed;
+
+    int64_t quiet = tmms::base::TTime::NowMS();
+    while(!closed && tmms::base::TTime::NowMS() - quiet < 10000)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    int64_t idle_ms = tmms::base::TTime::NowMS() - quiet;
+
+    std::atomic<bool> done{false};
+    loop->RunInLoop([&](){
+        conn->ForceClose();
+        loop->DelEvent(conn);
+        conn.reset();
+        done = true;
+    });
+    while(!done)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ::close(fds[1]);
+
+    // 时间轮按秒走，超时落在 max_idle 到 max_idle + 2 秒之间 (the wheel ticks per second)
+    bool ok = alive_while_active && closed && idle_ms >= (kMaxIdle - 1) * 1000 && idle_ms <= (kMaxIdle + 2) * 1000;
+    std::cout << "alive while active:" << alive_while_active
+              << " closed after idle:" << closed.load()
+              << " idle ms:" << idle_ms << std::endl;
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
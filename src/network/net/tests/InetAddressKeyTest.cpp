@@ -0,0 +1,86 @@
+#include "network/base/InetAddress.h" // 网络地址类
+#include "base/TTime.h"
+#include <iostream>
+#include <string>
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+
+using namespace tmms::network;
+
+// 二进制地址测试：字符串和 sockaddr 两种构造方式得到同一个地址，比较和哈希一致，
+// 还没解析的域名原样保留；最后对比用字符串 ToIpPort() 和用 InetAddress 作为哈希表键的查找耗时。
+// Binary address test: building from a string and from a sockaddr yields the same address, equality
+// and hash agree, and an unresolved domain is kept verbatim. Finally, lookups keyed by ToIpPort()
+// strings are timed against lookups keyed by InetAddress itself.
+
+namespace
+{
+    const int kPeers = 1000;
+    const int kLookups = 1000000;
+
+    bool Check(bool cond, const char *what)
+    {
+        std::cout << what << ": " << (cond ? "ok" : "failed") << std::endl;
+        return cond;
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    bool ok = true;
+
+    InetAddress a("192.168.1.20", (uint16_t)1935);
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(1935);
+    ::inet_pton(AF_INET, "192.168.1.20", &sin.sin_addr);
+    InetAddress b((struct sockaddr *)&sin);
+    ok = Check(a == b && a.Hash() == b.Hash() && b.ToIpPort() == "192.168.1.20:1935", "v4 string == sockaddr") && ok;
+    ok = Check(a.IsLanIp() && !a.IsLoopbackIp() && InetAddress("127.0.0.1:80").IsLoopbackIp(), "lan/loopback") && ok;
+
+    InetAddress c("192.168.1.20", (uint16_t)1936);
+    ok = Check(a != c, "port differs") && ok;
+
+    InetAddress v6("::1", 8000, true);
+    struct sockaddr_in6 sin6;
+    v6.GetSockAddr((struct sockaddr *)&sin6);
+    ok = Check(v6.IsIpV6() && InetAddress((struct sockaddr *)&sin6) == v6 && v6.IP() == "::1" && v6.Port() == 8000, "v6 round trip") && ok;
+
+    InetAddress domain("www.example.com:80");
+    ok = Check(domain.IP() == "www.example.com" && domain.Port() == 80, "unresolved domain kept") && ok;
+    domain.SetAddr("10.0.0.1");
+    ok = Check(domain.ToIpPort() == "10.0.0.1:80", "resolved domain") && ok;
+
+    std::unordered_map<std::string, int> by_string;
+    std::unordered_map<InetAddress, int> by_addr;
+    std::vector<InetAddress> peers;
+    for(int i = 0; i < kPeers; i++)
+    {
+        InetAddress peer("10.1." + std::to_string(i / 250) + "." + std::to_string(i % 250), (uint16_t)(40000 + i));
+        peers.push_back(peer);
+        by_string.emplace(peer.ToIpPort(), i);
+        by_addr.emplace(peer, i);
+    }
+    ok = Check(by_addr.size() == (size_t)kPeers, "distinct keys") && ok;
+
+    int64_t hits = 0;
+    int64_t start = tmms::base::TTime::NowMS();
+    for(int i = 0; i < kLookups; i++)
+    {
+        hits += by_string.find(peers[i % kPeers].ToIpPort())->second;
+    }
+    int64_t string_ms = tmms::base::TTime::NowMS() - start;
+    start = tmms::base::TTime::NowMS();
+    for(int i = 0; i < kLookups; i++)
+    {
+        hits -= by_addr.find(peers[i % kPeers])->second;
+    }
+    int64_t addr_ms = tmms::base::TTime::NowMS() - start;
+    std::cout << kLookups << " lookups: string key " << string_ms << "ms, binary key " << addr_ms << "ms" << std::endl;
+    ok = Check(hits == 0, "same results") && ok;
+
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,382 @@
+#include "network/net/EventLoop.h"       // 事件循环
+#include "network/net/EventLoopThread.h" // 单个事件循环线程
+#include "network/net/TcpConnection.h"   // TCP 连接
+#include "TcpPair.h"                     // 回环 TCP 连接对 (loopback TCP pair)
+#include "network/net/UdpSocket.h"       // UDP 套接字
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+using namespace tmms::network;
+
+// io_uring 数据通路测试：
+// 1. 正确性：连接由后端的多次触发 recv 收数据、writev 提交给后端发数据。多个连接同时回显，
+//    读预算很小时接收缓冲区会被占满（recv 收到 ENOBUFS 后停下，还回缓冲区后重新提交），
+//    对端收到的数据要完整有序；对端关闭时连接被关闭；UDP 的 sendmsg 提交后数据报都到达，
+//    写完成回调被调用。
+// 2. 基准：64 个回环连接做乒乓回显，服务端分别用 epoll 和 io_uring 数据通路，
+//    比较每秒往返次数和每次往返的 CPU 时间（用户态 + 内核态，客户端和服务端在同一个进程里）。
+// io_uring data path test:
+// 1. Correctness: connections receive through the backend's multishot recv and send through
+//    writevs submitted to it. Several connections echo at once, with a read budget small enough
+//    that the receive buffers fill up (the recv stops on ENOBUFS and is re-armed once buffers come
+//    back), and the peers must get their data back intact and in order; a peer's close closes the
+//    connection; submitted UDP sendmsgs all arrive and the write-complete callback runs.
+// 2. Benchmark: ping-pong echo over 64 loopback connections with the server on epoll and on the
+//    io_uring data path, comparing round trips per second and CPU time per round trip (user +
+//    system, client and server in the same process).
+
+namespace
+{
+    const int kEchoConns = 16;
+    const size_t kEchoBytes = 2 * 1024 * 1024;
+    const int kBenchConns = 64;
+    const size_t kMessage = 256;
+    const int kInFlight = 4;
+    const int kBenchMs = 1000;
+    const int kDatagrams = 1000;
+
+    // 按类型创建循环线程 (Starts a loop thread on the given backend)
+    std::unique_ptr<EventLoopThread> StartLoop(PollerType type)
+    {
+        Poller::SetDefaultType(type);
+        std::unique_ptr<EventLoopThread> t(new EventLoopThread());
+        t->Run();
+        return t;
+    }
+
+    TcpConnectionPtr Echo(EventLoop *loop, int fd, size_t budget, std::atomic<int> *closed)
+    {
+        auto conn = std::make_shared<TcpConnection>(loop, fd, InetAddress(), InetAddress());
+        conn->SetReadBudget(budget);
+        conn->SetRecvMsgCallback([](const TcpConnectionPtr &c, MsgBuffer &buf){
+            c->Send(buf.Peek(), buf.ReadableBytes());
+            buf.RetrieveAll();
+        });
+        conn->SetCloseCallback([closed](const TcpConnectionPtr &c){
+            if(closed)
+            {
+                (*closed)++;
+            }
+            c->Loop()->DelEvent(c);
+        });
+        loop->AddEvent(conn);
+        return conn;
+    }
+
+    bool TestEcho(EventLoop *loop, size_t budget)
+    {
+        std::vector<int> peers;
+        std::vector<TcpConnectionPtr> conns;
+        std::atomic<int> closed{0};
+        std::atomic<bool> added{false};
+        std::vector<int> fds(kEchoConns);
+        for(int i = 0; i < kEchoConns; i++)
+        {
+            int pair[2];
+            if(!test::TcpPair(pair))
+            {
+                return false;
+            }
+            fds[i] = pair[0];
+            peers.push_back(pair[1]);
+        }
+        loop->RunInLoop([&](){
+            for(auto fd : fds)
+            {
+                conns.push_back(Echo(loop, fd, budget, &closed));
+            }
+            added = true;
+        });
+        while(!added)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // 每个连接一个写线程一个读线程，字节 i 的值是 (i * 7 + 连接号) 的低 8 位
+        // One writer and one reader per connection; byte i holds the low 8 bits of (i * 7 + connection).
+        std::atomic<int> bad{0};
+        std::vector<std::thread> threads;
+        for(int c = 0; c < kEchoConns; c++)
+        {
+            int fd = peers[c];
+            threads.emplace_back([fd, c](){
+                std::vector<char> chunk(16 * 1024);
+                size_t sent = 0;
+                while(sent < kEchoBytes)
+                {
+                    size_t n = std::min(chunk.size(), kEchoBytes - sent);
+                    for(size_t i = 0; i < n; i++)
+                    {
+                        chunk[i] = (char)((sent + i) * 7 + c);
+                    }
+                    size_t off = 0;
+                    while(off < n)
+                    {
+                        auto ret = ::write(fd, chunk.data() + off, n - off);
+                        if(ret <= 0)
+                        {
+                            return;
+                        }
+                        off += ret;
+                    }
+                    sent += n;
+                }
+            });
+            threads.emplace_back([fd, c, &bad](){
+                std::vector<char> buf(64 * 1024);
+                size_t got = 0;
+                while(got < kEchoBytes)
+                {
+                    auto ret = ::read(fd, buf.data(), buf.size());
+                    if(ret <= 0)
+                    {
+                        bad++;
+                        return;
+                    }
+                    for(ssize_t i = 0; i < ret; i++)
+                    {
+                        if(buf[i] != (char)((got + i) * 7 + c))
+                        {
+                            bad++;
+                            return;
+                        }
+                    }
+                    got += ret;
+                }
+            });
+        }
+        for(auto &t : threads)
+        {
+            t.join();
+        }
+        for(auto fd : peers)
+        {
+            ::close(fd);
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while(closed.load() < kEchoConns && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        bool ok = bad.load() == 0 && closed.load() == kEchoConns;
+        std::cout << "echo, " << kEchoConns << " connections x " << kEchoBytes << " bytes, read budget "
+                  << budget << ": corrupt/short " << bad.load() << ", closed " << closed.load()
+                  << (ok ? " ok" : " failed") << std::endl;
+        loop->RunInLoop([&](){
+            conns.clear();
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        return ok;
+    }
+
+    bool TestUdp(EventLoop *loop)
+    {
+        int rfd = ::socket(AF_INET, SOCK_DGRAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        int size = 4 * 1024 * 1024;
+        ::setsockopt(rfd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+        ::bind(rfd, (struct sockaddr *)&addr, sizeof(addr));
+        ::getsockname(rfd, (struct sockaddr *)&addr, &len);
+        int sfd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+
+        std::atomic<int> completes{0};
+        UdpSocketPtr sock;
+        loop->RunInLoop([&](){
+            sock = std::make_shared<UdpSocket>(loop, sfd, InetAddress(), InetAddress());
+            sock->SetWriteCompleteCallback([&](const UdpSocketPtr &){
+                completes++;
+            });
+            loop->AddEvent(sock);
+            // 数据和地址在提交时拷走，这里的栈缓冲区马上复用 (data and address are copied on submit, so the stack buffer is reused)
+            for(int i = 0; i < kDatagrams; i++)
+            {
+                char msg[64];
+                int n = snprintf(msg, sizeof(msg), "datagram %d", i);
+                sock->Send(msg, n, (struct sockaddr *)&addr, sizeof(addr));
+            }
+        });
+        int got = 0, bad = 0;
+        struct timeval tv = {1, 0};
+        ::setsockopt(rfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        char buf[128];
+        while(got < kDatagrams)
+        {
+            auto n = ::recv(rfd, buf, sizeof(buf) - 1, 0);
+            if(n <= 0)
+            {
+                break;
+            }
+            buf[n] = 0;
+            if(std::string(buf) != "datagram " + std::to_string(got))
+            {
+                bad++;
+            }
+            got++;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        bool ok = got == kDatagrams && bad == 0 && (!loop->HasDataPath() || completes.load() > 0);
+        std::cout << "udp: sent " << kDatagrams << " received " << got << " out of order " << bad
+                  << " write completes " << completes.load() << (ok ? " ok" : " failed") << std::endl;
+        loop->RunInLoop([&](){
+            loop->DelEvent(sock);
+            sock.reset();
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ::close(rfd);
+        return ok;
+    }
+
+    double CpuSeconds()
+    {
+        struct rusage ru;
+        ::getrusage(RUSAGE_SELF, &ru);
+        return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+    }
+
+    struct Result
+    {
+        double round_trips{0};  // 每秒往返次数 (round trips per second)
+        double cpu_us{0};       // 每次往返的 CPU 时间，微秒 (CPU time per round trip, us)
+        double wakeups{0};      // 服务端每次往返的循环轮数 (server loop iterations per round trip)
+    };
+
+    // 客户端在 epoll 循环上，收到一条完整消息就发回去；服务端原样回显
+    // Clients sit on an epoll loop and send back every complete message; the server echoes as is.
+    Result Bench(PollerType server_type)
+    {
+        auto server = StartLoop(server_type);
+        auto client = StartLoop(kPollerEpoll);
+        EventLoop *sl = server->Loop();
+        EventLoop *cl = client->Loop();
+        std::atomic<uint64_t> trips{0};
+        std::atomic<bool> running{true};
+        std::vector<TcpConnectionPtr> servers, clients;
+        std::atomic<int> ready{0};
+        std::vector<int> sfds, cfds;
+        for(int i = 0; i < kBenchConns; i++)
+        {
+            int pair[2];
+            test::TcpPair(pair);
+            ::fcntl(pair[1], F_SETFL, O_NONBLOCK);
+            sfds.push_back(pair[0]);
+            cfds.push_back(pair[1]);
+        }
+        sl->RunInLoop([&](){
+            for(auto fd : sfds)
+            {
+                servers.push_back(Echo(sl, fd, kDefaultReadBudget, nullptr));
+            }
+            ready++;
+        });
+        cl->RunInLoop([&](){
+            for(auto fd : cfds)
+            {
+                auto conn = std::make_shared<TcpConnection>(cl, fd, InetAddress(), InetAddress());
+                conn->SetRecvMsgCallback([&](const TcpConnectionPtr &c, MsgBuffer &buf){
+                    while(buf.ReadableBytes() >= kMessage)
+                    {
+                        trips++;
+                        if(running.load(std::memory_order_relaxed))
+                        {
+                            c->Send(buf.Peek(), kMessage);
+                        }
+                        buf.Retrieve(kMessage);
+                    }
+                });
+                cl->AddEvent(conn);
+                clients.push_back(conn);
+            }
+            ready++;
+        });
+        while(ready.load() < 2)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        uint64_t iterations = sl->Iterations();
+        double cpu = CpuSeconds();
+        cl->RunInLoop([&](){
+            std::string msg(kMessage, 'x');
+            for(auto &c : clients)
+            {
+                for(int i = 0; i < kInFlight; i++)
+                {
+                    c->Send(msg.data(), msg.size());
+                }
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(kBenchMs));
+        uint64_t n = trips.load();
+        Result r;
+        r.cpu_us = (CpuSeconds() - cpu) * 1e6 / (n ? n : 1);
+        r.wakeups = (double)(sl->Iterations() - iterations) / (n ? n : 1);
+        r.round_trips = n * 1000.0 / kBenchMs;
+        running = false;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        std::atomic<int> done{0};
+        cl->RunInLoop([&](){
+            for(auto &c : clients)
+            {
+                cl->DelEvent(c);
+            }
+            clients.clear();
+            done++;
+        });
+        sl->RunInLoop([&](){
+            for(auto &c : servers)
+            {
+                sl->DelEvent(c);
+            }
+            servers.clear();
+            done++;
+        });
+        while(done.load() < 2)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return r;
+    }
+
+    void Print(const char *name, const Result &r)
+    {
+        std::cout << name << ": " << (uint64_t)r.round_trips << " round trips/s, " << r.cpu_us
+                  << " us CPU per round trip, " << r.wakeups << " server iterations per round trip" << std::endl;
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    auto thread = StartLoop(kPollerIoUring);
+    EventLoop *loop = thread->Loop();
+    if(!loop->HasDataPath())
+    {
+        // 内核不支持时连接照常自己读写，这里没有可测的 (without kernel support connections read and write themselves)
+        std::cout << "io_uring data path not available, skipped." << std::endl;
+        return 0;
+    }
+    bool ok = TestEcho(loop, kDefaultReadBudget);
+    ok = TestEcho(loop, 1024) && ok;
+    ok = TestUdp(loop) && ok;
+
+    std::cout << "ping-pong, " << kBenchConns << " connections, " << kMessage << " byte messages, "
+              << kInFlight << " in flight each" << std::endl;
+    Print("epoll", Bench(kPollerEpoll));
+    Print("io_uring data path", Bench(kPollerIoUring));
+    std::cout << (ok ? "PASS" : "FAIL") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include "network/net/EventLoop.h"       // 事件循环
+#include "network/net/EventLoopThread.h" // 单个事件循环线程
+#include "network/net/TcpConnection.h"   // TCP 连接
+#include "TcpPair.h"                     // 回环 TCP 连接对 (loopback TCP pair)
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <list>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+using namespace tmms::network;
+
+// 延迟模式测试：回环 TCP 连接开启延迟模式，检查 TCP_NOTSENT_LOWAT 和按码率设置的 SO_SNDBUF 生效；
+// 对端不读时发送一批数据，内核积压（SIOCOUTQ）大于 0，多出的数据留在连接的输出队列里；
+// 对端读完之后积压和输出队列都回到 0。
+// Latency mode test: turn latency mode on for a loopback TCP connection and check that
+// TCP_NOTSENT_LOWAT and the bitrate-sized SO_SNDBUF take effect. With the peer not reading, a
+// batch of data leaves a kernel backlog (SIOCOUTQ) above zero and the rest stays in the
+// connection's output queue; once the peer drains everything both drop back to zero.
+
+namespace
+{
+    const uint32_t kNotSentLowat = 16 * 1024;
+    const size_t kChunkSize = 64 * 1024;
+    const int kChunks = 64;
+
+    int GetIntOpt(int fd, int level, int name)
+    {
+        int val = 0;
+        socklen_t len = sizeof(val);
+        ::getsockopt(fd, level, name, &val, &len);
+        return val;
+    }
+
+    template <typename F>
+    void RunAndWait(EventLoop *loop, F f)
+    {
+        std::atomic<bool> done{false};
+        loop->RunInLoop([&](){
+            f();
+            done = true;
+        });
+        while(!done)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    int fds[2];
+    if(!test::TcpPair(fds))
+    {
+        std::cout << "create loopback tcp pair failed." << std::endl;
+        return 1;
+    }
+
+    EventLoopThread eventloop_thread;
+    eventloop_thread.Run();
+    EventLoop *loop = eventloop_thread.Loop();
+
+    int sndbuf_before = GetIntOpt(fds[0], SOL_SOCKET, SO_SNDBUF);
+    bool enabled = false;
+    auto chunk = std::make_shared<std::string>(kChunkSize, 'x');
+    TcpConnectionPtr conn;
+    RunAndWait(loop, [&](){
+        conn = std::make_shared<TcpConnection>(loop, fds[0], InetAddress(), InetAddress());
+        loop->AddEvent(conn);
+        enabled = conn->EnableLatencyMode(kNotSentLowat);
+        conn->SetSendBufferForBitrate(1024 * 1024, 500);  // 1MB/s 装 500ms (500ms of a 1MB/s stream)
+        std::list<BufferNodePtr> list;
+        for(int i = 0; i < kChunks; i++)
+        {
+            list.emplace_back(std::make_shared<BufferNode>((void *)chunk->data(), chunk->size(), chunk));
+        }
+        conn->Send(list);
+    });
+    int lowat = GetIntOpt(fds[0], IPPROTO_TCP, TCP_NOTSENT_LOWAT);
+    int sndbuf = GetIntOpt(fds[0], SOL_SOCKET, SO_SNDBUF);
+
+    size_t backlog = 0, pending = 0;
+    RunAndWait(loop, [&](){
+        backlog = conn->SocketBacklogBytes();
+        pending = conn->PendingBytes();
+    });
+    std::cout << "latency mode:" << enabled
+              << " notsent_lowat:" << lowat
+              << " sndbuf:" << sndbuf_before << "->" << sndbuf
+              << " backlog:" << backlog
+              << " pending:" << pending << std::endl;
+
+    size_t received = 0;
+    std::vector<char> buf(kChunkSize);
+    while(received < kChunkSize * kChunks)
+    {
+        ssize_t n = ::read(fds[1], buf.data(), buf.size());
+        if(n <= 0)
+        {
+            break;
+        }
+        received += n;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    size_t backlog_after = 0, pending_after = 0;
+    RunAndWait(loop, [&](){
+        backlog_after = conn->SocketBacklogBytes();
+        pending_after = conn->PendingBytes();
+        conn->ForceClose();
+        loop->DelEvent(conn);
+        conn.reset();
+    });
+    ::close(fds[1]);
+    std::cout << "drained: received:" << received << "/" << kChunkSize * kChunks
+              << " backlog:" << backlog_after
+              << " pending:" << pending_after << std::endl;
+
+    bool ok = enabled && lowat == (int)kNotSentLowat && sndbuf != sndbuf_before
+              && backlog > 0 && pending > 0
+              && received == kChunkSize * kChunks && backlog_after == 0 && pending_after == 0;
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
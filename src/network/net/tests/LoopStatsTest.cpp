@@ -0,0 +1,83 @@
+#include "network/net/EventLoop.h"       // 事件循环
+#include "network/net/EventLoopThread.h" // 单个事件循环线程
+#include <iostream>
+#include <thread>
+#include <chrono>
+
+using namespace tmms::network;
+
+// 循环统计测试：开启统计后投递一批任务（其中一个故意耗时 20 毫秒）和若干定时器，
+// 然后打印等待时间、回调时间、任务排队时间和定时器延迟；再关闭统计确认计数不再增长。
+// Loop stats test: with stats on, posts a stream of tasks (one deliberately takes 20 ms) plus a
+// few timers, then prints wait, callback, task queueing and timer lag figures; finally turns stats
+// off and checks the counters stop moving.
+
+namespace
+{
+    void Print(const char *name, const Log2Histogram &h)
+    {
+        std::cout << name << ": count " << h.Count()
+                  << " avg " << (h.Count() > 0 ? h.Sum() / h.Count() : 0)
+                  << " p50 " << h.Percentile(0.5)
+                  << " p99 " << h.Percentile(0.99)
+                  << " max " << h.Max() << std::endl;
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    EventLoopThread eventloop_thread;
+    eventloop_thread.Run();
+    EventLoop *loop = eventloop_thread.Loop();
+    loop->EnableStats(true);
+
+    for(int i = 0; i < 5; i++)
+    {
+        loop->RunAfter(0.01 * (i + 1), [](){});
+    }
+    for(int i = 0; i < 2000; i++)
+    {
+        loop->RunInLoop([](){});
+        if(i == 1000)
+        {
+            loop->RunInLoop([](){
+                std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            });
+        }
+        if(i % 100 == 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    // 等一个 1 秒窗口结束，让最大值和速率发布出来 (wait for a 1 s window so maxima and rates are published)
+    std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+
+    const LoopStats &stats = loop->Stats();
+    Print("poll wait us", stats.PollWait());
+    Print("iteration callbacks us", stats.IterationCallbacks());
+    Print("callback us", stats.Callback());
+    Print("task batch", stats.TaskBatch());
+    Print("task age us", stats.TaskAge());
+    Print("timer lag us", stats.TimerLag());
+    std::cout << "iterations/s " << stats.IterationsPerSec()
+              << " wakeups/s " << stats.WakeupsPerSec()
+              << " callback max us " << stats.CallbackMaxUs()
+              << " task age max us " << stats.TaskAgeMaxUs()
+              << " timer lag max us " << stats.TimerLagMaxUs() << std::endl;
+    if(stats.Callback().Max() < 20000)
+    {
+        std::cout << "FAIL: the 20 ms task was not seen" << std::endl;
+        return 1;
+    }
+
+    loop->EnableStats(false);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    uint64_t before = stats.Callback().Count();
+    for(int i = 0; i < 100; i++)
+    {
+        loop->RunInLoop([](){});
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    std::cout << "callbacks recorded while disabled: " << stats.Callback().Count() - before << std::endl;
+    return stats.Callback().Count() == before ? 0 : 1;
+}
@@ -0,0 +1,160 @@
+#include "network/net/EventLoop.h"       // 事件循环
+#include "network/net/EventLoopThread.h" // 单个事件循环线程
+#include "network/net/TcpConnection.h"   // TCP 连接
+#include "network/net/OutputChain.h"     // 输出分片队列
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <list>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace tmms::network;
+
+// 输出分片队列测试：
+// 1. OutputChain 单独测试：小块拷贝合并进头部块、写出后释放所有者、字节数正确。
+// 2. 连接上连续排入多批数据而不等写完成：每批的协议头都写进同一个复用的栈缓冲区，包体带所有者，
+//    总分片数远超 IOV_MAX，对端收到的字节流必须和发送顺序一致，所有者全部释放。
+// Output chain test:
+// 1. OutputChain on its own: small copies merge into a header block, owners are released once
+//    written, byte counts add up.
+// 2. Many batches queued on a connection without waiting for write-complete: every batch's
+//    headers are written into the same reused stack buffer and bodies carry owners; the total
+//    slice count is far above IOV_MAX, the peer must see the bytes in send order, and every owner
+//    must be released.
+
+namespace
+{
+    const int kBatches = 200;
+    const int kFramesPerBatch = 10;
+    const size_t kBodySize = 1000;
+
+    bool TestChain()
+    {
+        OutputChain chain;
+        auto body = std::make_shared<std::string>(5000, 'b');
+        std::weak_ptr<std::string> watch = body;
+        chain.AppendCopy("abc", 3);
+        chain.AppendCopy("def", 3);       // 和上一段在同一个头部块里，合并 (merges with the previous copy)
+        chain.Append(body->data(), body->size(), body);
+        chain.AppendCopy("ghi", 3);
+        body.reset();
+        bool ok = chain.Count() == 3 && chain.Bytes() == 5009 && chain.Iovec(0).iov_len == 6;
+
+        chain.Consume(4);                 // 写出一部分 (partial write)
+        ok = ok && chain.Count() == 3 && chain.Bytes() == 5005 && chain.Iovec(0).iov_len == 2;
+        chain.Consume(2 + 5000);
+        ok = ok && chain.Count() == 1 && watch.expired();
+        chain.Consume(3);
+        ok = ok && chain.Empty() && chain.Bytes() == 0;
+        std::cout << "chain: " << (ok ? "ok" : "failed") << std::endl;
+        return ok;
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    bool ok = TestChain();
+
+    int fds[2];
+    ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+    EventLoopThread eventloop_thread;
+    eventloop_thread.Run();
+    EventLoop *loop = eventloop_thread.Loop();
+
+    // 期望的字节流 (expected byte stream)
+    std::string expected;
+    std::vector<std::weak_ptr<std::string>> watchers;
+    std::atomic<bool> queued{false};
+    size_t queued_bytes = 0;
+    TcpConnectionPtr conn;
+    loop->RunInLoop([&](){
+        conn = std::make_shared<TcpConnection>(loop, fds[0], InetAddress(), InetAddress());
+        loop->AddEvent(conn);
+        char headers[kFramesPerBatch * 16];  // 每批复用的协议头缓冲区 (header buffer reused by every batch)
+        for(int b = 0; b < kBatches; b++)
+        {
+            std::list<BufferNodePtr> list;
+            char *p = headers;
+            for(int f = 0; f < kFramesPerBatch; f++)
+            {
+                int n = snprintf(p, 16, "[%d:%d]", b, f);
+                list.emplace_back(std::make_shared<BufferNode>((void *)p, n));
+                expected.append(p, n);
+                p += n;
+
+                auto body = std::make_shared<std::string>(kBodySize, (char)('a' + (b + f) % 26));
+                watchers.push_back(body);
+                list.emplace_back(std::make_shared<BufferNode>((void *)body->data(), body->size(), body));
+                expected.append(*body);
+            }
+            conn->Send(list);
+            // 不等写完成就覆盖缓冲区，再用 Send(buf,size) 发一个批尾 (overwrite without waiting for write-complete, then a trailer)
+            memset(headers, 'x', sizeof(headers));
+            int n = snprintf(headers, 16, "<%d>", b);
+            conn->Send(headers, n);
+            expected.append(headers, n);
+        }
+        queued_bytes = conn->PendingBytes();
+        queued = true;
+    });
+    while(!queued)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    std::string received;
+    char buf[64 * 1024];
+    int64_t deadline = 0;
+    while(received.size() < expected.size() && deadline++ < 5000)
+    {
+        ssize_t n = ::read(fds[1], buf, sizeof(buf));
+        if(n > 0)
+        {
+            received.append(buf, n);
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    size_t alive = 0;
+    for(auto &w : watchers)
+    {
+        if(!w.expired())
+        {
+            alive++;
+        }
+    }
+    std::atomic<bool> done{false};
+    size_t pending = 0;
+    loop->RunInLoop([&](){
+        pending = conn->PendingBytes();
+        conn->ForceClose();
+        loop->DelEvent(conn);
+        conn.reset();
+        done = true;
+    });
+    while(!done)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ::close(fds[1]);
+
+    bool stream_ok = received == expected && pending == 0 && alive == 0;
+    std::cout << "connection: queued bytes:" << queued_bytes
+              << " received:" << received.size() << "/" << expected.size()
+              << " in order:" << (received == expected)
+              << " pending:" << pending
+              << " owners alive:" << alive
+              << (stream_ok ? " ok" : " failed") << std::endl;
+    ok = ok && stream_ok;
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+#include "network/net/EventLoop.h"       // 事件循环
+#include "network/net/EventLoopThread.h" // 单个事件循环线程
+#include "network/net/TcpConnection.h"   // TCP 连接
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <list>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace tmms::network;
+
+// 输出队列上限测试：对端一直不读，不断往连接里发 64KB 的块。没有上限时输出队列无限增长；
+// 设置上限后 PendingBytes 超过上限的那次发送会关闭连接。
+// Output queue cap test: the peer never reads while 64KB chunks keep being sent. Without a cap the
+// output queue grows without bound; with one, the send that takes PendingBytes over it closes
+// the connection.
+
+namespace
+{
+    const size_t kChunkSize = 64 * 1024;
+    const size_t kLimit = 1024 * 1024;
+
+    bool RunCase(EventLoop *loop, size_t limit, int rounds, size_t &pending)
+    {
+        int fds[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds);
+        auto chunk = std::make_shared<std::string>(kChunkSize, 'x');
+
+        std::atomic<bool> closed{false};
+        std::atomic<bool> done{false};
+        bool closed_by_limit = false;
+        TcpConnectionPtr conn;
+        loop->RunInLoop([&](){
+            conn = std::make_shared<TcpConnection>(loop, fds[0], InetAddress(), InetAddress());
+            conn->SetCloseCallback([&](const TcpConnectionPtr &){
+                closed = true;
+            });
+            conn->SetMaxPendingBytes(limit);
+            loop->AddEvent(conn);
+            for(int i = 0; i < rounds && !closed; i++)
+            {
+                std::list<BufferNodePtr> list;
+                list.emplace_back(std::make_shared<BufferNode>((void *)chunk->data(), chunk->size(), chunk));
+                conn->Send(list);
+            }
+            pending = conn->PendingBytes();
+            closed_by_limit = closed.load();
+            conn->ForceClose();  // 析构前先关闭，close 回调里还能拿到 shared_ptr
+            loop->DelEvent(conn);
+            conn.reset();
+            done = true;
+        });
+        while(!done)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ::close(fds[1]);
+        return closed_by_limit;
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    EventLoopThread eventloop_thread;
+    eventloop_thread.Run();
+    EventLoop *loop = eventloop_thread.Loop();
+
+    size_t pending = 0;
+    bool closed = RunCase(loop, 0, 64, pending);
+    std::cout << "no limit: closed:" << closed << " pending:" << pending << std::endl;
+    bool ok = !closed && pending > kLimit;
+
+    closed = RunCase(loop, kLimit, 64, pending);
+    std::cout << "limit " << kLimit << ": closed:" << closed << " pending:" << pending << std::endl;
+    ok = ok && closed && pending <= kLimit + kChunkSize;
+
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,246 @@
+#include "network/net/Connection.h"
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <algorithm>
+
+using namespace tmms::network;
+
+// 播放者发送路径基准测试：一个循环上的很多播放者，每次激活的固定开销。
+// 每次激活走一遍直播的发送路径：Connection::Active 回调拿到连接，LiveService::OnActive 从连接取出用户，
+// PlayerUser::PostFrames 把自己交给 Stream::GetFrames，PushFrames 取协议上下文发一批帧，
+// 写完成回调再取一次上下文。
+// 旧路径：上下文放在 unordered_map 里，每次查哈希表、拷贝 shared_ptr，PostFrames 和回调里做 dynamic_pointer_cast。
+// 新路径：上下文按类型放在固定的槽里，协议上下文由播放者缓存，PostFrames 直接传 this，回调用 static_pointer_cast。
+// 两条路径都用同样的类层次和同样的连接对象，只有取上下文和类型转换的方式不同。每项取几轮里最好的一次。
+// Player send path benchmark: the fixed cost of one activation for many players on one loop.
+// Every activation walks the live send path: the Connection::Active callback gets the connection,
+// LiveService::OnActive takes the user out of it, PlayerUser::PostFrames hands itself to
+// Stream::GetFrames, PushFrames fetches the protocol context to send a batch, and the write-complete
+// callback fetches the context once more.
+// Old path: contexts in an unordered_map, a hash lookup and a shared_ptr copy each time, and
+// dynamic_pointer_cast in PostFrames and the callbacks.
+// New path: contexts in fixed per-type slots, the protocol context cached by the player, PostFrames
+// passing this, and static_pointer_cast in the callbacks.
+// Both paths use the same class hierarchy and the same connection objects; only the context lookups
+// and casts differ. Each figure is the best of a few rounds.
+
+namespace
+{
+    const int kPlayers = 2000;
+    const int kActivations = 200;
+    const int kRounds = 5;
+
+    struct ProtocolContext
+    {
+        uint64_t frames{0};
+    };
+
+    class User : public std::enable_shared_from_this<User>
+    {
+    public:
+        virtual ~User() = default;
+        virtual int UserType() const
+        {
+            return 7;
+        }
+        ConnectionPtr connection;
+    };
+
+    class PlayerUser : public User
+    {
+    public:
+        virtual bool PostFrames() = 0;
+        uint64_t out_index{0};
+    };
+
+    // 和 TcpConnection 一样在 Connection 下面再派生一层 (one level below Connection, like TcpConnection)
+    class BenchConnection : public Connection
+    {
+    public:
+        BenchConnection()
+        : Connection(nullptr, -1, InetAddress(), InetAddress())
+        {
+        }
+        void ForceClose() override
+        {
+        }
+        // 旧的上下文哈希表 (the old context hash map)
+        template <typename T>
+        std::shared_ptr<T> OldContext(int type) const
+        {
+            auto iter = old_contexts.find(type);
+            if(iter != old_contexts.end())
+            {
+                return std::static_pointer_cast<T>(iter->second);
+            }
+            return std::shared_ptr<T>();
+        }
+        std::unordered_map<int, ContextPtr> old_contexts;
+    };
+
+    // 代表 Stream::GetFrames，不内联 (stands in for Stream::GetFrames; kept out of line)
+    __attribute__((noinline)) void OldGetFrames(const std::shared_ptr<PlayerUser> &user)
+    {
+        user->out_index += 10;
+    }
+    __attribute__((noinline)) void NewGetFrames(PlayerUser *user)
+    {
+        user->out_index += 10;
+    }
+
+    class OldPlayer : public PlayerUser
+    {
+    public:
+        bool PostFrames() override
+        {
+            OldGetFrames(std::dynamic_pointer_cast<PlayerUser>(shared_from_this()));
+            auto conn = std::static_pointer_cast<BenchConnection>(connection);
+            auto cx = conn->OldContext<ProtocolContext>(kFlvContext);
+            if(!cx)
+            {
+                return false;
+            }
+            cx->frames += 10;
+            return true;
+        }
+    };
+
+    class NewPlayer : public PlayerUser
+    {
+    public:
+        bool PostFrames() override
+        {
+            NewGetFrames(this);
+            if(!context_)
+            {
+                context_ = connection->GetContext<ProtocolContext>(kFlvContext);
+            }
+            if(!context_)
+            {
+                return false;
+            }
+            context_->frames += 10;
+            return true;
+        }
+    private:
+        std::shared_ptr<ProtocolContext> context_;
+    };
+
+    __attribute__((noinline)) void OldActivate(BenchConnection *c)
+    {
+        ConnectionPtr conn = std::dynamic_pointer_cast<Connection>(c->shared_from_this());
+        // LiveService::OnActive
+        auto user = std::static_pointer_cast<BenchConnection>(conn)->OldContext<PlayerUser>(kUserContext);
+        if(user && user->UserType() >= 4)
+        {
+            user->PostFrames();
+        }
+        // 写完成回调 (write-complete callback)
+        auto tcp = std::dynamic_pointer_cast<BenchConnection>(c->shared_from_this());
+        auto http = tcp->OldContext<ProtocolContext>(kHttpContext);
+        auto flv = tcp->OldContext<ProtocolContext>(kFlvContext);
+        if(http && flv)
+        {
+            flv->frames++;
+        }
+    }
+
+    __attribute__((noinline)) void NewActivate(BenchConnection *c)
+    {
+        ConnectionPtr conn = std::static_pointer_cast<Connection>(c->shared_from_this());
+        auto user = conn->GetContext<PlayerUser>(kUserContext);
+        if(user && user->UserType() >= 4)
+        {
+            user->PostFrames();
+        }
+        auto tcp = std::static_pointer_cast<BenchConnection>(c->shared_from_this());
+        auto http = tcp->GetContext<ProtocolContext>(kHttpContext);
+        auto flv = tcp->GetContext<ProtocolContext>(kFlvContext);
+        if(http && flv)
+        {
+            flv->frames++;
+        }
+    }
+
+    // 像 FLV 播放连接一样放三个上下文 (three contexts, like an FLV player connection)
+    template <typename Player>
+    std::vector<std::shared_ptr<BenchConnection>> MakePlayers()
+    {
+        std::vector<std::shared_ptr<BenchConnection>> conns;
+        for(int i = 0; i < kPlayers; i++)
+        {
+            auto conn = std::make_shared<BenchConnection>();
+            auto user = std::make_shared<Player>();
+            user->connection = conn;
+            std::shared_ptr<User> base = user;
+            auto http = std::make_shared<ProtocolContext>();
+            auto flv = std::make_shared<ProtocolContext>();
+            conn->old_contexts[kHttpContext] = http;
+            conn->old_contexts[kUserContext] = base;
+            conn->old_contexts[kFlvContext] = flv;
+            conn->SetContext(kHttpContext, http);
+            conn->SetContext(kUserContext, base);
+            conn->SetContext(kFlvContext, flv);
+            conns.emplace_back(conn);
+        }
+        return conns;
+    }
+
+    template <typename F>
+    double Run(std::vector<std::shared_ptr<BenchConnection>> &conns, F activate)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for(int a = 0; a < kActivations; a++)
+        {
+            for(auto &c : conns)
+            {
+                activate(c.get());
+            }
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        return ns / ((double)kActivations * conns.size());
+    }
+
+    uint64_t Frames(std::vector<std::shared_ptr<BenchConnection>> &conns)
+    {
+        uint64_t frames = 0;
+        for(auto &c : conns)
+        {
+            frames += c->GetContext<ProtocolContext>(kFlvContext)->frames;
+        }
+        return frames;
+    }
+
+    void Release(std::vector<std::shared_ptr<BenchConnection>> &conns)
+    {
+        // 连接和用户互相引用，和 OnConnectionDestroy 一样先清上下文 (connections and users refer to each other; clear contexts like OnConnectionDestroy)
+        for(auto &c : conns)
+        {
+            c->ClearContext();
+            c->old_contexts.clear();
+        }
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    auto old_conns = MakePlayers<OldPlayer>();
+    auto new_conns = MakePlayers<NewPlayer>();
+    double old_ns = 1e18, new_ns = 1e18;
+    for(int r = 0; r < kRounds; r++)
+    {
+        old_ns = std::min(old_ns, Run(old_conns, OldActivate));
+        new_ns = std::min(new_ns, Run(new_conns, NewActivate));
+    }
+    bool ok = Frames(old_conns) == Frames(new_conns)
+            && Frames(new_conns) == (uint64_t)kRounds * kActivations * kPlayers * 11;
+    std::cout << "players:" << kPlayers << " hash map + dynamic_pointer_cast: " << old_ns
+              << " ns, slots + cached context: " << new_ns << " ns per activation" << std::endl;
+    Release(old_conns);
+    Release(new_conns);
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+#include "network/net/EventLoop.h"       // 事件循环
+#include "network/net/EventLoopThread.h" // 单个事件循环线程
+#include "network/net/TcpConnection.h"   // TCP 连接
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <limits>
+#include <vector>
+#include <algorithm>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <ctime>
+
+using namespace tmms::network;
+
+// 读预算公平性测试：同一个循环上一个连接被持续灌数据（处理速度跟不上），
+// 另一个连接每毫秒收一个时间戳，统计它的收包延迟。不限预算时灌数据的连接一直读不到 EAGAIN，
+// 另一个连接会被饿死；有预算时每轮都会轮到它。有预算时丢了探测包或者探测延迟的 p99 超过 kMaxP99Us 算失败。
+// Read budget fairness: on one loop, a connection is flooded faster than it can process while
+// another receives a timestamp every millisecond and records its delivery latency. Without a
+// budget the flooded connection never reaches EAGAIN and starves the other; with one, every
+// iteration gives the other connection its turn. The budgeted cases fail when a probe goes
+// missing or the probe's p99 latency goes above kMaxP99Us.
+
+namespace
+{
+    // 有预算时探测延迟 p99 的上限，留够单核机器上线程调度的余量
+    // Bound on the probe's p99 latency with a budget, leaving room for scheduling on a single core.
+    const int64_t kMaxP99Us = 5000;
+
+    int64_t NowUs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    }
+
+    bool RunCase(EventLoop *loop, size_t budget, const char *name, bool check)
+    {
+        int flood[2], probe[2];
+        ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, flood);
+        ::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, probe);
+
+        std::atomic<int64_t> max_latency{0}, total_latency{0}, samples{0};
+        std::vector<int64_t> latencies;   // 只在循环线程里写 (written on the loop thread only)
+        TcpConnectionPtr flood_conn, probe_conn;
+        loop->RunInLoop([&](){
+            flood_conn = std::make_shared<TcpConnection>(loop, flood[0], InetAddress(), InetAddress());
+            probe_conn = std::make_shared<TcpConnection>(loop, probe[0], InetAddress(), InetAddress());
+            flood_conn->SetReadBudget(budget);
+            flood_conn->SetRecvMsgCallback([](const TcpConnectionPtr &, MsgBuffer &buf){
+                // 模拟解析开销，让读的速度跟不上写 (simulated parsing cost so reads fall behind writes)
+                volatile uint32_t sum = 0;
+                for(size_t i = 0; i < buf.ReadableBytes(); i += 4)
+                {
+                    sum += (uint8_t)buf.Peek()[i];
+                }
+                buf.RetrieveAll();
+            });
+            probe_conn->SetRecvMsgCallback([&](const TcpConnectionPtr &, MsgBuffer &buf){
+                int64_t now = NowUs();
+                while(buf.ReadableBytes() >= sizeof(int64_t))
+                {
+                    int64_t sent = 0;
+                    memcpy(&sent, buf.Peek(), sizeof(sent));
+                    buf.Retrieve(sizeof(sent));
+                    int64_t latency = now - sent;
+                    total_latency += latency;
+                    samples++;
+                    latencies.push_back(latency);
+                    if(latency > max_latency)
+                    {
+                        max_latency = latency;
+                    }
+                }
+            });
+            loop->AddEvent(flood_conn);
+            loop->AddEvent(probe_conn);
+        });
+
+        uint64_t yields_before = loop->ReadYields();
+        uint64_t iterations_before = loop->Iterations();
+        std::atomic<bool> running{true};
+        std::thread writer([&](){
+            static char chunk[64 * 1024] = {0,};
+            while(running)
+            {
+                if(::write(flood[1], chunk, sizeof(chunk)) < 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        int64_t end = NowUs() + 1000000;
+        int sent = 0;
+        while(NowUs() < end)
+        {
+            int64_t now = NowUs();
+            ::write(probe[1], &now, sizeof(now));
+            sent++;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        running = false;
+        writer.join();
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        std::atomic<bool> closed{false};
+        loop->RunInLoop([&](){
+            loop->DelEvent(flood_conn);
+            loop->DelEvent(probe_conn);
+            flood_conn.reset();
+            probe_conn.reset();
+            closed = true;
+        });
+        while(!closed)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ::close(flood[1]);
+        ::close(probe[1]);
+
+        int64_t n = samples.load();
+        std::sort(latencies.begin(), latencies.end());
+        int64_t p99 = latencies.empty() ? 0 : latencies[latencies.size() * 99 / 100];
+        uint64_t yields = loop->ReadYields() - yields_before;
+        // 预算要真的起作用过（让出过），不然这一轮没有测到公平性 (the budget must have kicked in, or fairness went untested)
+        bool ok = !check || (n == sent && p99 <= kMaxP99Us && yields > 0);
+        std::cout << name << ": probes sent " << sent << " received " << n
+                  << " avg latency " << (n > 0 ? total_latency / n : 0) << "us"
+                  << " p99 latency " << p99 << "us"
+                  << " max latency " << max_latency << "us"
+                  << " loop iterations " << loop->Iterations() - iterations_before
+                  << " read yields " << yields
+                  << (check ? (ok ? " ok" : " failed") : "") << std::endl;
+        return ok;
+    }
+}
+
+int main(int argc, const char **argv)
+{
+    EventLoopThread eventloop_thread;
+    eventloop_thread.Run();
+    EventLoop *loop = eventloop_thread.Loop();
+
+    // 不限预算只是对照，饿死的程度取决于核数，不检查 (no budget is the baseline; how badly it starves depends on the core count, so it is not checked)
+    RunCase(loop, std::numeric_limits<size_t>::max(), "before (read until EAGAIN)", false);
+    bool ok = RunCase(loop, kDefaultReadBudget, "after (128KB read budget)", true);
+
+    loop->SetBusyPoll(50);
+    ok = RunCase(loop, kDefaultReadBudget, "after + 50us busy poll", true) && ok;
+    std::cout << "busy poll hits:" << loop->SpinHits() << std::endl;
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}
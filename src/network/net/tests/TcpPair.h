@@ -0,0 +1,50 @@
+#pragma once
+// 防止头文件被重复包含
+// Prevents this header file from being included multiple times.
+
+#include <cstring>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+namespace tmms
+{
+    namespace network
+    {
+        namespace test
+        {
+            // 建一对回环 TCP 连接：fds[0] 是接受端（非阻塞），fds[1] 是连接端（阻塞）。
+            // 需要真正 TCP 的测试用它（套接字选项、零拷贝、io_uring 的 recv），其他测试用 socketpair。
+            // Makes a loopback TCP pair: fds[0] is the accepted end (non-blocking), fds[1] the
+            // connecting end (blocking). For tests that need real TCP (socket options, zero copy,
+            // io_uring recv); the rest use socketpair.
+            inline bool TcpPair(int fds[2])
+            {
+                int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+                struct sockaddr_in addr;
+                memset(&addr, 0, sizeof(addr));
+                addr.sin_family = AF_INET;
+                addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                socklen_t len = sizeof(addr);
+                if(::bind(listener, (struct sockaddr *)&addr, sizeof(addr)) < 0
+                    || ::listen(listener, 1) < 0
+                    || ::getsockname(listener, (struct sockaddr *)&addr, &len) < 0)
+                {
+                    ::close(listener);
+                    return false;
+                }
+                fds[1] = ::socket(AF_INET, SOCK_STREAM, 0);
+                if(::connect(fds[1], (struct sockaddr *)&addr, sizeof(addr)) < 0)
+                {
+                    ::close(fds[1]);
+                    ::close(listener);
+                    return false;
+                }
+                fds[0] = ::accept4(listener, nullptr, nullptr, SOCK_NONBLOCK);
+                ::close(listener);
+                return fds[0] >= 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#include "network/net/EventLoop.h"       // 事件循环
+#include "network/net/EventLoopThread.h" // 单个事件循环线程
+#include "network/net/TcpConnection.h"   // TCP 连接
+#include "TcpPair.h"                     // 回环 TCP 连接对 (loopback TCP pair)
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <list>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+using namespace tmms::network;
+
+// 零拷贝发送测试：在回环 TCP 连接上开启 MSG_ZEROCOPY，发送一批带 holder 的大块数据，
+// 检查对端收到的数据完整有序、完成通知到达后 holder 全部释放。回环上内核总是拷贝，
+// 所以还会看到连续 COPIED 通知之后连接自动退回普通发送。
+// Zero-copy send test: turn MSG_ZEROCOPY on for a loopback TCP connection, send a batch of large
+// chunks that carry holders, and check the peer receives them intact and in order and every holder
+// is released once the completions arrive. Loopback always copies, so the connection is also
+// expected to fall back to plain sends after a streak of COPIED completions.
+
+namespace
+{
+    const size_t kChunkSize = 64 * 1024;
+    const int kChunks = 64;
+}
+
+int main(int argc, const char **argv)
+{
+    int fds[2];
+    if(!test::TcpPair(fds))
+    {
+        std::cout << "create loopback tcp pair failed." << std::endl;
+        return 1;
+    }
+
+    EventLoopThread eventloop_thread;
+    eventloop_thread.Run();
+    EventLoop *loop = eventloop_thread.Loop();
+
+    // 每块用块号填充，接收端按顺序校验 (every chunk is filled with its index, checked in order by the reader)
+    std::vector<std::weak_ptr<std::string>> watchers;
+    std::list<BufferNodePtr> list;
+    for(int i = 0; i < kChunks; i++)
+    {
+        auto chunk = std::make_shared<std::string>(kChunkSize, (char)i);
+        watchers.push_back(chunk);
+        list.emplace_back(std::make_shared<BufferNode>((void *)chunk->data(), chunk->size(), chunk));
+    }
+
+    std::atomic<bool> enabled{false};
+    TcpConnectionPtr conn;
+    loop->RunInLoop([&](){
+        conn = std::make_shared<TcpConnection>(loop, fds[0], InetAddress(), InetAddress());
+        loop->AddEvent(conn);
+        enabled = conn->EnableZeroCopy(16 * 1024);
+        conn->Send(list);
+    });
+
+    size_t received = 0;
+    bool intact = true;
+    std::vector<char> buf(kChunkSize);
+    while(received < kChunkSize * kChunks)
+    {
+        ssize_t n = ::read(fds[1], buf.data(), buf.size());
+        if(n <= 0)
+        {
+            break;
+        }
+        for(ssize_t i = 0; i < n; i++)
+        {
+            if(buf[i] != (char)((received + i) / kChunkSize))
+            {
+                intact = false;
+            }
+        }
+        received += n;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    list.clear();
+
+    size_t alive = 0;
+    for(auto &w : watchers)
+    {
+        if(!w.expired())
+        {
+            alive++;
+        }
+    }
+
+    std::atomic<bool> done{false};
+    uint64_t sends = 0, copied = 0;
+    size_t pending = 0;
+    bool still_enabled = false;
+    loop->RunInLoop([&](){
+        sends = conn->ZeroCopySends();
+        copied = conn->ZeroCopyCopied();
+        pending = conn->ZeroCopyPending();
+        still_enabled = conn->ZeroCopyEnabled();
+        loop->DelEvent(conn);
+        conn.reset();
+        done = true;
+    });
+    while(!done)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    ::close(fds[1]);
+
+    std::cout << "zerocopy enabled:" << enabled
+              << " received:" << received << "/" << kChunkSize * kChunks
+              << " intact:" << intact
+              << " zerocopy sends:" << sends
+              << " copied:" << copied
+              << " pending:" << pending
+              << " holders alive:" << alive
+              << " still enabled:" << still_enabled << std::endl;
+
+    bool ok = received == kChunkSize * kChunks && intact && pending == 0 && alive == 0;
+    if(enabled)
+    {
+        // 回环总是拷贝：连续 COPIED 之后应已退回普通发送 (loopback always copies, so the fallback must have kicked in)
+        ok = ok && sends > 0 && (copied < kZeroCopyCopiedLimit || !still_enabled);
+    }
+    std::cout << (ok ? "ok" : "failed") << std::endl;
+    return ok ? 0 : 1;
+}